@@ -36,10 +36,18 @@ template < class T, class COMPARE >
 void ShellSort( T * begin, T * end, const COMPARE & compare )
 {
     size_t numItems = end - begin;
-    size_t increment = 3;
+
+    // gaps from Knuth's sequence (1, 4, 13, 40, ...), to avoid quadratic
+    // behaviour with large arrays
+    size_t increment = 1;
+    while ( increment < ( numItems / 3 ) )
+    {
+        increment = ( increment * 3 ) + 1;
+    }
+
     while ( increment > 0 )
     {
-        for ( size_t i=0; i < numItems; i++ )
+        for ( size_t i=increment; i < numItems; i++ )
         {
             size_t j = i;
             T temp( begin[ i ] );
@@ -50,18 +58,7 @@ void ShellSort( T * begin, T * end, const COMPARE & compare )
             }
             begin[ j ] = temp;
         }
-        if ( increment / 2 != 0 )
-        {
-            increment = increment / 2 ;
-        }
-        else if ( increment == 1 )
-        {
-            increment = 0;
-        }
-        else
-        {
-            increment = 1;
-        }
+        increment = increment / 3;
     }
 }
 
@@ -21,7 +21,9 @@ int main(int , char * [])
     REGISTER_TESTGROUP( TestLevenshteinDistance )
     REGISTER_TESTGROUP( TestMemPoolBlock )
     REGISTER_TESTGROUP( TestMutex )
+    REGISTER_TESTGROUP( TestPathMatcher )
     REGISTER_TESTGROUP( TestPathUtils )
+    REGISTER_TESTGROUP( TestProcess )
     REGISTER_TESTGROUP( TestReflection )
     REGISTER_TESTGROUP( TestSemaphore )
     REGISTER_TESTGROUP( TestSharedMemory )
@@ -18,6 +18,7 @@ private:
 
     void GetCommandLine() const;
     void GetExePath() const;
+    void GetMemoryInfo() const;
 };
 
 // Register Tests
@@ -25,6 +26,7 @@ private:
 REGISTER_TESTS_BEGIN( TestEnv )
     REGISTER_TEST( GetCommandLine )
     REGISTER_TEST( GetExePath )
+    REGISTER_TEST( GetMemoryInfo )
 REGISTER_TESTS_END
 
 // GetCommandLine
@@ -49,4 +51,15 @@ void TestEnv::GetExePath() const
     #endif
 }
 
+// GetMemoryInfo
+//------------------------------------------------------------------------------
+void TestEnv::GetMemoryInfo() const
+{
+    uint64_t totalBytes = 0;
+    uint64_t availableBytes = 0;
+    TEST_ASSERT( Env::GetMemoryInfo( totalBytes, availableBytes ) );
+    TEST_ASSERT( totalBytes > 0 );
+    TEST_ASSERT( availableBytes <= totalBytes );
+}
+
 //------------------------------------------------------------------------------
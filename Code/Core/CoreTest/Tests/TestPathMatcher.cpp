@@ -0,0 +1,271 @@
+// TestPathMatcher.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/UnitTest.h"
+
+#include "Core/FileIO/PathMatcher.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Random.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// TestPathMatcher
+//------------------------------------------------------------------------------
+class TestPathMatcher : public UnitTest
+{
+private:
+    DECLARE_TESTS
+
+    void PathPrefixes() const;
+    void FileNames() const;
+    void Wildcards() const;
+    void Wildcards_Exhaustive() const;
+    void CompareMatchTimes() const;
+
+    static void GetStrings( const char * alphabet, size_t maxLength, Array< AString > & outStrings );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestPathMatcher )
+    REGISTER_TEST( PathPrefixes )
+    REGISTER_TEST( FileNames )
+    REGISTER_TEST( Wildcards )
+    REGISTER_TEST( Wildcards_Exhaustive )
+    REGISTER_TEST( CompareMatchTimes )
+REGISTER_TESTS_END
+
+// NativePath - paths in the tests use forward slashes
+//------------------------------------------------------------------------------
+class NativePath : public AStackString<>
+{
+public:
+    explicit NativePath( const char * path ) : AStackString<>( path ) { Replace( FORWARD_SLASH, NATIVE_SLASH ); }
+};
+
+// PathPrefixes
+//------------------------------------------------------------------------------
+void TestPathMatcher::PathPrefixes() const
+{
+    PathMatcher matcher;
+    TEST_ASSERT( matcher.MatchesPathPrefix( NativePath( "/folder/" ) ) == false );
+
+    matcher.AddPathPrefix( NativePath( "/folder/sub/" ) );
+    matcher.AddPathPrefix( NativePath( "/other/" ) );
+
+    #define DOCHECK( path, expectedResult ) \
+        TEST_ASSERT( matcher.MatchesPathPrefix( NativePath( path ) ) == expectedResult );
+
+    DOCHECK( "/folder/sub/", true )
+    DOCHECK( "/folder/sub/deeper/", true )
+    DOCHECK( "/other/file.cpp", true )
+    DOCHECK( "/folder/", false )
+    DOCHECK( "/folder/subfolder/", false )
+    DOCHECK( "/folder/su", false )
+    DOCHECK( "", false )
+    #if defined( __LINUX__ )
+        // Case sensitive
+        DOCHECK( "/Other/", false )
+    #else
+        DOCHECK( "/Other/", true )
+    #endif
+
+    #undef DOCHECK
+}
+
+// FileNames
+//------------------------------------------------------------------------------
+void TestPathMatcher::FileNames() const
+{
+    PathMatcher matcher;
+    matcher.AddFileName( NativePath( "file.cpp" ) );
+    matcher.AddFileName( NativePath( "sub/other.cpp" ) );
+
+    #define DOCHECK( path, expectedResult ) \
+        TEST_ASSERT( matcher.MatchesFileName( NativePath( path ) ) == expectedResult );
+
+    DOCHECK( "file.cpp", true )
+    DOCHECK( "/folder/file.cpp", true )
+    DOCHECK( "/folder/anotherfile.cpp", false )
+    DOCHECK( "/folder/file.cpp.bak", false )
+    DOCHECK( "/folder/sub/other.cpp", true )
+    DOCHECK( "/folder/other.cpp", false )
+    DOCHECK( "/folder/nosub/other.cpp", false )
+    #if defined( __LINUX__ )
+        // Case sensitive
+        DOCHECK( "/FILE.cpp", false )
+    #else
+        DOCHECK( "/FILE.cpp", true )
+    #endif
+
+    #undef DOCHECK
+}
+
+// Wildcards
+//------------------------------------------------------------------------------
+void TestPathMatcher::Wildcards() const
+{
+    PathMatcher matcher;
+    TEST_ASSERT( matcher.MatchesWildcard( NativePath( "file.cpp" ) ) == false );
+
+    matcher.AddWildcard( NativePath( "*.inl" ) );
+    matcher.AddWildcard( NativePath( "*/Test*.cpp" ) );
+    matcher.AddWildcard( NativePath( "*/gen_??.cpp" ) );
+
+    #define DOCHECK( path, expectedResult ) \
+        TEST_ASSERT( matcher.MatchesWildcard( NativePath( path ) ) == expectedResult );
+
+    DOCHECK( "/folder/file.inl", true )
+    DOCHECK( "/folder/file.inl.cpp", false )
+    DOCHECK( "/folder/TestFile.cpp", true )
+    DOCHECK( "/folder/Test.cpp", true )
+    DOCHECK( "/folder/File.cpp", false )
+    DOCHECK( "/folder/gen_01.cpp", true )
+    DOCHECK( "/folder/gen_1.cpp", false )
+    DOCHECK( "/folder/gen_.1.cpp", false ) // '?' doesn't match '.'
+
+    #undef DOCHECK
+}
+
+// Wildcards_Exhaustive
+//------------------------------------------------------------------------------
+void TestPathMatcher::Wildcards_Exhaustive() const
+{
+    // Check every short pattern against every short path, individually and
+    // combined, against the existing wildcard matching
+    Array< AString > patterns( 1024, true );
+    GetStrings( "a*?.", 4, patterns );
+    Array< AString > paths( 1024, true );
+    GetStrings( "ab./", 5, paths );
+
+    PathMatcher combined;
+    for ( size_t i = 0; i < patterns.GetSize(); ++i )
+    {
+        PathMatcher matcher;
+        matcher.AddWildcard( patterns[ i ] );
+        if ( ( i % 7 ) == 0 )
+        {
+            combined.AddWildcard( patterns[ i ] );
+        }
+        for ( const AString & path : paths )
+        {
+            const bool expected = PathUtils::IsWildcardMatch( patterns[ i ].Get(), path.Get() );
+            TEST_ASSERT( matcher.MatchesWildcard( path ) == expected );
+        }
+    }
+    for ( const AString & path : paths )
+    {
+        bool expected = false;
+        for ( size_t i = 0; i < patterns.GetSize(); i += 7 )
+        {
+            expected = expected || PathUtils::IsWildcardMatch( patterns[ i ].Get(), path.Get() );
+        }
+        TEST_ASSERT( combined.MatchesWildcard( path ) == expected );
+    }
+}
+
+// CompareMatchTimes
+//------------------------------------------------------------------------------
+void TestPathMatcher::CompareMatchTimes() const
+{
+    // Many exclusions checked against many paths, as for a large directory
+    // tree with long exclusion lists
+    const size_t numExclusions = 1000;
+    const size_t numPaths = 10000;
+    Random r( 0x12345678 );
+
+    Array< AString > excludePaths( numExclusions, false );
+    Array< AString > excludeFiles( numExclusions, false );
+    Array< AString > excludePatterns( numExclusions, false );
+    PathMatcher matcher;
+    AStackString<> tmp;
+    for ( size_t i = 0; i < numExclusions; ++i )
+    {
+        tmp.Format( "%cCode%cModule%u%cSub%u%c", NATIVE_SLASH, NATIVE_SLASH, r.GetRandIndex( 200 ), NATIVE_SLASH, r.GetRandIndex( 100 ), NATIVE_SLASH );
+        excludePaths.Append( tmp );
+        matcher.AddPathPrefix( tmp );
+        tmp.Format( "File%u.cpp", r.GetRandIndex( 50000 ) );
+        excludeFiles.Append( tmp );
+        matcher.AddFileName( tmp );
+        tmp.Format( "*%cGenerated%u*.cpp", NATIVE_SLASH, r.GetRandIndex( 50000 ) );
+        excludePatterns.Append( tmp );
+        matcher.AddWildcard( tmp );
+    }
+    Array< AString > paths( numPaths, false );
+    for ( size_t i = 0; i < numPaths; ++i )
+    {
+        const bool generated = ( r.GetRandIndex( 4 ) == 0 );
+        tmp.Format( "%cCode%cModule%u%cSub%u%c%s%u.cpp", NATIVE_SLASH, NATIVE_SLASH, r.GetRandIndex( 200 ), NATIVE_SLASH, r.GetRandIndex( 100 ), NATIVE_SLASH,
+                    generated ? "Generated" : "File", r.GetRandIndex( 50000 ) );
+        paths.Append( tmp );
+    }
+
+    // existing checks, one exclusion at a time
+    uint32_t numMatchesLoop = 0;
+    Timer t1;
+    for ( const AString & path : paths )
+    {
+        bool excluded = false;
+        for ( const AString & excludePath : excludePaths )
+        {
+            excluded = excluded || PathUtils::PathBeginsWith( path, excludePath );
+        }
+        for ( const AString & excludeFile : excludeFiles )
+        {
+            excluded = excluded || PathUtils::PathEndsWithFile( path, excludeFile );
+        }
+        for ( const AString & excludePattern : excludePatterns )
+        {
+            excluded = excluded || PathUtils::IsWildcardMatch( excludePattern.Get(), path.Get() );
+        }
+        numMatchesLoop += excluded ? 1 : 0;
+    }
+    const float loopTime = t1.GetElapsed();
+
+    // compiled matcher
+    uint32_t numMatches = 0;
+    Timer t2;
+    for ( const AString & path : paths )
+    {
+        const bool excluded = matcher.MatchesPathPrefix( path ) ||
+                              matcher.MatchesFileName( path ) ||
+                              matcher.MatchesWildcard( path );
+        numMatches += excluded ? 1 : 0;
+    }
+    const float matcherTime = t2.GetElapsed();
+
+    TEST_ASSERT( numMatches == numMatchesLoop );
+    TEST_ASSERT( numMatches > 0 );
+    OUTPUT( "Exclusions: %u paths x %u x 3 exclusions (%u excluded)\n", (uint32_t)numPaths, (uint32_t)numExclusions, numMatches );
+    OUTPUT( " - One at a time : %2.3fs\n", loopTime );
+    OUTPUT( " - PathMatcher   : %2.3fs\n", matcherTime );
+}
+
+// GetStrings
+//------------------------------------------------------------------------------
+/*static*/ void TestPathMatcher::GetStrings( const char * alphabet, size_t maxLength, Array< AString > & outStrings )
+{
+    // every string up to maxLength chars long (including the empty string)
+    const size_t alphabetSize = AString::StrLen( alphabet );
+    size_t first = outStrings.GetSize();
+    outStrings.Append( AString::GetEmpty() );
+    for ( size_t length = 1; length <= maxLength; ++length )
+    {
+        const size_t last = outStrings.GetSize();
+        for ( size_t i = first; i < last; ++i )
+        {
+            for ( size_t j = 0; j < alphabetSize; ++j )
+            {
+                AStackString<> str( outStrings[ i ] );
+                str += alphabet[ j ];
+                outStrings.Append( str );
+            }
+        }
+        first = last;
+    }
+}
+
+//------------------------------------------------------------------------------
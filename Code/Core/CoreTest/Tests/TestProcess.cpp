@@ -0,0 +1,276 @@
+// TestProcess.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/UnitTest.h"
+
+// Core
+#include <Core/Process/Process.h>
+#include <Core/Strings/AStackString.h>
+#include <Core/Time/Timer.h>
+#include <Core/Tracing/Tracing.h>
+
+#if defined( __LINUX__ )
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __WINDOWS__ )
+    #define TEST_SHELL      "C:\\Windows\\System32\\cmd.exe"
+    #define TEST_SHELL_ARG  "/c"
+#else
+    #define TEST_SHELL      "/bin/sh"
+    #define TEST_SHELL_ARG  "-c"
+#endif
+
+// TestProcess
+//------------------------------------------------------------------------------
+class TestProcess : public UnitTest
+{
+private:
+    DECLARE_TESTS
+
+    void CaptureOutput() const;
+    void CaptureLargeOutput() const;
+    void ExitCode() const;
+    void TimeOut() const;
+    void SpawnManyTrivialProcesses() const;
+    void SpawnFailure() const;
+    void SpawnLatencyVsRSS() const;
+
+    static float TimeSpawns( uint32_t numProcesses, bool useFork );
+    static bool Run( const char * command, AutoPtr< char > & out, uint32_t & outSize,
+                     AutoPtr< char > & err, uint32_t & errSize, int & exitCode, uint32_t timeOutMS = 0 );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestProcess )
+    REGISTER_TEST( CaptureOutput )
+    REGISTER_TEST( CaptureLargeOutput )
+    REGISTER_TEST( ExitCode )
+    REGISTER_TEST( TimeOut )
+    REGISTER_TEST( SpawnManyTrivialProcesses )
+    REGISTER_TEST( SpawnFailure )
+    REGISTER_TEST( SpawnLatencyVsRSS )
+REGISTER_TESTS_END
+
+// Run
+//------------------------------------------------------------------------------
+/*static*/ bool TestProcess::Run( const char * command, AutoPtr< char > & out, uint32_t & outSize,
+                                  AutoPtr< char > & err, uint32_t & errSize, int & exitCode, uint32_t timeOutMS )
+{
+    AStackString< 1024 > args;
+    args.Format( "%s \"%s\"", TEST_SHELL_ARG, command );
+
+    Process p;
+    if ( p.Spawn( TEST_SHELL, args.Get(), nullptr, nullptr ) == false )
+    {
+        return false;
+    }
+    const bool result = p.ReadAllData( out, &outSize, err, &errSize, timeOutMS );
+    exitCode = p.WaitForExit();
+    return result;
+}
+
+// CaptureOutput
+//------------------------------------------------------------------------------
+void TestProcess::CaptureOutput() const
+{
+    AutoPtr< char > out;
+    AutoPtr< char > err;
+    uint32_t outSize = 0;
+    uint32_t errSize = 0;
+    int exitCode = -1;
+    TEST_ASSERT( Run( "echo stdout&& echo stderr 1>&2", out, outSize, err, errSize, exitCode ) );
+    TEST_ASSERT( exitCode == 0 );
+    TEST_ASSERT( AString::StrNCmp( out.Get(), "stdout", 6 ) == 0 );
+    TEST_ASSERT( AString::StrNCmp( err.Get(), "stderr", 6 ) == 0 );
+}
+
+// CaptureLargeOutput
+//------------------------------------------------------------------------------
+void TestProcess::CaptureLargeOutput() const
+{
+    // enough output to fill the pipes and grow the buffers several times
+    AutoPtr< char > out;
+    AutoPtr< char > err;
+    uint32_t outSize = 0;
+    uint32_t errSize = 0;
+    int exitCode = -1;
+    #if defined( __WINDOWS__ )
+        TEST_ASSERT( Run( "for /L %i in (1,1,20000) do @echo 0123456789012345678901234567890123456789", out, outSize, err, errSize, exitCode ) );
+        const uint32_t expectedSize = 20000 * 42;
+    #else
+        TEST_ASSERT( Run( "i=0; while [ $i -lt 20000 ]; do echo 012345678901234567890123456789012345678; i=$((i+1)); done", out, outSize, err, errSize, exitCode ) );
+        const uint32_t expectedSize = 20000 * 40;
+    #endif
+    TEST_ASSERT( exitCode == 0 );
+    TEST_ASSERT( outSize == expectedSize );
+    TEST_ASSERT( out.Get()[ outSize ] == 0 ); // null terminated
+    TEST_ASSERT( errSize == 0 );
+}
+
+// ExitCode
+//------------------------------------------------------------------------------
+void TestProcess::ExitCode() const
+{
+    AutoPtr< char > out;
+    AutoPtr< char > err;
+    uint32_t outSize = 0;
+    uint32_t errSize = 0;
+    int exitCode = -1;
+    TEST_ASSERT( Run( "exit 3", out, outSize, err, errSize, exitCode ) );
+    TEST_ASSERT( exitCode == 3 );
+}
+
+// TimeOut
+//------------------------------------------------------------------------------
+void TestProcess::TimeOut() const
+{
+    AutoPtr< char > out;
+    AutoPtr< char > err;
+    uint32_t outSize = 0;
+    uint32_t errSize = 0;
+    int exitCode = -1;
+    Timer t;
+    #if defined( __WINDOWS__ )
+        TEST_ASSERT( Run( "ping -n 10 127.0.0.1", out, outSize, err, errSize, exitCode, 200 ) == false );
+    #else
+        TEST_ASSERT( Run( "exec sleep 10", out, outSize, err, errSize, exitCode, 200 ) == false );
+    #endif
+    TEST_ASSERT( t.GetElapsed() < 5.0f );
+}
+
+// SpawnManyTrivialProcesses
+//------------------------------------------------------------------------------
+void TestProcess::SpawnManyTrivialProcesses() const
+{
+    // Spawn overhead dominates short processes (such as preprocessing), so
+    // make sure we don't add latency waiting for them to exit
+    #if defined( __WINDOWS__ )
+        const char * exe = TEST_SHELL;
+        const char * args = "/c exit";
+    #else
+        const char * exe = "/bin/true";
+        const char * args = nullptr;
+    #endif
+
+    const uint32_t numProcesses = 10000;
+    Timer t;
+    for ( uint32_t i = 0; i < numProcesses; ++i )
+    {
+        Process p;
+        TEST_ASSERT( p.Spawn( exe, args, nullptr, nullptr ) );
+        AutoPtr< char > out;
+        AutoPtr< char > err;
+        uint32_t outSize = 0;
+        uint32_t errSize = 0;
+        TEST_ASSERT( p.ReadAllData( out, &outSize, err, &errSize ) );
+        TEST_ASSERT( p.WaitForExit() == 0 );
+    }
+    const float time = t.GetElapsed();
+    OUTPUT( "Spawned %u processes in %2.3fs (%2.3fms per process)\n", numProcesses, time, ( time * 1000.0f ) / (float)numProcesses );
+}
+
+// SpawnFailure
+//------------------------------------------------------------------------------
+void TestProcess::SpawnFailure() const
+{
+    // Failing to start the executable (or change to the working dir) should
+    // be reported by Spawn (on OSX, this is only seen when the child exits)
+    #if defined( __WINDOWS__ )
+        Process p;
+        TEST_ASSERT( p.Spawn( "C:\\does\\not\\exist.exe", nullptr, nullptr, nullptr ) == false );
+        Process p2;
+        TEST_ASSERT( p2.Spawn( TEST_SHELL, "/c exit", "C:\\does\\not\\exist", nullptr ) == false );
+    #elif defined( __LINUX__ )
+        Process p;
+        TEST_ASSERT( p.Spawn( "/does/not/exist", nullptr, nullptr, nullptr ) == false );
+        Process p2;
+        TEST_ASSERT( p2.Spawn( "/bin/true", nullptr, "/does/not/exist", nullptr ) == false );
+    #endif
+}
+
+// SpawnLatencyVsRSS
+//------------------------------------------------------------------------------
+void TestProcess::SpawnLatencyVsRSS() const
+{
+    // The cost of spawning with fork() grows with the size of the parent (the
+    // page tables must be copied) but this should not be the case for Spawn
+    const uint32_t rssSizesMiB[] = { 0, 128, 512 };
+    const uint32_t numProcesses = 100;
+    for ( const uint32_t rssMiB : rssSizesMiB )
+    {
+        // grow the process by touching every page of a large allocation
+        const size_t rssSize = (size_t)rssMiB * MEGABYTE;
+        char * mem = rssSize ? (char *)ALLOC( rssSize ) : nullptr;
+        for ( size_t i = 0; i < rssSize; i += 4096 )
+        {
+            mem[ i ] = (char)i;
+        }
+
+        const float spawnTime = TimeSpawns( numProcesses, false );
+        #if defined( __LINUX__ )
+            const float forkTime = TimeSpawns( numProcesses, true );
+            OUTPUT( "RSS +%4u MiB : Spawn %2.3fms, fork+exec %2.3fms per process\n", rssMiB,
+                    ( spawnTime * 1000.0f ) / (float)numProcesses,
+                    ( forkTime * 1000.0f ) / (float)numProcesses );
+        #else
+            OUTPUT( "RSS +%4u MiB : Spawn %2.3fms per process\n", rssMiB,
+                    ( spawnTime * 1000.0f ) / (float)numProcesses );
+        #endif
+
+        FREE( mem );
+    }
+}
+
+// TimeSpawns
+//------------------------------------------------------------------------------
+/*static*/ float TestProcess::TimeSpawns( uint32_t numProcesses, bool useFork )
+{
+    #if defined( __WINDOWS__ )
+        const char * exe = TEST_SHELL;
+        const char * args = "/c exit";
+    #else
+        const char * exe = "/bin/true";
+        const char * args = nullptr;
+    #endif
+
+    Timer t;
+    for ( uint32_t i = 0; i < numProcesses; ++i )
+    {
+        if ( useFork )
+        {
+            // baseline for comparison
+            #if defined( __LINUX__ )
+                const pid_t pid = fork();
+                if ( pid == 0 )
+                {
+                    execl( exe, exe, (char *)nullptr );
+                    _exit( 127 );
+                }
+                TEST_ASSERT( pid != -1 );
+                int status = 0;
+                TEST_ASSERT( waitpid( pid, &status, 0 ) == pid );
+                TEST_ASSERT( WIFEXITED( status ) && ( WEXITSTATUS( status ) == 0 ) );
+            #endif
+            continue;
+        }
+
+        Process p;
+        TEST_ASSERT( p.Spawn( exe, args, nullptr, nullptr ) );
+        AutoPtr< char > out;
+        AutoPtr< char > err;
+        uint32_t outSize = 0;
+        uint32_t errSize = 0;
+        TEST_ASSERT( p.ReadAllData( out, &outSize, err, &errSize ) );
+        TEST_ASSERT( p.WaitForExit() == 0 );
+    }
+    return t.GetElapsed();
+}
+
+//------------------------------------------------------------------------------
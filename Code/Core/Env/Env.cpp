@@ -27,6 +27,8 @@
 #endif
 
 #if defined( __APPLE__ )
+    #include <mach/mach.h>
+    #include <sys/sysctl.h>
     extern "C"
     {
         int *_NSGetArgc(void);
@@ -111,6 +113,76 @@
     #endif
 }
 
+// GetMemoryInfo
+//------------------------------------------------------------------------------
+/*static*/ bool Env::GetMemoryInfo( uint64_t & outTotalBytes, uint64_t & outAvailableBytes )
+{
+    #if defined( __WINDOWS__ )
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof( status );
+        if ( ::GlobalMemoryStatusEx( &status ) == FALSE )
+        {
+            return false;
+        }
+        outTotalBytes = status.ullTotalPhys;
+        outAvailableBytes = status.ullAvailPhys;
+        return true;
+    #elif defined( __APPLE__ )
+        uint64_t totalBytes = 0;
+        size_t len = sizeof( totalBytes );
+        if ( sysctlbyname( "hw.memsize", &totalBytes, &len, nullptr, 0 ) != 0 )
+        {
+            return false;
+        }
+        vm_statistics64_data_t vmStats;
+        mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+        if ( host_statistics64( mach_host_self(), HOST_VM_INFO64, (host_info64_t)&vmStats, &count ) != KERN_SUCCESS )
+        {
+            return false;
+        }
+        const uint64_t pageSize = (uint64_t)sysconf( _SC_PAGESIZE );
+        outTotalBytes = totalBytes;
+        outAvailableBytes = ( (uint64_t)vmStats.free_count + (uint64_t)vmStats.inactive_count ) * pageSize;
+        return true;
+    #elif defined( __LINUX__ )
+        // MemAvailable accounts for reclaimable caches, unlike MemFree
+        FILE * f = fopen( "/proc/meminfo", "r" );
+        if ( f == nullptr )
+        {
+            return false;
+        }
+        uint64_t totalKiB = 0;
+        uint64_t availableKiB = 0;
+        bool foundTotal = false;
+        bool foundAvailable = false;
+        char line[ 256 ];
+        while ( fgets( line, sizeof( line ), f ) )
+        {
+            unsigned long long value;
+            if ( sscanf( line, "MemTotal: %llu kB", &value ) == 1 )
+            {
+                totalKiB = value;
+                foundTotal = true;
+            }
+            else if ( sscanf( line, "MemAvailable: %llu kB", &value ) == 1 )
+            {
+                availableKiB = value;
+                foundAvailable = true;
+            }
+        }
+        fclose( f );
+        if ( ( foundTotal == false ) || ( foundAvailable == false ) )
+        {
+            return false;
+        }
+        outTotalBytes = totalKiB * 1024;
+        outAvailableBytes = availableKiB * 1024;
+        return true;
+    #else
+        #error Unknown platform
+    #endif
+}
+
 // GetEnvVariable
 //------------------------------------------------------------------------------
 /*static*/ bool Env::GetEnvVariable( const char * envVarName, AString & envVarValue )
@@ -29,6 +29,7 @@ public:
     static inline const char * GetPlatformName() { return GetPlatformName( GetPlatform() ); }
 
     static uint32_t GetNumProcessors();
+    static bool GetMemoryInfo( uint64_t & outTotalBytes, uint64_t & outAvailableBytes );
 
     static bool GetEnvVariable( const char * envVarName, AString & envVarValue );
     static bool SetEnvVariable( const char * envVarName, const AString & envVarValue );
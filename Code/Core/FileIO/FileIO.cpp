@@ -22,13 +22,13 @@
 #if defined( __LINUX__ ) || defined( __APPLE__ )
     #include <dirent.h>
     #include <errno.h>
+    #include <fcntl.h>
     #include <limits.h>
     #include <stdio.h>
     #include <sys/stat.h>
     #include <unistd.h>
 #endif
 #if defined( __LINUX__ )
-    #include <fcntl.h>
     #include <sys/sendfile.h>
 #endif
 #if defined( __APPLE__ )
@@ -321,6 +321,228 @@
     return false;
 }
 
+// GetDirectoryContents
+//------------------------------------------------------------------------------
+/*static*/ bool FileIO::GetDirectoryContents( const AString & path,
+                                            const Array< AString > * patterns,
+                                            uint64_t & outLastWriteTime,
+                                            Array< AString > * outSubDirs,
+                                            Array< FileInfo > * outFiles )
+{
+    ASSERT( path.EndsWith( NATIVE_SLASH ) );
+    ASSERT( outSubDirs && outFiles );
+
+    AStackString< 256 > pathCopy( path );
+    const uint32_t baseLength = pathCopy.GetLength();
+
+    #if defined( __WINDOWS__ )
+        // get the time before listing, so changes during listing are seen next time
+        WIN32_FILE_ATTRIBUTE_DATA dirAttribs;
+        const AStackString< 256 > dirPath( path.Get(), path.GetEnd() - 1 ); // no trailing slash
+        if ( GetFileAttributesEx( dirPath.Get(), GetFileExInfoStandard, &dirAttribs ) == FALSE )
+        {
+            return false;
+        }
+        outLastWriteTime = (uint64_t)dirAttribs.ftLastWriteTime.dwLowDateTime | ( (uint64_t)dirAttribs.ftLastWriteTime.dwHighDateTime << 32 );
+
+        pathCopy += '*';
+        WIN32_FIND_DATA findData;
+        HANDLE hFind = FindFirstFileEx( pathCopy.Get(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, 0 );
+        if ( hFind == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        do
+        {
+            if ( findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+            {
+                // ignore magic '.' and '..' folders
+                if ( findData.cFileName[ 0 ] == '.' &&
+                    ( ( findData.cFileName[ 1 ] == '.' ) || ( findData.cFileName[ 1 ] == '\000' ) ) )
+                {
+                    continue;
+                }
+                outSubDirs->Append( AStackString<>( findData.cFileName ) );
+                continue;
+            }
+
+            if ( IsMatch( patterns, findData.cFileName ) )
+            {
+                pathCopy.SetLength( baseLength );
+                pathCopy += findData.cFileName;
+                if ( outFiles->GetSize() == outFiles->GetCapacity() )
+                {
+                    outFiles->SetCapacity( ( outFiles->GetSize() * 2 ) + 16 );
+                }
+                outFiles->SetSize( outFiles->GetSize() + 1 );
+                FileInfo & newInfo = outFiles->Top();
+                newInfo.m_Name = pathCopy;
+                newInfo.m_Attributes = findData.dwFileAttributes;
+                newInfo.m_LastWriteTime = (uint64_t)findData.ftLastWriteTime.dwLowDateTime | ( (uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32 );
+                newInfo.m_Size = (uint64_t)findData.nFileSizeLow | ( (uint64_t)findData.nFileSizeHigh << 32 );
+            }
+        }
+        while ( FindNextFile( hFind, &findData ) != 0 );
+
+        FindClose( hFind );
+        return true;
+
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        // Open the directory itself (not following symlinks, as for GetFilesEx)
+        // so entries can be queried relative to it, avoiding a lookup of the
+        // full path for each one
+        const AStackString< 256 > dirPath( path.Get(), path.GetEnd() - 1 ); // no trailing slash
+        const int dirFd = open( dirPath.Get(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC );
+        if ( dirFd == -1 )
+        {
+            return false;
+        }
+
+        // get the time before listing, so changes during listing are seen next time
+        struct stat dirInfo;
+        if ( fstat( dirFd, &dirInfo ) != 0 )
+        {
+            close( dirFd );
+            return false;
+        }
+        #if defined( __APPLE__ )
+            outLastWriteTime = ( ( (uint64_t)dirInfo.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)dirInfo.st_mtimespec.tv_nsec );
+        #else
+            outLastWriteTime = ( ( (uint64_t)dirInfo.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)dirInfo.st_mtim.tv_nsec );
+        #endif
+
+        DIR * dir = fdopendir( dirFd ); // takes ownership of dirFd
+        if ( dir == nullptr )
+        {
+            close( dirFd );
+            return false;
+        }
+
+        for ( ;; )
+        {
+            dirent * entry = readdir( dir );
+            if ( entry == nullptr )
+            {
+                break; // no more entries
+            }
+
+            // ignore . and ..
+            if ( entry->d_name[ 0 ] == '.' )
+            {
+                if ( ( entry->d_name[ 1 ] == 0 ) ||
+                     ( ( entry->d_name[ 1 ] == '.' ) && ( entry->d_name[ 2 ] == 0 ) ) )
+                {
+                    continue;
+                }
+            }
+
+            // Not all filesystems have support for returning the file type in
+            // d_type and applications must properly handle a return of DT_UNKNOWN.
+            bool isDir = ( entry->d_type == DT_DIR );
+            struct stat info;
+            bool haveInfo = false;
+            if ( entry->d_type == DT_UNKNOWN )
+            {
+                if ( fstatat( dirFd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW ) != 0 )
+                {
+                    continue; // deleted while listing
+                }
+                isDir = S_ISDIR( info.st_mode );
+                haveInfo = true;
+            }
+
+            if ( isDir )
+            {
+                outSubDirs->Append( AStackString<>( entry->d_name ) );
+                continue;
+            }
+
+            // file - does it match wildcard?
+            if ( IsMatch( patterns, entry->d_name ) == false )
+            {
+                continue;
+            }
+
+            // get additional info
+            if ( ( haveInfo == false ) && ( fstatat( dirFd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW ) != 0 ) )
+            {
+                continue; // deleted while listing
+            }
+
+            pathCopy.SetLength( baseLength );
+            pathCopy += entry->d_name;
+            if ( outFiles->GetSize() == outFiles->GetCapacity() )
+            {
+                outFiles->SetCapacity( ( outFiles->GetSize() * 2 ) + 16 );
+            }
+            outFiles->SetSize( outFiles->GetSize() + 1 );
+            FileInfo & newInfo = outFiles->Top();
+            newInfo.m_Name = pathCopy;
+            newInfo.m_Attributes = info.st_mode;
+            #if defined( __APPLE__ )
+                newInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtimespec.tv_nsec );
+            #else
+                newInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtim.tv_nsec );
+            #endif
+            newInfo.m_Size = info.st_size;
+        }
+        closedir( dir );
+        return true;
+    #else
+        #error Unknown platform
+    #endif
+}
+
+// GetFilesInfo
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    /*static*/ bool FileIO::GetFilesInfo( const AString & path,
+                                        const Array< AString > & fileNames,
+                                        Array< FileInfo > * outFiles )
+    {
+        ASSERT( path.EndsWith( NATIVE_SLASH ) );
+        ASSERT( outFiles );
+
+        AStackString< 256 > pathCopy( path );
+        const uint32_t baseLength = pathCopy.GetLength();
+        const AStackString< 256 > dirPath( path.Get(), path.GetEnd() - 1 ); // no trailing slash
+        const int dirFd = open( dirPath.Get(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC );
+        if ( dirFd == -1 )
+        {
+            return false;
+        }
+
+        outFiles->SetCapacity( outFiles->GetSize() + fileNames.GetSize() );
+
+        bool ok = true;
+        for ( const AString & fileName : fileNames )
+        {
+            struct stat info;
+            if ( fstatat( dirFd, fileName.Get(), &info, AT_SYMLINK_NOFOLLOW ) != 0 )
+            {
+                ok = false; // file was removed
+                break;
+            }
+
+            pathCopy.SetLength( baseLength );
+            pathCopy += fileName;
+            outFiles->SetSize( outFiles->GetSize() + 1 );
+            FileInfo & newInfo = outFiles->Top();
+            newInfo.m_Name = pathCopy;
+            newInfo.m_Attributes = info.st_mode;
+            #if defined( __APPLE__ )
+                newInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtimespec.tv_nsec );
+            #else
+                newInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtim.tv_nsec );
+            #endif
+            newInfo.m_Size = info.st_size;
+        }
+        close( dirFd );
+        return ok;
+    }
+#endif
+
 // GetCurrentDir
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::GetCurrentDir( AString & output )
@@ -43,6 +43,20 @@ public:
                             Array< FileInfo > * results );
     static bool GetFileInfo( const AString & fileName, FileInfo & info );
 
+    // listing of a single directory (path with trailing slash), returning the
+    // names of sub-directories and the info for files matching the patterns
+    static bool GetDirectoryContents( const AString & path,
+                                      const Array< AString > * patterns,
+                                      uint64_t & outLastWriteTime,
+                                      Array< AString > * outSubDirs,
+                                      Array< FileInfo > * outFiles );
+    #if defined( __LINUX__ ) || defined( __APPLE__ )
+        // info for known files in a directory, without listing it
+        static bool GetFilesInfo( const AString & path,
+                                  const Array< AString > & fileNames,
+                                  Array< FileInfo > * outFiles );
+    #endif
+
     static bool GetCurrentDir( AString & output );
     static bool SetCurrentDir( const AString & dir );
     static bool GetTempDir( AString & output );
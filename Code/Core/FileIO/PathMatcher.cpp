@@ -0,0 +1,261 @@
+// PathMatcher.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/PrecompiledHeader.h"
+
+#include "PathMatcher.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Strings/AString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define PATH_MATCHER_INITIAL_STATES ( 32 ) // usually enough for all the wildcard states
+
+// Fold
+//------------------------------------------------------------------------------
+static inline char Fold( char c )
+{
+    #if defined( __LINUX__ )
+        // Linux : Case sensitive
+        return c;
+    #else
+        // Windows & OSX : Case insensitive
+        return ( ( c >= 'A' ) && ( c <= 'Z' ) ) ? (char)( 'a' + ( c - 'A' ) ) : c;
+    #endif
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+PathMatcher::PathMatcher()
+    : m_PathPrefixes( 1, true )
+    , m_FileNames( 1, true )
+    , m_Wildcards( 1, true )
+{
+    // each trie starts with an empty root
+    const TrieNode root = { 0, 0, 0, false };
+    m_PathPrefixes.Append( root );
+    m_FileNames.Append( root );
+    m_Wildcards.Append( root );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+PathMatcher::~PathMatcher() = default;
+
+// AddPathPrefix
+//------------------------------------------------------------------------------
+void PathMatcher::AddPathPrefix( const AString & cleanPath )
+{
+    uint32_t node = 0;
+    for ( const char * pos = cleanPath.Get(); pos < cleanPath.GetEnd(); ++pos )
+    {
+        node = FindOrAddChild( m_PathPrefixes, node, Fold( *pos ) );
+    }
+    m_PathPrefixes[ node ].m_Terminal = true;
+}
+
+// AddFileName
+//------------------------------------------------------------------------------
+void PathMatcher::AddFileName( const AString & fileName )
+{
+    // names are matched from the end of paths, so are stored reversed
+    uint32_t node = 0;
+    for ( const char * pos = fileName.GetEnd(); pos > fileName.Get(); --pos )
+    {
+        node = FindOrAddChild( m_FileNames, node, Fold( *( pos - 1 ) ) );
+    }
+    m_FileNames[ node ].m_Terminal = true;
+}
+
+// AddWildcard
+//------------------------------------------------------------------------------
+void PathMatcher::AddWildcard( const AString & pattern )
+{
+    uint32_t node = 0;
+    for ( const char * pos = pattern.Get(); pos < pattern.GetEnd(); ++pos )
+    {
+        if ( ( *pos == '*' ) && ( m_Wildcards[ node ].m_Char == '*' ) )
+        {
+            continue; // consecutive '*' are equivalent to one
+        }
+        node = FindOrAddChild( m_Wildcards, node, Fold( *pos ) );
+    }
+    m_Wildcards[ node ].m_Terminal = true;
+}
+
+// MatchesPathPrefix
+//------------------------------------------------------------------------------
+bool PathMatcher::MatchesPathPrefix( const AString & cleanPath ) const
+{
+    uint32_t node = 0;
+    const char * pos = cleanPath.Get();
+    for ( ;; )
+    {
+        if ( m_PathPrefixes[ node ].m_Terminal )
+        {
+            return true;
+        }
+        if ( pos == cleanPath.GetEnd() )
+        {
+            return false;
+        }
+        node = FindChild( m_PathPrefixes, node, Fold( *pos ) );
+        if ( node == 0 )
+        {
+            return false;
+        }
+        ++pos;
+    }
+}
+
+// MatchesFileName
+//------------------------------------------------------------------------------
+bool PathMatcher::MatchesFileName( const AString & cleanPath ) const
+{
+    // a name matches if it's the whole path, or everything after a slash
+    uint32_t node = 0;
+    const char * pos = cleanPath.GetEnd();
+    for ( ;; )
+    {
+        if ( m_FileNames[ node ].m_Terminal )
+        {
+            if ( ( pos == cleanPath.Get() ) || ( *( pos - 1 ) == NATIVE_SLASH ) )
+            {
+                return true;
+            }
+        }
+        if ( pos == cleanPath.Get() )
+        {
+            return false;
+        }
+        --pos;
+        node = FindChild( m_FileNames, node, Fold( *pos ) );
+        if ( node == 0 )
+        {
+            return false;
+        }
+    }
+}
+
+// MatchesWildcard
+//------------------------------------------------------------------------------
+bool PathMatcher::MatchesWildcard( const AString & path ) const
+{
+    if ( m_Wildcards[ 0 ].m_FirstChild == 0 )
+    {
+        return ( m_Wildcards[ 0 ].m_Terminal && path.IsEmpty() ); // no wildcards, or just an empty one
+    }
+
+    // Run all the patterns at once, tracking the set of trie nodes reached by
+    // the characters so far. Each node appears at most once, so the work per
+    // character is bounded by the size of the trie, not the number of patterns.
+    Array< uint32_t > current( PATH_MATCHER_INITIAL_STATES, true );
+    Array< uint32_t > next( PATH_MATCHER_INITIAL_STATES, true );
+    AddWildcardState( 0, current );
+    for ( const char * pos = path.Get(); pos < path.GetEnd(); ++pos )
+    {
+        const char c = Fold( *pos );
+        next.Clear();
+        for ( const uint32_t state : current )
+        {
+            const TrieNode & node = m_Wildcards[ state ];
+            if ( node.m_Char == '*' )
+            {
+                if ( node.m_Terminal )
+                {
+                    return true; // a trailing '*' matches the rest of the path
+                }
+                AddWildcardState( state, next );
+            }
+            for ( uint32_t child = node.m_FirstChild; child != 0; child = m_Wildcards[ child ].m_NextSibling )
+            {
+                const char edge = m_Wildcards[ child ].m_Char;
+                if ( edge == '*' )
+                {
+                    continue; // already added with its parent
+                }
+                if ( ( edge == c ) || ( ( edge == '?' ) && ( c != '.' ) ) )
+                {
+                    AddWildcardState( child, next );
+                }
+            }
+        }
+        if ( next.IsEmpty() )
+        {
+            return false;
+        }
+        current.Swap( next );
+    }
+
+    for ( const uint32_t state : current )
+    {
+        if ( m_Wildcards[ state ].m_Terminal )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// FindChild
+//------------------------------------------------------------------------------
+/*static*/ uint32_t PathMatcher::FindChild( const Array< TrieNode > & trie, uint32_t parent, char c )
+{
+    for ( uint32_t child = trie[ parent ].m_FirstChild; child != 0; child = trie[ child ].m_NextSibling )
+    {
+        if ( trie[ child ].m_Char == c )
+        {
+            return child;
+        }
+    }
+    return 0;
+}
+
+// FindOrAddChild
+//------------------------------------------------------------------------------
+/*static*/ uint32_t PathMatcher::FindOrAddChild( Array< TrieNode > & trie, uint32_t parent, char c )
+{
+    const uint32_t existing = FindChild( trie, parent, c );
+    if ( existing != 0 )
+    {
+        return existing;
+    }
+    const uint32_t child = (uint32_t)trie.GetSize();
+    const TrieNode node = { 0, trie[ parent ].m_FirstChild, c, false };
+    if ( trie.GetSize() == trie.GetCapacity() )
+    {
+        trie.SetCapacity( trie.GetSize() * 2 );
+    }
+    trie.Append( node );
+    trie[ parent ].m_FirstChild = child;
+    return child;
+}
+
+// AddWildcardState
+//------------------------------------------------------------------------------
+void PathMatcher::AddWildcardState( uint32_t node, Array< uint32_t > & states ) const
+{
+    if ( states.Find( node ) )
+    {
+        return;
+    }
+    if ( states.GetSize() == states.GetCapacity() )
+    {
+        states.SetCapacity( states.GetSize() * 2 );
+    }
+    states.Append( node );
+
+    // a '*' can match nothing, so the node after it is reached at the same time
+    for ( uint32_t child = m_Wildcards[ node ].m_FirstChild; child != 0; child = m_Wildcards[ child ].m_NextSibling )
+    {
+        if ( m_Wildcards[ child ].m_Char == '*' )
+        {
+            AddWildcardState( child, states );
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+// PathMatcher.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// PathMatcher
+//  - Checks paths against many path prefixes, file names and wildcards at once.
+//  - Each kind is compiled into a trie, so a check costs one pass over the
+//    path instead of one comparison per entry. Results are the same as with
+//    PathUtils::PathBeginsWith, PathUtils::PathEndsWithFile and
+//    PathUtils::IsWildcardMatch.
+//------------------------------------------------------------------------------
+class PathMatcher
+{
+public:
+    explicit PathMatcher();
+    ~PathMatcher();
+
+    void AddPathPrefix( const AString & cleanPath );
+    void AddFileName( const AString & fileName );
+    void AddWildcard( const AString & pattern );
+
+    bool MatchesPathPrefix( const AString & cleanPath ) const;
+    bool MatchesFileName( const AString & cleanPath ) const;
+    bool MatchesWildcard( const AString & path ) const;
+
+private:
+    struct TrieNode
+    {
+        uint32_t    m_FirstChild;   // 0 if none (the root is never a child)
+        uint32_t    m_NextSibling;  // 0 if none
+        char        m_Char;         // for wildcards, '*' and '?' have their usual meaning
+        bool        m_Terminal;     // an entry ends here
+    };
+
+    static uint32_t FindChild( const Array< TrieNode > & trie, uint32_t parent, char c );
+    static uint32_t FindOrAddChild( Array< TrieNode > & trie, uint32_t parent, char c );
+    void AddWildcardState( uint32_t node, Array< uint32_t > & states ) const;
+
+    Array< TrieNode >   m_PathPrefixes;
+    Array< TrieNode >   m_FileNames;    // stored reversed
+    Array< TrieNode >   m_Wildcards;
+};
+
+//------------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 
         // Hint when operating only on a single thread as we can greatly reduce allocation cost
         static void     SetSingleThreadedMode( bool singleThreadedMode );
+        static bool     IsSingleThreadedMode() { return ( s_ThreadSafeAllocs == false ); }
 
         #if defined( DEBUG )
             static void DumpStats();
@@ -28,14 +28,96 @@
     #include <signal.h>
     #include <stdio.h>
     #include <stdlib.h>
+    #include <poll.h>
     #include <string.h>
     #include <sys/wait.h>
     #include <unistd.h>
 #endif
+#if defined( __LINUX__ )
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+#endif
+
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    #define PROCESS_ABORT_CHECK_INTERVAL_MS ( 15 )      // how often to check abort flags while waiting
+    #define PROCESS_INITIAL_BUFFER_SIZE     ( 64 * 1024 )
+    #define PROCESS_MAX_BUFFER_GROWTH       ( 16 * MEGABYTE )
+#endif
+#if defined( __LINUX__ )
+    #define PROCESS_SPAWN_STACK_SIZE        ( 64 * 1024 )   // stack for the child until it calls exec
+#endif
 
 // Static Data
 //------------------------------------------------------------------------------
 
+// SpawnChildArgs
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    struct SpawnChildArgs
+    {
+        const char *        m_Executable;
+        char * const *      m_ArgV;
+        char * const *      m_EnvV;         // nullptr to inherit the environment
+        const char *        m_WorkingDir;   // nullptr to inherit the working dir
+        int                 m_StdOutFD;
+        int                 m_StdErrFD;
+        sigset_t            m_SignalMask;   // mask to restore in the child
+        volatile int        m_Error;        // errno if the child failed before/during exec
+    };
+#endif
+
+// SpawnChildFunc
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    // Runs in the child, sharing the parent's memory until exec. Only
+    // async-signal-safe calls are allowed and nothing may be allocated.
+    static int SpawnChildFunc( void * userData )
+    {
+        SpawnChildArgs & args = *static_cast< SpawnChildArgs * >( userData );
+
+        // Our handlers would run on the parent's memory, so reset them (exec
+        // would do this anyway). The handler table is our own copy.
+        for ( int sig = 1; sig < NSIG; ++sig )
+        {
+            struct sigaction action;
+            if ( ( sigaction( sig, nullptr, &action ) == 0 ) &&
+                 ( action.sa_handler != SIG_DFL ) &&
+                 ( action.sa_handler != SIG_IGN ) )
+            {
+                action.sa_handler = SIG_DFL;
+                action.sa_flags = 0;
+                sigaction( sig, &action, nullptr );
+            }
+        }
+        pthread_sigmask( SIG_SETMASK, &args.m_SignalMask, nullptr );
+
+        // redirect output (pipes are close-on-exec, but the duplicates are not)
+        if ( ( dup2( args.m_StdOutFD, STDOUT_FILENO ) == -1 ) ||
+             ( dup2( args.m_StdErrFD, STDERR_FILENO ) == -1 ) ||
+             ( args.m_WorkingDir && ( chdir( args.m_WorkingDir ) != 0 ) ) )
+        {
+            args.m_Error = errno;
+            _exit( 127 );
+        }
+
+        // transfer execution to new executable
+        if ( args.m_EnvV )
+        {
+            execve( args.m_Executable, args.m_ArgV, args.m_EnvV );
+        }
+        else
+        {
+            execv( args.m_Executable, args.m_ArgV );
+        }
+
+        args.m_Error = errno; // only get here if exec fails
+        _exit( 127 );
+    }
+#endif
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Process::Process( const volatile bool * masterAbortFlag,
@@ -52,6 +134,9 @@ Process::Process( const volatile bool * masterAbortFlag,
 #if defined( __LINUX__ ) || defined( __APPLE__ )
     , m_ChildPID( -1 )
     , m_HasAlreadyWaitTerminated( false )
+    , m_StdOutRead( -1 )
+    , m_StdErrRead( -1 )
+    , m_PidFD( -1 )
 #endif
     , m_HasAborted( false )
     , m_MasterAbortFlag( masterAbortFlag )
@@ -239,10 +324,22 @@ bool Process::Spawn( const char * executable,
         (void)shareHandles; // unsupported
 
         // create StdOut and StdErr pipes to capture output of spawned process
+        // (close-on-exec so processes spawned concurrently by other threads don't hold
+        // them open, which would delay seeing the end of the output)
         int stdOutPipeFDs[ 2 ];
         int stdErrPipeFDs[ 2 ];
-        VERIFY( pipe( stdOutPipeFDs ) == 0 );
-        VERIFY( pipe( stdErrPipeFDs ) == 0 );
+        #if defined( __LINUX__ )
+            VERIFY( pipe2( stdOutPipeFDs, O_CLOEXEC ) == 0 );
+            VERIFY( pipe2( stdErrPipeFDs, O_CLOEXEC ) == 0 );
+        #else
+            VERIFY( pipe( stdOutPipeFDs ) == 0 );
+            VERIFY( pipe( stdErrPipeFDs ) == 0 );
+            const int fds[] = { stdOutPipeFDs[ 0 ], stdOutPipeFDs[ 1 ], stdErrPipeFDs[ 0 ], stdErrPipeFDs[ 1 ] };
+            for ( const int fd : fds )
+            {
+                VERIFY( fcntl( fd, F_SETFD, FD_CLOEXEC ) == 0 );
+            }
+        #endif
 
         // prepare args
         Array< AString > splitArgs( 64, true );
@@ -283,66 +380,109 @@ bool Process::Spawn( const char * executable,
         }
         envVector.Append( nullptr ); // env must be terminated with a nullptr
 
-        // fork the process
-        const pid_t childProcessPid = fork();
-        if ( childProcessPid == -1 )
-        {
-            // cleanup pipes
-            VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
-
-            ASSERT( false ); // fork failed - should not happen in normal operation
-            return false;
-        }
-
-        const bool isChild = ( childProcessPid == 0 );
-        if ( isChild )
-        {
-            VERIFY( dup2( stdOutPipeFDs[ 1 ], STDOUT_FILENO ) != -1 );
-            VERIFY( dup2( stdErrPipeFDs[ 1 ], STDERR_FILENO ) != -1 );
-
-            VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
-
-            if ( workingDir )
+        #if defined( __LINUX__ )
+            // Start the process without copying our address space (which can be
+            // large), sharing memory with the child until it calls exec
+            SpawnChildArgs childArgs;
+            childArgs.m_Executable = executable;
+            childArgs.m_ArgV = (char * const *)argVector.Begin();
+            childArgs.m_EnvV = environment ? (char * const *)envVector.Begin() : nullptr;
+            childArgs.m_WorkingDir = workingDir;
+            childArgs.m_StdOutFD = stdOutPipeFDs[ 1 ];
+            childArgs.m_StdErrFD = stdErrPipeFDs[ 1 ];
+            childArgs.m_Error = 0;
+
+            // block signals so no handlers run on the child's shared memory (the child restores them)
+            sigset_t allSignals;
+            sigfillset( &allSignals );
+            VERIFY( pthread_sigmask( SIG_SETMASK, &allSignals, &childArgs.m_SignalMask ) == 0 );
+
+            // The parent is suspended until the child calls exec (or exits), so the stack can be freed after
+            char * childStack = (char *)ALLOC( PROCESS_SPAWN_STACK_SIZE );
+            const pid_t childProcessPid = clone( SpawnChildFunc, childStack + PROCESS_SPAWN_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, &childArgs );
+            FREE( childStack );
+
+            VERIFY( pthread_sigmask( SIG_SETMASK, &childArgs.m_SignalMask, nullptr ) == 0 );
+
+            // did the child fail before or during exec?
+            if ( ( childProcessPid != -1 ) && ( childArgs.m_Error != 0 ) )
             {
-                VERIFY( chdir( workingDir ) == 0 );
+                int status;
+                while ( ( waitpid( childProcessPid, &status, 0 ) == -1 ) && ( errno == EINTR ) ) {}
             }
-
-            // transfer execution to new executable
-            char * const * argV = (char * const *)argVector.Begin();
-            if ( environment )
+            if ( ( childProcessPid == -1 ) || ( childArgs.m_Error != 0 ) )
             {
-                char * const * envV = (char * const *)envVector.Begin();
-                execve( executable, argV, envV );
+                // cleanup pipes
+                VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+                return false;
             }
-            else
+        #else
+            // fork the process
+            const pid_t childProcessPid = fork();
+            if ( childProcessPid == -1 )
             {
-                execv( executable, argV );
+                // cleanup pipes
+                VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+
+                ASSERT( false ); // fork failed - should not happen in normal operation
+                return false;
             }
 
-            exit( -1 ); // only get here if execv fails
-        }
-        else
-        {
-            // close write pipes (we never write anything)
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+            const bool isChild = ( childProcessPid == 0 );
+            if ( isChild )
+            {
+                VERIFY( dup2( stdOutPipeFDs[ 1 ], STDOUT_FILENO ) != -1 );
+                VERIFY( dup2( stdErrPipeFDs[ 1 ], STDERR_FILENO ) != -1 );
 
-            // keep pipes for reading child process
-            m_StdOutRead = stdOutPipeFDs[ 0 ];
-            m_StdErrRead = stdErrPipeFDs[ 0 ];
-            m_ChildPID = (int)childProcessPid;
+                VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
 
-            // TODO: How can we tell if child spawn failed?
-            m_Started = true;
-            m_HasAlreadyWaitTerminated = false;
-            return true;
-        }
+                if ( workingDir )
+                {
+                    VERIFY( chdir( workingDir ) == 0 );
+                }
+
+                // transfer execution to new executable
+                char * const * argV = (char * const *)argVector.Begin();
+                if ( environment )
+                {
+                    char * const * envV = (char * const *)envVector.Begin();
+                    execve( executable, argV, envV );
+                }
+                else
+                {
+                    execv( executable, argV );
+                }
+
+                exit( -1 ); // only get here if execv fails
+            }
+        #endif
+
+        // close write pipes (we never write anything)
+        VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+        VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+
+        // keep pipes for reading child process
+        m_StdOutRead = stdOutPipeFDs[ 0 ];
+        m_StdErrRead = stdErrPipeFDs[ 0 ];
+        m_ChildPID = (int)childProcessPid;
+
+        // get notified when the child exits, so we don't have to poll
+        #if defined( __LINUX__ ) && defined( SYS_pidfd_open )
+            m_PidFD = (int)syscall( SYS_pidfd_open, childProcessPid, 0 ); // fails on kernels before 5.3
+        #endif
+
+        m_Started = true;
+        m_HasAlreadyWaitTerminated = false;
+        return true;
     #else
         #error Unknown platform
     #endif
@@ -445,8 +585,7 @@ int Process::WaitForExit()
 
         return exitCode;
     #elif defined( __LINUX__ ) || defined( __APPLE__ )
-        VERIFY( close( m_StdOutRead ) == 0 );
-        VERIFY( close( m_StdErrRead ) == 0 );
+        CloseHandles();
         if ( m_HasAlreadyWaitTerminated == false )
         {
             int status;
@@ -530,6 +669,11 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
 
     Timer t;
 
+    #if defined( __LINUX__ ) || defined( __APPLE__ )
+        bool stdOutOpen = true;
+        bool stdErrOpen = true;
+    #endif
+
     bool processExited = false;
     for ( ;; )
     {
@@ -545,8 +689,19 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
 
         uint32_t prevOutSize = outSize;
         uint32_t prevErrSize = errSize;
-        Read( m_StdOutRead, outMem, outSize, outBufferSize );
-        Read( m_StdErrRead, errMem, errSize, errBufferSize );
+        #if defined( __WINDOWS__ )
+            Read( m_StdOutRead, outMem, outSize, outBufferSize );
+            Read( m_StdErrRead, errMem, errSize, errBufferSize );
+        #else
+            if ( stdOutOpen )
+            {
+                stdOutOpen = Read( m_StdOutRead, outMem, outSize, outBufferSize );
+            }
+            if ( stdErrOpen )
+            {
+                stdErrOpen = Read( m_StdErrRead, errMem, errSize, errBufferSize );
+            }
+        #endif
 
         // did we get some data?
         if ( ( prevOutSize != outSize ) || ( prevErrSize != errSize ) )
@@ -586,9 +741,15 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
                     return false; // Timed out
                 }
 
-                // no data available, but process is still going, so wait
-                // TODO:C Replace this sleep with event-based wait
-                Thread::Sleep( 15 );
+                // no data available, but process is still going, so wait for
+                // more output or for it to exit (waking periodically to check for aborts)
+                uint32_t waitMS = PROCESS_ABORT_CHECK_INTERVAL_MS;
+                if ( timeOutMS > 0 )
+                {
+                    const uint32_t elapsedMS = (uint32_t)t.GetElapsedMS();
+                    waitMS = Math::Min( waitMS, ( elapsedMS < timeOutMS ) ? ( timeOutMS - elapsedMS ) : 0 );
+                }
+                WaitForOutputOrExit( stdOutOpen, stdErrOpen, waitMS );
                 continue;
             }
         #endif
@@ -665,24 +826,22 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
 // Read
 //------------------------------------------------------------------------------
 #if defined( __LINUX__ ) || defined( __APPLE__ )
-    void Process::Read( int handle, AutoPtr< char > & buffer, uint32_t & sizeSoFar, uint32_t & bufferSize )
+    bool Process::Read( int handle, AutoPtr< char > & buffer, uint32_t & sizeSoFar, uint32_t & bufferSize )
     {
         // any data available?
-        timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 0;
-        fd_set fdSet;
-        FD_ZERO( &fdSet );
-        FD_SET( handle, &fdSet );
-        int ret = select( handle+1, &fdSet, nullptr, nullptr, &timeout );
+        pollfd pfd;
+        pfd.fd = handle;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll( &pfd, 1, 0 );
         if ( ret == -1 )
         {
-            ASSERT( false ); // usage error?
-            return;
+            ASSERT( errno == EINTR ); // usage error?
+            return true;
         }
         if ( ret == 0 )
         {
-            return; // no data available
+            return true; // no data available
         }
 
         // how much space do we have left for reading into?
@@ -690,11 +849,10 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
         if ( spaceInBuffer == 0 )
         {
             // allocate a bigger buffer (also handles the first time with no buffer)
-
-            // TODO:B look at a new container type (like a linked list of 1mb buffers) to avoid the wasteage here
-            // The caller has to take a copy to avoid the overhead if they want to hang onto the data
-            // grow buffer in at least 16MB chunks, to prevent future reallocations
-            uint32_t newBufferSize = ( sizeSoFar + ( 16 * MEGABYTE ) );
+            // Most processes output very little, so start small and double the size
+            // as needed, limiting growth to 16MiB at a time
+            uint32_t newBufferSize = ( bufferSize == 0 ) ? PROCESS_INITIAL_BUFFER_SIZE
+                                                         : ( bufferSize + Math::Min< uint32_t >( bufferSize, PROCESS_MAX_BUFFER_GROWTH ) );
             char * newBuffer = (char *)ALLOC( newBufferSize + 1 ); // +1 so we can always add a null char
             if ( buffer.Get() )
             {
@@ -711,8 +869,12 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
         ssize_t result = read( handle, buffer.Get() + sizeSoFar, spaceInBuffer );
         if ( result == -1 )
         {
-            ASSERT( false ); // error!
-            return;
+            ASSERT( errno == EINTR ); // error!
+            return true;
+        }
+        if ( result == 0 )
+        {
+            return false; // end of file - the child (and any children it shared the pipe with) closed it
         }
 
         // account for newly read bytes
@@ -720,6 +882,60 @@ bool Process::ReadAllData( AutoPtr< char > & outMem, uint32_t * outMemSize,
 
         // keep data null char terminated for caller convenience
         buffer.Get()[ sizeSoFar ] = '\000';
+        return true;
+    }
+#endif
+
+// WaitForOutputOrExit
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    void Process::WaitForOutputOrExit( bool stdOutOpen, bool stdErrOpen, uint32_t timeoutMS ) const
+    {
+        PROFILE_FUNCTION
+
+        // Wait on the pipes which are still open and the process exit (where supported)
+        pollfd pfds[ 3 ];
+        nfds_t numFDs = 0;
+        const int fds[ 3 ] = { stdOutOpen ? m_StdOutRead : -1,
+                               stdErrOpen ? m_StdErrRead : -1,
+                               m_PidFD };
+        for ( const int fd : fds )
+        {
+            if ( fd != -1 )
+            {
+                pfds[ numFDs ].fd = fd;
+                pfds[ numFDs ].events = POLLIN;
+                pfds[ numFDs ].revents = 0;
+                ++numFDs;
+            }
+        }
+
+        // Without a pidfd, we can only see the exit by checking periodically.
+        // Once the output is closed, the process is usually about to exit
+        if ( ( m_PidFD == -1 ) && ( stdOutOpen == false ) && ( stdErrOpen == false ) )
+        {
+            timeoutMS = Math::Min< uint32_t >( timeoutMS, 1 );
+        }
+
+        // Interruption by a signal is harmless, as the caller will check state and wait again
+        poll( pfds, numFDs, (int)timeoutMS );
+    }
+#endif
+
+// CloseHandles
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    void Process::CloseHandles()
+    {
+        VERIFY( close( m_StdOutRead ) == 0 );
+        VERIFY( close( m_StdErrRead ) == 0 );
+        m_StdOutRead = -1;
+        m_StdErrRead = -1;
+        if ( m_PidFD != -1 )
+        {
+            VERIFY( close( m_PidFD ) == 0 );
+            m_PidFD = -1;
+        }
     }
 #endif
 
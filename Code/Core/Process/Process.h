@@ -54,7 +54,9 @@ private:
         char * Read( void * handle, uint32_t * bytesRead );
         uint32_t Read( void * handle, char * outputBuffer, uint32_t outputBufferSize );
     #else
-        void Read( int handle, AutoPtr< char > & buffer, uint32_t & sizeSoFar, uint32_t & bufferSize );
+        bool Read( int handle, AutoPtr< char > & buffer, uint32_t & sizeSoFar, uint32_t & bufferSize );
+        void WaitForOutputOrExit( bool stdOutOpen, bool stdErrOpen, uint32_t timeoutMS ) const;
+        void CloseHandles();
     #endif
 
     void Terminate();
@@ -92,6 +94,7 @@ private:
         mutable int m_ReturnStatus;
         int m_StdOutRead;
         int m_StdErrRead;
+        int m_PidFD;            // signalled when the child exits (-1 if unsupported)
     #endif
     bool m_HasAborted;
     const volatile bool * m_MasterAbortFlag; // This member is set when we must cancel processes asap when the master process dies.
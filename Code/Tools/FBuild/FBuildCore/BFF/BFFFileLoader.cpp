@@ -0,0 +1,296 @@
+// BFFFileLoader
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "BFFFileLoader.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+
+// Core
+#include "Core/Env/Env.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/CRC32.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Strings/AStackString.h"
+
+#include <string.h> // for memchr
+
+// Defines
+//------------------------------------------------------------------------------
+#define BFF_FILE_LOADER_MAX_THREADS ( 8 )
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BFFFileLoader::BFFFileLoader()
+    : m_Files( 64, true )
+    , m_NextFileToLoad( 0 )
+    , m_Exit( false )
+    , m_Threads( BFF_FILE_LOADER_MAX_THREADS, false )
+{
+    // loading is often waiting on the disk, so overlaps the parsing even
+    // without spare cores
+    const uint32_t numThreads = Math::Min< uint32_t >( Env::GetNumProcessors(), BFF_FILE_LOADER_MAX_THREADS );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        m_Threads.Append( Thread::CreateThread( ThreadFunc, "BFFFileLoader", ( 64 * KILOBYTE ), this ) );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BFFFileLoader::~BFFFileLoader()
+{
+    // stop the workers (they finish the file they're loading, if any)
+    m_Exit = true;
+    m_WorkSemaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle thread : m_Threads )
+    {
+        Thread::WaitForThread( thread );
+        Thread::CloseHandle( thread );
+    }
+
+    for ( File * file : m_Files )
+    {
+        FREE( file->m_Data );
+        FDELETE( file );
+    }
+}
+
+// PrefetchIncludes
+//------------------------------------------------------------------------------
+void BFFFileLoader::PrefetchIncludes( const AString & fileName, const char * data, uint32_t size )
+{
+    // includes are relative to the including file
+    const char * lastSlash = fileName.FindLast( NATIVE_SLASH );
+    lastSlash = lastSlash ? ( lastSlash + 1 ) : fileName.Get();
+    const AStackString<> includeDir( fileName.Get(), lastSlash );
+
+    // find lines of the form: #include "literal/path.bff"
+    // - anything else (including paths needing substitutions) is left to the parser
+    const char * const end = data + size;
+    const char * pos = data;
+    while ( ( pos = static_cast< const char * >( memchr( pos, '#', (size_t)( end - pos ) ) ) ) != nullptr )
+    {
+        // directives are first on a line
+        const char * lineStart = pos;
+        while ( ( lineStart > data ) && ( ( lineStart[ -1 ] == ' ' ) || ( lineStart[ -1 ] == '\t' ) ) )
+        {
+            --lineStart;
+        }
+        ++pos;
+        if ( ( lineStart > data ) && ( lineStart[ -1 ] != '\n' ) && ( lineStart[ -1 ] != '\r' ) )
+        {
+            continue;
+        }
+
+        while ( ( pos < end ) && ( ( *pos == ' ' ) || ( *pos == '\t' ) ) )
+        {
+            ++pos;
+        }
+        if ( ( ( end - pos ) <= 7 ) || ( AString::StrNCmp( pos, "include", 7 ) != 0 ) )
+        {
+            continue;
+        }
+        pos += 7;
+        while ( ( pos < end ) && ( ( *pos == ' ' ) || ( *pos == '\t' ) ) )
+        {
+            ++pos;
+        }
+        if ( ( pos == end ) || ( *pos != '"' ) )
+        {
+            continue;
+        }
+        const char * const includeStart = ++pos;
+        while ( ( pos < end ) && ( *pos != '"' ) && ( *pos != '\n' ) && ( *pos != '$' ) && ( *pos != '^' ) )
+        {
+            ++pos;
+        }
+        if ( ( pos == end ) || ( *pos != '"' ) )
+        {
+            continue;
+        }
+
+        AStackString<> include( includeStart, pos );
+        AStackString<> includePath;
+        if ( PathUtils::IsFullPath( include ) == false )
+        {
+            includePath = includeDir;
+        }
+        includePath += include;
+        AStackString<> includePathClean;
+        NodeGraph::CleanPath( includePath, includePathClean );
+        QueueFile( includePathClean );
+    }
+}
+
+// GetFile
+//------------------------------------------------------------------------------
+const BFFFileLoader::File * BFFFileLoader::GetFile( const AString & fileName )
+{
+    File * file;
+    bool loadHere = false;
+    {
+        MutexHolder mh( m_Mutex );
+        file = FindFile( fileName, CRC32::CalcLower( fileName ) );
+        if ( file == nullptr )
+        {
+            return nullptr;
+        }
+
+        // rather than wait for a worker to get to it, load it now
+        if ( file->m_State == QUEUED )
+        {
+            file->m_State = LOADING;
+            loadHere = true;
+        }
+    }
+
+    if ( loadHere )
+    {
+        LoadFile( *file );
+    }
+
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( file->m_State == LOADED )
+            {
+                return file;
+            }
+            if ( file->m_State == FAILED )
+            {
+                return nullptr;
+            }
+        }
+        m_LoadedSemaphore.Wait();
+    }
+}
+
+// QueueFile
+//------------------------------------------------------------------------------
+void BFFFileLoader::QueueFile( const AString & fileName )
+{
+    const uint32_t fileNameCRC = CRC32::CalcLower( fileName );
+    {
+        MutexHolder mh( m_Mutex );
+        if ( FindFile( fileName, fileNameCRC ) )
+        {
+            return; // already found through another include
+        }
+
+        File * file = FNEW( File );
+        file->m_FileName = fileName;
+        file->m_FileNameCRC = fileNameCRC;
+        file->m_Data = nullptr;
+        file->m_Size = 0;
+        file->m_TimeStamp = 0;
+        file->m_DataHash = 0;
+        file->m_State = QUEUED;
+        m_Files.Append( file );
+    }
+    m_WorkSemaphore.Signal();
+}
+
+// FindFile
+//------------------------------------------------------------------------------
+BFFFileLoader::File * BFFFileLoader::FindFile( const AString & fileName, uint32_t fileNameCRC ) const
+{
+    for ( File * file : m_Files )
+    {
+        if ( ( file->m_FileNameCRC == fileNameCRC ) && PathUtils::ArePathsEqual( file->m_FileName, fileName ) )
+        {
+            return file;
+        }
+    }
+    return nullptr;
+}
+
+// LoadFile
+//------------------------------------------------------------------------------
+void BFFFileLoader::LoadFile( File & file )
+{
+    ASSERT( file.m_State == LOADING );
+
+    bool ok = false;
+    FileStream f;
+    if ( f.Open( file.m_FileName.Get(), FileStream::READ_ONLY ) )
+    {
+        const uint32_t size = (uint32_t)f.GetFileSize();
+        char * data = (char *)ALLOC( size + 1 ); // extra byte for null character sentinel
+        if ( f.Read( data, size ) == size )
+        {
+            data[ size ] = '\000';
+            file.m_Data = data;
+            file.m_Size = size;
+            file.m_TimeStamp = FileIO::GetFileLastWriteTime( file.m_FileName );
+            file.m_DataHash = xxHash::Calc64( data, size );
+            ok = true;
+        }
+        else
+        {
+            FREE( data );
+        }
+    }
+
+    // files included from this one are found before the parser gets to them
+    if ( ok )
+    {
+        PrefetchIncludes( file.m_FileName, file.m_Data, file.m_Size );
+    }
+
+    MutexHolder mh( m_Mutex );
+    file.m_State = ok ? LOADED : FAILED;
+}
+
+// WorkerLoop
+//------------------------------------------------------------------------------
+void BFFFileLoader::WorkerLoop()
+{
+    for ( ;; )
+    {
+        m_WorkSemaphore.Wait();
+        if ( m_Exit )
+        {
+            return;
+        }
+
+        File * file = nullptr;
+        {
+            MutexHolder mh( m_Mutex );
+            while ( m_NextFileToLoad < m_Files.GetSize() )
+            {
+                File * candidate = m_Files[ m_NextFileToLoad++ ];
+                if ( candidate->m_State == QUEUED )
+                {
+                    candidate->m_State = LOADING;
+                    file = candidate;
+                    break;
+                }
+            }
+        }
+        if ( file == nullptr )
+        {
+            continue; // the parser loaded it already
+        }
+
+        LoadFile( *file );
+        m_LoadedSemaphore.Signal();
+    }
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t BFFFileLoader::ThreadFunc( void * userData )
+{
+    static_cast< BFFFileLoader * >( userData )->WorkerLoop();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
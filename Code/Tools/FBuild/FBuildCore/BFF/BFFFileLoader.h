@@ -0,0 +1,71 @@
+// BFFFileLoader - loads included BFF files ahead of the parser
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Singleton.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// BFFFileLoader
+//  - While the parser works through a file, the files it includes (and the
+//    files they include) are read, hashed and scanned for further includes
+//    on worker threads.
+//  - Only includes with a literal path can be found ahead; others are loaded
+//    by the parser when it reaches them, as before.
+//------------------------------------------------------------------------------
+class BFFFileLoader : public Singleton< BFFFileLoader >
+{
+public:
+    explicit BFFFileLoader();
+    ~BFFFileLoader();
+
+    enum State : uint32_t
+    {
+        QUEUED,
+        LOADING,
+        LOADED,
+        FAILED
+    };
+
+    struct File
+    {
+        AString     m_FileName;     // clean path
+        uint32_t    m_FileNameCRC;
+        char *      m_Data;         // followed by a null character sentinel
+        uint32_t    m_Size;         // excluding sentinel
+        uint64_t    m_TimeStamp;
+        uint64_t    m_DataHash;
+        State       m_State;
+    };
+
+    // Start loading the files included by a file the parser is about to use
+    void PrefetchIncludes( const AString & fileName, const char * data, uint32_t size );
+
+    // Get a file loaded ahead, waiting for it if needed
+    // - returns nullptr if the file wasn't found ahead or couldn't be loaded,
+    //   in which case the parser should load it itself (and report any errors)
+    const File * GetFile( const AString & fileName );
+
+private:
+    void QueueFile( const AString & fileName );
+    File * FindFile( const AString & fileName, uint32_t fileNameCRC ) const;
+    void LoadFile( File & file );
+    void WorkerLoop();
+    static uint32_t ThreadFunc( void * userData );
+
+    Mutex                           m_Mutex;
+    Semaphore                       m_WorkSemaphore;    // signalled for each queued file
+    Semaphore                       m_LoadedSemaphore;  // signalled for each file loaded by a worker
+    Array< File * >                 m_Files;            // in the order they were found
+    size_t                          m_NextFileToLoad;
+    volatile bool                   m_Exit;
+    Array< Thread::ThreadHandle >   m_Threads;
+};
+
+//------------------------------------------------------------------------------
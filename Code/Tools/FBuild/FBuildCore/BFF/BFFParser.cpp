@@ -6,6 +6,7 @@
 #include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
 
 #include "BFFParser.h"
+#include "BFFFileLoader.h"
 #include "BFFIterator.h"
 #include "BFFMacros.h"
 #include "BFFStackFrame.h"
@@ -807,6 +808,18 @@ bool BFFParser::ParseIncludeDirective( BFFIterator & iter )
         return true;
     }
 
+    // use the include if it was loaded ahead
+    if ( BFFFileLoader::IsValid() )
+    {
+        const BFFFileLoader::File * file = BFFFileLoader::Get().GetFile( includeToUseClean );
+        if ( file )
+        {
+            BFFParser parser( m_NodeGraph );
+            const bool pushStackFrame = false; // include is treated as if injected at this point
+            return parser.Parse( file->m_Data, file->m_Size, file->m_FileName.Get(), file->m_TimeStamp, file->m_DataHash, pushStackFrame );
+        }
+    }
+
     FileStream f;
     if ( f.Open( includeToUseClean.Get(), FileStream::READ_ONLY ) == false )
     {
@@ -826,6 +839,10 @@ bool BFFParser::ParseIncludeDirective( BFFIterator & iter )
     }
     const uint64_t includeDataHash = xxHash::Calc64( mem.Get(), fileSize );
     mem.Get()[ fileSize ] = '\000'; // sentinel
+    if ( BFFFileLoader::IsValid() )
+    {
+        BFFFileLoader::Get().PrefetchIncludes( includeToUseClean, mem.Get(), fileSize );
+    }
     BFFParser parser( m_NodeGraph );
     const bool pushStackFrame = false; // include is treated as if injected at this point
     return parser.Parse( mem.Get(), fileSize, includeToUseClean.Get(), includeTimeStamp, includeDataHash, pushStackFrame );
@@ -1276,19 +1293,23 @@ bool BFFParser::StoreVariableString( const AString & name,
         if ( var->IsString() )
         {
             // OK - can concat String to String
-            AStackString< 1024 > finalValue( var->GetString() );
             if ( *operatorIter == BFF_VARIABLE_CONCATENATION )
             {
-                finalValue += value;
-            }
-            else
-            {
-                finalValue.Replace( value.Get(), "" );
+                BFFStackFrame::ConcatVarString( name, value, frame );
+                return true;
             }
 
+            AStackString< 1024 > finalValue( var->GetString() );
+            finalValue.Replace( value.Get(), "" );
             BFFStackFrame::SetVarString( name, finalValue, frame );
             return true;
         }
+        else if ( var->IsArrayOfStrings() && ( *operatorIter == BFF_VARIABLE_CONCATENATION ) )
+        {
+            // OK - can concat String to ArrayOfStrings (in place)
+            BFFStackFrame::ConcatVarArrayOfStrings( name, value, frame );
+            return true;
+        }
         else if ( var->IsArrayOfStrings() || dstIsEmpty )
         {
             // OK - can concat String to ArrayOfStrings or to empty array
@@ -1362,6 +1383,7 @@ bool BFFParser::StoreVariableArray( const AString & name,
 
     // find existing
     const BFFVariable * var = BFFStackFrame::GetVar( name, frame );
+    bool appendToExisting = false;
 
     // are we concatenating?
     if ( ( *operatorIter == BFF_VARIABLE_CONCATENATION ) ||
@@ -1377,8 +1399,8 @@ bool BFFParser::StoreVariableArray( const AString & name,
         // make sure existing is an array
         if ( var->IsArrayOfStrings() )
         {
-            // get values to start with
-            values = var->GetArrayOfStrings();
+            // new values are appended in place
+            appendToExisting = true;
         }
         else if ( var->IsArrayOfStructs() )
         {
@@ -1604,6 +1626,11 @@ bool BFFParser::StoreVariableArray( const AString & name,
         // structs
         BFFStackFrame::SetVarArrayOfStructs( name, structValues, frame );
     }
+    else if ( appendToExisting )
+    {
+        // strings, added to the existing ones
+        BFFStackFrame::ConcatVarArrayOfStrings( name, values, frame );
+    }
     else if ( varType == BFFVariable::VAR_ARRAY_OF_STRINGS )
     {
         // strings
@@ -1756,6 +1783,12 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         // Mismatched - is there a supported conversion?
 
         // String to ArrayOfStrings or empty array
+        if ( ( dstType == BFFVariable::VAR_ARRAY_OF_STRINGS ) && !dstIsEmpty &&
+             ( srcType == BFFVariable::VAR_STRING ) && concat )
+        {
+            BFFStackFrame::ConcatVarArrayOfStrings( dstName, varSrc->GetString(), dstFrame );
+            return true;
+        }
         if ( ( dstType == BFFVariable::VAR_ARRAY_OF_STRINGS || dstIsEmpty ) &&
              ( srcType == BFFVariable::VAR_STRING ) )
         {
@@ -1813,7 +1846,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         {
             if ( concat )
             {
-                BFFStackFrame::SetVarArrayOfStrings( dstName, varDst->GetArrayOfStrings(), dstFrame );
+                BFFStackFrame::SetVar( dstName, varDst, dstFrame );
             }
             else
             {
@@ -1827,7 +1860,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         {
             if ( concat )
             {
-                BFFStackFrame::SetVarArrayOfStructs( dstName, varDst->GetArrayOfStructs(), dstFrame );
+                BFFStackFrame::SetVar( dstName, varDst, dstFrame );
             }
             else
             {
@@ -1839,14 +1872,14 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         // ArrayOfStrings to empty array, assignment or concatenation
         if ( dstIsEmpty && srcType == BFFVariable::VAR_ARRAY_OF_STRINGS && !subtract )
         {
-            BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetArrayOfStrings(), dstFrame );
+            BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             return true;
         }
 
         // ArrayOfStructs to empty array, assignment or concatenation
         if ( dstIsEmpty && srcType == BFFVariable::VAR_ARRAY_OF_STRUCTS && !subtract )
         {
-            BFFStackFrame::SetVarArrayOfStructs( dstName, varSrc->GetArrayOfStructs(), dstFrame );
+            BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             return true;
         }
     }
@@ -1858,9 +1891,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         {
             if ( concat )
             {
-                AStackString< 2048 > finalValue(varDst->GetString());
-                finalValue += varSrc->GetString();
-                BFFStackFrame::SetVarString( dstName, finalValue, dstFrame );
+                BFFStackFrame::ConcatVarString( dstName, varSrc->GetString(), dstFrame );
             }
             else if ( subtract )
             {
@@ -1870,7 +1901,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
             }
             else
             {
-                BFFStackFrame::SetVarString( dstName, varSrc->GetString(), dstFrame );
+                BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             }
             return true;
         }
@@ -1879,15 +1910,11 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
         {
             if ( concat )
             {
-                const unsigned int num = (unsigned int)( varSrc->GetArrayOfStrings().GetSize() + varDst->GetArrayOfStrings().GetSize() );
-                Array< AString > values( num, false );
-                values.Append( varDst->GetArrayOfStrings() );
-                values.Append( varSrc->GetArrayOfStrings() );
-                BFFStackFrame::SetVarArrayOfStrings( dstName, values, dstFrame );
+                BFFStackFrame::ConcatVarArrayOfStrings( dstName, varSrc->GetArrayOfStrings(), dstFrame );
             }
             else
             {
-                BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetArrayOfStrings(), dstFrame );
+                BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             }
             return true;
         }
@@ -1904,7 +1931,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
             }
             else
             {
-                BFFStackFrame::SetVarArrayOfStructs( dstName, varSrc->GetArrayOfStructs(), dstFrame );
+                BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             }
             return true;
         }
@@ -1934,7 +1961,6 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
 
         if ( ( srcType == BFFVariable::VAR_STRUCT ) && !subtract )
         {
-            const Array< const BFFVariable * > & srcMembers = varSrc->GetStructMembers();
             if ( concat )
             {
                 BFFVariable *const newVar = BFFStackFrame::ConcatVars( dstName, varDst, varSrc, dstFrame, operatorIter );
@@ -1946,7 +1972,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, BFFIterator &
             else
             {
                 // Register this variable
-                BFFStackFrame::SetVarStruct( dstName, srcMembers, dstFrame );
+                BFFStackFrame::SetVar( dstName, varSrc, dstFrame );
             }
             return true;
         }
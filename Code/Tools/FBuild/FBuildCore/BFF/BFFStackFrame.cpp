@@ -10,6 +10,12 @@
 #include "Core/Mem/Mem.h"
 #include "Core/Strings/AStackString.h"
 
+#include <string.h> // for memset
+
+// Defines
+//------------------------------------------------------------------------------
+#define BFF_STACKFRAME_TABLE_MIN_VARIABLES ( 16 )
+
 //
 /*static*/ BFFStackFrame * BFFStackFrame::s_StackHead = nullptr;
 
@@ -17,6 +23,7 @@
 //------------------------------------------------------------------------------
 BFFStackFrame::BFFStackFrame()
 : m_Variables( 32, true )
+, m_VariableTable( 0, true )
 {
     // hook into top of stack chain
     m_Next = s_StackHead;
@@ -58,7 +65,7 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarArrayOfStrings
@@ -79,7 +86,7 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, values ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarBool
@@ -98,7 +105,7 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarInt
@@ -117,7 +124,7 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarStruct
@@ -138,7 +145,7 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, members ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarArrayOfStructs
@@ -159,30 +166,64 @@ BFFStackFrame::~BFFStackFrame()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, structs, BFFVariable::VAR_ARRAY_OF_STRUCTS ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 
 // SetVar
 //------------------------------------------------------------------------------
 /*static*/ void BFFStackFrame::SetVar( const BFFVariable * var, BFFStackFrame * frame )
+{
+    ASSERT( var );
+    SetVar( var->GetName(), var, frame );
+}
+
+// SetVar
+//------------------------------------------------------------------------------
+/*static*/ void BFFStackFrame::SetVar( const AString & name, const BFFVariable * var, BFFStackFrame * frame )
 {
     frame = frame ? frame : s_StackHead;
     ASSERT( frame );
 
     ASSERT( var );
 
-    switch ( var->GetType() )
+    BFFVariable * existingVar = frame->GetVarMutableNoRecurse( name );
+    if ( existingVar )
     {
-        case BFFVariable::VAR_ANY:              ASSERT( false ); break;
-        case BFFVariable::VAR_STRING:           SetVarString( var->GetName(), var->GetString(), frame ); break;
-        case BFFVariable::VAR_BOOL:             SetVarBool( var->GetName(), var->GetBool(), frame ); break;
-        case BFFVariable::VAR_ARRAY_OF_STRINGS: SetVarArrayOfStrings( var->GetName(), var->GetArrayOfStrings(), frame ); break;
-        case BFFVariable::VAR_INT:              SetVarInt( var->GetName(), var->GetInt(), frame ); break;
-        case BFFVariable::VAR_STRUCT:           SetVarStruct( var->GetName(), var->GetStructMembers(), frame ); break;
-        case BFFVariable::VAR_ARRAY_OF_STRUCTS: SetVarArrayOfStructs( var->GetName(), var->GetArrayOfStructs(), frame ); break;
-        case BFFVariable::MAX_VAR_TYPES: ASSERT( false ); break;
+        existingVar->SetValue( *var );
+        return;
     }
+
+    // variable not found at this level, so create it
+    BFFVariable * v = FNEW( BFFVariable( name, *var ) );
+    frame->AddVar( v );
+}
+
+// ConcatVarString
+//------------------------------------------------------------------------------
+/*static*/ void BFFStackFrame::ConcatVarString( const AString & name,
+                                                const AString & value,
+                                                BFFStackFrame * frame )
+{
+    GetVarForModification( name, frame )->AppendValueString( value );
+}
+
+// ConcatVarArrayOfStrings
+//------------------------------------------------------------------------------
+/*static*/ void BFFStackFrame::ConcatVarArrayOfStrings( const AString & name,
+                                                        const AString & value,
+                                                        BFFStackFrame * frame )
+{
+    GetVarForModification( name, frame )->AppendValueArrayOfStrings( value );
+}
+
+// ConcatVarArrayOfStrings
+//------------------------------------------------------------------------------
+/*static*/ void BFFStackFrame::ConcatVarArrayOfStrings( const AString & name,
+                                                        const Array< AString > & values,
+                                                        BFFStackFrame * frame )
+{
+    GetVarForModification( name, frame )->AppendValueArrayOfStrings( values );
 }
 
 // ConcatVars
@@ -240,23 +281,18 @@ BFFVariable * BFFStackFrame::ConcatVars( const AString & name,
 //------------------------------------------------------------------------------
 const BFFVariable * BFFStackFrame::GetVariableRecurse( const AString & name ) const
 {
-    // look at this scope level
-    Array< BFFVariable * >::Iter i = m_Variables.Begin();
-    Array< BFFVariable * >::Iter end = m_Variables.End();
-    for( ; i < end ; ++i )
+    const uint32_t nameHash = BFFVariable::CalcNameHash( name );
+
+    // look at this scope level, then the parents
+    for ( const BFFStackFrame * frame = this; frame; frame = frame->m_Next )
     {
-        if ( ( *i )->GetName() == name )
+        const int32_t index = frame->FindVarIndex( name, nameHash );
+        if ( index >= 0 )
         {
-            return *i;
+            return frame->m_Variables[ (size_t)index ];
         }
     }
 
-    // look at parent
-    if ( m_Next )
-    {
-        return m_Next->GetVariableRecurse( name );
-    }
-
     // not found
     return nullptr;
 }
@@ -287,12 +323,15 @@ const BFFVariable * BFFStackFrame::GetLocalVar( const AString & name ) const
     variable = nullptr;
 
     BFFStackFrame * parentFrame = frame ? frame->GetParent() : GetCurrent()->GetParent();
+    const uint32_t nameHash = BFFVariable::CalcNameHash( name );
 
     // look for the scope containing the original variable
     for ( ; parentFrame; parentFrame = parentFrame->GetParent() )
     {
-        if ( ( variable = parentFrame->GetLocalVar( name ) ) != nullptr )
+        const int32_t index = parentFrame->FindVarIndex( name, nameHash );
+        if ( index >= 0 )
         {
+            variable = parentFrame->m_Variables[ (size_t)index ];
             return parentFrame;
         }
     }
@@ -308,6 +347,15 @@ const BFFVariable * BFFStackFrame::GetLocalVar( const AString & name ) const
     // we shouldn't be calling this if there aren't any stack frames
     ASSERT( s_StackHead );
 
+    // variables are stored with the '.' prefix, so find them directly
+    AStackString<> internalName( "." );
+    internalName += name;
+    const BFFVariable * var = s_StackHead->GetVariableRecurse( internalName );
+    if ( var )
+    {
+        return var;
+    }
+
     // recurse up the stack
     return s_StackHead->GetVariableRecurse( name, BFFVariable::VAR_ANY );
 }
@@ -355,17 +403,8 @@ const BFFVariable * BFFStackFrame::GetVarNoRecurse( const AString & name ) const
     ASSERT( s_StackHead ); // we shouldn't be calling this if there aren't any stack frames
 
     // look at this scope level
-    Array< BFFVariable * >::Iter i = m_Variables.Begin();
-    Array< BFFVariable * >::Iter end = m_Variables.End();
-    for( ; i < end ; ++i )
-    {
-        if ( ( *i )->GetName() == name )
-        {
-            return *i;
-        }
-    }
-
-    return nullptr;
+    const int32_t index = FindVarIndex( name, BFFVariable::CalcNameHash( name ) );
+    return ( index >= 0 ) ? m_Variables[ (size_t)index ] : nullptr;
 }
 
 // GetVarMutableNoRecurse
@@ -375,17 +414,30 @@ BFFVariable * BFFStackFrame::GetVarMutableNoRecurse( const AString & name )
     ASSERT( s_StackHead ); // we shouldn't be calling this if there aren't any stack frames
 
     // look at this scope level
-    Array< BFFVariable * >::Iter i = m_Variables.Begin();
-    Array< BFFVariable * >::Iter end = m_Variables.End();
-    for( ; i < end ; ++i )
+    const int32_t index = FindVarIndex( name, BFFVariable::CalcNameHash( name ) );
+    return ( index >= 0 ) ? m_Variables[ (size_t)index ] : nullptr;
+}
+
+// GetVarForModification
+//------------------------------------------------------------------------------
+/*static*/ BFFVariable * BFFStackFrame::GetVarForModification( const AString & name, BFFStackFrame * frame )
+{
+    BFFStackFrame * dstFrame = frame ? frame : s_StackHead;
+    ASSERT( dstFrame );
+
+    BFFVariable * var = dstFrame->GetVarMutableNoRecurse( name );
+    if ( var )
     {
-        if ( ( *i )->GetName() == name )
-        {
-            return *i;
-        }
+        return var;
     }
 
-    return nullptr;
+    // found in a parent, so modify a copy in this frame (sharing the value
+    // until it is modified)
+    const BFFVariable * parentVar = GetVar( name, frame );
+    ASSERT( parentVar );
+    var = FNEW( BFFVariable( *parentVar ) );
+    dstFrame->AddVar( var );
+    return var;
 }
 
 // CreateOrReplaceVarMutableNoRecurse
@@ -396,19 +448,110 @@ void BFFStackFrame::CreateOrReplaceVarMutableNoRecurse( BFFVariable *var )
     ASSERT( var );
 
     // look at this scope level
-    Array< BFFVariable * >::Iter i = m_Variables.Begin();
-    Array< BFFVariable * >::Iter end = m_Variables.End();
-    for( ; i < end ; ++i )
+    const int32_t index = FindVarIndex( var->GetName(), var->GetNameHash() );
+    if ( index >= 0 )
     {
-        if ( ( *i )->GetName() == var->GetName() )
+        // replaced in place, so the table is still valid
+        FDELETE m_Variables[ (size_t)index ];
+        m_Variables[ (size_t)index ] = var;
+        return;
+    }
+
+    AddVar( var );
+}
+
+// FindVarIndex
+//------------------------------------------------------------------------------
+int32_t BFFStackFrame::FindVarIndex( const AString & name, uint32_t nameHash ) const
+{
+    // small scopes are searched linearly
+    if ( m_VariableTable.IsEmpty() )
+    {
+        const size_t numVariables = m_Variables.GetSize();
+        for ( size_t i = 0; i < numVariables; ++i )
         {
-            FDELETE *i;
-            *i = var;
-            return;
+            const BFFVariable * var = m_Variables[ i ];
+            if ( ( var->GetNameHash() == nameHash ) && ( var->GetName() == name ) )
+            {
+                return (int32_t)i;
+            }
         }
+        return -1;
     }
 
+    // larger scopes use the table (linear probing)
+    const size_t mask = ( m_VariableTable.GetSize() - 1 );
+    for ( size_t i = ( nameHash & mask ); ; i = ( ( i + 1 ) & mask ) )
+    {
+        const uint32_t slot = m_VariableTable[ i ];
+        if ( slot == 0 )
+        {
+            return -1;
+        }
+        const BFFVariable * var = m_Variables[ slot - 1 ];
+        if ( ( var->GetNameHash() == nameHash ) && ( var->GetName() == name ) )
+        {
+            return (int32_t)( slot - 1 );
+        }
+    }
+}
+
+// AddVar
+//------------------------------------------------------------------------------
+void BFFStackFrame::AddVar( BFFVariable * var )
+{
     m_Variables.Append( var );
+    const size_t numVariables = m_Variables.GetSize();
+
+    if ( m_VariableTable.IsEmpty() )
+    {
+        if ( numVariables >= BFF_STACKFRAME_TABLE_MIN_VARIABLES )
+        {
+            RebuildVariableTable();
+        }
+        return;
+    }
+
+    // keep load factor below 1/2
+    if ( ( numVariables * 2 ) > m_VariableTable.GetSize() )
+    {
+        RebuildVariableTable();
+        return;
+    }
+
+    const size_t mask = ( m_VariableTable.GetSize() - 1 );
+    size_t i = ( var->GetNameHash() & mask );
+    while ( m_VariableTable[ i ] != 0 )
+    {
+        i = ( ( i + 1 ) & mask );
+    }
+    m_VariableTable[ i ] = (uint32_t)numVariables;
+}
+
+// RebuildVariableTable
+//------------------------------------------------------------------------------
+void BFFStackFrame::RebuildVariableTable()
+{
+    // power of 2 number of slots, with room to grow
+    const size_t numVariables = m_Variables.GetSize();
+    size_t numSlots = 64;
+    while ( numSlots < ( numVariables * 4 ) )
+    {
+        numSlots <<= 1;
+    }
+    m_VariableTable.SetSize( numSlots );
+    memset( m_VariableTable.Begin(), 0, numSlots * sizeof( uint32_t ) );
+
+    const size_t mask = ( numSlots - 1 );
+    for ( size_t index = 0; index < numVariables; ++index )
+    {
+        size_t i = ( m_Variables[ index ]->GetNameHash() & mask );
+        while ( m_VariableTable[ i ] != 0 )
+        {
+            i = ( ( i + 1 ) & mask );
+        }
+        m_VariableTable[ i ] = (uint32_t)( index + 1 );
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -39,8 +39,21 @@ public:
                                       const Array< const BFFVariable * > & structs,
                                       BFFStackFrame * frame );
 
-    // set from an existing variable
+    // set from an existing variable (sharing its value until either is modified)
     static void SetVar( const BFFVariable * var, BFFStackFrame * frame );
+    static void SetVar( const AString & name, const BFFVariable * var, BFFStackFrame * frame );
+
+    // append to the value of an existing variable (found as GetVar would find
+    // it, and copied into the frame first if it was found in a parent)
+    static void ConcatVarString( const AString & name,
+                                 const AString & value,
+                                 BFFStackFrame * frame );
+    static void ConcatVarArrayOfStrings( const AString & name,
+                                         const AString & value,
+                                         BFFStackFrame * frame );
+    static void ConcatVarArrayOfStrings( const AString & name,
+                                         const Array< AString > & values,
+                                         BFFStackFrame * frame );
 
     // set from two existing variable
     static BFFVariable * ConcatVars( const AString & name,
@@ -80,9 +93,20 @@ private:
 
     void CreateOrReplaceVarMutableNoRecurse( BFFVariable * var );
 
+    static BFFVariable * GetVarForModification( const AString & name, BFFStackFrame * frame );
+
+    // find a variable at this scope level (index in m_Variables, or -1)
+    int32_t FindVarIndex( const AString & name, uint32_t nameHash ) const;
+    void AddVar( BFFVariable * var );
+    void RebuildVariableTable();
+
     // variables at current scope
     Array< BFFVariable * > m_Variables;
 
+    // hash table of m_Variables (index + 1, 0 for empty slots), only used
+    // once a scope has enough variables for a linear search to be slow
+    Array< uint32_t > m_VariableTable;
+
     // pointer to parent scope
     BFFStackFrame * m_Next;
 
@@ -24,114 +24,120 @@
     "ArrayOfStructs"
 };
 
+/*static*/ BFFVariable::Value BFFVariable::s_EmptyValue;
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, VarType type )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( type )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, true )
-, m_SubVariables( 0, true )
+, m_Value( nullptr )
 {
+    ShareValue( &s_EmptyValue );
 }
 
 // CONSTRUCTOR (copy)
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const BFFVariable & other )
 : m_Name( other.m_Name )
+, m_NameHash( other.m_NameHash )
 , m_Type( other.m_Type )
 , m_FreezeCount( 0 )
-, m_BoolValue( false )
-, m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, true )
-, m_SubVariables( 0, true )
+, m_BoolValue( other.m_BoolValue )
+, m_IntValue( other.m_IntValue )
+, m_Value( nullptr )
 {
-    switch( m_Type )
-    {
-        case VAR_ANY:               ASSERT( false ); break;
-        case VAR_STRING:            SetValueString( other.GetString() ); break;
-        case VAR_BOOL:              SetValueBool( other.GetBool() ); break;
-        case VAR_ARRAY_OF_STRINGS:  SetValueArrayOfStrings( other.GetArrayOfStrings() ); break;
-        case VAR_INT:               SetValueInt( other.GetInt() ); break;
-        case VAR_STRUCT:            SetValueStruct( other.GetStructMembers() ); break;
-        case VAR_ARRAY_OF_STRUCTS:  SetValueArrayOfStructs( other.GetArrayOfStructs() ); break;
-        case MAX_VAR_TYPES: ASSERT( false ); break;
-    }
+    ASSERT( ( m_Type != VAR_ANY ) && ( m_Type != MAX_VAR_TYPES ) );
+    ShareValue( other.m_Value );
+}
+
+// CONSTRUCTOR (copy with a different name)
+//------------------------------------------------------------------------------
+BFFVariable::BFFVariable( const AString & name, const BFFVariable & other )
+: m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
+, m_Type( other.m_Type )
+, m_FreezeCount( 0 )
+, m_BoolValue( other.m_BoolValue )
+, m_IntValue( other.m_IntValue )
+, m_Value( nullptr )
+{
+    ASSERT( ( m_Type != VAR_ANY ) && ( m_Type != MAX_VAR_TYPES ) );
+    ShareValue( other.m_Value );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, const AString & value )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_STRING )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( 0 )
-, m_StringValue( value )
-, m_ArrayValues( 0, false )
-, m_SubVariables( 0, true )
+, m_Value( nullptr )
 {
+    NewValue( VAR_STRING ).m_StringValue = value;
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, bool value )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_BOOL )
 , m_FreezeCount( 0 )
 , m_BoolValue( value )
 , m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, false )
-, m_SubVariables( 0, false )
+, m_Value( nullptr )
 {
+    ShareValue( &s_EmptyValue );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, const Array< AString > & values )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_ARRAY_OF_STRINGS )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, true )
-, m_SubVariables( 0, false )
+, m_Value( nullptr )
 {
-    m_ArrayValues = values;
+    NewValue( VAR_ARRAY_OF_STRINGS ).m_ArrayValues = values;
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, int i )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_INT )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( i )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, true )
-, m_SubVariables( 0, true )
+, m_Value( nullptr )
 {
+    ShareValue( &s_EmptyValue );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, const Array< const BFFVariable * > & values )
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_STRUCT )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, false )
-, m_SubVariables( values.GetSize(), true )
+, m_Value( nullptr )
 {
+    ShareValue( &s_EmptyValue );
     SetValueStruct( values );
 }
 
@@ -141,17 +147,17 @@ BFFVariable::BFFVariable( const AString & name,
                           const Array< const BFFVariable * > & structs,
                           VarType type ) // type for disambiguation
 : m_Name( name )
+, m_NameHash( CalcNameHash( name ) )
 , m_Type( VAR_ARRAY_OF_STRUCTS )
 , m_FreezeCount( 0 )
 , m_BoolValue( false )
 , m_IntValue( 0 )
-//, m_StringValue() // default construct this
-, m_ArrayValues( 0, false )
-, m_SubVariables( structs.GetSize(), true )
+, m_Value( nullptr )
 {
     // type for disambiguation only - sanity check it's the right type
     ASSERT( type == VAR_ARRAY_OF_STRUCTS ); (void)type;
 
+    ShareValue( &s_EmptyValue );
     SetValueArrayOfStructs( structs );
 }
 
@@ -159,13 +165,7 @@ BFFVariable::BFFVariable( const AString & name,
 //------------------------------------------------------------------------------
 BFFVariable::~BFFVariable()
 {
-    // clean up sub variables
-    for ( BFFVariable ** it = m_SubVariables.Begin();
-          it != m_SubVariables.End();
-          ++it )
-    {
-        FDELETE *it;
-    }
+    ShareValue( nullptr );
 }
 
 // SetValueString
@@ -173,8 +173,7 @@ BFFVariable::~BFFVariable()
 void BFFVariable::SetValueString( const AString & value )
 {
     ASSERT( 0 == m_FreezeCount );
-    m_Type = VAR_STRING;
-    m_StringValue = value;
+    NewValue( VAR_STRING ).m_StringValue = value;
 }
 
 // SetValueBool
@@ -182,6 +181,7 @@ void BFFVariable::SetValueString( const AString & value )
 void BFFVariable::SetValueBool( bool value )
 {
     ASSERT( 0 == m_FreezeCount );
+    ShareValue( &s_EmptyValue );
     m_Type = VAR_BOOL;
     m_BoolValue = value;
 }
@@ -191,8 +191,12 @@ void BFFVariable::SetValueBool( bool value )
 void BFFVariable::SetValueArrayOfStrings( const Array< AString > & values )
 {
     ASSERT( 0 == m_FreezeCount );
-    m_Type = VAR_ARRAY_OF_STRINGS;
-    m_ArrayValues = values;
+    if ( &values == &m_Value->m_ArrayValues )
+    {
+        m_Type = VAR_ARRAY_OF_STRINGS;
+        return; // self-assignment
+    }
+    NewValue( VAR_ARRAY_OF_STRINGS ).m_ArrayValues = values;
 }
 
 // SetValueInt
@@ -200,6 +204,7 @@ void BFFVariable::SetValueArrayOfStrings( const Array< AString > & values )
 void BFFVariable::SetValueInt( int i )
 {
     ASSERT( 0 == m_FreezeCount );
+    ShareValue( &s_EmptyValue );
     m_Type = VAR_INT;
     m_IntValue = i;
 }
@@ -211,10 +216,8 @@ void BFFVariable::SetValueStruct( const Array< const BFFVariable * > & values )
     ASSERT( 0 == m_FreezeCount );
 
     // build list of new members, but don't touch old ones yet to gracefully
-    // handle self-assignment
+    // handle self-assignment (members share their values with the originals)
     Array< BFFVariable * > newVars( values.GetSize(), false );
-
-    m_Type = VAR_STRUCT;
     for ( const BFFVariable ** it = values.Begin();
           it != values.End();
           ++it )
@@ -224,16 +227,8 @@ void BFFVariable::SetValueStruct( const Array< const BFFVariable * > & values )
         newVars.Append( newV );
     }
 
-    // free old members
-    for ( BFFVariable ** it = m_SubVariables.Begin();
-          it != m_SubVariables.End();
-          ++it )
-    {
-        FDELETE *it;
-    }
-
-    // swap
-    m_SubVariables.Swap( newVars );
+    // swap (freeing old members, unless still shared)
+    NewValue( VAR_STRUCT ).m_SubVariables.Swap( newVars );
 }
 
 // SetValueArrayOfStructs
@@ -243,10 +238,8 @@ void BFFVariable::SetValueArrayOfStructs( const Array< const BFFVariable * > & v
     ASSERT( 0 == m_FreezeCount );
 
     // build list of new members, but don't touch old ones yet to gracefully
-    // handle self-assignment
+    // handle self-assignment (members share their values with the originals)
     Array< BFFVariable * > newVars( values.GetSize(), false );
-
-    m_Type = VAR_ARRAY_OF_STRUCTS;
     for ( const BFFVariable ** it = values.Begin();
           it != values.End();
           ++it )
@@ -256,15 +249,160 @@ void BFFVariable::SetValueArrayOfStructs( const Array< const BFFVariable * > & v
         newVars.Append( newV );
     }
 
-    // free old members
+    // swap (freeing old members, unless still shared)
+    NewValue( VAR_ARRAY_OF_STRUCTS ).m_SubVariables.Swap( newVars );
+}
+
+// SetValue
+//------------------------------------------------------------------------------
+void BFFVariable::SetValue( const BFFVariable & other )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( ( other.m_Type != VAR_ANY ) && ( other.m_Type != MAX_VAR_TYPES ) );
+
+    // take everything before releasing our value, which may own other
+    // (a struct member with the same name as the struct)
+    const VarType type = other.m_Type;
+    const bool boolValue = other.m_BoolValue;
+    const int intValue = other.m_IntValue;
+    ShareValue( other.m_Value );
+    m_Type = type;
+    m_BoolValue = boolValue;
+    m_IntValue = intValue;
+}
+
+// AppendValueString
+//------------------------------------------------------------------------------
+void BFFVariable::AppendValueString( const AString & value )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( IsString() );
+    if ( &value == &m_Value->m_StringValue )
+    {
+        const AString copy( value ); // self-concatenation
+        ModifyValue().m_StringValue += copy;
+        return;
+    }
+    ModifyValue().m_StringValue += value;
+}
+
+// AppendValueArrayOfStrings
+//------------------------------------------------------------------------------
+void BFFVariable::AppendValueArrayOfStrings( const AString & value )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( IsArrayOfStrings() );
+    Value & v = ModifyValue();
+    if ( v.m_ArrayValues.IsEmpty() == false )
+    {
+        const AString * const begin = v.m_ArrayValues.Begin();
+        if ( ( &value >= begin ) && ( &value < v.m_ArrayValues.End() ) )
+        {
+            const AString copy( value ); // appending an element of itself
+            v.m_ArrayValues.Append( copy );
+            return;
+        }
+    }
+    v.m_ArrayValues.Append( value );
+}
+
+// AppendValueArrayOfStrings
+//------------------------------------------------------------------------------
+void BFFVariable::AppendValueArrayOfStrings( const Array< AString > & values )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( IsArrayOfStrings() );
+    if ( &values == &m_Value->m_ArrayValues )
+    {
+        const Array< AString > copy( values ); // self-concatenation
+        ModifyValue().m_ArrayValues.Append( copy );
+        return;
+    }
+    ModifyValue().m_ArrayValues.Append( values );
+}
+
+// ShareValue
+//------------------------------------------------------------------------------
+void BFFVariable::ShareValue( Value * value )
+{
+    if ( value )
+    {
+        ++value->m_RefCount;
+    }
+    Value * const oldValue = m_Value;
+    m_Value = value;
+    if ( oldValue && ( --oldValue->m_RefCount == 0 ) && ( oldValue != &s_EmptyValue ) )
+    {
+        FDELETE oldValue;
+    }
+}
+
+// NewValue
+//------------------------------------------------------------------------------
+BFFVariable::Value & BFFVariable::NewValue( VarType type )
+{
+    // the previous value is discarded, so strings and arrays of strings can
+    // re-use it if it isn't shared
+    const bool reuse = ( m_Value != nullptr ) && // not constructed yet
+                       ( m_Type == type ) &&
+                       ( ( type == VAR_STRING ) || ( type == VAR_ARRAY_OF_STRINGS ) ) &&
+                       ( m_Value->m_RefCount == 1 ) &&
+                       ( m_Value != &s_EmptyValue );
+    if ( reuse == false )
+    {
+        ShareValue( FNEW( Value ) );
+    }
+    m_Type = type;
+    return *m_Value;
+}
+
+// ModifyValue
+//------------------------------------------------------------------------------
+BFFVariable::Value & BFFVariable::ModifyValue()
+{
+    if ( ( m_Value->m_RefCount > 1 ) || ( m_Value == &s_EmptyValue ) )
+    {
+        // copy on write
+        ShareValue( FNEW( Value( *m_Value ) ) );
+    }
+    return *m_Value;
+}
+
+// Value (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+BFFVariable::Value::Value()
+: m_RefCount( 0 )
+, m_ArrayValues( 0, true )
+, m_SubVariables( 0, true )
+{
+}
+
+// Value (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+BFFVariable::Value::Value( const Value & other )
+: m_RefCount( 0 )
+, m_StringValue( other.m_StringValue )
+, m_ArrayValues( other.m_ArrayValues )
+, m_SubVariables( other.m_SubVariables.GetSize(), true )
+{
+    // members share their values with the originals
+    for ( const BFFVariable * var : other.m_SubVariables )
+    {
+        m_SubVariables.Append( FNEW( BFFVariable( *var ) ) );
+    }
+}
+
+// Value (DESTRUCTOR)
+//------------------------------------------------------------------------------
+BFFVariable::Value::~Value()
+{
+    // clean up sub variables
     for ( BFFVariable ** it = m_SubVariables.Begin();
           it != m_SubVariables.End();
           ++it )
     {
         FDELETE *it;
     }
-
-    m_SubVariables.Swap( newVars );
 }
 
 // GetMemberByName
@@ -394,8 +532,8 @@ BFFVariable * BFFVariable::ConcatVarsRecurse( const AString & dstName, const BFF
             const Array< const BFFVariable * > & dstMembers = varDst->GetStructMembers();
 
             BFFVariable * const result = FNEW( BFFVariable( dstName, BFFVariable::VAR_STRUCT ) );
-            result->m_SubVariables.SetCapacity( srcMembers.GetSize() + dstMembers.GetSize() );
-            Array< BFFVariable * > & allMembers = result->m_SubVariables;
+            Array< BFFVariable * > & allMembers = result->NewValue( VAR_STRUCT ).m_SubVariables;
+            allMembers.SetCapacity( srcMembers.GetSize() + dstMembers.GetSize() );
 
             // keep original (dst) members where member is only present in original (dst)
             // or concatenate recursively members where the name exists in both
@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Containers/Array.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Strings/AString.h"
 
 // Forward Declarations
@@ -30,13 +31,15 @@ class BFFVariable
 {
 public:
     inline const AString & GetName() const { return m_Name; }
+    inline uint32_t GetNameHash() const { return m_NameHash; }
+    inline static uint32_t CalcNameHash( const AString & name ) { return xxHash::Calc32( name ); }
 
-    const AString & GetString() const { ASSERT( IsString() ); return m_StringValue; }
-    const Array< AString > & GetArrayOfStrings() const { ASSERT( IsArrayOfStrings() ); return m_ArrayValues; }
+    const AString & GetString() const { ASSERT( IsString() ); return m_Value->m_StringValue; }
+    const Array< AString > & GetArrayOfStrings() const { ASSERT( IsArrayOfStrings() ); return m_Value->m_ArrayValues; }
     int GetInt() const { ASSERT( IsInt() ); return m_IntValue; }
     bool GetBool() const { ASSERT( IsBool() ); return m_BoolValue; }
-    const Array< const BFFVariable * > & GetStructMembers() const { ASSERT( IsStruct() ); RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables ); }
-    const Array< const BFFVariable * > & GetArrayOfStructs() const { ASSERT( IsArrayOfStructs() ); RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables ); }
+    const Array< const BFFVariable * > & GetStructMembers() const { ASSERT( IsStruct() ); RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_Value->m_SubVariables ); }
+    const Array< const BFFVariable * > & GetArrayOfStructs() const { ASSERT( IsArrayOfStructs() ); RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_Value->m_SubVariables ); }
 
     enum VarType : uint8_t
     {
@@ -72,6 +75,7 @@ private:
     friend class BFFStackFrame;
 
     explicit BFFVariable( const BFFVariable & other );
+    explicit BFFVariable( const AString & name, const BFFVariable & other );
 
     explicit BFFVariable( const AString & name, VarType type );
     explicit BFFVariable( const AString & name, const AString & value );
@@ -89,7 +93,38 @@ private:
     void SetValueStruct( const Array< const BFFVariable * > & members );
     void SetValueArrayOfStructs( const Array< const BFFVariable * > & values );
 
+    // take the value of another variable (sharing it until either is modified)
+    void SetValue( const BFFVariable & other );
+
+    // modify the value in place
+    void AppendValueString( const AString & value );
+    void AppendValueArrayOfStrings( const AString & value );
+    void AppendValueArrayOfStrings( const Array< AString > & values );
+
+    // Values which are expensive to copy are shared by copies of a variable
+    // (Using, ForEach, assignment from another variable etc). A shared value
+    // is never modified: the variable making a change gets its own copy first.
+    class Value
+    {
+    public:
+        explicit Value();
+        explicit Value( const Value & other );
+        ~Value();
+
+        uint32_t                m_RefCount;
+        AString                 m_StringValue;
+        Array< AString >        m_ArrayValues;
+        Array< BFFVariable * >  m_SubVariables; // Used for struct members of arrays of structs
+    private:
+        Value & operator = ( const Value & ) = delete;
+    };
+
+    void ShareValue( Value * value );
+    Value & NewValue( VarType type );       // replaces the value
+    Value & ModifyValue();                  // keeps the value, copying it if shared
+
     AString m_Name;
+    uint32_t m_NameHash;
     VarType m_Type;
 
     mutable uint8_t     m_FreezeCount;
@@ -97,10 +132,9 @@ private:
     //
     bool                m_BoolValue;
     int                 m_IntValue;
-    AString             m_StringValue;
-    Array< AString >    m_ArrayValues;
-    Array< BFFVariable * > m_SubVariables; // Used for struct members of arrays of structs
+    Value *             m_Value;
 
+    static Value        s_EmptyValue;   // shared by variables without a string, array or struct value
     static const char * s_TypeNames[ MAX_VAR_TYPES ];
 };
 
@@ -189,7 +189,7 @@ FunctionForEach::FunctionForEach()
             }
             else if ( arrayVars[ j ]->GetType() == BFFVariable::VAR_ARRAY_OF_STRUCTS )
             {
-                BFFStackFrame::SetVarStruct( localNames[ j ], arrayVars[ j ]->GetArrayOfStructs()[ i ]->GetStructMembers(), &loopStackFrame );
+                BFFStackFrame::SetVar( localNames[ j ], arrayVars[ j ]->GetArrayOfStructs()[ i ], &loopStackFrame );
             }
             else
             {
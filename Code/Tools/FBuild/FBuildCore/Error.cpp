@@ -512,6 +512,16 @@
                                         token );
 }
 
+// Error_1107_ResourcePoolNotDeclared
+//------------------------------------------------------------------------------
+/*static*/ void Error::Error_1107_ResourcePoolNotDeclared( const BFFIterator & iter,
+                                                           const Function * function,
+                                                           const AString & name )
+{
+    FormatError( iter, 1107u, function, "'.ResourcePool' ('%s') is not declared in the Settings '.ResourcePools'.",
+                                        name.Get() );
+}
+
 // Error_1200_ExpectedVar // TODO:C Remove (Deprecated by 1007)
 //------------------------------------------------------------------------------
 /*static*/ void Error::Error_1200_ExpectedVar( const BFFIterator & iter, const Function * function )
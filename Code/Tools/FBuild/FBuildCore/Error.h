@@ -154,6 +154,9 @@ public:
                                                  const Function * function,
                                                  const char * propertyName,
                                                  const char * token );
+    static void Error_1107_ResourcePoolNotDeclared( const BFFIterator & iter,
+                                                    const Function * function,
+                                                    const AString & name );
 
     // 1200 - 1299 : ForEach specific errors
     //------------------------------------------------------------------------------
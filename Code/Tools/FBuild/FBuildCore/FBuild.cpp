@@ -468,6 +468,7 @@ bool FBuild::Build( Node * nodeToBuild )
 
     // wrap up/free any jobs that come from the last build pass
     m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
+    m_JobQueue->GetRaceStats( m_BuildStats );
 
     FDELETE m_JobQueue;
     m_JobQueue = nullptr;
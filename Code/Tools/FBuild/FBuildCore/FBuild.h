@@ -7,6 +7,7 @@
 #include "Tools/FBuild/FBuildCore/FBuildOptions.h"
 
 #include "Helpers/FBuildStats.h"
+#include "Helpers/FileHashCache.h"
 #include "WorkerPool/WorkerBrokerage.h"
 
 #include "Core/Containers/Array.h"
@@ -92,6 +93,9 @@ public:
     // stats - write access
     FBuildStats & GetStatsMutable()         { return m_BuildStats; }
 
+    // dependency graph - read access
+    const NodeGraph & GetDependencyGraph() const { return *m_DependencyGraph; }
+
     // attempt to cleanly stop the build
     static        void AbortBuild();
     static        void OnBuildError();
@@ -100,6 +104,10 @@ public:
 
     inline ICache * GetCache() const { return m_Cache; }
 
+    // hashes of file contents, shared by all nodes (and persisted in the fdb)
+    inline FileHashCache & GetFileHashCache() { return m_FileHashCache; }
+    inline const FileHashCache & GetFileHashCache() const { return m_FileHashCache; }
+
     static bool GetTempDir( AString & outTempDir );
 
     bool CacheOutputInfo() const;
@@ -132,6 +140,8 @@ private:
 
     FBuildStats m_BuildStats;
 
+    FileHashCache m_FileHashCache;
+
     FBuildOptions m_Options;
 
     WorkerBrokerage m_WorkerBrokerage;
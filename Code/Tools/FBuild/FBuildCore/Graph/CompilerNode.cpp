@@ -10,9 +10,12 @@
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CIncludeScanner.h"
 
 #include "Core/FileIO/IOStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Process/Process.h"
 #include "Core/Strings/AStackString.h"
 
 
@@ -25,6 +28,7 @@ REFLECT_NODE_BEGIN( CompilerNode, Node, MetaNone() )
     REFLECT( m_AllowDistribution,   "AllowDistribution",    MetaOptional() )
     REFLECT( m_VS2012EnumBugFix,    "VS2012EnumBugFix",     MetaOptional() )
     REFLECT( m_ClangRewriteIncludes, "ClangRewriteIncludes", MetaOptional() )
+    REFLECT( m_UseNativeIncludeScanner, "UseNativeIncludeScanner", MetaOptional() )
     REFLECT( m_ExecutableRootPath,  "ExecutableRootPath",   MetaOptional() + MetaPath() )
     REFLECT( m_SimpleDistributionMode,  "SimpleDistributionMode",   MetaOptional() )
     REFLECT( m_CompilerFamilyString,"CompilerFamily",       MetaOptional() )
@@ -41,9 +45,11 @@ CompilerNode::CompilerNode()
     , m_AllowDistribution( true )
     , m_VS2012EnumBugFix( false )
     , m_ClangRewriteIncludes( true )
+    , m_UseNativeIncludeScanner( false )
     , m_CompilerFamilyString( "auto" )
     , m_CompilerFamilyEnum( static_cast< uint8_t >( CUSTOM ) )
     , m_SimpleDistributionMode( false )
+    , m_IncludeScannerConfigs( 0, true )
 {
 }
 
@@ -297,7 +303,64 @@ bool CompilerNode::InitializeCompilerFamily( const BFFIterator & iter, const Fun
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
-CompilerNode::~CompilerNode() = default;
+CompilerNode::~CompilerNode()
+{
+    for ( CIncludeScannerConfig * config : m_IncludeScannerConfigs )
+    {
+        FDELETE config;
+    }
+}
+
+// GetIncludeScannerConfig
+//------------------------------------------------------------------------------
+const CIncludeScannerConfig * CompilerNode::GetIncludeScannerConfig( const AString & args ) const
+{
+    AStackString<> keyString( GetExecutable() );
+    keyString += ' ';
+    keyString += args;
+    const uint64_t key = xxHash::Calc64( keyString );
+
+    // already known? (most objects share a handful of configs)
+    {
+        MutexHolder mh( m_IncludeScannerConfigsMutex );
+        for ( const CIncludeScannerConfig * config : m_IncludeScannerConfigs )
+        {
+            if ( config->GetKey() == key )
+            {
+                return config->IsValid() ? config : nullptr;
+            }
+        }
+    }
+
+    // ask the compiler (outside the lock, so other configs aren't held up)
+    CIncludeScannerConfig * newConfig = FNEW( CIncludeScannerConfig( key ) );
+    Process p;
+    if ( p.Spawn( GetExecutable().Get(), args.Get(), nullptr, FBuild::Get().GetEnvironmentString() ) )
+    {
+        AutoPtr< char > out;
+        AutoPtr< char > err;
+        uint32_t outSize = 0;
+        uint32_t errSize = 0;
+        p.ReadAllData( out, &outSize, err, &errSize );
+        if ( p.WaitForExit() == 0 )
+        {
+            newConfig->ParseCompilerOutput( out.Get(), err.Get() );
+        }
+    }
+
+    // failures are stored too, so we don't keep trying
+    MutexHolder mh( m_IncludeScannerConfigsMutex );
+    for ( const CIncludeScannerConfig * config : m_IncludeScannerConfigs )
+    {
+        if ( config->GetKey() == key )
+        {
+            FDELETE newConfig; // another thread got there first
+            return config->IsValid() ? config : nullptr;
+        }
+    }
+    m_IncludeScannerConfigs.Append( newConfig );
+    return newConfig->IsValid() ? newConfig : nullptr;
+}
 
 // DoBuild
 //------------------------------------------------------------------------------
@@ -7,9 +7,12 @@
 #include "FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 
+#include "Core/Process/Mutex.h"
+
 // Forward Declarations
 //------------------------------------------------------------------------------
 class BFFIterator;
+class CIncludeScannerConfig;
 class Function;
 
 // CompilerNode
@@ -34,6 +37,10 @@ public:
         inline bool IsVS2012EnumBugFixEnabled() const { return m_VS2012EnumBugFix; }
     #endif
     inline bool IsClangRewriteIncludesEnabled() const { return m_ClangRewriteIncludes; }
+    inline bool UseNativeIncludeScanner() const { return m_UseNativeIncludeScanner; }
+
+    // Preprocessor state for the given args (nullptr if it can't be determined)
+    const CIncludeScannerConfig * GetIncludeScannerConfig( const AString & args ) const;
 
     enum CompilerFamily : uint8_t
     {
@@ -67,11 +74,16 @@ private:
     bool            m_AllowDistribution;
     bool            m_VS2012EnumBugFix;
     bool            m_ClangRewriteIncludes;
+    bool            m_UseNativeIncludeScanner;
     AString         m_ExecutableRootPath;
     AString         m_CompilerFamilyString;
     uint8_t         m_CompilerFamilyEnum;
     bool            m_SimpleDistributionMode;
     ToolManifest    m_Manifest;
+
+    // Internal State
+    mutable Mutex                           m_IncludeScannerConfigsMutex;
+    mutable Array< CIncludeScannerConfig * > m_IncludeScannerConfigs;
 };
 
 //------------------------------------------------------------------------------
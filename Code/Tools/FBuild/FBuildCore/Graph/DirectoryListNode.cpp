@@ -12,13 +12,149 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathMatcher.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define DIRECTORY_LIST_MAX_THREADS ( 8 )
+#if defined( __WINDOWS__ )
+    // Listing a directory on Windows returns the info for each file, so a
+    // snapshot would save nothing
+    #define DIRECTORY_LIST_USE_SNAPSHOTS ( 0 )
+#else
+    #define DIRECTORY_LIST_USE_SNAPSHOTS ( 1 )
+    #define DIRECTORY_LIST_SNAPSHOT_MIN_AGE ( 2 * 1000000000ULL ) // ns, for file systems with coarse times
+#endif
+
+// DirectoryListScan - state shared by the threads listing a directory tree
+//------------------------------------------------------------------------------
+class DirectoryListScan
+{
+public:
+    struct Directory
+    {
+        AString                     m_Path;
+        DirectoryListSnapshot       m_Snapshot;     // if listed
+        DirectoryListSnapshot *     m_Previous;     // if reused
+        Array< FileIO::FileInfo >   m_Files;
+        Array< Directory * >        m_SubDirs;
+        bool                        m_Found;
+
+        const DirectoryListSnapshot & GetSnapshot() const { return m_Previous ? *m_Previous : m_Snapshot; }
+    };
+
+    explicit DirectoryListScan( DirectoryListNode * node )
+        : m_Node( node )
+        , m_SnapshotTimeLimit( 0 )
+        , m_AllowReuse( false )
+        , m_Directories( 256, true )
+        , m_Pending( 256, true )
+        , m_NumThreads( 1 )
+        , m_NumActive( 0 )
+        , m_Done( false )
+    {
+        // compile the exclusions, to check each path against all of them at once
+        for ( const AString & excludePath : node->m_ExcludePaths )
+        {
+            m_ExcludePaths.AddPathPrefix( excludePath );
+        }
+        for ( const AString & excludedFile : node->m_FilesToExclude )
+        {
+            m_ExcludeFiles.AddFileName( excludedFile );
+        }
+        for ( const AString & excludedPattern : node->m_ExcludePatterns )
+        {
+            m_ExcludeFiles.AddWildcard( excludedPattern );
+        }
+    }
+    ~DirectoryListScan()
+    {
+        for ( Directory * dir : m_Directories )
+        {
+            FDELETE dir;
+        }
+    }
+
+    void ScanDirectories();
+    void ScanDirectory( Directory * dir );
+    static uint32_t ThreadFunc( void * userData );
+
+    inline bool IsPathExcluded( const AString & dirPath ) const { return m_ExcludePaths.MatchesPathPrefix( dirPath ); }
+    inline bool IsFileExcluded( const AString & fileName ) const
+    {
+        return m_ExcludeFiles.MatchesFileName( fileName ) || m_ExcludeFiles.MatchesWildcard( fileName );
+    }
+
+    Directory * AddDirectory( const AString & path )
+    {
+        Directory * dir = FNEW( Directory );
+        dir->m_Path = path;
+        dir->m_Previous = nullptr;
+        dir->m_Found = false;
+        m_Directories.Append( dir );
+        return dir;
+    }
+
+    DirectoryListNode *         m_Node;
+    PathMatcher                 m_ExcludePaths;
+    PathMatcher                 m_ExcludeFiles;
+    uint64_t                    m_SnapshotTimeLimit;    // directories modified after this can't be reused
+    bool                        m_AllowReuse;
+    Mutex                       m_Mutex;
+    Semaphore                   m_WorkAvailable;        // signalled for each pending directory, then to stop
+    Array< Directory * >        m_Directories;
+    Array< Directory * >        m_Pending;
+    uint32_t                    m_NumThreads;
+    uint32_t                    m_NumActive;
+    bool                        m_Done;
+};
+
+// NameCompare - order names consistently across file systems and platforms
+//------------------------------------------------------------------------------
+class NameCompare
+{
+public:
+    inline bool operator () ( const AString & a, const AString & b ) const
+    {
+        const int32_t result = a.CompareI( b );
+        return ( result != 0 ) ? ( result < 0 ) : ( a < b );
+    }
+    inline bool operator () ( const FileIO::FileInfo * a, const FileIO::FileInfo * b ) const
+    {
+        return ( *this )( a->m_Name, b->m_Name );
+    }
+};
+
+// PathCompare - order directories by path, for lookups in the snapshots
+//------------------------------------------------------------------------------
+class PathCompare
+{
+public:
+    inline bool operator () ( const DirectoryListScan::Directory * a, const DirectoryListScan::Directory * b ) const
+    {
+        return ( a->m_Path < b->m_Path );
+    }
+};
 
 // Reflection
 //------------------------------------------------------------------------------
+REFLECT_STRUCT_BEGIN_BASE( DirectoryListSnapshot )
+    REFLECT( m_Path,                    "Path",             MetaNone() )
+    REFLECT( m_LastWriteTime,           "LastWriteTime",    MetaNone() )
+    REFLECT_ARRAY( m_SubDirs,           "SubDirs",          MetaNone() )
+    REFLECT_ARRAY( m_Files,             "Files",            MetaNone() )
+REFLECT_END( DirectoryListSnapshot )
+
 REFLECT_NODE_BEGIN( DirectoryListNode, Node, MetaNone() )
     REFLECT( m_Path,                    "Path",             MetaNone() )
     REFLECT_ARRAY( m_Patterns,          "Patterns",         MetaNone() )
@@ -26,6 +162,9 @@ REFLECT_NODE_BEGIN( DirectoryListNode, Node, MetaNone() )
     REFLECT_ARRAY( m_FilesToExclude,    "FilesToExclude",   MetaNone() )
     REFLECT_ARRAY( m_ExcludePatterns,   "ExcludePatterns",  MetaNone() )
     REFLECT( m_Recursive,               "Recursive",        MetaNone() )
+
+    // Internal State
+    REFLECT_ARRAY_OF_STRUCT( m_Snapshots,   "Snapshots",    DirectoryListSnapshot,  MetaHidden() )
 REFLECT_END( DirectoryListNode )
 
 // CONSTRUCTOR
@@ -33,6 +172,9 @@ REFLECT_END( DirectoryListNode )
 DirectoryListNode::DirectoryListNode()
     : Node( AString::GetEmpty(), Node::DIRECTORY_LIST_NODE, Node::FLAG_NONE )
     , m_Recursive( true )
+    , m_Snapshots( 0, true )
+    , m_NumDirectoriesListed( 0 )
+    , m_NumDirectoriesReused( 0 )
 {
     m_LastBuildTimeMs = 100;
 }
@@ -138,77 +280,281 @@ DirectoryListNode::~DirectoryListNode() = default;
     // NOTE: The DirectoryListNode makes no assumptions about whether no files
     // is an error or not.  That's up to the dependent nodes to decide.
 
-    Array< FileIO::FileInfo > files( 4096, true );
-    FileIO::GetFilesEx( m_Path, &m_Patterns, m_Recursive, &files );
+    DirectoryListScan scan( this );
+    #if DIRECTORY_LIST_USE_SNAPSHOTS
+        // snapshots of directories modified very recently can't be trusted, as
+        // a change in the same time interval would not change the time
+        scan.m_SnapshotTimeLimit = Time::GetCurrentFileTime() - DIRECTORY_LIST_SNAPSHOT_MIN_AGE;
+        scan.m_AllowReuse = ( FBuild::Get().GetOptions().m_ForceCleanBuild == false );
+    #endif
+
+    // List the root directory on this thread, and the rest of the tree in parallel
+    // if it branches out. Excluded directories are not listed at all.
+    DirectoryListScan::Directory * root = scan.AddDirectory( m_Path );
+    if ( scan.IsPathExcluded( m_Path ) == false )
+    {
+        scan.ScanDirectory( root );
+    }
+    if ( scan.m_Pending.IsEmpty() == false )
+    {
+        const uint32_t numHelpers = Math::Min< uint32_t >( (uint32_t)scan.m_Pending.GetSize(), Math::Min< uint32_t >( Env::GetNumProcessors(), DIRECTORY_LIST_MAX_THREADS ) ) - 1;
+        scan.m_NumThreads = numHelpers + 1;
+        Array< Thread::ThreadHandle > helpers( numHelpers, false );
+        for ( uint32_t i = 0; i < numHelpers; ++i )
+        {
+            helpers.Append( Thread::CreateThread( DirectoryListScan::ThreadFunc, "DirectoryList", ( 64 * KILOBYTE ), &scan ) );
+        }
+        scan.ScanDirectories();
+        for ( Thread::ThreadHandle helper : helpers )
+        {
+            Thread::WaitForThread( helper );
+            Thread::CloseHandle( helper );
+        }
+    }
+
+    // gather results in a consistent order: the files of each directory, then
+    // each sub-directory (both sorted by name)
+    m_NumDirectoriesListed = 0;
+    m_NumDirectoriesReused = 0;
+    Array< DirectoryListScan::Directory * > found( scan.m_Directories.GetSize(), false );
+    Array< DirectoryListScan::Directory * > stack( 256, true );
+    size_t totalFiles = 0;
+    stack.Append( root );
+    while ( stack.IsEmpty() == false )
+    {
+        DirectoryListScan::Directory * dir = stack.Top();
+        stack.Pop();
+        if ( dir->m_Found == false )
+        {
+            continue; // missing
+        }
+        found.Append( dir );
+        totalFiles += dir->m_Files.GetSize();
+        for ( size_t i = dir->m_SubDirs.GetSize(); i > 0; --i )
+        {
+            stack.Append( dir->m_SubDirs[ i - 1 ] );
+        }
+        ++( dir->m_Previous ? m_NumDirectoriesReused : m_NumDirectoriesListed );
+    }
+    if ( found.GetSize() == 1 )
+    {
+        m_Files.Swap( root->m_Files );
+    }
+    else
+    {
+        m_Files.Clear();
+        m_Files.SetCapacity( totalFiles );
+        for ( const DirectoryListScan::Directory * dir : found )
+        {
+            m_Files.Append( dir->m_Files );
+        }
+    }
+
+    // keep the directory contents for the next build (moving rather than copying them)
+    #if DIRECTORY_LIST_USE_SNAPSHOTS
+        found.Sort( PathCompare() );
+        Array< DirectoryListSnapshot > snapshots( found.GetSize(), false );
+        snapshots.SetSize( found.GetSize() );
+        for ( size_t i = 0; i < found.GetSize(); ++i )
+        {
+            DirectoryListScan::Directory * dir = found[ i ];
+            DirectoryListSnapshot & source = dir->m_Previous ? *dir->m_Previous : dir->m_Snapshot;
+            DirectoryListSnapshot & snapshot = snapshots[ i ];
+            snapshot.m_Path = dir->m_Path;
+            snapshot.m_LastWriteTime = source.m_LastWriteTime;
+            snapshot.m_SubDirs.Swap( source.m_SubDirs );
+            snapshot.m_Files.Swap( source.m_Files );
+        }
+        m_Snapshots.Swap( snapshots );
+    #endif
+
+    if ( FLog::ShowInfo() )
+    {
+        const size_t numFiles = m_Files.GetSize();
+        FLOG_INFO( "Dir: '%s' (found %u files, listed %u dirs, reused %u dirs)\n",
+                            m_Name.Get(),
+                            (uint32_t)numFiles,
+                            m_NumDirectoriesListed,
+                            m_NumDirectoriesReused );
+        for ( size_t i=0; i<numFiles; ++i )
+        {
+            FLOG_INFO( " - %s\n", m_Files[ i ].m_Name.Get() );
+        }
+    }
+
+    return NODE_RESULT_OK;
+}
+
+// FindSnapshot
+//------------------------------------------------------------------------------
+DirectoryListSnapshot * DirectoryListNode::FindSnapshot( const AString & path )
+{
+    // m_Snapshots is sorted by path
+    size_t low = 0;
+    size_t high = m_Snapshots.GetSize();
+    while ( low < high )
+    {
+        const size_t mid = ( low + high ) / 2;
+        DirectoryListSnapshot & snapshot = m_Snapshots[ mid ];
+        if ( snapshot.m_Path == path )
+        {
+            return &snapshot;
+        }
+        if ( snapshot.m_Path < path )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
 
-    m_Files.SetCapacity( files.GetSize() );
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t DirectoryListScan::ThreadFunc( void * userData )
+{
+    static_cast< DirectoryListScan * >( userData )->ScanDirectories();
+    return 0;
+}
 
-    // filter exclusions
-    const FileIO::FileInfo * const end = files.End();
-    for ( const FileIO::FileInfo * it = files.Begin(); it != end; it++ )
+// ScanDirectories
+//------------------------------------------------------------------------------
+void DirectoryListScan::ScanDirectories()
+{
+    for ( ;; )
     {
-        bool excluded = false;
+        m_WorkAvailable.Wait();
 
-        // filter excluded paths
-        const AString * const eEnd = m_ExcludePaths.End();
-        for ( const AString * eIt=m_ExcludePaths.Begin(); eIt != eEnd; ++eIt )
+        Directory * dir;
         {
-            if ( PathUtils::PathBeginsWith( it->m_Name, *eIt ) )
+            MutexHolder mh( m_Mutex );
+            if ( m_Done )
             {
-                excluded = true;
-                break;
+                return;
             }
+            dir = m_Pending.Top();
+            m_Pending.Pop();
+            ++m_NumActive;
         }
 
-        // filter excluded files
-        if ( !excluded )
+        ScanDirectory( dir );
+
         {
-            const AString * fit = m_FilesToExclude.Begin();
-            const AString * const fend = m_FilesToExclude.End();
-            for ( ; fit != fend; ++fit )
+            MutexHolder mh( m_Mutex );
+            --m_NumActive;
+            if ( ( m_NumActive == 0 ) && m_Pending.IsEmpty() )
             {
-                if ( PathUtils::PathEndsWithFile( it->m_Name, *fit ) )
-                {
-                    excluded = true;
-                    break;
-                }
+                // nothing left, and nothing in progress which could add more
+                m_Done = true;
+                m_WorkAvailable.Signal( m_NumThreads );
             }
         }
+    }
+}
 
-        // filter excluded patterns
-        if ( !excluded )
+// ScanDirectory
+//------------------------------------------------------------------------------
+void DirectoryListScan::ScanDirectory( Directory * dir )
+{
+    // reuse the previous contents if the directory is unchanged (files
+    // changing doesn't modify the directory, so their info is always updated)
+    #if DIRECTORY_LIST_USE_SNAPSHOTS
+        DirectoryListSnapshot * previous = m_AllowReuse ? m_Node->FindSnapshot( dir->m_Path ) : nullptr;
+        if ( previous && ( previous->m_LastWriteTime != 0 ) &&
+             ( FileIO::GetFileLastWriteTime( dir->m_Path ) == previous->m_LastWriteTime ) )
         {
-            const AString * pit = m_ExcludePatterns.Begin();
-            const AString * const pend = m_ExcludePatterns.End();
-            for ( ; pit != pend; ++pit )
+            if ( FileIO::GetFilesInfo( dir->m_Path, previous->m_Files, &dir->m_Files ) )
             {
-                if ( PathUtils::IsWildcardMatch( pit->Get(), it->m_Name.Get() ) )
-                {
-                    excluded = true;
-                    break;
-                }
+                dir->m_Previous = previous;
+            }
+            else
+            {
+                dir->m_Files.Clear(); // modified during the build
             }
         }
+    #endif
+
+    if ( dir->m_Previous == nullptr )
+    {
+        uint64_t lastWriteTime = 0;
+        Array< AString > subDirs( 32, true );
+        Array< FileIO::FileInfo > files( 256, true );
+        if ( FileIO::GetDirectoryContents( dir->m_Path, &m_Node->m_Patterns, lastWriteTime, &subDirs, &files ) == false )
+        {
+            return; // missing
+        }
+
+        DirectoryListSnapshot & snapshot = dir->m_Snapshot;
+        #if DIRECTORY_LIST_USE_SNAPSHOTS
+            snapshot.m_LastWriteTime = ( lastWriteTime < m_SnapshotTimeLimit ) ? lastWriteTime : 0;
+        #else
+            (void)lastWriteTime;
+            snapshot.m_LastWriteTime = 0;
+        #endif
 
-        if ( !excluded )
+        // filter exclusions (sorting pointers to avoid copying the strings)
+        Array< const FileIO::FileInfo * > sortedFiles( files.GetSize(), false );
+        for ( const FileIO::FileInfo & file : files )
+        {
+            sortedFiles.Append( &file );
+        }
+        sortedFiles.Sort( NameCompare() );
+        dir->m_Files.SetCapacity( files.GetSize() );
+        #if DIRECTORY_LIST_USE_SNAPSHOTS
+            snapshot.m_Files.SetCapacity( files.GetSize() );
+            const uint32_t pathLength = dir->m_Path.GetLength();
+        #endif
+        for ( const FileIO::FileInfo * file : sortedFiles )
         {
-            m_Files.Append( *it );
+            if ( IsFileExcluded( file->m_Name ) == false )
+            {
+                dir->m_Files.Append( *file );
+                #if DIRECTORY_LIST_USE_SNAPSHOTS
+                    snapshot.m_Files.Append( AStackString<>( file->m_Name.Get() + pathLength ) );
+                #endif
+            }
+        }
+        if ( m_Node->m_Recursive )
+        {
+            subDirs.Sort( NameCompare() );
+            AStackString<> subDirPath;
+            for ( const AString & subDir : subDirs )
+            {
+                subDirPath = dir->m_Path;
+                subDirPath += subDir;
+                subDirPath += NATIVE_SLASH;
+                if ( IsPathExcluded( subDirPath ) == false )
+                {
+                    snapshot.m_SubDirs.Append( subDir );
+                }
+            }
         }
     }
 
-    if ( FLog::ShowInfo() )
+    // queue sub-directories
+    dir->m_Found = true;
+    const DirectoryListSnapshot & snapshot = dir->GetSnapshot();
+    if ( snapshot.m_SubDirs.IsEmpty() )
     {
-        const size_t numFiles = m_Files.GetSize();
-        FLOG_INFO( "Dir: '%s' (found %u files)\n",
-                            m_Name.Get(),
-                            (uint32_t)numFiles);
-        for ( size_t i=0; i<numFiles; ++i )
+        return;
+    }
+    {
+        MutexHolder mh( m_Mutex );
+        AStackString<> subDirPath;
+        for ( const AString & subDir : snapshot.m_SubDirs )
         {
-            FLOG_INFO( " - %s\n", m_Files[ i ].m_Name.Get() );
+            subDirPath = dir->m_Path;
+            subDirPath += subDir;
+            subDirPath += NATIVE_SLASH;
+            Directory * subDirectory = AddDirectory( subDirPath );
+            dir->m_SubDirs.Append( subDirectory );
+            m_Pending.Append( subDirectory );
         }
     }
-
-    return NODE_RESULT_OK;
+    m_WorkAvailable.Signal( (uint32_t)snapshot.m_SubDirs.GetSize() );
 }
 
 //------------------------------------------------------------------------------
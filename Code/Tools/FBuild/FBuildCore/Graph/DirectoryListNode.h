@@ -9,6 +9,25 @@
 // Core
 #include "Core/FileIO/FileIO.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class DirectoryListScan;
+
+// DirectoryListSnapshot - the filtered contents of one directory
+//------------------------------------------------------------------------------
+class DirectoryListSnapshot : public Struct
+{
+    REFLECT_STRUCT_DECLARE( DirectoryListSnapshot )
+public:
+    DirectoryListSnapshot() : m_LastWriteTime( 0 ) {}
+
+    AString             m_Path;             // with trailing slash
+    uint64_t            m_LastWriteTime;    // of the directory, or 0 if not safe to reuse
+    Array< AString >    m_SubDirs;          // names of sub-directories which are not excluded
+    Array< AString >    m_Files;            // names of files matching the patterns which are not excluded
+
+};
+
 // DirectoryListNode
 //------------------------------------------------------------------------------
 class DirectoryListNode : public Node
@@ -34,9 +53,16 @@ public:
                             const Array< AString > & excludePatterns,
                             AString & result );
 
+    // Number of directories listed and reused from snapshots in the last build
+    inline uint32_t GetNumDirectoriesListed() const { return m_NumDirectoriesListed; }
+    inline uint32_t GetNumDirectoriesReused() const { return m_NumDirectoriesReused; }
+
 private:
     virtual BuildResult DoBuild( Job * job ) override;
 
+    friend class DirectoryListScan;
+    DirectoryListSnapshot * FindSnapshot( const AString & path );
+
     // Reflected Properties
     friend class Function; // TODO:C Remove
     friend class TestGraph; // TODO:C Remove
@@ -48,7 +74,10 @@ private:
     bool m_Recursive;
 
     // Internal State
+    Array< DirectoryListSnapshot > m_Snapshots; // sorted by path
     Array< FileIO::FileInfo > m_Files;
+    uint32_t m_NumDirectoriesListed;
+    uint32_t m_NumDirectoriesReused;
 };
 
 //------------------------------------------------------------------------------
@@ -8,21 +8,37 @@
 #include "ExecNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
-
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileHashCache.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Process.h"
+#include "Core/Time/Timer.h"
 
 // Reflection
 //------------------------------------------------------------------------------
 REFLECT_NODE_BEGIN( ExecNode, Node, MetaName( "ExecOutput" ) + MetaFile() )
-    REFLECT(        m_ExecExecutable,           "ExecExecutable",           MetaFile() )
+    REFLECT(        m_ExecExecutable,           "ExecExecutable",           MetaFile() + MetaAllowNonFile( Node::COMPILER_NODE ) )
     REFLECT_ARRAY(  m_ExecInput,                "ExecInput",                MetaOptional() + MetaFile() )
     REFLECT_ARRAY(  m_ExecInputPath,            "ExecInputPath",            MetaOptional() + MetaPath() )
     REFLECT_ARRAY(  m_ExecInputPattern,         "ExecInputPattern",         MetaOptional() )
@@ -34,6 +50,9 @@ REFLECT_NODE_BEGIN( ExecNode, Node, MetaName( "ExecOutput" ) + MetaFile() )
     REFLECT(        m_ExecWorkingDir,           "ExecWorkingDir",           MetaOptional() + MetaPath() )
     REFLECT(        m_ExecReturnCode,           "ExecReturnCode",           MetaOptional() )
     REFLECT(        m_ExecUseStdOutAsOutput,    "ExecUseStdOutAsOutput",    MetaOptional() )
+    REFLECT(        m_ExecCacheable,            "ExecCacheable",            MetaOptional() )
+    REFLECT(        m_ExecAllowDistribution,    "ExecAllowDistribution",    MetaOptional() )
+    REFLECT(        m_ResourcePool,             "ResourcePool",             MetaOptional() )
     REFLECT_ARRAY(  m_PreBuildDependencyNames,  "PreBuildDependencies",     MetaOptional() + MetaFile() + MetaAllowNonFile() )
 
     // Internal State
@@ -46,6 +65,8 @@ ExecNode::ExecNode()
     : FileNode( AString::GetEmpty(), Node::FLAG_NONE )
     , m_ExecReturnCode( 0 )
     , m_ExecUseStdOutAsOutput( false )
+    , m_ExecCacheable( false )
+    , m_ExecAllowDistribution( false )
     , m_ExecInputPathRecurse( true )
 {
     m_Type = EXEC_NODE;
@@ -53,6 +74,32 @@ ExecNode::ExecNode()
     m_ExecInputPattern.Append( AStackString<>( "*.*" ) );
 }
 
+// CONSTRUCTOR (Remote)
+//------------------------------------------------------------------------------
+ExecNode::ExecNode( const AString & outputName,
+                    const Array< AString > & inputFiles,
+                    const AString & inputRoot,
+                    const AString & arguments,
+                    int32_t returnCode,
+                    bool useStdOutAsOutput )
+    : FileNode( outputName, Node::FLAG_NONE )
+    , m_ExecInput( inputFiles ) // names on the client (the contents are in the job data)
+    , m_ExecArguments( arguments )
+    , m_ExecReturnCode( returnCode )
+    , m_ExecUseStdOutAsOutput( useStdOutAsOutput )
+    , m_ExecCacheable( false )
+    , m_ExecAllowDistribution( true )
+    , m_ExecInputPathRecurse( false )
+    , m_NumExecInputFiles( (uint32_t)inputFiles.GetSize() )
+    , m_RemoteInputRoot( inputRoot )
+{
+    m_Type = EXEC_NODE;
+
+    // the executable comes from the ToolManifest
+    m_StaticDependencies.SetCapacity( 1 );
+    m_StaticDependencies.Append( Dependency( nullptr ) );
+}
+
 // Initialize
 //------------------------------------------------------------------------------
 /*virtual*/ bool ExecNode::Initialize( NodeGraph & nodeGraph, const BFFIterator & iter, const Function * function )
@@ -63,14 +110,32 @@ ExecNode::ExecNode()
         return false; // InitializePreBuildDependencies will have emitted an error
     }
 
-    // .ExecExecutable
+    // .ResourcePool
+    if ( !InitializeResourcePool( nodeGraph, iter, function, m_ResourcePool ) )
+    {
+        return false; // InitializeResourcePool will have emitted an error
+    }
+
+    // .ExecExecutable (a file, or a Compiler() providing the executable and its extra files)
     Dependencies executable;
-    if ( !Function::GetFileNode( nodeGraph, iter, function, m_ExecExecutable, "ExecExecutable", executable ) )
+    Node * compilerNode = nodeGraph.FindNodeExact( m_ExecExecutable );
+    if ( compilerNode && ( compilerNode->GetType() == Node::COMPILER_NODE ) )
+    {
+        executable.Append( Dependency( compilerNode ) );
+    }
+    else if ( !Function::GetFileNode( nodeGraph, iter, function, m_ExecExecutable, "ExecExecutable", executable ) )
     {
         return false; // GetFileNode will have emitted an error
     }
     ASSERT( executable.GetSize() == 1 ); // Should only be possible to be one
 
+    // .ExecAllowDistribution (the ToolManifest of a Compiler() is needed to execute remotely)
+    if ( m_ExecAllowDistribution && ( executable[ 0 ].GetNode()->GetType() != Node::COMPILER_NODE ) )
+    {
+        Error::Error_1102_UnexpectedType( iter, function, "ExecExecutable", m_ExecExecutable, executable[ 0 ].GetNode()->GetType(), Node::COMPILER_NODE );
+        return false;
+    }
+
     // .ExecInput
     Dependencies execInputFiles;
     if ( !Function::GetFileNodes( nodeGraph, iter, function, m_ExecInput, "ExecInput", execInputFiles ) )
@@ -155,21 +220,115 @@ ExecNode::~ExecNode() = default;
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult ExecNode::DoBuild( Job * job )
 {
+    // Format compiler args string
+    Array< AString > inputFiles;
+    GetInputFileNames( inputFiles );
+    AStackString< 4 * KILOBYTE > fullArgs;
+    GetFullArgs( inputFiles, fullArgs );
+
+    // try to get the output from the cache
+    const bool useCache = ShouldUseCache() && GetCacheName( job, fullArgs );
+    if ( useCache && RetrieveFromCache( job ) )
+    {
+        return NODE_RESULT_OK_CACHE;
+    }
+
+    // can we do the work remotely? (the layout of the inputs is recreated on
+    // the worker, so they must share a root dir)
+    AStackString<> inputRoot;
+    if ( CanBeDistributed() && GetInputRoot( inputFiles, inputRoot ) )
+    {
+        if ( LoadInputFilesForDistribution( job, inputFiles ) == false )
+        {
+            return NODE_RESULT_FAILED; // LoadInputFilesForDistribution will have emitted an error
+        }
+
+        // yes... re-queue for secondary build
+        return NODE_RESULT_NEED_SECOND_BUILD_PASS;
+    }
+
+    EmitCompilationMessage( fullArgs );
+
     // If the workingDir is empty, use the current dir for the process
     const char * workingDir = m_ExecWorkingDir.IsEmpty() ? nullptr : m_ExecWorkingDir.Get();
 
-    // Format compiler args string
+    const BuildResult result = Execute( job, GetExecutable(), fullArgs, workingDir, FBuild::Get().GetEnvironmentString() );
+
+    if ( ( result == NODE_RESULT_OK ) && m_Stamp && useCache )
+    {
+        WriteToCache( job );
+    }
+
+    return result;
+}
+
+// DoBuild2
+//------------------------------------------------------------------------------
+/*virtual*/ Node::BuildResult ExecNode::DoBuild2( Job * job, bool UNUSED( racingRemoteJob ) )
+{
+    // building a distributable job locally (stolen or raced) is the same as a normal build
+    if ( job->IsLocal() )
+    {
+        Array< AString > inputFiles;
+        GetInputFileNames( inputFiles );
+        AStackString< 4 * KILOBYTE > fullArgs;
+        GetFullArgs( inputFiles, fullArgs );
+
+        EmitCompilationMessage( fullArgs );
+
+        const char * workingDir = m_ExecWorkingDir.IsEmpty() ? nullptr : m_ExecWorkingDir.Get();
+
+        const BuildResult result = Execute( job, GetExecutable(), fullArgs, workingDir, FBuild::Get().GetEnvironmentString() );
+
+        // the cache name was determined in the first pass, if the cache is in use
+        if ( ( result == NODE_RESULT_OK ) && m_Stamp && ( job->GetCacheName().IsEmpty() == false ) )
+        {
+            WriteToCache( job );
+        }
+
+        return result;
+    }
+
+    // remotely, the inputs come with the job and are written to a temp dir
+    AStackString<> tmpDirectory;
+    Array< AString > inputFiles( m_ExecInput.GetSize(), false );
+    if ( WriteRemoteInputFiles( job, tmpDirectory, inputFiles ) == false )
+    {
+        DeleteRemoteInputFiles( tmpDirectory );
+        return NODE_RESULT_FAILED; // WriteRemoteInputFiles will have emitted an error
+    }
+
+    // arguments referring to the inputs' dirs on the client refer to the temp dir instead
+    ReplaceInputRoot( m_ExecArguments, m_RemoteInputRoot, tmpDirectory );
+
     AStackString< 4 * KILOBYTE > fullArgs;
-    GetFullArgs(fullArgs);
+    GetFullArgs( inputFiles, fullArgs );
 
-    EmitCompilationMessage( fullArgs );
+    // use the synchronized executable
+    ASSERT( job->GetToolManifest() );
+    AStackString<> executable;
+    AStackString<> workingDir;
+    job->GetToolManifest()->GetRemoteFilePath( 0, executable );
+    job->GetToolManifest()->GetRemotePath( workingDir );
+
+    const BuildResult result = Execute( job, executable, fullArgs, workingDir.Get(), job->GetToolManifest()->GetRemoteEnvironmentString() );
 
+    // cleanup inputs (the output is returned and cleaned up by the caller)
+    DeleteRemoteInputFiles( tmpDirectory );
+
+    return result;
+}
+
+// Execute
+//------------------------------------------------------------------------------
+Node::BuildResult ExecNode::Execute( Job * job, const AString & executable, const AString & args, const char * workingDir, const char * environment )
+{
     // spawn the process
-    Process p( FBuild::Get().GetAbortBuildPointer() );
-    bool spawnOK = p.Spawn( GetExecutable()->GetName().Get(),
-                            fullArgs.Get(),
+    Process p( FBuild::GetAbortBuildPointer(), job->GetAbortFlagPointer() );
+    bool spawnOK = p.Spawn( executable.Get(),
+                            args.Get(),
                             workingDir,
-                            FBuild::Get().GetEnvironmentString() );
+                            environment );
 
     if ( !spawnOK )
     {
@@ -178,7 +337,7 @@ ExecNode::~ExecNode() = default;
             return NODE_RESULT_FAILED;
         }
 
-        FLOG_ERROR( "Failed to spawn process for '%s'", GetName().Get() );
+        job->Error( "Failed to spawn process for '%s'", GetName().Get() );
         return NODE_RESULT_FAILED;
     }
 
@@ -203,7 +362,7 @@ ExecNode::~ExecNode() = default;
         Node::DumpOutput( job, memOut.Get(), memOutSize );
         Node::DumpOutput( job, memErr.Get(), memErrSize );
 
-        FLOG_ERROR( "Execution failed (error %i) '%s'", result, GetName().Get() );
+        job->Error( "Execution failed (error %i) '%s'", result, GetName().Get() );
         return NODE_RESULT_FAILED;
     }
 
@@ -221,9 +380,461 @@ ExecNode::~ExecNode() = default;
 
     // update the file's "last modified" time
     m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
+
     return NODE_RESULT_OK;
 }
 
+// CanBeDistributed
+//------------------------------------------------------------------------------
+bool ExecNode::CanBeDistributed() const
+{
+    if ( ( m_ExecAllowDistribution == false ) || ( FBuild::Get().GetOptions().m_AllowDistributed == false ) )
+    {
+        return false;
+    }
+
+    const CompilerNode * compiler = GetCompiler();
+    if ( ( compiler == nullptr ) || ( compiler->CanBeDistributed() == false ) )
+    {
+        return false;
+    }
+
+    // the inputs are held in memory until the job is done
+    return ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
+}
+
+// GetInputRoot
+//------------------------------------------------------------------------------
+bool ExecNode::GetInputRoot( const Array< AString > & inputFiles, AString & inputRoot ) const
+{
+    // the deepest dir holding all of the input files and .ExecInputPaths
+    inputRoot.Clear();
+    bool first = true;
+    Array< AString > inputDirs( inputFiles.GetSize() + m_ExecInputPath.GetSize(), false );
+    for ( const AString & inputFile : inputFiles )
+    {
+        const char * lastSlash = inputFile.FindLast( NATIVE_SLASH );
+        inputDirs.Append( AStackString<>( inputFile.Get(), lastSlash ? ( lastSlash + 1 ) : inputFile.Get() ) );
+    }
+    inputDirs.Append( m_ExecInputPath );
+    for ( const AString & inputDir : inputDirs )
+    {
+        if ( first )
+        {
+            inputRoot = inputDir;
+            first = false;
+        }
+        while ( PathUtils::PathBeginsWith( inputDir, inputRoot ) == false )
+        {
+            // move up a dir
+            inputRoot.SetLength( inputRoot.GetLength() - 1 );
+            const char * lastSlash = inputRoot.FindLast( NATIVE_SLASH );
+            inputRoot.SetLength( lastSlash ? (uint32_t)( lastSlash + 1 - inputRoot.Get() ) : 0 );
+        }
+        if ( inputRoot.IsEmpty() )
+        {
+            return false; // nothing in common (only possible with several drives on Windows)
+        }
+    }
+    return true;
+}
+
+// LoadInputFilesForDistribution
+//------------------------------------------------------------------------------
+bool ExecNode::LoadInputFilesForDistribution( Job * job, const Array< AString > & inputFiles ) const
+{
+    PROFILE_FUNCTION
+
+    MultiBuffer buffer;
+    if ( buffer.CreateFromFiles( inputFiles ) == false )
+    {
+        job->Error( "Failed to read inputs for distribution '%s'", GetName().Get() );
+        return false;
+    }
+
+    // compress job data
+    Compressor c;
+    c.Compress( buffer.GetData(), (size_t)buffer.GetDataSize() );
+    size_t compressedSize = c.GetResultSize();
+    job->OwnData( c.ReleaseResult(), compressedSize, true );
+    return true;
+}
+
+// WriteRemoteInputFiles
+//------------------------------------------------------------------------------
+bool ExecNode::WriteRemoteInputFiles( Job * job, AString & tmpDirectory, Array< AString > & inputFiles ) const
+{
+    const void * data = job->GetData();
+    size_t dataSize = job->GetDataSize();
+
+    // handle compressed data
+    Compressor c; // scoped here so we can access decompression buffer
+    if ( job->IsDataCompressed() )
+    {
+        c.Decompress( data );
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+    MultiBuffer buffer( data, dataSize );
+
+    // inputs keep their paths relative to the dir holding them all on the
+    // client, so executables can find inputs relative to each other
+    const uint32_t nameHash = xxHash::Calc32( GetName().Get(), GetName().GetLength() );
+    WorkerThread::GetTempFileDirectory( tmpDirectory );
+    tmpDirectory.AppendFormat( "%08X%c", nameHash, NATIVE_SLASH );
+
+    const size_t numInputFiles = m_ExecInput.GetSize();
+    for ( size_t i = 0; i < numInputFiles; ++i )
+    {
+        const AString & inputFile = m_ExecInput[ i ];
+        ASSERT( PathUtils::PathBeginsWith( inputFile, m_RemoteInputRoot ) );
+
+        AStackString<> tmpFileName( tmpDirectory );
+        tmpFileName += ( inputFile.Get() + m_RemoteInputRoot.GetLength() );
+        if ( Node::EnsurePathExistsForFile( tmpFileName ) == false )
+        {
+            job->Error( "Failed to create temp directory for '%s' to build '%s' (error %u)", tmpFileName.Get(), GetName().Get(), Env::GetLastErr() );
+            job->OnSystemError();
+            return false;
+        }
+
+        if ( buffer.ExtractFile( i, tmpFileName ) == false )
+        {
+            job->Error( "Failed to write temp file '%s' to build '%s' (error %u)", tmpFileName.Get(), GetName().Get(), Env::GetLastErr() );
+            job->OnSystemError();
+            return false;
+        }
+        inputFiles.Append( tmpFileName );
+    }
+
+    return true;
+}
+
+// DeleteRemoteInputFiles
+//------------------------------------------------------------------------------
+void ExecNode::DeleteRemoteInputFiles( const AString & tmpDirectory ) const
+{
+    if ( tmpDirectory.IsEmpty() )
+    {
+        return;
+    }
+
+    // the inputs, and any files the executable wrote alongside them
+    Array< AString > files( 16, true );
+    FileIO::GetFiles( tmpDirectory, AStackString<>( "*" ), true, &files );
+    for ( const AString & file : files )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+
+    // and the directories holding them, so they don't accumulate on the worker
+    // (deleting a dir still holding another input's dir fails, but it is
+    // deleted when that input is handled)
+    for ( const AString & inputFile : m_ExecInput )
+    {
+        AStackString<> inputDirectory( tmpDirectory );
+        inputDirectory += ( inputFile.Get() + m_RemoteInputRoot.GetLength() );
+        for ( ;; )
+        {
+            const char * lastSlash = inputDirectory.FindLast( NATIVE_SLASH );
+            if ( ( lastSlash == nullptr ) || ( (uint32_t)( lastSlash - inputDirectory.Get() ) < tmpDirectory.GetLength() ) )
+            {
+                break; // reached the temp dir
+            }
+            inputDirectory.SetLength( (uint32_t)( lastSlash - inputDirectory.Get() ) );
+            FileIO::DirectoryDelete( inputDirectory );
+        }
+    }
+    FileIO::DirectoryDelete( tmpDirectory );
+}
+
+// ReplaceInputRoot
+//------------------------------------------------------------------------------
+/*static*/ void ExecNode::ReplaceInputRoot( AString & arguments, const AString & inputRoot, const AString & tmpDirectory )
+{
+    // the root without its trailing slash, so the dir itself is also replaced
+    ASSERT( inputRoot.IsEmpty() || inputRoot.EndsWith( NATIVE_SLASH ) );
+    const AStackString<> from( inputRoot.Get(), inputRoot.GetEnd() - ( inputRoot.IsEmpty() ? 0 : 1 ) );
+    const AStackString<> to( tmpDirectory.Get(), tmpDirectory.GetEnd() - 1 );
+    if ( from.Find( NATIVE_SLASH ) == nullptr )
+    {
+        return; // a drive or filesystem root is too general to be replaced
+    }
+
+    // only whole dir names are replaced (so "c:\dir" is not replaced in "c:\dir2")
+    AStackString< 4 * KILOBYTE > result;
+    const char * pos = arguments.Get();
+    for ( ;; )
+    {
+        const char * found = strstr( pos, from.Get() );
+        if ( found == nullptr )
+        {
+            break;
+        }
+        const char next = found[ from.GetLength() ];
+        const bool wholeDir = ( next == NATIVE_SLASH ) || ( next == '"' ) || ( next == ' ' ) || ( next == '\0' );
+        result.Append( pos, (size_t)( found - pos ) );
+        result += wholeDir ? to : from;
+        pos = found + from.GetLength();
+    }
+    result += pos;
+    arguments = result;
+}
+
+// GetCompiler
+//------------------------------------------------------------------------------
+const CompilerNode * ExecNode::GetCompiler() const
+{
+    // node is null if executing remotely
+    const Node * node = m_StaticDependencies[ 0 ].GetNode();
+    return ( node && ( node->GetType() == Node::COMPILER_NODE ) ) ? node->CastTo< CompilerNode >() : nullptr;
+}
+
+// GetExecutable
+//------------------------------------------------------------------------------
+const AString & ExecNode::GetExecutable() const
+{
+    const CompilerNode * compiler = GetCompiler();
+    return compiler ? compiler->GetExecutable() : m_StaticDependencies[ 0 ].GetNode()->GetName();
+}
+
+// SaveRemote
+//------------------------------------------------------------------------------
+/*virtual*/ void ExecNode::SaveRemote( IOStream & stream ) const
+{
+    // Save minimal information for the remote worker
+    Array< AString > inputFiles;
+    GetInputFileNames( inputFiles );
+    AStackString<> inputRoot;
+    VERIFY( GetInputRoot( inputFiles, inputRoot ) ); // checked before the job was made distributable
+
+    stream.Write( m_Name );
+    stream.Write( inputFiles );
+    stream.Write( inputRoot );
+    stream.Write( m_ExecArguments );
+    stream.Write( m_ExecReturnCode );
+    stream.Write( m_ExecUseStdOutAsOutput );
+}
+
+// LoadRemote
+//------------------------------------------------------------------------------
+/*static*/ Node * ExecNode::LoadRemote( IOStream & stream )
+{
+    AStackString<> name;
+    Array< AString > inputFiles;
+    AStackString<> inputRoot;
+    AStackString<> arguments;
+    int32_t returnCode;
+    bool useStdOutAsOutput;
+    if ( ( stream.Read( name ) == false ) ||
+         ( stream.Read( inputFiles ) == false ) ||
+         ( stream.Read( inputRoot ) == false ) ||
+         ( stream.Read( arguments ) == false ) ||
+         ( stream.Read( returnCode ) == false ) ||
+         ( stream.Read( useStdOutAsOutput ) == false ) )
+    {
+        return nullptr;
+    }
+
+    return FNEW( ExecNode( name, inputFiles, inputRoot, arguments, returnCode, useStdOutAsOutput ) );
+}
+
+// ShouldUseCache
+//------------------------------------------------------------------------------
+bool ExecNode::ShouldUseCache() const
+{
+    return m_ExecCacheable &&
+           ( FBuild::Get().GetOptions().m_UseCacheRead ||
+             FBuild::Get().GetOptions().m_UseCacheWrite );
+}
+
+// GetCacheName
+//------------------------------------------------------------------------------
+bool ExecNode::GetCacheName( Job * job, const AString & fullArgs ) const
+{
+    PROFILE_FUNCTION
+
+    FileHashCache & fileHashCache = FBuild::Get().GetFileHashCache();
+
+    // hash the contents of the inputs (files and the contents of the input paths)
+    Array< uint64_t > inputHashes( m_StaticDependencies.GetSize() + m_DynamicDependencies.GetSize(), false );
+    const size_t endIndex = ( 1 + m_NumExecInputFiles ); // Skip Executable
+    for ( size_t i = 1; i < endIndex; ++i )
+    {
+        uint64_t hash;
+        if ( fileHashCache.GetHash( m_StaticDependencies[ i ].GetNode()->GetName(), hash ) == false )
+        {
+            return false; // can't cache without the input (the executable might not need it)
+        }
+        inputHashes.Append( hash );
+    }
+    for ( const Dependency & dep : m_DynamicDependencies )
+    {
+        uint64_t hash;
+        if ( fileHashCache.GetHash( dep.GetNode()->GetName(), hash ) == false )
+        {
+            return false;
+        }
+        inputHashes.Append( hash );
+    }
+    const uint64_t a = xxHash::Calc64( inputHashes.Begin(), inputHashes.GetSize() * sizeof( uint64_t ) );
+
+    // hash the command line (which includes the input and output names)
+    const uint32_t b = xxHash::Calc32( fullArgs.Get(), fullArgs.GetLength() );
+
+    // hash the executable (and its extra files when provided by a Compiler())
+    uint64_t c;
+    const CompilerNode * compiler = GetCompiler();
+    if ( compiler )
+    {
+        c = compiler->GetManifest().GetToolId();
+    }
+    else if ( fileHashCache.GetHash( GetExecutable(), c ) == false )
+    {
+        return false;
+    }
+
+    // how the executable is run (working dir and environment) and how the output is written
+    const char * envString = FBuild::Get().GetEnvironmentString();
+    uint64_t runHashes[ 3 ];
+    runHashes[ 0 ] = xxHash::Calc64( m_ExecWorkingDir );
+    runHashes[ 1 ] = envString ? xxHash::Calc64( envString, FBuild::Get().GetEnvironmentStringSize() ) : 0;
+    runHashes[ 2 ] = m_ExecUseStdOutAsOutput ? 1 : 0;
+    const uint64_t d = xxHash::Calc64( runHashes, sizeof( runHashes ) );
+
+    AStackString<> cacheName;
+    FBuild::Get().GetCacheFileName( a, b, c, d, cacheName );
+    job->SetCacheName( cacheName );
+    return true;
+}
+
+// RetrieveFromCache
+//------------------------------------------------------------------------------
+bool ExecNode::RetrieveFromCache( Job * job )
+{
+    if ( FBuild::Get().GetOptions().m_UseCacheRead == false )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION
+
+    const AString & cacheFileName = job->GetCacheName();
+
+    Timer t;
+
+    ICache * cache = FBuild::Get().GetCache();
+    ASSERT( cache );
+    if ( cache )
+    {
+        void * cacheData( nullptr );
+        size_t cacheDataSize( 0 );
+        if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+        {
+            // do decompression
+            Compressor c;
+            if ( c.IsValidData( cacheData, cacheDataSize ) == false )
+            {
+                cache->FreeMemory( cacheData, cacheDataSize );
+                FLOG_WARN( "Cache returned invalid data for '%s'", m_Name.Get() );
+                return false;
+            }
+            c.Decompress( cacheData );
+            cache->FreeMemory( cacheData, cacheDataSize );
+
+            // extract the output
+            MultiBuffer buffer( c.GetResult(), c.GetResultSize() );
+            if ( !buffer.ExtractFile( 0, m_Name ) )
+            {
+                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", m_Name.Get() );
+                return false;
+            }
+
+            FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
+            m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
+
+            // Output
+            AStackString<> output;
+            output.Format( "Run: %s <CACHE>\n", GetName().Get() );
+            if ( FBuild::Get().GetOptions().m_CacheVerbose )
+            {
+                output.AppendFormat( " - Cache Hit: %u ms '%s'\n", uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
+            }
+            FLOG_BUILD_DIRECT( output.Get() );
+
+            SetStatFlag( Node::STATS_CACHE_HIT );
+            return true;
+        }
+    }
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_BUILD( "Run: %s\n"
+                    " - Cache Miss: %u ms '%s'\n",
+                    GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
+    }
+
+    SetStatFlag( Node::STATS_CACHE_MISS );
+    return false;
+}
+
+// WriteToCache
+//------------------------------------------------------------------------------
+void ExecNode::WriteToCache( Job * job )
+{
+    if ( FBuild::Get().GetOptions().m_UseCacheWrite == false )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION
+
+    const AString & cacheFileName = job->GetCacheName();
+    ASSERT( !cacheFileName.IsEmpty() );
+
+    Timer t;
+
+    ICache * cache = FBuild::Get().GetCache();
+    ASSERT( cache );
+    if ( cache )
+    {
+        Array< AString > fileNames( 1, false );
+        fileNames.Append( m_Name );
+
+        MultiBuffer buffer;
+        if ( buffer.CreateFromFiles( fileNames ) )
+        {
+            // try to compress
+            Compressor c;
+            c.Compress( buffer.GetData(), (size_t)buffer.GetDataSize() );
+
+            if ( cache->Publish( cacheFileName, c.GetResult(), c.GetResultSize() ) )
+            {
+                // cache store complete
+                SetStatFlag( Node::STATS_CACHE_STORE );
+
+                // Output
+                if ( FBuild::Get().GetOptions().m_CacheVerbose )
+                {
+                    FLOG_BUILD( "Run: %s\n"
+                                " - Cache Store: %u ms '%s'\n",
+                                GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
+                }
+                return;
+            }
+        }
+    }
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_BUILD( "Run: %s\n"
+                    " - Cache Store Fail: %u ms '%s'\n",
+                    GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
+    }
+}
+
 // EmitCompilationMessage
 //------------------------------------------------------------------------------
 void ExecNode::EmitCompilationMessage( const AString & args ) const
@@ -239,7 +850,7 @@ void ExecNode::EmitCompilationMessage( const AString & args ) const
     {
         AStackString< 1024 > verboseOutput;
         verboseOutput.Format( "%s %s\nWorkingDir: %s\nExpectedReturnCode: %i\n",
-                              GetExecutable()->GetName().Get(),
+                              GetExecutable().Get(),
                               args.Get(),
                               m_ExecWorkingDir.Get(),
                               m_ExecReturnCode );
@@ -252,7 +863,7 @@ void ExecNode::EmitCompilationMessage( const AString & args ) const
 
 // GetFullArgs
 //------------------------------------------------------------------------------
-void ExecNode::GetFullArgs(AString & fullArgs) const
+void ExecNode::GetFullArgs( const Array< AString > & inputFiles, AString & fullArgs ) const
 {
     // split into tokens
     Array< AString > tokens(1024, true);
@@ -274,7 +885,7 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
             }
 
             // concatenate files, unquoted
-            GetInputFiles(fullArgs, pre, AString::GetEmpty());
+            GetInputFiles(inputFiles, fullArgs, pre, AString::GetEmpty());
         }
         else if (token.EndsWith("\"%1\""))
         {
@@ -282,7 +893,7 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
             AStackString<> pre(token.Get(), token.GetEnd() - 3); // 3 instead of 4 to include quote
 
             // concatenate files, quoted
-            GetInputFiles(fullArgs, pre, quote);
+            GetInputFiles(inputFiles, fullArgs, pre, quote);
         }
         else if (token.EndsWith("%2"))
         {
@@ -312,9 +923,26 @@ void ExecNode::GetFullArgs(AString & fullArgs) const
 
 // GetInputFiles
 //------------------------------------------------------------------------------
-void ExecNode::GetInputFiles(AString & fullArgs, const AString & pre, const AString & post) const
+void ExecNode::GetInputFiles( const Array< AString > & inputFiles, AString & fullArgs, const AString & pre, const AString & post ) const
 {
     bool first = true; // Handle comma separation
+    for ( const AString & inputFile : inputFiles )
+    {
+        if ( !first )
+        {
+            fullArgs += ' ';
+        }
+        fullArgs += pre;
+        fullArgs += inputFile;
+        fullArgs += post;
+        first = false;
+    }
+}
+
+// GetInputFileNames
+//------------------------------------------------------------------------------
+void ExecNode::GetInputFileNames( Array< AString > & inputFiles ) const
+{
     for ( size_t i=1; i < m_StaticDependencies.GetSize(); ++i ) // Note: Skip first dep (exectuable)
     {
         const Dependency & dep = m_StaticDependencies[ i ];
@@ -327,26 +955,12 @@ void ExecNode::GetInputFiles(AString & fullArgs, const AString & pre, const AStr
             const Array< FileIO::FileInfo > & files = dln->GetFiles();
             for ( const FileIO::FileInfo & file : files )
             {
-                if ( !first )
-                {
-                    fullArgs += ' ';
-                }
-                fullArgs += pre;
-                fullArgs += file.m_Name;
-                fullArgs += post;
-                first = false;
+                inputFiles.Append( file.m_Name );
             }
             continue;
         }
 
-        if ( !first )
-        {
-            fullArgs += ' ';
-        }
-        fullArgs += pre;
-        fullArgs += dep.GetNode()->GetName();
-        fullArgs += post;
-        first = false;
+        inputFiles.Append( n->GetName() );
     }
 }
 
@@ -9,6 +9,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CompilerNode;
 
 // ExecNode
 //------------------------------------------------------------------------------
@@ -18,20 +19,54 @@ class ExecNode : public FileNode
 public:
     explicit ExecNode();
     virtual bool Initialize( NodeGraph & nodeGraph, const BFFIterator & iter, const Function * function ) override;
+    // simplified remote constructor
+    explicit ExecNode( const AString & outputName,
+                       const Array< AString > & inputFiles,
+                       const AString & inputRoot,
+                       const AString & arguments,
+                       int32_t returnCode,
+                       bool useStdOutAsOutput );
     virtual ~ExecNode();
 
     static inline Node::Type GetTypeS() { return Node::EXEC_NODE; }
 
+    virtual const AString & GetResourcePool() const override { return m_ResourcePool; }
+
+    // the Compiler() providing the executable (nullptr for a plain file)
+    const CompilerNode * GetCompiler() const;
+
+    virtual void SaveRemote( IOStream & stream ) const override;
+    static Node * LoadRemote( IOStream & stream );
+
 private:
+    friend class Client;
+
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
     virtual BuildResult DoBuild( Job * job ) override;
+    virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
 
-    const FileNode * GetExecutable() const { return m_StaticDependencies[0].GetNode()->CastTo< FileNode >(); }
-    void GetFullArgs(AString & fullArgs) const;
-    void GetInputFiles(AString & fullArgs, const AString & pre, const AString & post) const;
+    const AString & GetExecutable() const;
+    void GetInputFileNames( Array< AString > & inputFiles ) const;
+    void GetFullArgs( const Array< AString > & inputFiles, AString & fullArgs ) const;
+    void GetInputFiles( const Array< AString > & inputFiles, AString & fullArgs, const AString & pre, const AString & post ) const;
 
+    BuildResult Execute( Job * job, const AString & executable, const AString & args, const char * workingDir, const char * environment );
     void EmitCompilationMessage( const AString & args ) const;
 
+    // with a Compiler() as the executable, the work can be done by a remote worker
+    bool CanBeDistributed() const;
+    bool GetInputRoot( const Array< AString > & inputFiles, AString & inputRoot ) const;
+    bool LoadInputFilesForDistribution( Job * job, const Array< AString > & inputFiles ) const;
+    bool WriteRemoteInputFiles( Job * job, AString & tmpDirectory, Array< AString > & inputFiles ) const;
+    void DeleteRemoteInputFiles( const AString & tmpDirectory ) const;
+    static void ReplaceInputRoot( AString & arguments, const AString & inputRoot, const AString & tmpDirectory );
+
+    // the output can be shared through the cache if requested
+    bool ShouldUseCache() const;
+    bool GetCacheName( Job * job, const AString & fullArgs ) const;
+    bool RetrieveFromCache( Job * job );
+    void WriteToCache( Job * job );
+
     // Exposed Properties
     AString             m_ExecExecutable;
     Array< AString >    m_ExecInput;
@@ -44,11 +79,15 @@ private:
     AString             m_ExecWorkingDir;
     int32_t             m_ExecReturnCode;
     bool                m_ExecUseStdOutAsOutput;
+    bool                m_ExecCacheable;
+    bool                m_ExecAllowDistribution;
     bool                m_ExecInputPathRecurse;
+    AString             m_ResourcePool;
     Array< AString >    m_PreBuildDependencyNames;
 
     // Internal State
     uint32_t            m_NumExecInputFiles;
+    AString             m_RemoteInputRoot;  // dir holding all inputs on the client (remote only)
 };
 
 //------------------------------------------------------------------------------
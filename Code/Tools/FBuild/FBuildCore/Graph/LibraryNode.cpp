@@ -138,6 +138,8 @@ LibraryNode::~LibraryNode() = default;
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult LibraryNode::DoBuild( Job * job )
 {
+    RecordUnityBuildTimes();
+
     // Delete previous file(s) if doing a clean build
     if ( FBuild::Get().GetOptions().m_ForceCleanBuild )
     {
@@ -9,6 +9,7 @@
 #include "FileNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/AliasNode.h"
@@ -41,16 +42,20 @@
 
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/CRC32.h"
 #include "Core/Profile/Profile.h"
+#include "Core/Reflection/MetaData/Meta_Hidden.h"
 #include "Core/Reflection/ReflectedProperty.h"
 #include "Core/Strings/AStackString.h"
 
 // system
 #include <stdio.h>
+#include <string.h>
 
 // Static Data
 //------------------------------------------------------------------------------
@@ -444,8 +449,14 @@ bool Node::DetermineNeedToBuild( bool forceClean ) const
     }
 
     // read contents
-    ASSERT( (Node::Type)nodeType == Node::OBJECT_NODE );
-    return ObjectNode::LoadRemote( stream );
+    switch ( (Node::Type)nodeType )
+    {
+        case Node::OBJECT_NODE: return ObjectNode::LoadRemote( stream );
+        case Node::EXEC_NODE:   return ExecNode::LoadRemote( stream );
+        default:                break;
+    }
+    ASSERT( false ); // only types which can be distributed are expected
+    return nullptr;
 }
 
 // SaveRemote
@@ -454,8 +465,8 @@ bool Node::DetermineNeedToBuild( bool forceClean ) const
 {
     ASSERT( node );
 
-    // only 1 type of node is ever serialized over the network
-    ASSERT( node->GetType() == Node::OBJECT_NODE );
+    // only distributable nodes are ever serialized over the network
+    ASSERT( ( node->GetType() == Node::OBJECT_NODE ) || ( node->GetType() == Node::EXEC_NODE ) );
 
     // save type
     uint32_t nodeType = (uint32_t)node->GetType();
@@ -747,6 +758,85 @@ bool Node::Deserialize( NodeGraph & nodeGraph, IOStream & stream )
     return false;
 }
 
+// DoPropertiesMatch
+//------------------------------------------------------------------------------
+/*static*/ bool Node::DoPropertiesMatch( const Node & a, const Node & b )
+{
+    ASSERT( a.GetType() == b.GetType() );
+
+    // hidden properties are either derived from the others or are build state
+    MemoryStream propertiesA;
+    MemoryStream propertiesB;
+    SerializeProperties( propertiesA, a, false );
+    SerializeProperties( propertiesB, b, false );
+    return ( propertiesA.GetSize() == propertiesB.GetSize() ) &&
+           ( memcmp( propertiesA.GetData(), propertiesB.GetData(), propertiesA.GetSize() ) == 0 );
+}
+
+// Migrate
+//------------------------------------------------------------------------------
+void Node::Migrate( const Node & oldNode )
+{
+    ASSERT( GetType() == oldNode.GetType() );
+    ASSERT( m_Name == oldNode.m_Name );
+
+    m_Stamp = oldNode.m_Stamp;
+    m_LastBuildTimeMs = oldNode.m_LastBuildTimeMs;
+
+    // hidden properties derived from the others are already the same, but
+    // those holding build state (PCH keys, tool manifests etc) are needed
+    MemoryStream hiddenProperties;
+    SerializeProperties( hiddenProperties, oldNode, true );
+    ConstMemoryStream ms( hiddenProperties.GetData(), hiddenProperties.GetSize() );
+    VERIFY( DeserializeProperties( ms, *this, true ) );
+}
+
+// SerializeProperties
+//------------------------------------------------------------------------------
+/*static*/ void Node::SerializeProperties( IOStream & stream, const Node & node, bool hidden )
+{
+    const ReflectionInfo * currentRI = node.GetReflectionInfoV();
+    while ( currentRI )
+    {
+        const ReflectionIter end = currentRI->End();
+        for ( ReflectionIter it = currentRI->Begin(); it != end; ++it )
+        {
+            const ReflectedProperty & property = *it;
+            if ( ( property.HasMetaData< Meta_Hidden >() != nullptr ) == hidden )
+            {
+                Serialize( stream, &node, property );
+            }
+        }
+
+        currentRI = currentRI->GetSuperClass();
+    }
+}
+
+// DeserializeProperties
+//------------------------------------------------------------------------------
+/*static*/ bool Node::DeserializeProperties( IOStream & stream, Node & node, bool hidden )
+{
+    const ReflectionInfo * currentRI = node.GetReflectionInfoV();
+    while ( currentRI )
+    {
+        const ReflectionIter end = currentRI->End();
+        for ( ReflectionIter it = currentRI->Begin(); it != end; ++it )
+        {
+            const ReflectedProperty & property = *it;
+            if ( ( property.HasMetaData< Meta_Hidden >() != nullptr ) == hidden )
+            {
+                if ( !Deserialize( stream, &node, property ) )
+                {
+                    return false;
+                }
+            }
+        }
+
+        currentRI = currentRI->GetSuperClass();
+    }
+    return true;
+}
+
 // SetName
 //------------------------------------------------------------------------------
 void Node::SetName( const AString & name )
@@ -1048,4 +1138,26 @@ bool Node::InitializePreBuildDependencies( NodeGraph & nodeGraph, const BFFItera
     return true;
 }
 
+// InitializeResourcePool
+//------------------------------------------------------------------------------
+/*static*/ bool Node::InitializeResourcePool( NodeGraph & nodeGraph, const BFFIterator & iter, const Function * function, const AString & resourcePool )
+{
+    if ( resourcePool.IsEmpty() )
+    {
+        return true;
+    }
+
+    // pools are declared in the Settings, which must come first
+    const Node * settings = nodeGraph.FindNode( AStackString<>( "$$Settings$$" ) );
+    uint32_t capacity;
+    if ( ( settings == nullptr ) ||
+         ( settings->CastTo< SettingsNode >()->GetResourcePoolCapacity( resourcePool, capacity ) == false ) )
+    {
+        Error::Error_1107_ResourcePoolNotDeclared( iter, function, resourcePool );
+        return false;
+    }
+
+    return true;
+}
+
 //------------------------------------------------------------------------------
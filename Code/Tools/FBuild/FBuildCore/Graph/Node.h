@@ -93,6 +93,7 @@ public:
         STATS_CACHE_STORE   = 0x10, // needed building, was cacheable & was stored to the cache
         STATS_BUILT_REMOTE  = 0x20, // node was built remotely
         STATS_FAILED        = 0x40, // node needed building, but failed
+        STATS_PCH_ANALYSIS_PROCESSED = 0x2000, // seen during PCH analysis
         STATS_REPORT_PROCESSED  = 0x4000, // seen during report processing
         STATS_STATS_PROCESSED   = 0x8000 // mark during stats gathering (leave this last)
     };
@@ -139,6 +140,9 @@ public:
     inline uint32_t GetProcessingTime() const   { return m_ProcessingTime; }
     inline uint32_t GetRecursiveCost() const    { return m_RecursiveCost; }
 
+    // jobs sharing a resource pool are limited to the capacity of the pool (see SettingsNode)
+    virtual const AString & GetResourcePool() const { return AString::GetEmpty(); }
+
     inline uint32_t GetProgressAccumulator() const { return m_ProgressAccumulator; }
     inline void     SetProgressAccumulator( uint32_t p ) const { m_ProgressAccumulator = p; }
 
@@ -181,6 +185,7 @@ protected:
     friend class JobQueue;
     friend class JobQueueRemote;
     friend class NodeGraph;
+    friend class PCHAnalysis;
     friend class ProjectGeneratorBase; // TODO:C Remove this
     friend class Report;
     friend class VSProjectConfig; // TODO:C Remove this
@@ -222,10 +227,20 @@ protected:
     static bool Deserialize( IOStream & stream, void * base, const ReflectionInfo & ri );
     static bool Deserialize( IOStream & stream, void * base, const ReflectedProperty & property );
 
+    // carry build state over from the same node in a previous NodeGraph
+    static bool DoPropertiesMatch( const Node & a, const Node & b );
+    void Migrate( const Node & oldNode );
+    static void SerializeProperties( IOStream & stream, const Node & node, bool hidden );
+    static bool DeserializeProperties( IOStream & stream, Node & node, bool hidden );
+
     bool            InitializePreBuildDependencies( NodeGraph & nodeGraph,
                                                     const BFFIterator & iter,
                                                     const Function * function,
                                                     const Array< AString > & preBuildDependencyNames );
+    static bool     InitializeResourcePool( NodeGraph & nodeGraph,
+                                            const BFFIterator & iter,
+                                            const Function * function,
+                                            const AString & resourcePool );
 
     AString m_Name;
 
@@ -7,6 +7,7 @@
 
 #include "NodeGraph.h"
 
+#include "Tools/FBuild/FBuildCore/BFF/BFFFileLoader.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionSettings.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
@@ -41,9 +42,11 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/CRC32.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Mem/SmallBlockAllocator.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -65,6 +68,11 @@ NodeGraph::NodeGraph()
 : m_AllNodes( 1024, true )
 , m_NextNodeIndex( 0 )
 , m_UsedFiles( 16, true )
+, m_OldNodeGraph( nullptr )
+, m_MigrationStates( 0, true )
+, m_NumPendingDynamicMigrations( 0 )
+, m_EnvironmentHash( 0 )
+, m_LibEnvVarHash( 0 )
 {
     m_NodeMap = FNEW_ARRAY( Node *[NODEMAP_TABLE_SIZE] );
     memset( m_NodeMap, 0, sizeof( Node * ) * NODEMAP_TABLE_SIZE );
@@ -82,6 +90,8 @@ NodeGraph::~NodeGraph()
     }
 
     FDELETE_ARRAY( m_NodeMap );
+
+    FDELETE( m_OldNodeGraph );
 }
 
 // Initialize
@@ -130,8 +140,8 @@ NodeGraph::~NodeGraph()
                 return nullptr;
             }
 
-            // TODO: Migrate old DB info to new DB
-            FDELETE( oldNG );
+            // Nodes defined the same way as before keep their build state
+            newNG->Migrate( oldNG );
 
             return newNG;
         }
@@ -176,7 +186,238 @@ bool NodeGraph::ParseFromRoot( const char * bffFile )
     // re-parse the BFF from scratch, clean build will result
     BFFParser bffParser( *this );
     data.Get()[ size ] = '\0'; // data passed to parser must be NULL terminated
-    return bffParser.Parse( data.Get(), size, bffFile, rootBFFTimeStamp, rootBFFDataHash ); // pass size excluding sentinel
+
+    // the loader threads allocate, so the SmallBlockAllocator can't be in
+    // single threaded mode while they run
+    const bool singleThreadedMode = SmallBlockAllocator::IsSingleThreadedMode();
+    if ( singleThreadedMode )
+    {
+        SmallBlockAllocator::SetSingleThreadedMode( false );
+    }
+
+    bool ok;
+    {
+        // load included files while the root is parsed
+        BFFFileLoader fileLoader;
+        AStackString<> bffFileClean;
+        CleanPath( AStackString<>( bffFile ), bffFileClean );
+        fileLoader.PrefetchIncludes( bffFileClean, data.Get(), size );
+
+        ok = bffParser.Parse( data.Get(), size, bffFile, rootBFFTimeStamp, rootBFFDataHash ); // pass size excluding sentinel
+    }
+
+    if ( singleThreadedMode )
+    {
+        SmallBlockAllocator::SetSingleThreadedMode( true );
+    }
+    return ok;
+}
+
+// Migrate
+//------------------------------------------------------------------------------
+void NodeGraph::Migrate( NodeGraph * oldNodeGraph )
+{
+    PROFILE_FUNCTION
+
+    // Nodes can be defined the same way and still build differently when the
+    // environment or settings changed, so nothing is migrated in that case
+    if ( DoGlobalSettingsMatch( *oldNodeGraph ) == false )
+    {
+        // make sure the user knows why everything will re-build
+        FLOG_WARN( "Environment or Settings have changed - build state will not be reused.\n" );
+        FDELETE( oldNodeGraph );
+        return;
+    }
+
+    // kept to migrate nodes created during the build (objects of an ObjectList etc)
+    ASSERT( m_OldNodeGraph == nullptr );
+    m_OldNodeGraph = oldNodeGraph;
+
+    // file nodes can be added while migrating, but have nothing to migrate
+    const size_t numNodes = m_AllNodes.GetSize();
+    uint32_t numMigrated = 0;
+    for ( size_t i = 0; i < numNodes; ++i )
+    {
+        Node * node = m_AllNodes[ i ];
+        if ( MigrateNode( *node ) && ( node->GetType() != Node::FILE_NODE ) )
+        {
+            ++numMigrated;
+        }
+    }
+
+    FLOG_INFO( "Build state of %u unchanged node(s) reused\n", numMigrated );
+
+    // ObjectLists migrate the objects they create during the build, after which
+    // the old NodeGraph is no longer needed
+    m_NumPendingDynamicMigrations = 0;
+    for ( const Node * node : m_AllNodes )
+    {
+        if ( IsCreatingMigratableNodes( *node ) )
+        {
+            ++m_NumPendingDynamicMigrations;
+        }
+    }
+    if ( m_NumPendingDynamicMigrations == 0 )
+    {
+        FreeOldNodeGraph();
+    }
+}
+
+// IsCreatingMigratableNodes
+//------------------------------------------------------------------------------
+/*static*/ bool NodeGraph::IsCreatingMigratableNodes( const Node & node )
+{
+    return ( ( node.GetType() == Node::OBJECT_LIST_NODE ) ||
+             ( node.GetType() == Node::LIBRARY_NODE ) );
+}
+
+// OnDynamicMigrationDone
+//------------------------------------------------------------------------------
+void NodeGraph::OnDynamicMigrationDone()
+{
+    if ( m_OldNodeGraph == nullptr )
+    {
+        return;
+    }
+
+    ASSERT( m_NumPendingDynamicMigrations > 0 );
+    --m_NumPendingDynamicMigrations;
+    if ( m_NumPendingDynamicMigrations == 0 )
+    {
+        FreeOldNodeGraph();
+    }
+}
+
+// FreeOldNodeGraph
+//------------------------------------------------------------------------------
+void NodeGraph::FreeOldNodeGraph()
+{
+    FDELETE( m_OldNodeGraph );
+    m_OldNodeGraph = nullptr;
+    m_MigrationStates.Destruct();
+}
+
+// DoGlobalSettingsMatch
+//------------------------------------------------------------------------------
+bool NodeGraph::DoGlobalSettingsMatch( const NodeGraph & oldNodeGraph ) const
+{
+    // the environment has been set by the Settings of the new BFF (if any)
+    const FBuild & fBuild = FBuild::Get();
+    if ( ( oldNodeGraph.m_LibEnvVarHash != GetLibEnvVarHash() ) ||
+         ( oldNodeGraph.m_EnvironmentHash != GetEnvironmentHash( fBuild.GetEnvironmentString(), fBuild.GetEnvironmentStringSize() ) ) )
+    {
+        return false;
+    }
+
+    // a default SettingsNode is used when the BFF doesn't define one
+    const AStackString<> settingsName( "$$Settings$$" );
+    const Node * oldSettings = oldNodeGraph.FindNodeExact( settingsName );
+    const Node * newSettings = FindNodeExact( settingsName );
+    if ( ( oldSettings == nullptr ) && ( newSettings == nullptr ) )
+    {
+        return true;
+    }
+    const SettingsNode defaultSettings;
+    return Node::DoPropertiesMatch( oldSettings ? *oldSettings : defaultSettings,
+                                    newSettings ? *newSettings : defaultSettings );
+}
+
+// MigrateNode
+//------------------------------------------------------------------------------
+bool NodeGraph::MigrateNode( Node & node )
+{
+    if ( m_OldNodeGraph == nullptr )
+    {
+        return false; // the BFF didn't change
+    }
+
+    const uint32_t index = node.GetIndex();
+    while ( m_MigrationStates.GetSize() <= index )
+    {
+        m_MigrationStates.Append( MIGRATION_NOT_VISITED );
+    }
+    if ( m_MigrationStates[ index ] == MIGRATION_NOT_VISITED )
+    {
+        m_MigrationStates[ index ] = MIGRATION_NOT_MIGRATED; // until the dependencies are checked
+        if ( MigrateNodeInternal( node ) )
+        {
+            m_MigrationStates[ index ] = MIGRATION_MIGRATED;
+        }
+    }
+    return ( m_MigrationStates[ index ] == MIGRATION_MIGRATED );
+}
+
+// MigrateNodeInternal
+//------------------------------------------------------------------------------
+bool NodeGraph::MigrateNodeInternal( Node & newNode )
+{
+    // files have no build state of their own
+    if ( newNode.GetType() == Node::FILE_NODE )
+    {
+        return true;
+    }
+
+    const Node * oldNode = m_OldNodeGraph->FindNodeExact( newNode.GetName() );
+    if ( ( oldNode == nullptr ) || ( oldNode->GetType() != newNode.GetType() ) )
+    {
+        return false; // new, or a different kind of node
+    }
+
+    // The node must be defined the same way, with the same dependencies. The
+    // dependencies must have been migrated too, since they can affect how the
+    // node builds (and its hidden properties) without changing its definition.
+    if ( ( MigrateDependencies( oldNode->m_PreBuildDependencies, newNode.m_PreBuildDependencies ) == false ) ||
+         ( MigrateDependencies( oldNode->m_StaticDependencies, newNode.m_StaticDependencies ) == false ) ||
+         ( Node::DoPropertiesMatch( *oldNode, newNode ) == false ) )
+    {
+        return false;
+    }
+
+    // dynamic dependencies found by the previous build (the includes of an
+    // ObjectNode for example)
+    ASSERT( newNode.m_DynamicDependencies.IsEmpty() );
+    newNode.m_DynamicDependencies.SetCapacity( oldNode->m_DynamicDependencies.GetSize() );
+    for ( const Dependency & dep : oldNode->m_DynamicDependencies )
+    {
+        const Node * oldDep = dep.GetNode();
+        Node * newDep = FindNodeExact( oldDep->GetName() );
+        if ( newDep == nullptr )
+        {
+            if ( oldDep->GetType() != Node::FILE_NODE )
+            {
+                // nodes depending on other kinds of nodes discover them again
+                // on every build (creating them if needed)
+                continue;
+            }
+            newDep = CreateFileNode( oldDep->GetName(), false ); // already clean
+        }
+        newNode.m_DynamicDependencies.Append( Dependency( newDep, dep.IsWeak() ) );
+    }
+
+    newNode.Migrate( *oldNode );
+    return true;
+}
+
+// MigrateDependencies
+//------------------------------------------------------------------------------
+bool NodeGraph::MigrateDependencies( const Dependencies & oldDeps, const Dependencies & newDeps )
+{
+    if ( oldDeps.GetSize() != newDeps.GetSize() )
+    {
+        return false;
+    }
+    for ( size_t i = 0; i < newDeps.GetSize(); ++i )
+    {
+        const Dependency & oldDep = oldDeps[ i ];
+        const Dependency & newDep = newDeps[ i ];
+        if ( ( oldDep.IsWeak() != newDep.IsWeak() ) ||
+             ( oldDep.GetNode()->GetName() != newDep.GetNode()->GetName() ) ||
+             ( MigrateNode( *newDep.GetNode() ) == false ) )
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 // Load
@@ -221,7 +462,15 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
         return LoadResult::OK_BFF_CHANGED;
     }
 
+    // file hashes remain valid even if the BFF has changed
+    if ( FBuild::Get().GetFileHashCache().Load( stream ) == false )
+    {
+        return LoadResult::LOAD_ERROR;
+    }
+
     // check if any files used have changed
+    // - the nodes are still loaded if so, so unchanged ones can keep their build state
+    bool bffChanged = false;
     for ( size_t i=0; i<usedFiles.GetSize(); ++i )
     {
         const AString & fileName = usedFiles[ i ].m_FileName;
@@ -235,7 +484,8 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
         if ( fs.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
         {
             FLOG_INFO( "BFF file '%s' missing or unopenable (reparsing will occur).", fileName.Get() );
-            return LoadResult::OK_BFF_CHANGED; // not opening the file is not an error, it could be not needed anymore
+            bffChanged = true; // not opening the file is not an error, it could be not needed anymore
+            break;
         }
 
         const size_t size = (size_t)fs.GetFileSize();
@@ -254,11 +504,10 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
         }
 
         FLOG_WARN( "BFF file '%s' has changed (reparsing will occur).", fileName.Get() );
-        return LoadResult::OK_BFF_CHANGED;
+        bffChanged = true;
+        break;
     }
 
-    m_UsedFiles = usedFiles;
-
     // TODO:C The serialization of these settings doesn't really belong here (not part of node graph)
 
     // environment
@@ -306,18 +555,29 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
                 return LoadResult::LOAD_ERROR;
             }
 
+            if ( bffChanged )
+            {
+                continue; // the BFF will be re-parsed, importing the variables it still uses
+            }
+
             bool optional = ( savedVarHash == 0 ); // a hash of 0 means the env var was missing when it was evaluated
             if ( FBuild::Get().ImportEnvironmentVar( varName.Get(), optional, varValue, importedVarHash ) == false )
             {
-                // make sure the user knows why some things might re-build
-                FLOG_WARN( "'%s' Environment variable was not found - BFF will be re-parsed\n", varName.Get() );
-                return LoadResult::OK_BFF_CHANGED;
+                if ( bffChanged == false )
+                {
+                    // make sure the user knows why some things might re-build
+                    FLOG_WARN( "'%s' Environment variable was not found - BFF will be re-parsed\n", varName.Get() );
+                    bffChanged = true;
+                }
             }
-            if ( importedVarHash != savedVarHash )
+            else if ( importedVarHash != savedVarHash )
             {
-                // make sure the user knows why some things might re-build
-                FLOG_WARN( "'%s' Environment variable has changed - BFF will be re-parsed\n", varName.Get() );
-                return LoadResult::OK_BFF_CHANGED;
+                if ( bffChanged == false )
+                {
+                    // make sure the user knows why some things might re-build
+                    FLOG_WARN( "'%s' Environment variable has changed - BFF will be re-parsed\n", varName.Get() );
+                    bffChanged = true;
+                }
             }
         }
     }
@@ -330,13 +590,17 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
     }
     else
     {
+        // kept to check whether the build state can be migrated if the BFF changed
+        m_LibEnvVarHash = libEnvVarHashInDB;
+        m_EnvironmentHash = GetEnvironmentHash( envString.Get(), envStringSize );
+
         // If the Environment will be overriden, make sure we use the LIB from that
         const uint32_t libEnvVarHash = ( envStringSize > 0 ) ? xxHash::Calc32( libEnvVar ) : GetLibEnvVarHash();
-        if ( libEnvVarHashInDB != libEnvVarHash )
+        if ( ( libEnvVarHashInDB != libEnvVarHash ) && ( bffChanged == false ) )
         {
             // make sure the user knows why some things might re-build
             FLOG_WARN( "'%s' Environment variable has changed - BFF will be re-parsed\n", "LIB" );
-            return LoadResult::OK_BFF_CHANGED;
+            bffChanged = true;
         }
     }
 
@@ -366,8 +630,15 @@ NodeGraph::LoadResult NodeGraph::Load( IOStream & stream, const char * nodeGraph
         ASSERT( m_AllNodes[ i ]->GetIndex() == i ); // index was correctly persisted
     }
 
+    // The BFF will be re-parsed, with these nodes only used for their build state
+    if ( bffChanged )
+    {
+        return LoadResult::OK_BFF_CHANGED;
+    }
+
     // Everything OK - propagate global settings
     //------------------------------------------------
+    m_UsedFiles = usedFiles;
 
     // Environment
     if ( envStringSize > 0 )
@@ -443,6 +714,9 @@ void NodeGraph::Save( IOStream & stream, const char* nodeGraphDBFile ) const
         stream.Write( dataHash );
     }
 
+    // write file hashes (before anything which depends on the BFF, so they can be loaded even if it changes)
+    FBuild::Get().GetFileHashCache().Save( stream );
+
     // TODO:C The serialization of these settings doesn't really belong here (not part of node graph)
     {
         // environment
@@ -628,6 +902,15 @@ Node * NodeGraph::FindNodeExact( const AString & nodeName ) const
     return FindNodeInternal( nodeName );
 }
 
+// FindNodeExact (AString &, uint32_t)
+//------------------------------------------------------------------------------
+Node * NodeGraph::FindNodeExact( const AString & nodeName, uint32_t nameCRC ) const
+{
+    // try to find node 'as is', with a name hash computed by the caller
+    ASSERT( nameCRC == CRC32::CalcLower( nodeName ) );
+    return FindNodeInternal( nodeName, nameCRC );
+}
+
 // GetNodeByIndex
 //------------------------------------------------------------------------------
 Node * NodeGraph::GetNodeByIndex( size_t index ) const
@@ -654,6 +937,21 @@ void NodeGraph::RegisterNode( Node * node )
     AddNode( node );
 }
 
+// ReserveNodes
+//------------------------------------------------------------------------------
+void NodeGraph::ReserveNodes( size_t numNewNodes )
+{
+    ASSERT( Thread::IsMainThread() );
+
+    // avoid repeatedly growing the node list when many nodes are created at once,
+    // growing geometrically so repeated reservations don't copy the list each time
+    const size_t needed = ( m_AllNodes.GetSize() + numNewNodes );
+    if ( needed > m_AllNodes.GetCapacity() )
+    {
+        m_AllNodes.SetCapacity( Math::Max( needed, m_AllNodes.GetCapacity() * 3 / 2 ) );
+    }
+}
+
 // CreateCopyFileNode
 //------------------------------------------------------------------------------
 CopyFileNode * NodeGraph::CreateCopyFileNode( const AString & dstFileName )
@@ -927,7 +1225,8 @@ void NodeGraph::AddNode( Node * node )
     ASSERT( FindNodeInternal( node->GetName() ) == nullptr ); // node name must be unique
 
     // track in NodeMap
-    const uint32_t crc = CRC32::CalcLower( node->GetName() );
+    const uint32_t crc = node->GetNameCRC();
+    ASSERT( crc == CRC32::CalcLower( node->GetName() ) );
     const size_t key = ( crc & 0xFFFF );
     node->m_Next = m_NodeMap[ key ];
     m_NodeMap[ key ] = node;
@@ -1057,7 +1356,12 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
     {
         // static deps ready, update dynamic deps
         bool forceClean = FBuild::Get().GetOptions().m_ForceCleanBuild;
-        if ( nodeToBuild->DoDynamicDependencies( *this, forceClean ) == false )
+        const bool dynamicDepsOK = nodeToBuild->DoDynamicDependencies( *this, forceClean );
+        if ( IsCreatingMigratableNodes( *nodeToBuild ) )
+        {
+            OnDynamicMigrationDone();
+        }
+        if ( dynamicDepsOK == false )
         {
             nodeToBuild->SetState( Node::FAILED );
             return;
@@ -1381,10 +1685,16 @@ void NodeGraph::SetCurrentFileAsOneUse()
 // FindNodeInternal
 //------------------------------------------------------------------------------
 Node * NodeGraph::FindNodeInternal( const AString & fullPath ) const
+{
+    return FindNodeInternal( fullPath, CRC32::CalcLower( fullPath ) );
+}
+
+// FindNodeInternal
+//------------------------------------------------------------------------------
+Node * NodeGraph::FindNodeInternal( const AString & fullPath, uint32_t crc ) const
 {
     ASSERT( Thread::IsMainThread() );
 
-    const uint32_t crc = CRC32::CalcLower( fullPath );
     const size_t key = ( crc & 0xFFFF );
 
     Node * n = m_NodeMap[ key ];
@@ -1640,6 +1950,14 @@ uint32_t NodeGraph::GetLibEnvVarHash() const
     return xxHash::Calc32( libVar );
 }
 
+// GetEnvironmentHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t NodeGraph::GetEnvironmentHash( const char * envString, uint32_t envStringSize )
+{
+    // no environment string means the environment of the process is used
+    return ( envStringSize > 0 ) ? xxHash::Calc64( envString, envStringSize ) : 0;
+}
+
 // IsCleanPath
 //------------------------------------------------------------------------------
 #if defined( ASSERTS_ENABLED )
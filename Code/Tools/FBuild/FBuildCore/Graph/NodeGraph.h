@@ -53,7 +53,7 @@ public:
     }
     inline ~NodeGraphHeader() = default;
 
-    enum { NODE_GRAPH_CURRENT_VERSION = 116 };
+    enum { NODE_GRAPH_CURRENT_VERSION = 124 };
 
     bool IsValid() const
     {
@@ -93,10 +93,12 @@ public:
     // access existing nodes
     Node * FindNode( const AString & nodeName ) const;
     Node * FindNodeExact( const AString & nodeName ) const;
+    Node * FindNodeExact( const AString & nodeName, uint32_t nameCRC ) const;
     Node * GetNodeByIndex( size_t index ) const;
     size_t GetNodeCount() const;
 
     void RegisterNode( Node * n );
+    void ReserveNodes( size_t numNewNodes );
 
     // create new nodes
     CopyFileNode * CreateCopyFileNode( const AString & dstFileName );
@@ -122,6 +124,10 @@ public:
 
     void DoBuildPass( Node * nodeToBuild );
 
+    // take the build state of the same node from the NodeGraph used before the BFF changed
+    // (for nodes created during the build - the others are migrated after parsing)
+    bool MigrateNode( Node & node );
+
     static void CleanPath( AString & name, bool makeFullPath = true );
     static void CleanPath( const AString & name, AString & cleanPath, bool makeFullPath = true );
     #if defined( ASSERTS_ENABLED )
@@ -140,6 +146,13 @@ private:
     friend class FBuild;
 
     bool ParseFromRoot( const char * bffFile );
+    void Migrate( NodeGraph * oldNodeGraph );
+    bool DoGlobalSettingsMatch( const NodeGraph & oldNodeGraph ) const;
+    bool MigrateNodeInternal( Node & newNode );
+    bool MigrateDependencies( const Dependencies & oldDeps, const Dependencies & newDeps );
+    static bool IsCreatingMigratableNodes( const Node & node );
+    void OnDynamicMigrationDone();
+    void FreeOldNodeGraph();
 
     void AddNode( Node * node );
 
@@ -153,6 +166,7 @@ private:
                                           uint32_t & totalNodeTime );
 
     Node * FindNodeInternal( const AString & fullPath ) const;
+    Node * FindNodeInternal( const AString & fullPath, uint32_t crc ) const;
 
     struct NodeWithDistance
     {
@@ -166,6 +180,7 @@ private:
     struct UsedFile;
     bool ReadHeaderAndUsedFiles( IOStream & nodeGraphStream, const char* nodeGraphDBFile, Array< UsedFile > & files, bool & compatibleDB ) const;
     uint32_t GetLibEnvVarHash() const;
+    static uint64_t GetEnvironmentHash( const char * envString, uint32_t envStringSize );
 
     // load/save helpers
     static void SaveRecurse( IOStream & stream, Node * node, Array< bool > & savedNodeFlags );
@@ -192,6 +207,21 @@ private:
     };
     Array< UsedFile > m_UsedFiles;
 
+    // the NodeGraph from before the BFF changed, from which unchanged nodes take their build state
+    enum MigrationState : uint8_t
+    {
+        MIGRATION_NOT_VISITED,
+        MIGRATION_MIGRATED,
+        MIGRATION_NOT_MIGRATED,
+    };
+    NodeGraph *                 m_OldNodeGraph;
+    Array< MigrationState >     m_MigrationStates; // indexed by node index
+    uint32_t                    m_NumPendingDynamicMigrations; // ObjectLists which have yet to create (and migrate) their objects
+
+    // global settings of a loaded DB, which must match for its nodes to be migrated
+    uint64_t                    m_EnvironmentHash;
+    uint32_t                    m_LibEnvVarHash;
+
     static uint32_t s_BuildPassTag;
 };
 
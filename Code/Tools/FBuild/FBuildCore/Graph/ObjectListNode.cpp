@@ -22,10 +22,58 @@
 #include "Tools/FBuild/FBuildCore/BFF/BFFVariable.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/FileIO/IOStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/CRC32.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define OBJECT_LIST_NAME_BATCH_SIZE ( 256 ) // files named at a time by each thread
+#define OBJECT_LIST_MAX_THREADS ( 8 )
+
+// ObjectNameBatch - names (and name hashes) of the objects for many input files,
+//                   computed in parallel before the nodes are created
+//------------------------------------------------------------------------------
+class ObjectNameBatch
+{
+public:
+    struct Name
+    {
+        AString     m_ObjectName;
+        uint32_t    m_FileNameCRC;
+        uint32_t    m_ObjectNameCRC;
+    };
+
+    ObjectNameBatch( const ObjectListNode * node, const Array< FileIO::FileInfo > & files, const AString & baseDir )
+        : m_Node( node )
+        , m_Files( files )
+        , m_BaseDir( baseDir )
+        , m_Names( files.GetSize(), false )
+        , m_NumBatches( (uint32_t)( ( files.GetSize() + OBJECT_LIST_NAME_BATCH_SIZE - 1 ) / OBJECT_LIST_NAME_BATCH_SIZE ) )
+        , m_NextBatch( 0 )
+    {
+        m_Names.SetSize( files.GetSize() );
+    }
+
+    void Process();
+    inline const Name & GetName( size_t index ) const { return m_Names[ index ]; }
+
+private:
+    void ProcessBatches();
+    static uint32_t ThreadFunc( void * userData );
+
+    const ObjectListNode *              m_Node;
+    const Array< FileIO::FileInfo > &   m_Files;
+    const AString &                     m_BaseDir;
+    Array< Name >                       m_Names;
+    uint32_t                            m_NumBatches;
+    volatile uint32_t                   m_NextBatch;
+};
+
 // Reflection
 //------------------------------------------------------------------------------
 REFLECT_NODE_BEGIN( ObjectListNode, Node, MetaNone() )
@@ -267,16 +315,21 @@ ObjectListNode::~ObjectListNode() = default;
     // clear dynamic deps from previous passes
     m_DynamicDependencies.Clear();
 
+    // On Windows, with MSVC we compile a cpp file to generate the PCH
+    // Filter here to ensure that doesn't get compiled twice
+    const Node * pchCPP = nullptr;
     #if defined( __WINDOWS__ )
-        // On Windows, with MSVC we compile a cpp file to generate the PCH
-        // Filter here to ensure that doesn't get compiled twice
-        Node * pchCPP = nullptr;
         if ( m_UsingPrecompiledHeader && GetPrecompiledHeader()->IsMSVC() )
         {
             pchCPP = GetPrecompiledHeader()->GetPrecompiledHeaderCPPFile();
         }
     #endif
 
+    // flags depend only on the options, so are the same for all of our objects
+    const bool usingPCH = ( m_PCHInputFile.IsEmpty() == false );
+    const uint32_t flags = ObjectNode::DetermineFlags( GetCompiler(), m_CompilerOptions, false, usingPCH );
+    const uint32_t preprocessorFlags = m_Preprocessor.IsEmpty() ? 0 : ObjectNode::DetermineFlags( GetPreprocessor(), m_PreprocessorOptions, false, usingPCH );
+
     // Handle converting all static inputs into dynamic onces (i.e. cpp->obj)
     for ( size_t i=m_ObjectListInputStartIndex; i<m_ObjectListInputEndIndex; ++i )
     {
@@ -285,40 +338,11 @@ ObjectListNode::~ObjectListNode() = default;
         // is this a dir list?
         if ( dep.GetNode()->GetType() == Node::DIRECTORY_LIST_NODE )
         {
-            // get the list of files
-            DirectoryListNode * dln = dep.GetNode()->CastTo< DirectoryListNode >();
-            const Array< FileIO::FileInfo > & files = dln->GetFiles();
-            m_DynamicDependencies.SetCapacity( m_DynamicDependencies.GetSize() + files.GetSize() );
-            for ( Array< FileIO::FileInfo >::Iter fIt = files.Begin();
-                    fIt != files.End();
-                    fIt++ )
+            // create the objects for all the files in the list
+            const DirectoryListNode * dln = dep.GetNode()->CastTo< DirectoryListNode >();
+            if ( CreateDynamicObjectNodes( nodeGraph, dln, pchCPP, flags, preprocessorFlags ) == false )
             {
-                // Create the file node (or find an existing one)
-                Node * n = nodeGraph.FindNode( fIt->m_Name );
-                if ( n == nullptr )
-                {
-                    n = nodeGraph.CreateFileNode( fIt->m_Name );
-                }
-                else if ( n->IsAFile() == false )
-                {
-                    FLOG_ERROR( "Library() .CompilerInputFile '%s' is not a FileNode (type: %s)", n->GetName().Get(), n->GetTypeName() );
-                    return false;
-                }
-
-                // ignore the precompiled header as a convenience for the user
-                // so they don't have to exclude it explicitly
-                #if defined( __WINDOWS__ )
-                    if ( n == pchCPP )
-                    {
-                        continue;
-                    }
-                #endif
-
-                // create the object that will compile the above file
-                if ( CreateDynamicObjectNode( nodeGraph, n, dln->GetPath() ) == false )
-                {
-                    return false; // CreateDynamicObjectNode will have emitted error
-                }
+                return false; // CreateDynamicObjectNodes will have emitted error
             }
         }
         else if ( dep.GetNode()->GetType() == Node::UNITY_NODE )
@@ -344,7 +368,7 @@ ObjectListNode::~ObjectListNode() = default;
                 }
 
                 // create the object that will compile the above file
-                if ( CreateDynamicObjectNode( nodeGraph, n, AString::GetEmpty(), true ) == false )
+                if ( CreateDynamicObjectNode( nodeGraph, n, AString::GetEmpty(), ( flags | ObjectNode::FLAG_UNITY ), preprocessorFlags ) == false )
                 {
                     return false; // CreateDynamicObjectNode will have emitted error
                 }
@@ -369,7 +393,7 @@ ObjectListNode::~ObjectListNode() = default;
 
                 // create the object that will compile the above file
                 const AString & baseDir = it->GetDirListOrigin() ? it->GetDirListOrigin()->GetPath() : AString::GetEmpty();
-                if ( CreateDynamicObjectNode( nodeGraph, n, baseDir, false, true ) == false )
+                if ( CreateDynamicObjectNode( nodeGraph, n, baseDir, ( flags | ObjectNode::FLAG_ISOLATED_FROM_UNITY ), preprocessorFlags ) == false )
                 {
                     return false; // CreateDynamicObjectNode will have emitted error
                 }
@@ -378,7 +402,7 @@ ObjectListNode::~ObjectListNode() = default;
         else if ( dep.GetNode()->IsAFile() )
         {
             // a single file, create the object that will compile it
-            if ( CreateDynamicObjectNode( nodeGraph, dep.GetNode(), AString::GetEmpty() ) == false )
+            if ( CreateDynamicObjectNode( nodeGraph, dep.GetNode(), AString::GetEmpty(), flags, preprocessorFlags ) == false )
             {
                 return false; // CreateDynamicObjectNode will have emitted error
             }
@@ -442,6 +466,8 @@ ObjectListNode::~ObjectListNode() = default;
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult ObjectListNode::DoBuild( Job * UNUSED( job ) )
 {
+    RecordUnityBuildTimes();
+
     // consider ourselves to be as recent as the newest file
     uint64_t timeStamp = 0;
     const Dependency * const end = m_DynamicDependencies.End();
@@ -455,6 +481,21 @@ ObjectListNode::~ObjectListNode() = default;
     return NODE_RESULT_OK;
 }
 
+// RecordUnityBuildTimes
+//------------------------------------------------------------------------------
+void ObjectListNode::RecordUnityBuildTimes() const
+{
+    // let Unity inputs know how long their files took to compile
+    for ( size_t i=m_ObjectListInputStartIndex; i<m_ObjectListInputEndIndex; ++i )
+    {
+        Node * node = m_StaticDependencies[ i ].GetNode();
+        if ( node->GetType() == Node::UNITY_NODE )
+        {
+            node->CastTo< UnityNode >()->RecordBuildTimes( m_DynamicDependencies );
+        }
+    }
+}
+
 // GetInputFiles
 //------------------------------------------------------------------------------
 void ObjectListNode::GetInputFiles( Args & fullArgs, const AString & pre, const AString & post, bool objectsInsteadOfLibs ) const
@@ -569,70 +610,92 @@ CompilerNode * ObjectListNode::GetPreprocessor() const
     return m_StaticDependencies[ preprocessorIndex ].GetNode()->CastTo< CompilerNode >();
 }
 
-// CreateDynamicObjectNode
+// CreateDynamicObjectNodes
 //------------------------------------------------------------------------------
-bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, bool isUnityNode, bool isIsolatedFromUnityNode )
+bool ObjectListNode::CreateDynamicObjectNodes( NodeGraph & nodeGraph, const DirectoryListNode * dirNode, const Node * fileToSkip, uint32_t flags, uint32_t preprocessorFlags )
 {
-    const AString & fileName = inputFile->GetName();
+    const Array< FileIO::FileInfo > & files = dirNode->GetFiles();
 
-    // Transform src file to dst object path
-    // get file name only (no path, no ext)
-    const char * lastSlash = fileName.FindLast( NATIVE_SLASH );
-    lastSlash = lastSlash ? ( lastSlash + 1 ) : fileName.Get();
-    const char * lastDot = fileName.FindLast( '.' );
-    lastDot = lastDot && ( lastDot > lastSlash ) ? lastDot : fileName.GetEnd();
+    // name the objects in parallel, then find or create all the nodes
+    // (which must be done on the main thread)
+    ObjectNameBatch batch( this, files, dirNode->GetPath() );
+    batch.Process();
 
-    // if source comes from a directory listing, use path relative to dirlist base
-    // to replicate the folder hierearchy in the output
-    AStackString<> subPath;
-    if ( baseDir.IsEmpty() == false )
+    m_DynamicDependencies.SetCapacity( m_DynamicDependencies.GetSize() + files.GetSize() );
+    bool reserved = false;
+    for ( size_t i = 0; i < files.GetSize(); ++i )
     {
-        ASSERT( NodeGraph::IsCleanPath( baseDir ) );
-        if ( PathUtils::PathBeginsWith( fileName, baseDir ) )
+        const AString & fileName = files[ i ].m_Name;
+        const ObjectNameBatch::Name & name = batch.GetName( i );
+
+        // Create the file node (or find an existing one)
+        // Files from a directory list are already clean full paths
+        Node * n = nodeGraph.FindNodeExact( fileName, name.m_FileNameCRC );
+        if ( n == nullptr )
         {
-            // ... use everything after that
-            subPath.Assign( fileName.Get() + baseDir.GetLength(), lastSlash ); // includes last slash
+            ReserveNodes( nodeGraph, files.GetSize() - i, reserved );
+            n = nodeGraph.CreateFileNode( fileName, false );
         }
-    }
-    else
-    {
-        if ( !m_CompilerInputFilesRoot.IsEmpty() && PathUtils::PathBeginsWith( fileName, m_CompilerInputFilesRoot ) )
+        else if ( n->IsAFile() == false )
         {
-            // ... use everything after that
-            subPath.Assign( fileName.Get() + m_CompilerInputFilesRoot.GetLength(), lastSlash ); // includes last slash
+            FLOG_ERROR( "Library() .CompilerInputFile '%s' is not a FileNode (type: %s)", n->GetName().Get(), n->GetTypeName() );
+            return false;
         }
-    }
-
-    AStackString<> fileNameOnly( lastSlash, lastDot );
-    AStackString<> objFile( m_CompilerOutputPath );
-    objFile += subPath;
-    objFile += m_CompilerOutputPrefix;
-    objFile += fileNameOnly;
-    objFile += GetObjExtension();
 
-    // Create an ObjectNode to compile the above file
-    // and depend on that
-    Node * on = nodeGraph.FindNode( objFile );
-    if ( on == nullptr )
-    {
-        // determine flags - TODO:B Move DetermineFlags call out of build-time
-        const bool usingPCH = ( m_PCHInputFile.IsEmpty() == false );
-        uint32_t flags = ObjectNode::DetermineFlags( GetCompiler(), m_CompilerOptions, false, usingPCH );
-        if ( isUnityNode )
+        // ignore the precompiled header as a convenience for the user
+        // so they don't have to exclude it explicitly
+        if ( n == fileToSkip )
         {
-            flags |= ObjectNode::FLAG_UNITY;
+            continue;
         }
-        if ( isIsolatedFromUnityNode )
+
+        // create the object that will compile the above file
+        Node * on = nodeGraph.FindNodeExact( name.m_ObjectName, name.m_ObjectNameCRC );
+        if ( on == nullptr )
         {
-            flags |= ObjectNode::FLAG_ISOLATED_FROM_UNITY;
+            ReserveNodes( nodeGraph, files.GetSize() - i, reserved );
         }
-        uint32_t preprocessorFlags = 0;
-        if ( m_Preprocessor.IsEmpty() == false )
+        if ( AddDynamicObjectNode( nodeGraph, n, on, name.m_ObjectName, flags, preprocessorFlags ) == false )
         {
-            // determine flags - TODO:B Move DetermineFlags call out of build-time
-            preprocessorFlags = ObjectNode::DetermineFlags( GetPreprocessor(), m_PreprocessorOptions, false, usingPCH );
+            return false; // AddDynamicObjectNode will have emitted error
         }
+    }
+    return true;
+}
 
+// ReserveNodes
+//------------------------------------------------------------------------------
+/*static*/ void ObjectListNode::ReserveNodes( NodeGraph & nodeGraph, size_t numRemainingFiles, bool & reserved )
+{
+    // reserve once, on creating the first node, as nothing needs creating when
+    // the objects already exist (every build but the first)
+    if ( reserved == false )
+    {
+        nodeGraph.ReserveNodes( numRemainingFiles * 2 ); // a file and an object for each, at most
+        reserved = true;
+    }
+}
+
+// CreateDynamicObjectNode
+//------------------------------------------------------------------------------
+bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, uint32_t flags, uint32_t preprocessorFlags )
+{
+    AStackString<> objFile;
+    GetObjectFileName( inputFile->GetName(), baseDir, objFile );
+
+    Node * on = nodeGraph.FindNode( objFile );
+    return AddDynamicObjectNode( nodeGraph, inputFile, on, objFile, flags, preprocessorFlags );
+}
+
+// AddDynamicObjectNode
+//------------------------------------------------------------------------------
+bool ObjectListNode::AddDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, Node * existingObject, const AString & objFile, uint32_t flags, uint32_t preprocessorFlags )
+{
+    // Create an ObjectNode to compile the above file
+    // and depend on that
+    Node * on = existingObject;
+    if ( on == nullptr )
+    {
         BFFIterator dummyIter;
         ObjectNode * objectNode = CreateObjectNode( nodeGraph, dummyIter, nullptr, flags, preprocessorFlags, m_CompilerOptions, m_CompilerOptionsDeoptimized, m_Preprocessor, m_PreprocessorOptions, objFile, inputFile->GetName(), AString::GetEmpty() );
         if ( !objectNode )
@@ -640,6 +703,9 @@ bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inpu
             FLOG_ERROR( "Failed to create node '%s'!", objFile.Get() );
             return false;
         }
+
+        // if the BFF changed, the object may have been built before
+        nodeGraph.MigrateNode( *objectNode );
         on = objectNode;
     }
     else if ( on->GetType() != Node::OBJECT_NODE )
@@ -666,6 +732,46 @@ bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inpu
     return true;
 }
 
+// GetObjectFileName
+//------------------------------------------------------------------------------
+void ObjectListNode::GetObjectFileName( const AString & fileName, const AString & baseDir, AString & objFile ) const
+{
+    // Transform src file to dst object path
+    // get file name only (no path, no ext)
+    const char * lastSlash = fileName.FindLast( NATIVE_SLASH );
+    lastSlash = lastSlash ? ( lastSlash + 1 ) : fileName.Get();
+    const char * lastDot = fileName.FindLast( '.' );
+    lastDot = lastDot && ( lastDot > lastSlash ) ? lastDot : fileName.GetEnd();
+
+    // if source comes from a directory listing, use path relative to dirlist base
+    // to replicate the folder hierearchy in the output
+    AStackString<> subPath;
+    if ( baseDir.IsEmpty() == false )
+    {
+        ASSERT( NodeGraph::IsCleanPath( baseDir ) );
+        if ( PathUtils::PathBeginsWith( fileName, baseDir ) )
+        {
+            // ... use everything after that
+            subPath.Assign( fileName.Get() + baseDir.GetLength(), lastSlash ); // includes last slash
+        }
+    }
+    else
+    {
+        if ( !m_CompilerInputFilesRoot.IsEmpty() && PathUtils::PathBeginsWith( fileName, m_CompilerInputFilesRoot ) )
+        {
+            // ... use everything after that
+            subPath.Assign( fileName.Get() + m_CompilerInputFilesRoot.GetLength(), lastSlash ); // includes last slash
+        }
+    }
+
+    AStackString<> fileNameOnly( lastSlash, lastDot );
+    objFile = m_CompilerOutputPath;
+    objFile += subPath;
+    objFile += m_CompilerOutputPrefix;
+    objFile += fileNameOnly;
+    objFile += GetObjExtension();
+}
+
 // CreateObjectNode
 //------------------------------------------------------------------------------
 ObjectNode * ObjectListNode::CreateObjectNode( NodeGraph & nodeGraph,
@@ -741,4 +847,56 @@ const char * ObjectListNode::GetObjExtension() const
     return m_CompilerOutputExtension.Get();
 }
 
+// ObjectNameBatch::Process
+//------------------------------------------------------------------------------
+void ObjectNameBatch::Process()
+{
+    // large lists are shared with helper threads
+    const uint32_t numThreads = Math::Min< uint32_t >( m_NumBatches, Math::Min< uint32_t >( Env::GetNumProcessors(), OBJECT_LIST_MAX_THREADS ) );
+    const uint32_t numHelpers = ( numThreads > 1 ) ? ( numThreads - 1 ) : 0;
+    Array< Thread::ThreadHandle > helpers( numHelpers, false );
+    for ( uint32_t i = 0; i < numHelpers; ++i )
+    {
+        helpers.Append( Thread::CreateThread( ThreadFunc, "ObjectNames", ( 64 * KILOBYTE ), this ) );
+    }
+    ProcessBatches();
+    for ( Thread::ThreadHandle helper : helpers )
+    {
+        Thread::WaitForThread( helper );
+        Thread::CloseHandle( helper );
+    }
+}
+
+// ObjectNameBatch::ProcessBatches
+//------------------------------------------------------------------------------
+void ObjectNameBatch::ProcessBatches()
+{
+    for ( ;; )
+    {
+        const uint32_t batch = AtomicIncU32( &m_NextBatch ) - 1;
+        if ( batch >= m_NumBatches )
+        {
+            return;
+        }
+        const size_t begin = ( batch * OBJECT_LIST_NAME_BATCH_SIZE );
+        const size_t end = Math::Min< size_t >( begin + OBJECT_LIST_NAME_BATCH_SIZE, m_Files.GetSize() );
+        for ( size_t i = begin; i < end; ++i )
+        {
+            const AString & fileName = m_Files[ i ].m_Name;
+            Name & name = m_Names[ i ];
+            m_Node->GetObjectFileName( fileName, m_BaseDir, name.m_ObjectName );
+            name.m_FileNameCRC = CRC32::CalcLower( fileName );
+            name.m_ObjectNameCRC = CRC32::CalcLower( name.m_ObjectName );
+        }
+    }
+}
+
+// ObjectNameBatch::ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t ObjectNameBatch::ThreadFunc( void * userData )
+{
+    static_cast< ObjectNameBatch * >( userData )->ProcessBatches();
+    return 0;
+}
+
 //------------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 class Args;
 class BFFIterator;
 class CompilerNode;
+class DirectoryListNode;
 class Function;
 class NodeGraph;
 class ObjectNode;
@@ -41,13 +42,18 @@ public:
     inline const AString & GetCompilerOptions() const { return m_CompilerOptions; }
 protected:
     friend class FunctionObjectList;
+    friend class ObjectNameBatch;
 
     virtual bool GatherDynamicDependencies( NodeGraph & nodeGraph, bool forceClean );
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
     virtual BuildResult DoBuild( Job * job ) override;
 
     // internal helpers
-    bool CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, bool isUnityNode = false, bool isIsolatedFromUnityNode = false );
+    bool CreateDynamicObjectNodes( NodeGraph & nodeGraph, const DirectoryListNode * dirNode, const Node * fileToSkip, uint32_t flags, uint32_t preprocessorFlags );
+    static void ReserveNodes( NodeGraph & nodeGraph, size_t numRemainingFiles, bool & reserved );
+    bool CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, uint32_t flags, uint32_t preprocessorFlags );
+    bool AddDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, Node * existingObject, const AString & objFile, uint32_t flags, uint32_t preprocessorFlags );
+    void GetObjectFileName( const AString & fileName, const AString & baseDir, AString & objFile ) const;
     ObjectNode * CreateObjectNode( NodeGraph & nodeGraph,
                                    const BFFIterator & iter,
                                    const Function * function,
@@ -61,6 +67,7 @@ protected:
                                    const AString & objectInput,
                                    const AString & pchObjectName );
     ObjectNode * GetPrecompiledHeader() const;
+    void RecordUnityBuildTimes() const;
 
     // Exposed Properties
     AString             m_Compiler;
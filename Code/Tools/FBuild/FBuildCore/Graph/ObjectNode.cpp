@@ -17,6 +17,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CIncludeScanner.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
@@ -43,6 +44,12 @@
 #if defined( __OSX__ ) || defined( __LINUX__ )
     #include <sys/time.h>
 #endif
+#if defined( __LINUX__ )
+    #include <errno.h>
+    #include <linux/memfd.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
 
 // Reflection
 //------------------------------------------------------------------------------
@@ -257,6 +264,18 @@ ObjectNode::~ObjectNode()
 
     if ( usePreProcessor || useSimpleDist )
     {
+        // When only the dependencies are needed, try to find them without the preprocessor
+        if ( !useCache && !useDist && !useSimpleDist && !GetDedicatedPreprocessor() &&
+             GetFlag( FLAG_GCC | FLAG_CLANG ) && !GetFlag( FLAG_MSVC ) &&
+             GetCompiler()->UseNativeIncludeScanner() )
+        {
+            if ( ProcessIncludesNative( useDeoptimization ) )
+            {
+                return DoBuildOther( job, useDeoptimization );
+            }
+            // fall back to the preprocessor
+        }
+
         return DoBuildWithPreProcessor( job, useDeoptimization, useCache, useSimpleDist );
     }
 
@@ -406,9 +425,14 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
         }
     }
 
-    // calculate the cache entry lookup
+    // The preprocessed output is now shared by everything which follows (cache
+    // lookup and store, local compilation and distribution), so determine the
+    // cache key once, while the data is uncompressed. This ensures the key is the
+    // same regardless of where the object is compiled.
     if ( useCache )
     {
+        GetCacheName( job );
+
         // try to get from cache
         if ( RetrieveFromCache( job ) )
         {
@@ -502,17 +526,42 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor2( Job * job, bool useDeopt
     Args fullArgs;
     AStackString<> tmpDirectoryName;
     AStackString<> tmpFileName;
+    #if defined( __LINUX__ )
+        int inMemoryFD = -1;
+    #endif
     if ( usePreProcessedOutput )
     {
-        if ( WriteTmpFile( job, tmpDirectoryName, tmpFileName ) == false )
+        // Where possible, the compiler reads the preprocessed output directly from
+        // memory, avoiding writing it to disk and reading it back
+        const char * inMemoryLanguage = nullptr;
+        AStackString<> inputFileName;
+        #if defined( __LINUX__ )
+            inMemoryLanguage = GetInMemoryFileLanguage( useDeoptimization );
+            if ( inMemoryLanguage && ( WriteInMemoryFile( job, inMemoryFD, inputFileName ) == false ) )
+            {
+                inMemoryLanguage = nullptr; // fall back to a temp file
+            }
+        #endif
+
+        if ( inMemoryLanguage == nullptr )
         {
-            return NODE_RESULT_FAILED; // WriteTmpFile will have emitted an error
+            if ( WriteTmpFile( job, tmpDirectoryName, tmpFileName ) == false )
+            {
+                return NODE_RESULT_FAILED; // WriteTmpFile will have emitted an error
+            }
+            inputFileName = tmpFileName;
         }
 
         const bool showIncludes( false );
         const bool finalize( true );
-        if ( !BuildArgs( job, fullArgs, PASS_COMPILE_PREPROCESSED, useDeoptimization, showIncludes, finalize, tmpFileName ) )
+        if ( !BuildArgs( job, fullArgs, PASS_COMPILE_PREPROCESSED, useDeoptimization, showIncludes, finalize, inputFileName, inMemoryLanguage ) )
         {
+            #if defined( __LINUX__ )
+                if ( inMemoryFD != -1 )
+                {
+                    close( inMemoryFD );
+                }
+            #endif
             return NODE_RESULT_FAILED; // BuildArgs will have emitted an error
         }
     }
@@ -526,6 +575,14 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor2( Job * job, bool useDeopt
         }
     }
 
+    // The preprocessed output is no longer needed once handed to the compiler, unless
+    // the job may still be built elsewhere, so free it to allow more jobs to be queued
+    // for distribution (see DistributableJobMemoryLimitMiB)
+    if ( ( stealingRemoteJob == false ) && ( racingRemoteJob == false ) )
+    {
+        job->OwnData( nullptr, 0, false );
+    }
+
     const bool verbose = FLog::ShowInfo();
     const bool showCommands = ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ShowCommandLines );
     const bool isRemote = ( job->IsLocal() == false );
@@ -537,6 +594,14 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor2( Job * job, bool useDeopt
 
     bool result = BuildFinalOutput( job, fullArgs );
 
+    // cleanup in-memory file
+    #if defined( __LINUX__ )
+        if ( inMemoryFD != -1 )
+        {
+            close( inMemoryFD );
+        }
+    #endif
+
     // cleanup temp file
     if ( tmpFileName.IsEmpty() == false )
     {
@@ -753,6 +818,135 @@ bool ObjectNode::ProcessIncludesWithPreProcessor( Job * job )
     return true;
 }
 
+// ProcessIncludesNative
+//------------------------------------------------------------------------------
+bool ObjectNode::ProcessIncludesNative( bool useDeoptimization )
+{
+    Timer t;
+
+    {
+        AString args( 4096 );
+        Array< AString > forcedIncludes( 0, true );
+        if ( BuildIncludeScannerArgs( useDeoptimization, args, forcedIncludes ) == false )
+        {
+            return false; // unsupported args
+        }
+
+        // predefined macros etc are determined once per set of args
+        const CIncludeScannerConfig * config = GetCompiler()->GetIncludeScannerConfig( args );
+        if ( config == nullptr )
+        {
+            FLOG_INFO( "Include scanner unavailable for '%s' (using preprocessor)", GetName().Get() );
+            return false;
+        }
+
+        CIncludeScanner scanner( *config );
+        if ( scanner.Scan( GetSourceFile()->GetName(), forcedIncludes ) == false )
+        {
+            FLOG_INFO( "Include scanner failed for '%s' (using preprocessor): %s", GetName().Get(), scanner.GetError().Get() );
+            return false;
+        }
+
+        // record that we have a list of includes
+        m_Includes.Clear();
+        scanner.SwapIncludes( m_Includes );
+    }
+
+    FLOG_INFO( "Process Includes (Scanner):\n - File: %s\n - Time: %u ms\n - Num : %u", m_Name.Get(), uint32_t( t.GetElapsedMS() ), uint32_t( m_Includes.GetSize() ) );
+
+    return true;
+}
+
+// BuildIncludeScannerArgs
+//------------------------------------------------------------------------------
+bool ObjectNode::BuildIncludeScannerArgs( bool useDeoptimization, AString & outArgs, Array< AString > & outForcedIncludes ) const
+{
+    // Args which have the same effect on the preprocessor as the compilation
+    // args, to have the compiler report its state for an empty file
+    Array< AString > tokens( 1024, true );
+    ( useDeoptimization ? m_CompilerOptionsDeoptimized : m_CompilerOptions ).Tokenize( tokens );
+
+    bool hasLanguage = false;
+    const size_t numTokens = tokens.GetSize();
+    for ( size_t i = 0; i < numTokens; ++i )
+    {
+        const AString & token = tokens[ i ];
+
+        // input, output and compilation
+        if ( token.Find( "%1" ) || token.Find( "%2" ) || StripToken( "-c", token ) || StripTokenWithArg( "-o", token, i ) )
+        {
+            continue;
+        }
+
+        // dependency file generation
+        if ( StripToken( "-M", token ) || StripToken( "-MM", token ) ||
+             StripToken( "-MD", token ) || StripToken( "-MMD", token ) ||
+             StripToken( "-MP", token ) || StripToken( "-MG", token ) ||
+             StripTokenWithArg( "-MF", token, i ) || StripTokenWithArg( "-MT", token, i ) ||
+             StripTokenWithArg( "-MQ", token, i ) || StripTokenWithArg( "-MJ", token, i ) )
+        {
+            continue;
+        }
+
+        // only used for compilation
+        if ( StripTokenWithArg( "-include-pch", token, i ) || StripToken( "--analyze", token ) )
+        {
+            continue;
+        }
+
+        // forced includes are scanned before the source file
+        if ( token.BeginsWith( "-include" ) || token.BeginsWith( "-imacros" ) )
+        {
+            const size_t optionLen = 8; // both the same length
+            AStackString<> forcedInclude;
+            if ( token.GetLength() == optionLen )
+            {
+                if ( ++i == numTokens )
+                {
+                    return false;
+                }
+                Args::StripQuotes( tokens[ i ].Get(), tokens[ i ].GetEnd(), forcedInclude );
+            }
+            else
+            {
+                Args::StripQuotes( token.Get() + optionLen, token.GetEnd(), forcedInclude );
+            }
+            outForcedIncludes.Append( forcedInclude );
+            continue;
+        }
+
+        if ( token.BeginsWith( "-x" ) || token.BeginsWith( "--language" ) )
+        {
+            hasLanguage = true;
+        }
+
+        outArgs += token;
+        outArgs += ' ';
+    }
+
+    // the language of the empty file must match the source
+    if ( hasLanguage == false )
+    {
+        const char * language = GetLanguageFromFileName( GetSourceFile()->GetName() );
+        if ( language == nullptr )
+        {
+            return false;
+        }
+        outArgs += "-x ";
+        outArgs += language;
+        outArgs += ' ';
+    }
+
+    // report predefined macros and implicitly included files (-dD), include paths (-v)
+    // and files included by Clang before the source (-H)
+    #if defined( __WINDOWS__ )
+        outArgs += "-E -dD -v -H NUL";
+    #else
+        outArgs += "-E -dD -v -H /dev/null";
+    #endif
+    return true;
+}
+
 // LoadRemote
 //------------------------------------------------------------------------------
 /*static*/ Node * ObjectNode::LoadRemote( IOStream & stream )
@@ -1054,6 +1248,7 @@ const AString & ObjectNode::GetCacheName( Job * job ) const
 
     // hash the pre-processed intput data
     ASSERT( job->GetData() );
+    ASSERT( job->IsDataCompressed() == false ); // key must not depend on how the data is stored
     uint64_t a = xxHash::Calc64( job->GetData(), job->GetDataSize() );
 
     // hash the build "environment"
@@ -1427,7 +1622,7 @@ void ObjectNode::EmitCompilationMessage( const Args & fullArgs, bool useDeoptimi
 
 // BuildArgs
 //------------------------------------------------------------------------------
-bool ObjectNode::BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool useDeoptimization, bool showIncludes, bool finalize, const AString & overrideSrcFile ) const
+bool ObjectNode::BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool useDeoptimization, bool showIncludes, bool finalize, const AString & overrideSrcFile, const char * overrideSrcLanguage ) const
 {
     PROFILE_FUNCTION
 
@@ -1666,6 +1861,15 @@ bool ObjectNode::BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool us
         const char * found = token.Find( "%1" );
         if ( found )
         {
+            // language can't be determined from the file name, so must be specified
+            if ( overrideSrcLanguage )
+            {
+                fullArgs += "-x";
+                fullArgs.AddDelimiter();
+                fullArgs += overrideSrcLanguage;
+                fullArgs.AddDelimiter();
+            }
+
             fullArgs += AStackString<>( token.Get(), found );
             if ( overrideSrcFile.IsEmpty() )
             {
@@ -2079,16 +2283,120 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
 
     FileIO::WorkAroundForWindowsFilePermissionProblem( tmpFileName );
 
-    // On remote workers, free compressed buffer as we don't need it anymore
-    // This reduces memory consumed on the remote worker.
-    if ( job->IsLocal() == false )
+    return true;
+}
+
+// GetInMemoryFileLanguage
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    const char * ObjectNode::GetInMemoryFileLanguage( bool useDeoptimization ) const
     {
-        job->OwnData( nullptr, 0, false ); // Free compressed buffer
+        // Only GCC and Clang can be told the language of a file without an extension
+        if ( ( GetFlag( FLAG_GCC | FLAG_CLANG ) == false ) || GetFlag( FLAG_MSVC ) )
+        {
+            return nullptr;
+        }
+
+        // Don't override a language specified by the user
+        Array< AString > tokens( 1024, true );
+        ( useDeoptimization ? m_CompilerOptionsDeoptimized : m_CompilerOptions ).Tokenize( tokens );
+        for ( const AString & token : tokens )
+        {
+            if ( token.BeginsWith( "-x" ) || token.BeginsWith( "--language" ) )
+            {
+                return nullptr;
+            }
+        }
+
+        // Determine language from the source file (if unknown, use a temp file)
+        return GetLanguageFromFileName( GetSourceFile()->GetName() );
     }
+#endif
 
-    return true;
+// GetLanguageFromFileName
+//------------------------------------------------------------------------------
+/*static*/ const char * ObjectNode::GetLanguageFromFileName( const AString & fileName )
+{
+    // GCC/Clang language (-x) implied by the file extension
+    if ( fileName.EndsWith( ".c" ) )
+    {
+        return "c";
+    }
+    if ( fileName.EndsWithI( ".cpp" ) ||
+         fileName.EndsWithI( ".cc" ) ||
+         fileName.EndsWithI( ".cxx" ) ||
+         fileName.EndsWithI( ".c++" ) ||
+         fileName.EndsWith( ".C" ) )
+    {
+        return "c++";
+    }
+    if ( fileName.EndsWith( ".m" ) )
+    {
+        return "objective-c";
+    }
+    if ( fileName.EndsWith( ".mm" ) )
+    {
+        return "objective-c++";
+    }
+    return nullptr;
 }
 
+// WriteInMemoryFile
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    bool ObjectNode::WriteInMemoryFile( Job * job, int & outFD, AString & outFileName ) const
+    {
+        ASSERT( job->GetData() && job->GetDataSize() );
+
+        #if defined( SYS_memfd_create )
+            // Create an anonymous in-memory file (unavailable on kernels before 3.17).
+            // The compiler opens it via our fd table, so it needn't be inherited.
+            const int fd = (int)syscall( SYS_memfd_create, "FBuildPreprocessed", MFD_CLOEXEC );
+            if ( fd == -1 )
+            {
+                return false; // caller will fall back to a temp file
+            }
+
+            const char * dataToWrite = static_cast< const char * >( job->GetData() );
+            size_t dataToWriteSize = job->GetDataSize();
+
+            // handle compressed data
+            Compressor c; // scoped here so we can access decompression buffer
+            if ( job->IsDataCompressed() )
+            {
+                c.Decompress( dataToWrite );
+                dataToWrite = static_cast< const char * >( c.GetResult() );
+                dataToWriteSize = c.GetResultSize();
+            }
+
+            while ( dataToWriteSize > 0 )
+            {
+                const ssize_t written = write( fd, dataToWrite, dataToWriteSize );
+                if ( written == -1 )
+                {
+                    if ( errno == EINTR )
+                    {
+                        continue;
+                    }
+                    close( fd );
+                    return false; // caller will fall back to a temp file
+                }
+                dataToWrite += written;
+                dataToWriteSize -= (size_t)written;
+            }
+
+            outFD = fd;
+            outFileName.Format( "/proc/%u/fd/%i", Process::GetCurrentId(), fd );
+            return true;
+        #else
+            (void)job;
+            (void)outFD;
+            (void)outFileName;
+            return false;
+        #endif
+    }
+#endif
+
 // BuildFinalOutput
 //------------------------------------------------------------------------------
 bool ObjectNode::BuildFinalOutput( Job * job, const Args & fullArgs ) const
@@ -102,6 +102,9 @@ private:
 
     bool ProcessIncludesMSCL( const char * output, uint32_t outputSize );
     bool ProcessIncludesWithPreProcessor( Job * job );
+    bool ProcessIncludesNative( bool useDeoptimization );
+    bool BuildIncludeScannerArgs( bool useDeoptimization, AString & outArgs, Array< AString > & outForcedIncludes ) const;
+    static const char * GetLanguageFromFileName( const AString & fileName );
 
     const AString & GetCacheName( Job * job ) const;
     bool RetrieveFromCache( Job * job );
@@ -121,13 +124,17 @@ private:
     static bool StripTokenWithArg_MSVC( const char * tokenToCheckFor, const AString & token, size_t & index );
     static bool StripToken( const char * tokenToCheckFor, const AString & token, bool allowStartsWith = false );
     static bool StripToken_MSVC( const char * tokenToCheckFor, const AString & token, bool allowStartsWith = false );
-    bool BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool useDeoptimization, bool useShowIncludes, bool finalize, const AString & overrideSrcFile = AString::GetEmpty() ) const;
+    bool BuildArgs( const Job * job, Args & fullArgs, Pass pass, bool useDeoptimization, bool useShowIncludes, bool finalize, const AString & overrideSrcFile = AString::GetEmpty(), const char * overrideSrcLanguage = nullptr ) const;
 
     void ExpandCompilerForceUsing( Args & fullArgs, const AString & pre, const AString & post ) const;
     bool BuildPreprocessedOutput( const Args & fullArgs, Job * job, bool useDeoptimization ) const;
     bool LoadStaticSourceFileForDistribution( const Args & fullArgs, Job * job, bool useDeoptimization ) const;
     void TransferPreprocessedData( const char * data, size_t dataSize, Job * job ) const;
     bool WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName ) const;
+    #if defined( __LINUX__ )
+        const char * GetInMemoryFileLanguage( bool useDeoptimization ) const;
+        bool WriteInMemoryFile( Job * job, int & outFD, AString & outFileName ) const;
+    #endif
     bool BuildFinalOutput( Job * job, const Args & fullArgs ) const;
 
     inline bool GetFlag( uint32_t flag ) const { return ( ( m_Flags & flag ) != 0 ); }
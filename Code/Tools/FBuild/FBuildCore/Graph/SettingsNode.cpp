@@ -7,6 +7,7 @@
 
 #include "SettingsNode.h"
 
+#include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
@@ -17,6 +18,7 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AStackString.h"
 
 // Defines
@@ -24,6 +26,8 @@
 #define DIST_MEMORY_LIMIT_MIN ( 16 ) // 16MiB
 #define DIST_MEMORY_LIMIT_MAX ( ( sizeof(void *) == 8 ) ? 64 * 1024 : 2048 ) // 64 GiB or 2 GiB
 #define DIST_MEMORY_LIMIT_DEFAULT ( ( sizeof(void *) == 8 ) ? 2048 : 1024 ) // 2 GiB or 1 GiB
+#define RESOURCE_POOL_CAPACITY_MIN ( 1 )
+#define RESOURCE_POOL_CAPACITY_MAX ( 1024 )
 
 // REFLECTION
 //------------------------------------------------------------------------------
@@ -34,6 +38,7 @@ REFLECT_NODE_BEGIN( SettingsNode, Node, MetaNone() )
     REFLECT_ARRAY(  m_Workers,                  "Workers",                  MetaOptional() )
     REFLECT(        m_WorkerConnectionLimit,    "WorkerConnectionLimit",    MetaOptional() )
     REFLECT(        m_DistributableJobMemoryLimitMiB, "DistributableJobMemoryLimitMiB", MetaOptional() + MetaRange( DIST_MEMORY_LIMIT_MIN, DIST_MEMORY_LIMIT_MAX ) )
+    REFLECT_ARRAY(  m_ResourcePools,            "ResourcePools",            MetaOptional() )
 REFLECT_END( SettingsNode )
 
 // CONSTRUCTOR
@@ -49,7 +54,7 @@ SettingsNode::SettingsNode()
 
 // Initialize
 //------------------------------------------------------------------------------
-/*virtual*/ bool SettingsNode::Initialize( NodeGraph & /*nodeGraph*/, const BFFIterator & /*iter*/, const Function * /*function*/ )
+/*virtual*/ bool SettingsNode::Initialize( NodeGraph & /*nodeGraph*/, const BFFIterator & iter, const Function * function )
 {
     // using a cache plugin?
     if ( m_CachePluginDLL.IsEmpty() == false )
@@ -63,6 +68,25 @@ SettingsNode::SettingsNode()
         ProcessEnvironment( m_Environment );
     }
 
+    // "ResourcePools"
+    for ( const AString & resourcePool : m_ResourcePools )
+    {
+        const char * equals = resourcePool.Find( '=' );
+        if ( ( equals == nullptr ) || ( equals == resourcePool.Get() ) )
+        {
+            Error::Error_1106_MissingRequiredToken( iter, function, ".ResourcePools", "=" );
+            return false;
+        }
+        AStackString<> name;
+        int32_t capacity;
+        if ( ( ParseResourcePool( resourcePool, name, capacity ) == false ) ||
+             ( capacity < RESOURCE_POOL_CAPACITY_MIN ) || ( capacity > RESOURCE_POOL_CAPACITY_MAX ) )
+        {
+            Error::Error_1054_IntegerOutOfRange( iter, function, ".ResourcePools", RESOURCE_POOL_CAPACITY_MIN, RESOURCE_POOL_CAPACITY_MAX );
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -96,6 +120,54 @@ const AString & SettingsNode::GetCachePluginDLL() const
     return m_CachePluginDLL;
 }
 
+// GetResourcePoolCapacity
+//------------------------------------------------------------------------------
+bool SettingsNode::GetResourcePoolCapacity( const AString & name, uint32_t & outCapacity ) const
+{
+    for ( const AString & resourcePool : m_ResourcePools )
+    {
+        AStackString<> poolName;
+        int32_t capacity;
+        if ( ParseResourcePool( resourcePool, poolName, capacity ) && ( poolName == name ) )
+        {
+            outCapacity = (uint32_t)capacity;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ParseResourcePool
+//------------------------------------------------------------------------------
+/*static*/ bool SettingsNode::ParseResourcePool( const AString & resourcePool, AString & outName, int32_t & outCapacity )
+{
+    // "Name=Capacity"
+    const char * equals = resourcePool.Find( '=' );
+    if ( ( equals == nullptr ) || ( equals == resourcePool.Get() ) )
+    {
+        return false;
+    }
+    outName.Assign( resourcePool.Get(), equals );
+
+    // decimal digits only ("4abc", "0x10", "-1" etc are not capacities)
+    const char * pos = equals + 1;
+    if ( *pos == '\0' )
+    {
+        return false;
+    }
+    outCapacity = 0;
+    for ( ; *pos != '\0'; ++pos )
+    {
+        if ( ( *pos < '0' ) || ( *pos > '9' ) )
+        {
+            return false;
+        }
+        // clamped (still out of range) so large values can't overflow
+        outCapacity = Math::Min< int32_t >( ( outCapacity * 10 ) + ( *pos - '0' ), RESOURCE_POOL_CAPACITY_MAX + 1 );
+    }
+    return true;
+}
+
 // ProcessEnvironment
 //------------------------------------------------------------------------------
 void SettingsNode::ProcessEnvironment( const Array< AString > & envStrings ) const
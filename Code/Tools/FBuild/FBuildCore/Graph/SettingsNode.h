@@ -31,11 +31,13 @@ public:
     inline const Array< AString > &     GetWorkerList() const { return m_Workers; }
     uint32_t                            GetWorkerConnectionLimit() const { return m_WorkerConnectionLimit; }
     uint32_t                            GetDistributableJobMemoryLimitMiB() const { return m_DistributableJobMemoryLimitMiB; }
+    bool                                GetResourcePoolCapacity( const AString & name, uint32_t & outCapacity ) const;
 
 private:
     //virtual BuildResult DoBuild( Job * job ) override;
 
     void ProcessEnvironment( const Array< AString > & envStrings ) const;
+    static bool ParseResourcePool( const AString & resourcePool, AString & outName, int32_t & outCapacity );
 
     // Settings from environment variables
     AString             m_CachePathFromEnvVar;
@@ -48,6 +50,7 @@ private:
     Array< AString  >   m_Workers;
     uint32_t            m_WorkerConnectionLimit;
     uint32_t            m_DistributableJobMemoryLimitMiB;
+    Array< AString  >   m_ResourcePools;    // "Name=Capacity" - limits how many jobs using a pool run at once
 };
 
 //------------------------------------------------------------------------------
@@ -35,6 +35,7 @@ REFLECT_NODE_BEGIN( TestNode, Node, MetaName( "TestOutput" ) + MetaFile() )
     REFLECT(        m_TestWorkingDir,           "TestWorkingDir",           MetaOptional() + MetaPath() )
     REFLECT(        m_TestTimeOut,              "TestTimeOut",              MetaOptional() + MetaRange( 0, 4 * 60 * 60 ) ) // 4hrs
     REFLECT(        m_TestAlwaysShowOutput,     "TestAlwaysShowOutput",     MetaOptional() )
+    REFLECT(        m_ResourcePool,             "ResourcePool",             MetaOptional() )
     REFLECT_ARRAY(  m_PreBuildDependencyNames,  "PreBuildDependencies",     MetaOptional() + MetaFile() + MetaAllowNonFile() )
 
     // Internal State
@@ -65,6 +66,12 @@ TestNode::TestNode()
         return false; // InitializePreBuildDependencies will have emitted an error
     }
 
+    // .ResourcePool
+    if ( !InitializeResourcePool( nodeGraph, iter, function, m_ResourcePool ) )
+    {
+        return false; // InitializeResourcePool will have emitted an error
+    }
+
     // .TestExecutable
     Dependencies executable;
     if ( !Function::GetFileNode( nodeGraph, iter, function, m_TestExecutable, "TestExecutable", executable ) )
@@ -23,6 +23,8 @@ public:
 
     static inline Node::Type GetTypeS() { return Node::TEST_NODE; }
 
+    virtual const AString & GetResourcePool() const override { return m_ResourcePool; }
+
     inline const Node* GetTestExecutable() const { return m_StaticDependencies[0].GetNode(); }
 private:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
@@ -42,6 +44,7 @@ private:
     uint32_t            m_TestTimeOut;
     bool                m_TestAlwaysShowOutput;
     bool                m_TestInputPathRecurse;
+    AString             m_ResourcePool;
     Array< AString >    m_PreBuildDependencyNames;
 
     // Internal State
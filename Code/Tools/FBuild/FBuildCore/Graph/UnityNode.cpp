@@ -19,11 +19,19 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Process/Mutex.h"
 #include "Core/Process/Process.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
 //------------------------------------------------------------------------------
+REFLECT_STRUCT_BEGIN_BASE( UnityFileBuildTime )
+    REFLECT( m_FileName,                "FileName",                             MetaNone() )
+    REFLECT( m_BuildTimeMS,             "BuildTimeMS",                          MetaNone() )
+REFLECT_END( UnityFileBuildTime )
+
 REFLECT_NODE_BEGIN( UnityNode, Node, MetaNone() )
     REFLECT_ARRAY( m_InputPaths,        "UnityInputPath",                       MetaOptional() + MetaPath() )
     REFLECT_ARRAY( m_PathsToExclude,    "UnityInputExcludePath",                MetaOptional() + MetaPath() )
@@ -38,8 +46,13 @@ REFLECT_NODE_BEGIN( UnityNode, Node, MetaNone() )
     REFLECT( m_NumUnityFilesToCreate,   "UnityNumFiles",                        MetaOptional() + MetaRange( 1, 1048576 ) )
     REFLECT( m_MaxIsolatedFiles,        "UnityInputIsolateWritableFilesLimit",  MetaOptional() + MetaRange( 0, 1048576 ) )
     REFLECT( m_IsolateWritableFiles,    "UnityInputIsolateWritableFiles",       MetaOptional() )
+    REFLECT( m_BalanceByBuildTime,      "UnityBalanceByBuildTime",              MetaOptional() )
+    REFLECT( m_StableAssignment,        "UnityStableAssignment",                MetaOptional() )
     REFLECT( m_PrecompiledHeader,       "UnityPCH",                             MetaOptional() + MetaFile( true ) ) // relative
     REFLECT_ARRAY( m_PreBuildDependencyNames,   "PreBuildDependencies",         MetaOptional() + MetaFile() + MetaAllowNonFile() )
+
+    // Internal State
+    REFLECT_ARRAY_OF_STRUCT( m_FileBuildTimes,  "FileBuildTimes",   UnityFileBuildTime, MetaHidden() )
 REFLECT_END( UnityNode )
 
 // CONSTRUCTOR
@@ -57,9 +70,14 @@ UnityNode::UnityNode()
 , m_FilesToExclude( 0, true )
 , m_IsolateWritableFiles( false )
 , m_MaxIsolatedFiles( 0 )
+, m_BalanceByBuildTime( false )
+, m_StableAssignment( false )
 , m_ExcludePatterns( 0, true )
 , m_IsolatedFiles( 0, true )
+, m_FileBuildTimes( 0, true )
 , m_UnityFileNames( 0, true )
+, m_FilesInUnityFiles( 0, true )
+, m_FilesInUnityFilesEnd( 0, true )
 {
     m_InputPattern.Append( AStackString<>( "*.cpp" ) );
     m_LastBuildTimeMs = 100; // higher default than a file node
@@ -140,10 +158,36 @@ UnityNode::~UnityNode()
 
     // TODO:A Sort files for consistent ordering across file systems/platforms
 
-    // how many files should go in each unity file?
+    // determine allocation of files to each unity file
     const size_t numFiles = files.GetSize();
-    float numFilesPerUnity = (float)numFiles / m_NumUnityFilesToCreate;
-    float remainingInThisUnity( 0.0 );
+    Array< uint32_t > unityEnds( m_NumUnityFilesToCreate, false );
+    if ( m_StableAssignment )
+    {
+        Array< uint32_t > costs( numFiles, false );
+        if ( m_BalanceByBuildTime )
+        {
+            GetFileCosts( files, costs );
+        }
+        else
+        {
+            costs.SetSize( numFiles );
+            for ( uint32_t & cost : costs )
+            {
+                cost = 1;
+            }
+        }
+        AssignFilesByHash( files, costs, unityEnds );
+    }
+    else if ( m_BalanceByBuildTime )
+    {
+        Array< uint32_t > costs( numFiles, false );
+        GetFileCosts( files, costs );
+        PartitionByCost( costs, m_NumUnityFilesToCreate, unityEnds );
+    }
+    else
+    {
+        AssignFilesByCount( numFiles, unityEnds );
+    }
 
     uint32_t numFilesWritten( 0 );
 
@@ -154,12 +198,12 @@ UnityNode::~UnityNode()
     AString output;
     output.SetReserved( 32 * 1024 );
 
+    m_FilesInUnityFiles.SetCapacity( numFiles );
+    m_FilesInUnityFilesEnd.SetCapacity( m_NumUnityFilesToCreate );
+
     // create each unity file
     for ( size_t i=0; i<m_NumUnityFilesToCreate; ++i )
     {
-        // add allocation to this unity
-        remainingInThisUnity += numFilesPerUnity;
-
         // header
         output = "// Auto-generated Unity file - do not modify\r\n\r\n";
 
@@ -171,23 +215,11 @@ UnityNode::~UnityNode()
             output += "\"\r\n\r\n";
         }
 
-        // make sure any remaining files are added to the last unity to account
-        // for floating point imprecision
-
-        // determine allocation of includes for this unity file
+        // gather the includes for this unity file
         Array< FileAndOrigin > filesInThisUnity( 256, true );
         uint32_t numIsolated( 0 );
-        const bool lastUnity = ( i == ( m_NumUnityFilesToCreate - 1 ) );
-        while ( ( remainingInThisUnity > 0.0f ) || lastUnity )
+        for ( ; index < unityEnds[ i ]; ++index )
         {
-            remainingInThisUnity -= 1.0f; // reduce allocation, but leave rounding
-
-            // handle cases where there's more unity files than source files
-            if ( index >= numFiles )
-            {
-                break;
-            }
-
             filesInThisUnity.Append( files[index ] );
 
             // files which are modified (writable) can optionally be excluded from the unity
@@ -207,7 +239,6 @@ UnityNode::~UnityNode()
             }
 
             // count the file, whether we wrote it or not, to keep unity files stable
-            index++;
             numFilesWritten++;
         }
 
@@ -233,6 +264,10 @@ UnityNode::~UnityNode()
                 m_IsolatedFiles.Append( *file );
                 numFilesActuallyIsolatedInThisUnity++;
             }
+            else
+            {
+                m_FilesInUnityFiles.Append( *file );
+            }
 
             // write pragma showing cpp file being compiled to assist resolving compilation errors
             AStackString<> buffer( file->GetName().Get() );
@@ -276,6 +311,7 @@ UnityNode::~UnityNode()
         if ( filesInThisUnity.GetSize() != numFilesActuallyIsolatedInThisUnity )
         {
             m_UnityFileNames.Append( unityName );
+            m_FilesInUnityFilesEnd.Append( (uint32_t)m_FilesInUnityFiles.GetSize() );
         }
 
         // need to write the unity file?
@@ -448,4 +484,421 @@ bool UnityNode::GetFiles( Array< FileAndOrigin > & files )
     return ok;
 }
 
+
+// RecordBuildTimes
+//------------------------------------------------------------------------------
+void UnityNode::RecordBuildTimes( const Dependencies & objects )
+{
+    if ( m_BalanceByBuildTime == false )
+    {
+        return;
+    }
+
+    MutexHolder mh( m_FileBuildTimesMutex );
+
+    Array< UnityFileBuildTime > newEntries( 0, true );
+    for ( const Dependency & dep : objects )
+    {
+        // only objects compiled during this build have a meaningful time
+        // (not cache hits, or objects which were up-to-date)
+        const Node * node = dep.GetNode();
+        if ( ( node->GetType() != Node::OBJECT_NODE ) || ( node->GetStatFlag( Node::STATS_BUILT ) == false ) )
+        {
+            continue;
+        }
+        const ObjectNode * obj = node->CastTo< ObjectNode >();
+        if ( obj->IsCreatingPCH() )
+        {
+            continue;
+        }
+        const AString & sourceFile = obj->GetSourceFile()->GetName();
+        const uint32_t buildTime = obj->GetLastBuildTime();
+
+        // files isolated from the unity are compiled individually
+        bool isolated = false;
+        for ( const FileAndOrigin & file : m_IsolatedFiles )
+        {
+            if ( file.GetName().EqualsI( sourceFile ) )
+            {
+                SetFileBuildTime( file.GetName(), buildTime, newEntries );
+                isolated = true;
+                break;
+            }
+        }
+        if ( isolated )
+        {
+            continue;
+        }
+
+        // for unity files, split the time across the included files by size
+        for ( size_t i = 0; i < m_UnityFileNames.GetSize(); ++i )
+        {
+            if ( m_UnityFileNames[ i ].EqualsI( sourceFile ) == false )
+            {
+                continue;
+            }
+            const size_t start = ( i > 0 ) ? m_FilesInUnityFilesEnd[ i - 1 ] : 0;
+            const size_t end = m_FilesInUnityFilesEnd[ i ];
+            uint64_t totalSize = 0;
+            for ( size_t j = start; j < end; ++j )
+            {
+                totalSize += m_FilesInUnityFiles[ j ].GetSize();
+            }
+            for ( size_t j = start; j < end; ++j )
+            {
+                const FileAndOrigin & file = m_FilesInUnityFiles[ j ];
+                const uint64_t fileTime = ( totalSize > 0 ) ? ( ( (uint64_t)buildTime * file.GetSize() ) / totalSize )
+                                                            : ( buildTime / ( end - start ) );
+                SetFileBuildTime( file.GetName(), (uint32_t)fileTime, newEntries );
+            }
+            break;
+        }
+    }
+
+    if ( newEntries.IsEmpty() == false )
+    {
+        m_FileBuildTimes.Append( newEntries );
+        m_FileBuildTimes.Sort();
+    }
+}
+
+// GetFileBuildTime
+//------------------------------------------------------------------------------
+bool UnityNode::GetFileBuildTime( const AString & fileName, uint32_t & outBuildTimeMS ) const
+{
+    MutexHolder mh( m_FileBuildTimesMutex );
+    const UnityFileBuildTime * entry = FindFileBuildTime( fileName );
+    if ( entry )
+    {
+        outBuildTimeMS = entry->m_BuildTimeMS;
+        return true;
+    }
+    return false;
+}
+
+// PartitionByCost
+//------------------------------------------------------------------------------
+/*static*/ void UnityNode::PartitionByCost( const Array< uint32_t > & costs, uint32_t numGroups, Array< uint32_t > & outGroupEnds )
+{
+    ASSERT( numGroups > 0 );
+
+    uint64_t totalCost = 0;
+    for ( const uint32_t cost : costs )
+    {
+        totalCost += cost;
+    }
+
+    // Groups are contiguous so that small changes in cost only move files
+    // between neighbouring groups, keeping most groups (and their cache
+    // entries) unchanged
+    const size_t numItems = costs.GetSize();
+    uint64_t cumulativeCost = 0;
+    size_t index = 0;
+    for ( uint32_t group = 0; group < numGroups; ++group )
+    {
+        if ( group == ( numGroups - 1 ) )
+        {
+            index = numItems; // last group takes everything remaining
+        }
+        else
+        {
+            // take items while most of their cost falls within this group's share,
+            // but always at least one, so expensive items don't leave groups empty
+            const uint64_t groupEndCost = ( totalCost * ( group + 1 ) ) / numGroups;
+            const size_t groupStart = index;
+            while ( ( index < numItems ) &&
+                    ( ( index == groupStart ) || ( ( ( cumulativeCost * 2 ) + costs[ index ] ) <= ( groupEndCost * 2 ) ) ) )
+            {
+                cumulativeCost += costs[ index ];
+                ++index;
+            }
+        }
+        outGroupEnds.Append( (uint32_t)index );
+    }
+}
+
+// AssignByHash
+//------------------------------------------------------------------------------
+/*static*/ void UnityNode::AssignByHash( const Array< uint64_t > & keys, const Array< uint32_t > & costs, uint32_t numGroups, Array< uint32_t > & outGroups )
+{
+    ASSERT( numGroups > 0 );
+    ASSERT( keys.GetSize() == costs.GetSize() );
+
+    // Each file goes to the group with the highest score for its key. Adding or
+    // removing a file changes only the group it belongs to, unlike a split by
+    // position where every following group shifts.
+    // To keep groups balanced, the cost of each group is bounded, with files
+    // over the bound going to their next best group. Files are placed from most
+    // to least expensive (then in key order), so expensive files are spread out
+    // first, and the result doesn't depend on the order of the files.
+    const size_t numItems = keys.GetSize();
+    uint64_t totalCost = 0;
+    for ( const uint32_t cost : costs )
+    {
+        totalCost += cost;
+    }
+    const uint64_t maxGroupCost = ( ( totalCost * 5 ) + ( 4 * numGroups ) - 1 ) / ( 4 * numGroups ); // 25% over average
+
+    struct ItemOrder
+    {
+        uint32_t    m_Cost;
+        uint64_t    m_Key;
+        uint32_t    m_Index;
+        inline bool operator < ( const ItemOrder & other ) const
+        {
+            if ( m_Cost != other.m_Cost )
+            {
+                return ( m_Cost > other.m_Cost );
+            }
+            return ( m_Key != other.m_Key ) ? ( m_Key < other.m_Key ) : ( m_Index < other.m_Index );
+        }
+    };
+    Array< ItemOrder > order( numItems, false );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        ItemOrder item;
+        item.m_Cost = costs[ i ];
+        item.m_Key = keys[ i ];
+        item.m_Index = (uint32_t)i;
+        order.Append( item );
+    }
+    order.Sort();
+
+    Array< uint64_t > groupCosts( numGroups, false );
+    groupCosts.SetSize( numGroups );
+    for ( uint64_t & groupCost : groupCosts )
+    {
+        groupCost = 0;
+    }
+    outGroups.SetSize( numItems );
+
+    for ( const ItemOrder & item : order )
+    {
+        const uint32_t cost = costs[ item.m_Index ];
+        uint32_t bestGroup = 0;
+        uint64_t bestScore = 0;
+        bool found = false;
+        uint32_t leastLoadedGroup = 0;
+        for ( uint32_t group = 0; group < numGroups; ++group )
+        {
+            if ( groupCosts[ group ] < groupCosts[ leastLoadedGroup ] )
+            {
+                leastLoadedGroup = group;
+            }
+            if ( ( groupCosts[ group ] + cost ) > maxGroupCost )
+            {
+                continue; // full
+            }
+
+            // mix the key and group (SplitMix64 finalizer)
+            uint64_t score = item.m_Key ^ ( ( group + 1 ) * 0x9E3779B97F4A7C15ULL );
+            score = ( score ^ ( score >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+            score = ( score ^ ( score >> 27 ) ) * 0x94D049BB133111EBULL;
+            score = score ^ ( score >> 31 );
+            if ( ( found == false ) || ( score > bestScore ) )
+            {
+                bestGroup = group;
+                bestScore = score;
+                found = true;
+            }
+        }
+
+        // a single very expensive file can exceed the bound of every group
+        const uint32_t group = found ? bestGroup : leastLoadedGroup;
+        groupCosts[ group ] += cost;
+        outGroups[ item.m_Index ] = group;
+    }
+}
+
+// AssignFilesByCount
+//------------------------------------------------------------------------------
+void UnityNode::AssignFilesByCount( size_t numFiles, Array< uint32_t > & outUnityEnds ) const
+{
+    // how many files should go in each unity file?
+    const float numFilesPerUnity = (float)numFiles / m_NumUnityFilesToCreate;
+    float remainingInThisUnity( 0.0 );
+
+    size_t index = 0;
+    for ( size_t i=0; i<m_NumUnityFilesToCreate; ++i )
+    {
+        // add allocation to this unity
+        remainingInThisUnity += numFilesPerUnity;
+
+        // make sure any remaining files are added to the last unity to account
+        // for floating point imprecision
+        const bool lastUnity = ( i == ( m_NumUnityFilesToCreate - 1 ) );
+        while ( ( remainingInThisUnity > 0.0f ) || lastUnity )
+        {
+            remainingInThisUnity -= 1.0f; // reduce allocation, but leave rounding
+
+            // handle cases where there's more unity files than source files
+            if ( index >= numFiles )
+            {
+                break;
+            }
+            index++;
+        }
+        outUnityEnds.Append( (uint32_t)index );
+    }
+}
+
+// AssignFilesByHash
+//------------------------------------------------------------------------------
+void UnityNode::AssignFilesByHash( Array< FileAndOrigin > & files, const Array< uint32_t > & costs, Array< uint32_t > & outUnityEnds ) const
+{
+    // key each file by its (case-insensitive) name, so the assignment of a file
+    // doesn't depend on the other files
+    const size_t numFiles = files.GetSize();
+    Array< uint64_t > keys( numFiles, false );
+    for ( const FileAndOrigin & file : files )
+    {
+        AStackString<> lowerName( file.GetName() );
+        lowerName.ToLower();
+        keys.Append( xxHash::Calc64( lowerName ) );
+    }
+
+    Array< uint32_t > groups( numFiles, false );
+    AssignByHash( keys, costs, m_NumUnityFilesToCreate, groups );
+
+    // reorder the files so each unity file is contiguous, keeping the original
+    // relative order within each unity file
+    Array< uint32_t > groupStarts( m_NumUnityFilesToCreate, false );
+    groupStarts.SetSize( m_NumUnityFilesToCreate );
+    for ( uint32_t & start : groupStarts )
+    {
+        start = 0;
+    }
+    for ( const uint32_t group : groups )
+    {
+        ++groupStarts[ group ];
+    }
+    uint32_t total = 0;
+    for ( uint32_t & start : groupStarts )
+    {
+        const uint32_t count = start;
+        start = total;
+        total += count;
+        outUnityEnds.Append( total );
+    }
+    Array< uint32_t > sourceIndices( numFiles, false );
+    sourceIndices.SetSize( numFiles );
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        sourceIndices[ groupStarts[ groups[ i ] ]++ ] = (uint32_t)i;
+    }
+    Array< FileAndOrigin > sortedFiles( numFiles, false );
+    for ( const uint32_t sourceIndex : sourceIndices )
+    {
+        sortedFiles.Append( files[ sourceIndex ] );
+    }
+    files.Swap( sortedFiles );
+}
+
+// GetFileCosts
+//------------------------------------------------------------------------------
+void UnityNode::GetFileCosts( const Array< FileAndOrigin > & files, Array< uint32_t > & outCosts )
+{
+    MutexHolder mh( m_FileBuildTimesMutex );
+
+    // find the measured times from previous builds
+    const size_t numFiles = files.GetSize();
+    Array< const UnityFileBuildTime * > buildTimes( numFiles, false );
+    uint64_t knownTime = 0;
+    uint64_t knownSize = 0;
+    for ( const FileAndOrigin & file : files )
+    {
+        const UnityFileBuildTime * buildTime = FindFileBuildTime( file.GetName() );
+        buildTimes.Append( buildTime );
+        if ( buildTime )
+        {
+            knownTime += buildTime->m_BuildTimeMS;
+            knownSize += file.GetSize();
+        }
+    }
+
+    // estimate the cost of files never built, by size
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        uint64_t cost;
+        if ( buildTimes[ i ] )
+        {
+            cost = buildTimes[ i ]->m_BuildTimeMS;
+        }
+        else if ( knownSize > 0 )
+        {
+            cost = ( files[ i ].GetSize() * knownTime ) / knownSize;
+        }
+        else
+        {
+            cost = files[ i ].GetSize(); // nothing measured yet
+        }
+        outCosts.Append( (uint32_t)Math::Clamp< uint64_t >( cost, 1, 0xFFFFFFFF ) );
+    }
+
+    // forget files which are no longer part of the unity
+    Array< UnityFileBuildTime > currentBuildTimes( numFiles, true );
+    for ( const UnityFileBuildTime * buildTime : buildTimes )
+    {
+        if ( buildTime )
+        {
+            currentBuildTimes.Append( *buildTime );
+        }
+    }
+    currentBuildTimes.Sort();
+    m_FileBuildTimes.Swap( currentBuildTimes );
+}
+
+// FindFileBuildTime
+//------------------------------------------------------------------------------
+const UnityFileBuildTime * UnityNode::FindFileBuildTime( const AString & fileName ) const
+{
+    // m_FileBuildTimes is sorted by name
+    size_t low = 0;
+    size_t high = m_FileBuildTimes.GetSize();
+    while ( low < high )
+    {
+        const size_t mid = ( low + high ) / 2;
+        const UnityFileBuildTime & entry = m_FileBuildTimes[ mid ];
+        const int32_t result = entry.m_FileName.CompareI( fileName );
+        if ( result == 0 )
+        {
+            return &entry;
+        }
+        if ( result < 0 )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+// SetFileBuildTime
+//------------------------------------------------------------------------------
+void UnityNode::SetFileBuildTime( const AString & fileName, uint32_t buildTimeMS, Array< UnityFileBuildTime > & newEntries )
+{
+    const UnityFileBuildTime * entry = FindFileBuildTime( fileName );
+    if ( entry == nullptr )
+    {
+        UnityFileBuildTime newEntry;
+        newEntry.m_FileName = fileName;
+        newEntry.m_BuildTimeMS = buildTimeMS;
+        newEntries.Append( newEntry );
+        return;
+    }
+
+    // ignore small variations (noise in timings), which would otherwise move files
+    // between unity files, invalidating them for no real benefit
+    const uint32_t oldTime = entry->m_BuildTimeMS;
+    const uint32_t difference = ( buildTimeMS > oldTime ) ? ( buildTimeMS - oldTime ) : ( oldTime - buildTimeMS );
+    const uint32_t threshold = Math::Max< uint32_t >( oldTime / 4, 100 );
+    if ( difference > threshold )
+    {
+        m_FileBuildTimes[ (size_t)( entry - m_FileBuildTimes.Begin() ) ].m_BuildTimeMS = buildTimeMS;
+    }
+}
+
 //------------------------------------------------------------------------------
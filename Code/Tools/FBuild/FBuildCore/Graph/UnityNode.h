@@ -7,6 +7,7 @@
 #include "FileNode.h"
 #include "Core/Containers/Array.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Mutex.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -14,6 +15,18 @@ class BFFIterator;
 class DirectoryListNode;
 class Function;
 
+// UnityFileBuildTime - measured cost of compiling a file included in a Unity
+//------------------------------------------------------------------------------
+class UnityFileBuildTime : public Struct
+{
+    REFLECT_STRUCT_DECLARE( UnityFileBuildTime )
+public:
+    AString     m_FileName;
+    uint32_t    m_BuildTimeMS;
+
+    inline bool operator < ( const UnityFileBuildTime & other ) const { return ( m_FileName.CompareI( other.m_FileName ) < 0 ); }
+};
+
 // UnityNode
 //------------------------------------------------------------------------------
 class UnityNode : public Node
@@ -41,6 +54,7 @@ public:
         {}
 
         inline const AString &              GetName() const             { return m_Info->m_Name; }
+        inline uint64_t                     GetSize() const             { return m_Info->m_Size; }
         inline bool                         IsReadOnly() const          { return m_Info->IsReadOnly(); }
         inline const DirectoryListNode *    GetDirListOrigin() const    { return m_DirListOrigin; }
 
@@ -50,6 +64,17 @@ public:
     };
     inline const Array< FileAndOrigin > & GetIsolatedFileNames() const { return m_IsolatedFiles; }
 
+    // Build times of the objects compiled from this Unity, used to balance Unity files
+    void RecordBuildTimes( const Dependencies & objects );
+    bool GetFileBuildTime( const AString & fileName, uint32_t & outBuildTimeMS ) const;
+
+    // Split files (in order) into contiguous groups of similar total cost
+    static void PartitionByCost( const Array< uint32_t > & costs, uint32_t numGroups, Array< uint32_t > & outGroupEnds );
+
+    // Assign each file to a group using its key (rendezvous hashing), keeping
+    // the total cost of each group within a bound
+    static void AssignByHash( const Array< uint64_t > & keys, const Array< uint32_t > & costs, uint32_t numGroups, Array< uint32_t > & outGroups );
+
 private:
     virtual BuildResult DoBuild( Job * job ) override;
 
@@ -57,6 +82,12 @@ private:
 
     bool GetFiles( Array< FileAndOrigin > & files );
 
+    void AssignFilesByCount( size_t numFiles, Array< uint32_t > & outUnityEnds ) const;
+    void AssignFilesByHash( Array< FileAndOrigin > & files, const Array< uint32_t > & costs, Array< uint32_t > & outUnityEnds ) const;
+    void GetFileCosts( const Array< FileAndOrigin > & files, Array< uint32_t > & outCosts );
+    const UnityFileBuildTime * FindFileBuildTime( const AString & fileName ) const;
+    void SetFileBuildTime( const AString & fileName, uint32_t buildTimeMS, Array< UnityFileBuildTime > & newEntries );
+
     // Exposed properties
     Array< AString > m_InputPaths;
     bool m_InputPathRecurse;
@@ -71,13 +102,21 @@ private:
     Array< AString > m_FilesToExclude;
     bool m_IsolateWritableFiles;
     uint32_t m_MaxIsolatedFiles;
+    bool m_BalanceByBuildTime;
+    bool m_StableAssignment;
     Array< AString > m_ExcludePatterns;
     Array< FileAndOrigin > m_IsolatedFiles;
     Array< AString > m_PreBuildDependencyNames;
 
+    // Internal State
+    Array< UnityFileBuildTime > m_FileBuildTimes; // sorted by file name
+
     // Temporary data
     Array< AString > m_UnityFileNames;
     Array< FileIO::FileInfo* > m_FilesInfo;
+    Array< FileAndOrigin > m_FilesInUnityFiles;     // files compiled by each Unity file (excluding isolated files)...
+    Array< uint32_t > m_FilesInUnityFilesEnd;       // ...ending at this index, for each entry in m_UnityFileNames
+    mutable Mutex m_FileBuildTimesMutex;            // build times are recorded by each ObjectList using this Unity
 };
 
 //------------------------------------------------------------------------------
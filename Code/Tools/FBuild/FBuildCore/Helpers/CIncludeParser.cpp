@@ -17,13 +17,45 @@
 #include "Core/Tracing/Tracing.h"
 
 #include <string.h>
+#if defined( __WINDOWS__ )
+    #include <intrin.h>
+#endif
+#if defined( __AVX2__ )
+    #include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    #include <emmintrin.h>
+#endif
+
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __AVX2__ )
+    #define INCLUDE_PARSER_AVX2
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    #define INCLUDE_PARSER_SSE2
+#endif
+
+// CountTrailingZeros
+//------------------------------------------------------------------------------
+#if defined( INCLUDE_PARSER_AVX2 ) || defined( INCLUDE_PARSER_SSE2 )
+    static inline uint32_t CountTrailingZeros( uint64_t mask )
+    {
+        ASSERT( mask != 0 );
+        #if defined( __WINDOWS__ )
+            unsigned long index;
+            _BitScanForward64( &index, mask );
+            return (uint32_t)index;
+        #else
+            return (uint32_t)__builtin_ctzll( mask );
+        #endif
+    }
+#endif
 
 //------------------------------------------------------------------------------
 CIncludeParser::CIncludeParser()
     : m_LastCRC1( 0 )
-    , m_CRCs1( 4096, true )
+    , m_CRCs1( 4096 )
     , m_LastCRC2( 0 )
-    , m_CRCs2( 4096, true )
+    , m_CRCs2( 4096 )
     , m_Includes( 4096, true )
 #ifdef DEBUG
     , m_NonUniqueCount( 0 )
@@ -227,27 +259,79 @@ bool CIncludeParser::ParseMSCL_Preprocessed( const char * compilerOutput,
     return true;
 }
 
-// ParseToNextLineStaringWithHash
+// FindNextLineStartingWithHash
 //------------------------------------------------------------------------------
-/*static*/ void CIncludeParser::ParseToNextLineStartingWithHash( const char * & pos )
+/*static*/ const char * CIncludeParser::FindNextLineStartingWithHash( const char * pos, const char * end )
 {
-    for (;;)
+    // Safe to index -1 because # as first char is handled as a
+    // special case to avoid having it in this critical loop
+
+    // Most blocks contain no '#' at all, so skip 64 bytes at a time checking only
+    // for '#', and only check the preceeding chars for blocks which have one
+    #if defined( INCLUDE_PARSER_AVX2 )
+        const __m256i hash = _mm256_set1_epi8( '#' );
+        const __m256i lf = _mm256_set1_epi8( '\n' );
+        const __m256i cr = _mm256_set1_epi8( '\r' );
+        while ( ( end - pos ) >= 64 )
+        {
+            const __m256i hash0 = _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i *)pos ), hash );
+            const __m256i hash1 = _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i *)( pos + 32 ) ), hash );
+            if ( _mm256_movemask_epi8( _mm256_or_si256( hash0, hash1 ) ) != 0 )
+            {
+                const __m256i prev0 = _mm256_loadu_si256( (const __m256i *)( pos - 1 ) );
+                const __m256i prev1 = _mm256_loadu_si256( (const __m256i *)( pos + 31 ) );
+                const __m256i lineStart0 = _mm256_or_si256( _mm256_cmpeq_epi8( prev0, lf ), _mm256_cmpeq_epi8( prev0, cr ) );
+                const __m256i lineStart1 = _mm256_or_si256( _mm256_cmpeq_epi8( prev1, lf ), _mm256_cmpeq_epi8( prev1, cr ) );
+                const uint64_t mask = (uint64_t)(uint32_t)_mm256_movemask_epi8( _mm256_and_si256( hash0, lineStart0 ) ) |
+                                      ( (uint64_t)(uint32_t)_mm256_movemask_epi8( _mm256_and_si256( hash1, lineStart1 ) ) << 32 );
+                if ( mask )
+                {
+                    return pos + CountTrailingZeros( mask );
+                }
+            }
+            pos += 64;
+        }
+    #elif defined( INCLUDE_PARSER_SSE2 )
+        const __m128i hash = _mm_set1_epi8( '#' );
+        const __m128i lf = _mm_set1_epi8( '\n' );
+        const __m128i cr = _mm_set1_epi8( '\r' );
+        while ( ( end - pos ) >= 64 )
+        {
+            const __m128i hash0 = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)pos ), hash );
+            const __m128i hash1 = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( pos + 16 ) ), hash );
+            const __m128i hash2 = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( pos + 32 ) ), hash );
+            const __m128i hash3 = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( pos + 48 ) ), hash );
+            if ( _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( hash0, hash1 ), _mm_or_si128( hash2, hash3 ) ) ) != 0 )
+            {
+                const __m128i hashes[ 4 ] = { hash0, hash1, hash2, hash3 };
+                for ( size_t i = 0; i < 4; ++i )
+                {
+                    const __m128i prev = _mm_loadu_si128( (const __m128i *)( pos + ( i * 16 ) - 1 ) );
+                    const __m128i lineStart = _mm_or_si128( _mm_cmpeq_epi8( prev, lf ), _mm_cmpeq_epi8( prev, cr ) );
+                    const uint32_t mask = (uint32_t)_mm_movemask_epi8( _mm_and_si128( hashes[ i ], lineStart ) );
+                    if ( mask )
+                    {
+                        return pos + ( i * 16 ) + CountTrailingZeros( mask );
+                    }
+                }
+            }
+            pos += 64;
+        }
+    #endif
+
+    // Remaining bytes (or everything when no SIMD is available)
+    for ( ; pos < end; ++pos )
     {
-        pos = strchr( pos, '#' );
-        if ( pos )
+        if ( *pos == '#' )
         {
-            // Safe to index -1 because # as first char is handled as a
-            // special case to avoid having it in this critical loop
             const char prevC = pos[ -1 ];
             if ( ( prevC  == '\n' ) || ( prevC  == '\r' ) )
             {
-                return;
+                return pos;
             }
-            ++pos;
-            continue;
         }
-        return;
     }
+    return nullptr;
 }
 
 // Parse
@@ -257,9 +341,9 @@ bool CIncludeParser::ParseGCC_Preprocessed( const char * compilerOutput,
 {
     // we require null terminated input
     ASSERT( compilerOutput[ compilerOutputSize ] == 0 );
-    (void)compilerOutputSize;
 
     const char * pos = compilerOutput;
+    const char * const end = compilerOutput + compilerOutputSize;
 
     // special case for include on first line
     // (out of loop to keep loop logic simple)
@@ -268,10 +352,14 @@ bool CIncludeParser::ParseGCC_Preprocessed( const char * compilerOutput,
         ++pos;
         goto possibleInclude;
     }
+    if ( pos < end )
+    {
+        ++pos; // the search looks at the previous char, so don't start on the first one
+    }
 
     for (;;)
     {
-        ParseToNextLineStartingWithHash( pos );
+        pos = FindNextLineStartingWithHash( pos, end );
         if ( !pos )
         {
             break;
@@ -370,11 +458,10 @@ void CIncludeParser::AddInclude( const char * begin, const char * end )
         return;
     }
     m_LastCRC1 = crc1;
-    if ( m_CRCs1.Find( crc1 ) )
+    if ( m_CRCs1.Insert( crc1 ) == false )
     {
         return;
     }
-    m_CRCs1.Append( crc1 );
 
     // robust check
     AStackString< 256 > include( begin, end );
@@ -394,11 +481,89 @@ void CIncludeParser::AddInclude( const char * begin, const char * end )
         return;
     }
     m_LastCRC2 = crc2;
-    if ( m_CRCs2.Find( crc2 ) == nullptr )
+    if ( m_CRCs2.Insert( crc2 ) )
     {
-        m_CRCs2.Append( crc2 );
         m_Includes.Append( cleanInclude );
     }
 }
 
+// HashSet (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+CIncludeParser::HashSet::HashSet( size_t initialCapacity )
+    : m_Slots( 0, true )
+    , m_Mask( 0 )
+    , m_Count( 0 )
+    , m_HasZero( false )
+{
+    // power of 2 number of slots
+    size_t numSlots = 16;
+    while ( numSlots < initialCapacity )
+    {
+        numSlots <<= 1;
+    }
+    m_Slots.SetSize( numSlots );
+    memset( m_Slots.Begin(), 0, numSlots * sizeof( uint32_t ) );
+    m_Mask = numSlots - 1;
+}
+
+// HashSet::Insert
+//------------------------------------------------------------------------------
+bool CIncludeParser::HashSet::Insert( uint32_t hash )
+{
+    if ( hash == 0 )
+    {
+        const bool inserted = ( m_HasZero == false );
+        m_HasZero = true;
+        return inserted;
+    }
+
+    // keep load factor below 1/2
+    if ( ( ( m_Count + 1 ) * 2 ) > m_Slots.GetSize() )
+    {
+        Grow();
+    }
+
+    // hashes are already well distributed, so use them directly with linear probing
+    for ( size_t i = ( hash & m_Mask ); ; i = ( ( i + 1 ) & m_Mask ) )
+    {
+        uint32_t & slot = m_Slots[ i ];
+        if ( slot == hash )
+        {
+            return false;
+        }
+        if ( slot == 0 )
+        {
+            slot = hash;
+            ++m_Count;
+            return true;
+        }
+    }
+}
+
+// HashSet::Grow
+//------------------------------------------------------------------------------
+void CIncludeParser::HashSet::Grow()
+{
+    Array< uint32_t > oldSlots( 0, true );
+    oldSlots.Swap( m_Slots );
+
+    const size_t numSlots = oldSlots.GetSize() * 2;
+    m_Slots.SetSize( numSlots );
+    memset( m_Slots.Begin(), 0, numSlots * sizeof( uint32_t ) );
+    m_Mask = numSlots - 1;
+
+    for ( const uint32_t hash : oldSlots )
+    {
+        if ( hash )
+        {
+            size_t i = ( hash & m_Mask );
+            while ( m_Slots[ i ] != 0 )
+            {
+                i = ( ( i + 1 ) & m_Mask );
+            }
+            m_Slots[ i ] = hash;
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
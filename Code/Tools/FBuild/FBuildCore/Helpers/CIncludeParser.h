@@ -28,16 +28,34 @@ public:
         inline size_t GetNonUniqueCount() const { return m_NonUniqueCount; }
     #endif
 
-private:
-    static void ParseToNextLineStartingWithHash( const char * & pos );
+    // find a '#' at the start of a line in [pos, end) - pos[ -1 ] must be readable
+    static const char * FindNextLineStartingWithHash( const char * pos, const char * end );
 
+private:
     void AddInclude( const char * begin, const char * end );
 
+    // Set of hashes (open addressing)
+    class HashSet
+    {
+    public:
+        explicit HashSet( size_t initialCapacity );
+
+        bool Insert( uint32_t hash ); // returns false if already present
+
+    private:
+        void Grow();
+
+        Array< uint32_t >   m_Slots;    // 0 indicates an empty slot
+        size_t              m_Mask;
+        size_t              m_Count;
+        bool                m_HasZero;  // zero is tracked separately
+    };
+
     // temporary data
     uint32_t            m_LastCRC1;
-    Array< uint32_t >   m_CRCs1;
+    HashSet             m_CRCs1;
     uint32_t            m_LastCRC2;
-    Array< uint32_t >   m_CRCs2;
+    HashSet             m_CRCs2;
 
     // final data
     Array< AString > m_Includes;    // list of unique includes
@@ -0,0 +1,2860 @@
+// CIncludeScanner
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "CIncludeScanner.h"
+
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+
+// Core
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+// Defines
+//------------------------------------------------------------------------------
+#define MACRO_BUCKETS_INITIAL   ( 1024 )
+#define FILE_BUCKETS_INITIAL    ( 256 )
+#define MAX_INCLUDE_DEPTH       ( 200 )     // same as GCC
+#define MAX_EXPANSIONS          ( 100000 )  // per directive
+#define MAX_EXPAND_DEPTH        ( 32 )      // nesting of macro args (recursion uses stack)
+
+// Directory index of a file on the context stack
+#define DIR_NONE                ( -1 )      // found relative to includer, or absolute
+#define DIR_MAIN                ( -2 )      // source file
+
+// Token types
+enum TokenType : uint8_t
+{
+    TOKEN_IDENTIFIER,
+    TOKEN_NUMBER,
+    TOKEN_STRING,
+    TOKEN_CHAR,
+    TOKEN_PUNCTUATOR,
+    TOKEN_PASTE,        // ## in a macro body
+    TOKEN_PLACEMARKER,  // empty macro arg
+    TOKEN_UNKNOWN       // value can't be determined
+};
+
+// Token
+//------------------------------------------------------------------------------
+struct CIncludeScanner::Token
+{
+    const char *    m_Text;
+    uint32_t        m_Length;
+    uint32_t        m_HideSet;      // index into m_HideSets (0 is the empty set)
+    uint8_t         m_Type;
+    bool            m_LeadingSpace;
+    bool            m_NoExpand;     // macro name which can never be expanded again
+
+    template < size_t N >
+    inline bool Is( const char ( &text )[ N ] ) const { return ( m_Length == ( N - 1 ) ) && ( memcmp( m_Text, text, N - 1 ) == 0 ); }
+    inline bool IsPunctuator( char c ) const { return ( m_Type == TOKEN_PUNCTUATOR ) && ( m_Length == 1 ) && ( m_Text[ 0 ] == c ); }
+};
+
+// Macro
+//------------------------------------------------------------------------------
+struct CIncludeScanner::Macro
+{
+    Macro *             m_Next;         // next macro in hash bucket
+    uint32_t            m_Hash;
+    bool                m_FunctionLike;
+    bool                m_Variadic;     // last param collects remaining args
+    bool                m_Poisoned;     // (un)defined in a region which might be inactive
+    AString             m_Name;
+    AString             m_Body;
+    Array< Token >      m_Tokens;       // pointing into m_Body
+    Array< AString >    m_Params;
+};
+
+// File
+//------------------------------------------------------------------------------
+struct CIncludeScanner::File
+{
+    File *      m_Next;         // next file in hash bucket
+    uint32_t    m_Hash;
+    bool        m_Exists;
+    bool        m_Once;         // #pragma once or #import
+    bool        m_Included;     // recorded in m_Includes
+    AString     m_Path;         // cleaned path
+    AString     m_Contents;     // with line continuations removed
+    AString     m_Guard;        // macro guarding the entire file (if any)
+};
+
+// Context
+//------------------------------------------------------------------------------
+struct CIncludeScanner::Context
+{
+    File *          m_File;
+    const char *    m_Pos;
+    int32_t         m_DirIndex;         // include path the file was found in (or DIR_NONE/DIR_MAIN)
+    uint32_t        m_ConditionBase;    // size of m_Conditions when file was entered
+    State           m_State;            // state of the region containing the #include
+
+    // include guard detection (#ifndef X ... #endif surrounding everything)
+    bool            m_SeenDirective;
+    bool            m_GuardPossible;
+    bool            m_GuardClosed;
+    uint32_t        m_GuardCondition;   // index in m_Conditions
+    AString         m_GuardName;
+};
+
+// Condition
+//------------------------------------------------------------------------------
+struct CIncludeScanner::Condition
+{
+    State   m_State;        // state of the current branch
+    State   m_ParentState;  // state of the region containing the #if
+    bool    m_TakenKnown;   // an earlier branch was definitely taken
+    bool    m_TakenMaybe;   // an earlier branch might have been taken
+    bool    m_SeenElse;
+};
+
+// HideSet
+//------------------------------------------------------------------------------
+struct CIncludeScanner::HideSet
+{
+    const Macro *   m_Macro;
+    uint32_t        m_Parent;   // rest of the set
+};
+
+// Character helpers
+//------------------------------------------------------------------------------
+static inline bool IsSpace( char c )            { return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\f' ) || ( c == '\v' ); }
+static inline bool IsDigit( char c )            { return ( c >= '0' ) && ( c <= '9' ); }
+static inline bool IsHexDigit( char c )         { return IsDigit( c ) || ( ( ( c | 0x20 ) >= 'a' ) && ( ( c | 0x20 ) <= 'f' ) ); }
+static inline bool IsIdentifierStart( char c )  { return ( ( ( c | 0x20 ) >= 'a' ) && ( ( c | 0x20 ) <= 'z' ) ) || ( c == '_' ) || ( c == '$' ) || ( (unsigned char)c >= 0x80 ); }
+static inline bool IsIdentifierChar( char c )   { return IsIdentifierStart( c ) || IsDigit( c ); }
+static inline uint32_t HexValue( char c )       { return IsDigit( c ) ? (uint32_t)( c - '0' ) : (uint32_t)( ( c | 0x20 ) - 'a' + 10 ); }
+
+template < size_t N >
+static inline bool IsWord( const char * word, size_t wordLen, const char ( &text )[ N ] )
+{
+    return ( wordLen == ( N - 1 ) ) && ( memcmp( word, text, N - 1 ) == 0 );
+}
+
+// SkipSpaces
+//------------------------------------------------------------------------------
+static inline const char * SkipSpaces( const char * pos )
+{
+    // only used on null terminated directive lines
+    while ( IsSpace( *pos ) )
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+// SkipIdentifier
+//------------------------------------------------------------------------------
+static inline const char * SkipIdentifier( const char * pos, const char * end )
+{
+    while ( ( pos < end ) && IsIdentifierChar( *pos ) )
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+// SkipNumber
+//------------------------------------------------------------------------------
+static const char * SkipNumber( const char * pos, const char * end )
+{
+    // pp-number: digits, letters, '.', exponent signs and digit separators
+    ++pos;
+    while ( pos < end )
+    {
+        const char c = *pos;
+        if ( ( ( c == '+' ) || ( c == '-' ) ) && ( ( ( pos[ -1 ] | 0x20 ) == 'e' ) || ( ( pos[ -1 ] | 0x20 ) == 'p' ) ) )
+        {
+            ++pos;
+        }
+        else if ( ( c == '\'' ) && ( pos + 1 < end ) && IsIdentifierChar( pos[ 1 ] ) )
+        {
+            pos += 2;
+        }
+        else if ( IsIdentifierChar( c ) || ( c == '.' ) )
+        {
+            ++pos;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return pos;
+}
+
+// SkipLiteral
+//------------------------------------------------------------------------------
+static const char * SkipLiteral( const char * pos, const char * end )
+{
+    // string or char literal, which ends at the closing quote or end of line
+    const char quote = *pos;
+    ++pos;
+    while ( pos < end )
+    {
+        const char c = *pos;
+        if ( ( c == '\\' ) && ( pos + 1 < end ) && ( pos[ 1 ] != '\n' ) )
+        {
+            pos += 2;
+            continue;
+        }
+        if ( c == quote )
+        {
+            return pos + 1;
+        }
+        if ( c == '\n' )
+        {
+            break;
+        }
+        ++pos;
+    }
+    return pos;
+}
+
+// IsEncodingPrefix
+//------------------------------------------------------------------------------
+static inline bool IsEncodingPrefix( const char * begin, const char * end )
+{
+    const size_t len = (size_t)( end - begin );
+    return IsWord( begin, len, "L" ) || IsWord( begin, len, "u" ) || IsWord( begin, len, "U" ) || IsWord( begin, len, "u8" );
+}
+
+// IsRawStringPrefix
+//------------------------------------------------------------------------------
+static inline bool IsRawStringPrefix( const char * begin, const char * end )
+{
+    return ( end > begin ) && ( end[ -1 ] == 'R' ) && ( ( end - begin == 1 ) || IsEncodingPrefix( begin, end - 1 ) );
+}
+
+// SkipRawString
+//------------------------------------------------------------------------------
+static const char * SkipRawString( const char * pos, const char * end )
+{
+    // R"delim( ... )delim" - pos is at the opening quote
+    const char * delim = pos + 1;
+    const char * open = delim;
+    while ( ( open < end ) && ( *open != '(' ) )
+    {
+        const char c = *open;
+        if ( ( c == ')' ) || ( c == '\\' ) || ( c == '"' ) || ( c == '\n' ) || IsSpace( c ) || ( open - delim >= 16 ) )
+        {
+            return nullptr; // not a raw string
+        }
+        ++open;
+    }
+    if ( open >= end )
+    {
+        return nullptr;
+    }
+    const size_t delimLen = (size_t)( open - delim );
+    for ( const char * p = open + 1; p < end; ++p )
+    {
+        if ( ( *p == ')' ) &&
+             ( (size_t)( end - p ) > ( delimLen + 1 ) ) &&
+             ( memcmp( p + 1, delim, delimLen ) == 0 ) &&
+             ( p[ delimLen + 1 ] == '"' ) )
+        {
+            return p + delimLen + 2;
+        }
+    }
+    return end;
+}
+
+// PunctuatorLength
+//------------------------------------------------------------------------------
+static uint32_t PunctuatorLength( const char * pos, const char * end )
+{
+    static const char * const s_Punctuators3[] = { "...", "<<=", ">>=", "->*", "<=>" };
+    static const char * const s_Punctuators2[] = { "##", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "->",
+                                                   "++", "--", "::", "+=", "-=", "*=", "/=", "%=", "&=", "|=",
+                                                   "^=", ".*" };
+    const size_t remaining = (size_t)( end - pos );
+    if ( remaining >= 3 )
+    {
+        for ( const char * punctuator : s_Punctuators3 )
+        {
+            if ( memcmp( pos, punctuator, 3 ) == 0 )
+            {
+                return 3;
+            }
+        }
+    }
+    if ( remaining >= 2 )
+    {
+        for ( const char * punctuator : s_Punctuators2 )
+        {
+            if ( ( pos[ 0 ] == punctuator[ 0 ] ) && ( pos[ 1 ] == punctuator[ 1 ] ) )
+            {
+                return 2;
+            }
+        }
+    }
+    return 1;
+}
+
+// IsDynamicMacro
+//------------------------------------------------------------------------------
+static bool IsDynamicMacro( const char * name, size_t nameLen )
+{
+    // builtin macros whose value depends on where/when they are used
+    return IsWord( name, nameLen, "__FILE__" ) ||
+           IsWord( name, nameLen, "__LINE__" ) ||
+           IsWord( name, nameLen, "__COUNTER__" ) ||
+           IsWord( name, nameLen, "__INCLUDE_LEVEL__" ) ||
+           IsWord( name, nameLen, "__DATE__" ) ||
+           IsWord( name, nameLen, "__TIME__" ) ||
+           IsWord( name, nameLen, "__TIMESTAMP__" ) ||
+           IsWord( name, nameLen, "__BASE_FILE__" ) ||
+           IsWord( name, nameLen, "__FILE_NAME__" );
+}
+
+// GetArgEnd
+//------------------------------------------------------------------------------
+static inline uint32_t GetArgEnd( const Array< uint32_t > & argStarts, size_t numArgTokens, size_t index )
+{
+    return ( index + 1 < argStarts.GetSize() ) ? argStarts[ index + 1 ] : (uint32_t)numArgTokens;
+}
+
+// Expression
+//------------------------------------------------------------------------------
+// Evaluates a fully macro expanded #if expression. Values which can't be
+// determined propagate through the expression, except where the result can
+// be determined regardless (such as 0 && x).
+class CIncludeScanner::Expression
+{
+public:
+    Expression( const Array< Token > & tokens, bool isCPlusPlus, bool charIsUnsigned )
+        : m_Tokens( tokens )
+        , m_Pos( 0 )
+        , m_IsCPlusPlus( isCPlusPlus )
+        , m_CharIsUnsigned( charIsUnsigned )
+    {}
+
+    bool Evaluate( Truth & outTruth );
+
+private:
+    struct Value
+    {
+        int64_t m_Value;
+        bool    m_Unsigned;
+        bool    m_Known;
+    };
+
+    bool ParseComma( Value & v, bool evaluate );
+    bool ParseConditional( Value & v, bool evaluate );
+    bool ParseBinary( Value & v, uint32_t minPrecedence, bool evaluate );
+    bool ParseUnary( Value & v, bool evaluate );
+    bool ParsePrimary( Value & v, bool evaluate );
+    bool ParseNumber( const Token & token, Value & v ) const;
+    bool ParseChar( const Token & token, Value & v ) const;
+    static uint32_t GetPrecedence( const Token & token );
+    static bool Apply( const Token & op, const Value & a, const Value & b, bool evaluate, Value & out );
+
+    inline const Token * Peek() const { return ( m_Pos < m_Tokens.GetSize() ) ? &m_Tokens[ m_Pos ] : nullptr; }
+    inline bool Accept( char c )
+    {
+        const Token * token = Peek();
+        if ( token && token->IsPunctuator( c ) )
+        {
+            ++m_Pos;
+            return true;
+        }
+        return false;
+    }
+
+    const Array< Token > &  m_Tokens;
+    size_t                  m_Pos;
+    bool                    m_IsCPlusPlus;
+    bool                    m_CharIsUnsigned;
+};
+
+// Evaluate
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::Evaluate( Truth & outTruth )
+{
+    Value v;
+    if ( ( ParseComma( v, true ) == false ) || ( m_Pos != m_Tokens.GetSize() ) )
+    {
+        return false;
+    }
+    outTruth = ( v.m_Known == false ) ? IS_UNKNOWN : ( v.m_Value != 0 ) ? IS_TRUE : IS_FALSE;
+    return true;
+}
+
+// ParseComma
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseComma( Value & v, bool evaluate )
+{
+    if ( ParseConditional( v, evaluate ) == false )
+    {
+        return false;
+    }
+    while ( Accept( ',' ) )
+    {
+        if ( ParseConditional( v, evaluate ) == false )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ParseConditional
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseConditional( Value & v, bool evaluate )
+{
+    if ( ParseBinary( v, 1, evaluate ) == false )
+    {
+        return false;
+    }
+    if ( Accept( '?' ) == false )
+    {
+        return true;
+    }
+
+    const bool known = v.m_Known;
+    const bool condition = ( v.m_Value != 0 );
+    Value a;
+    Value b;
+    if ( ( ParseComma( a, evaluate && ( !known || condition ) ) == false ) ||
+         ( Accept( ':' ) == false ) ||
+         ( ParseConditional( b, evaluate && ( !known || !condition ) ) == false ) )
+    {
+        return false;
+    }
+
+    const bool isUnsigned = ( a.m_Unsigned || b.m_Unsigned );
+    if ( known )
+    {
+        v = condition ? a : b;
+    }
+    else if ( a.m_Known && b.m_Known && ( a.m_Value == b.m_Value ) )
+    {
+        v = a; // same result either way
+    }
+    else
+    {
+        v.m_Known = false;
+    }
+    v.m_Unsigned = isUnsigned;
+    return true;
+}
+
+// ParseBinary
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseBinary( Value & v, uint32_t minPrecedence, bool evaluate )
+{
+    if ( ParseUnary( v, evaluate ) == false )
+    {
+        return false;
+    }
+    for ( ;; )
+    {
+        const Token * op = Peek();
+        const uint32_t precedence = op ? GetPrecedence( *op ) : 0;
+        if ( ( precedence == 0 ) || ( precedence < minPrecedence ) )
+        {
+            return true;
+        }
+        ++m_Pos;
+
+        // errors (such as division by zero) are ignored in unevaluated operands
+        bool evaluateRight = evaluate;
+        if ( v.m_Known && ( ( op->Is( "&&" ) && ( v.m_Value == 0 ) ) || ( op->Is( "||" ) && ( v.m_Value != 0 ) ) ) )
+        {
+            evaluateRight = false;
+        }
+
+        Value right;
+        if ( ParseBinary( right, precedence + 1, evaluateRight ) == false )
+        {
+            return false;
+        }
+        if ( Apply( *op, v, right, evaluateRight, v ) == false )
+        {
+            return false;
+        }
+    }
+}
+
+// ParseUnary
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseUnary( Value & v, bool evaluate )
+{
+    const Token * token = Peek();
+    if ( token && ( token->m_Type == TOKEN_PUNCTUATOR ) && ( token->m_Length == 1 ) )
+    {
+        const char op = token->m_Text[ 0 ];
+        if ( ( op == '+' ) || ( op == '-' ) || ( op == '~' ) || ( op == '!' ) )
+        {
+            ++m_Pos;
+            if ( ParseUnary( v, evaluate ) == false )
+            {
+                return false;
+            }
+            switch ( op )
+            {
+                case '-': v.m_Value = (int64_t)( 0 - (uint64_t)v.m_Value ); break;
+                case '~': v.m_Value = ~v.m_Value; break;
+                case '!': v.m_Value = ( v.m_Value == 0 ) ? 1 : 0; v.m_Unsigned = false; break;
+                default: break;
+            }
+            return true;
+        }
+    }
+    return ParsePrimary( v, evaluate );
+}
+
+// ParsePrimary
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParsePrimary( Value & v, bool evaluate )
+{
+    const Token * token = Peek();
+    if ( token == nullptr )
+    {
+        return false;
+    }
+    ++m_Pos;
+
+    v.m_Value = 0;
+    v.m_Unsigned = false;
+    v.m_Known = true;
+    switch ( token->m_Type )
+    {
+        case TOKEN_NUMBER:      return ParseNumber( *token, v );
+        case TOKEN_CHAR:        return ParseChar( *token, v );
+        case TOKEN_UNKNOWN:     v.m_Known = false; return true;
+        case TOKEN_IDENTIFIER:
+        {
+            // identifiers remaining after expansion evaluate to 0
+            if ( m_IsCPlusPlus && token->Is( "true" ) )
+            {
+                v.m_Value = 1;
+            }
+            return true;
+        }
+        case TOKEN_PUNCTUATOR:
+        {
+            if ( token->IsPunctuator( '(' ) )
+            {
+                return ParseComma( v, evaluate ) && Accept( ')' );
+            }
+            return false;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+// ParseNumber
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseNumber( const Token & token, Value & v ) const
+{
+    const char * pos = token.m_Text;
+    const char * const end = token.m_Text + token.m_Length;
+
+    uint32_t base = 10;
+    if ( ( token.m_Length > 2 ) && ( pos[ 0 ] == '0' ) && ( ( pos[ 1 ] | 0x20 ) == 'x' ) )
+    {
+        base = 16;
+        pos += 2;
+    }
+    else if ( ( token.m_Length > 2 ) && ( pos[ 0 ] == '0' ) && ( ( pos[ 1 ] | 0x20 ) == 'b' ) )
+    {
+        base = 2;
+        pos += 2;
+    }
+    else if ( pos[ 0 ] == '0' )
+    {
+        base = 8;
+    }
+
+    uint64_t value = 0;
+    bool anyDigits = false;
+    for ( ; pos < end; ++pos )
+    {
+        const char c = *pos;
+        if ( c == '\'' )
+        {
+            continue; // digit separator
+        }
+        if ( !IsDigit( c ) && !( ( base == 16 ) && IsHexDigit( c ) ) )
+        {
+            break;
+        }
+        const uint32_t digit = HexValue( c );
+        if ( digit >= base )
+        {
+            return false;
+        }
+        value = ( value * base ) + digit;
+        anyDigits = true;
+    }
+    if ( anyDigits == false )
+    {
+        return false;
+    }
+
+    // suffix (floating point values are not allowed)
+    bool isUnsigned = false;
+    for ( ; pos < end; ++pos )
+    {
+        const char c = ( *pos | 0x20 );
+        if ( c == 'u' )
+        {
+            isUnsigned = true;
+        }
+        else if ( ( c != 'l' ) && ( c != 'z' ) )
+        {
+            return false;
+        }
+    }
+
+    v.m_Value = (int64_t)value;
+    v.m_Unsigned = isUnsigned || ( ( value >> 63 ) != 0 );
+    return true;
+}
+
+// ParseChar
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Expression::ParseChar( const Token & token, Value & v ) const
+{
+    const char * pos = token.m_Text;
+    const char * const end = token.m_Text + token.m_Length;
+
+    // encoding prefix
+    bool narrow = true;
+    while ( ( pos < end ) && ( *pos != '\'' ) )
+    {
+        narrow = false;
+        ++pos;
+    }
+    ++pos;
+
+    int64_t value = 0;
+    uint32_t numChars = 0;
+    while ( ( pos < end ) && ( *pos != '\'' ) )
+    {
+        uint32_t c = (unsigned char)*pos++;
+        if ( ( c == '\\' ) && ( pos < end ) )
+        {
+            const char escape = *pos++;
+            switch ( escape )
+            {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'e': c = 27; break; // GNU extension
+                case 'x':
+                {
+                    c = 0;
+                    while ( ( pos < end ) && IsHexDigit( *pos ) )
+                    {
+                        c = ( c * 16 ) + HexValue( *pos++ );
+                    }
+                    break;
+                }
+                default:
+                {
+                    if ( ( escape >= '0' ) && ( escape <= '7' ) )
+                    {
+                        c = (uint32_t)( escape - '0' );
+                        for ( uint32_t i = 0; ( i < 2 ) && ( pos < end ) && ( *pos >= '0' ) && ( *pos <= '7' ); ++i )
+                        {
+                            c = ( c * 8 ) + (uint32_t)( *pos++ - '0' );
+                        }
+                    }
+                    else
+                    {
+                        c = (unsigned char)escape; // \\ \' \" \?
+                    }
+                    break;
+                }
+            }
+        }
+        value = narrow ? ( ( value << 8 ) | ( c & 0xFF ) ) : (int64_t)c;
+        ++numChars;
+    }
+    if ( ( pos >= end ) || ( numChars == 0 ) )
+    {
+        return false;
+    }
+    if ( narrow && ( numChars == 1 ) && ( m_CharIsUnsigned == false ) )
+    {
+        value = (int64_t)(int8_t)( value & 0xFF );
+    }
+    v.m_Value = value;
+    return true;
+}
+
+// GetPrecedence
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CIncludeScanner::Expression::GetPrecedence( const Token & token )
+{
+    if ( token.m_Type != TOKEN_PUNCTUATOR )
+    {
+        return 0;
+    }
+    if ( token.m_Length == 1 )
+    {
+        switch ( token.m_Text[ 0 ] )
+        {
+            case '|': return 3;
+            case '^': return 4;
+            case '&': return 5;
+            case '<': return 7;
+            case '>': return 7;
+            case '+': return 9;
+            case '-': return 9;
+            case '*': return 10;
+            case '/': return 10;
+            case '%': return 10;
+            default: return 0;
+        }
+    }
+    if ( token.Is( "||" ) ) { return 1; }
+    if ( token.Is( "&&" ) ) { return 2; }
+    if ( token.Is( "==" ) || token.Is( "!=" ) ) { return 6; }
+    if ( token.Is( "<=" ) || token.Is( ">=" ) ) { return 7; }
+    if ( token.Is( "<<" ) || token.Is( ">>" ) ) { return 8; }
+    return 0;
+}
+
+// Apply
+//------------------------------------------------------------------------------
+/*static*/ bool CIncludeScanner::Expression::Apply( const Token & op, const Value & a, const Value & b, bool evaluate, Value & out )
+{
+    // logical operators can have a known result when one operand is unknown
+    if ( op.Is( "&&" ) || op.Is( "||" ) )
+    {
+        const int64_t shortCircuit = op.Is( "&&" ) ? 0 : 1;
+        const bool aDecides = a.m_Known && ( ( a.m_Value != 0 ) == ( shortCircuit != 0 ) );
+        const bool bDecides = b.m_Known && ( ( b.m_Value != 0 ) == ( shortCircuit != 0 ) );
+        out.m_Unsigned = false;
+        out.m_Known = ( aDecides || bDecides || ( a.m_Known && b.m_Known ) );
+        out.m_Value = ( aDecides || bDecides ) ? shortCircuit : ( 1 - shortCircuit );
+        return true;
+    }
+
+    const bool isUnsigned = ( a.m_Unsigned || b.m_Unsigned );
+    const uint64_t ua = (uint64_t)a.m_Value;
+    const uint64_t ub = (uint64_t)b.m_Value;
+    const int64_t sa = a.m_Value;
+    const int64_t sb = b.m_Value;
+    out.m_Known = ( a.m_Known && b.m_Known );
+    out.m_Unsigned = isUnsigned;
+    if ( out.m_Known == false )
+    {
+        out.m_Value = 0;
+        return true;
+    }
+
+    // comparisons
+    bool compare = true;
+    bool result = false;
+    if ( op.Is( "<" ) )         { result = isUnsigned ? ( ua < ub ) : ( sa < sb ); }
+    else if ( op.Is( ">" ) )    { result = isUnsigned ? ( ua > ub ) : ( sa > sb ); }
+    else if ( op.Is( "<=" ) )   { result = isUnsigned ? ( ua <= ub ) : ( sa <= sb ); }
+    else if ( op.Is( ">=" ) )   { result = isUnsigned ? ( ua >= ub ) : ( sa >= sb ); }
+    else if ( op.Is( "==" ) )   { result = ( ua == ub ); }
+    else if ( op.Is( "!=" ) )   { result = ( ua != ub ); }
+    else                        { compare = false; }
+    if ( compare )
+    {
+        out.m_Value = result ? 1 : 0;
+        out.m_Unsigned = false;
+        return true;
+    }
+
+    // shifts (result has the type of the left operand)
+    if ( op.Is( "<<" ) || op.Is( ">>" ) )
+    {
+        bool left = op.Is( "<<" );
+        uint64_t count = ub;
+        if ( ( b.m_Unsigned == false ) && ( sb < 0 ) )
+        {
+            left = !left;
+            count = ( 0 - ub );
+        }
+        out.m_Unsigned = a.m_Unsigned;
+        if ( left )
+        {
+            out.m_Value = ( count >= 64 ) ? 0 : (int64_t)( ua << count );
+        }
+        else if ( a.m_Unsigned )
+        {
+            out.m_Value = ( count >= 64 ) ? 0 : (int64_t)( ua >> count );
+        }
+        else
+        {
+            out.m_Value = ( count >= 64 ) ? ( ( sa < 0 ) ? -1 : 0 ) : ( sa >> count );
+        }
+        return true;
+    }
+
+    switch ( op.m_Text[ 0 ] )
+    {
+        case '+': out.m_Value = (int64_t)( ua + ub ); return true;
+        case '-': out.m_Value = (int64_t)( ua - ub ); return true;
+        case '*': out.m_Value = (int64_t)( ua * ub ); return true;
+        case '&': out.m_Value = (int64_t)( ua & ub ); return true;
+        case '^': out.m_Value = (int64_t)( ua ^ ub ); return true;
+        case '|': out.m_Value = (int64_t)( ua | ub ); return true;
+        case '/':
+        case '%':
+        {
+            if ( ub == 0 )
+            {
+                out.m_Value = 0;
+                return ( evaluate == false ); // division by zero is an error if evaluated
+            }
+            const bool divide = ( op.m_Text[ 0 ] == '/' );
+            if ( isUnsigned )
+            {
+                out.m_Value = (int64_t)( divide ? ( ua / ub ) : ( ua % ub ) );
+            }
+            else if ( sb == -1 )
+            {
+                out.m_Value = divide ? (int64_t)( 0 - ua ) : 0; // avoid overflow of INT64_MIN / -1
+            }
+            else
+            {
+                out.m_Value = divide ? ( sa / sb ) : ( sa % sb );
+            }
+            return true;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+// CIncludeScannerConfig (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+CIncludeScannerConfig::CIncludeScannerConfig( uint64_t key )
+    : m_Key( key )
+    , m_Valid( false )
+    , m_Defines( 16 * 1024 )
+    , m_IncludePaths( 16, true )
+    , m_NumQuoteIncludePaths( 0 )
+    , m_ImplicitIncludes( 4, true )
+{
+}
+
+// CIncludeScannerConfig (DESTRUCTOR)
+//------------------------------------------------------------------------------
+CIncludeScannerConfig::~CIncludeScannerConfig() = default;
+
+// ParseCompilerOutput
+//------------------------------------------------------------------------------
+bool CIncludeScannerConfig::ParseCompilerOutput( const char * stdOut, const char * stdErr )
+{
+    // -dD lists the predefined macros on stdout, along with line markers
+    // for files entered before the empty file:
+    //   # 1 "<path>" 1
+    m_Defines = stdOut ? stdOut : "";
+    if ( stdErr == nullptr )
+    {
+        return false;
+    }
+    for ( const char * pos = m_Defines.Get(); *pos; )
+    {
+        const char * lineEnd = strchr( pos, '\n' );
+        if ( lineEnd == nullptr )
+        {
+            lineEnd = pos + AString::StrLen( pos );
+        }
+        const char * marker = pos;
+        pos = ( *lineEnd ) ? lineEnd + 1 : lineEnd;
+
+        if ( ( marker[ 0 ] != '#' ) || ( marker[ 1 ] != ' ' ) || ( IsDigit( marker[ 2 ] ) == false ) )
+        {
+            continue;
+        }
+        const char * pathStart = static_cast< const char * >( memchr( marker, '"', (size_t)( lineEnd - marker ) ) );
+        const char * pathEnd = pathStart ? static_cast< const char * >( memchr( pathStart + 1, '"', (size_t)( lineEnd - pathStart - 1 ) ) ) : nullptr;
+        if ( ( pathEnd == nullptr ) || ( pathEnd + 2 >= lineEnd ) || ( pathEnd[ 1 ] != ' ' ) || ( pathEnd[ 2 ] != '1' ) )
+        {
+            continue; // not entering a file
+        }
+        AStackString<> path( pathStart + 1, pathEnd );
+        if ( path.BeginsWith( '<' ) || m_ImplicitIncludes.Find( path ) )
+        {
+            continue; // <built-in>, <command-line> etc
+        }
+        m_ImplicitIncludes.Append( path );
+    }
+
+    // -v lists the include paths on stderr:
+    //   #include "..." search starts here:
+    //    <path>
+    //   #include <...> search starts here:
+    //    <path>
+    //   End of search list.
+    // and -H lists the files which were included (before the empty file):
+    //   . <path>
+    enum { SECTION_NONE, SECTION_QUOTE, SECTION_ANGLE } section = SECTION_NONE;
+    bool foundEnd = false;
+    const char * pos = stdErr;
+    while ( *pos )
+    {
+        const char * lineEnd = strchr( pos, '\n' );
+        if ( lineEnd == nullptr )
+        {
+            lineEnd = pos + AString::StrLen( pos );
+        }
+        const char * next = ( *lineEnd ) ? lineEnd + 1 : lineEnd;
+        while ( ( lineEnd > pos ) && IsSpace( lineEnd[ -1 ] ) )
+        {
+            --lineEnd;
+        }
+        AStackString<> line( pos, lineEnd );
+        pos = next;
+
+        if ( line.BeginsWith( "#include \"...\" search starts here:" ) )
+        {
+            section = SECTION_QUOTE;
+        }
+        else if ( line.BeginsWith( "#include <...> search starts here:" ) )
+        {
+            section = SECTION_ANGLE;
+        }
+        else if ( line.BeginsWith( "End of search list." ) )
+        {
+            section = SECTION_NONE;
+            foundEnd = true;
+        }
+        else if ( ( section != SECTION_NONE ) && line.BeginsWith( ' ' ) )
+        {
+            // Clang lists framework directories, which are searched differently
+            if ( line.EndsWith( "(framework directory)" ) || line.EndsWith( "(headermap)" ) )
+            {
+                continue;
+            }
+            const char * path = SkipSpaces( line.Get() );
+            m_IncludePaths.Append( AStackString<>( path, line.GetEnd() ) );
+            if ( section == SECTION_QUOTE )
+            {
+                ++m_NumQuoteIncludePaths;
+            }
+        }
+        else if ( line.BeginsWith( '.' ) )
+        {
+            const char * path = line.Get();
+            while ( *path == '.' )
+            {
+                ++path;
+            }
+            if ( *path == ' ' )
+            {
+                AStackString<> implicitInclude( path + 1, line.GetEnd() );
+                if ( m_ImplicitIncludes.Find( implicitInclude ) == nullptr )
+                {
+                    m_ImplicitIncludes.Append( implicitInclude );
+                }
+            }
+        }
+    }
+    m_Valid = foundEnd;
+    return m_Valid;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CIncludeScanner::CIncludeScanner( const CIncludeScannerConfig & config )
+    : m_Config( config )
+    , m_Macros( 0, true )
+    , m_NumMacros( 0 )
+    , m_Files( 0, true )
+    , m_NumFiles( 0 )
+    , m_Contexts( MAX_INCLUDE_DEPTH + 1, false ) // never resized, so references remain valid
+    , m_Conditions( 64, true )
+    , m_IsCPlusPlus( false )
+    , m_CharIsUnsigned( false )
+    , m_HideSets( 256, true )
+    , m_Scratch( 0, true )
+    , m_NumExpansions( 0 )
+    , m_ExpandDepth( 0 )
+    , m_Includes( 256, true )
+{
+    m_Macros.SetSize( MACRO_BUCKETS_INITIAL );
+    memset( m_Macros.Begin(), 0, m_Macros.GetSize() * sizeof( Macro * ) );
+    m_Files.SetSize( FILE_BUCKETS_INITIAL );
+    memset( m_Files.Begin(), 0, m_Files.GetSize() * sizeof( File * ) );
+
+    // index 0 is the empty set
+    HideSet empty;
+    empty.m_Macro = nullptr;
+    empty.m_Parent = 0;
+    m_HideSets.Append( empty );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CIncludeScanner::~CIncludeScanner()
+{
+    for ( Macro * macro : m_Macros )
+    {
+        while ( macro )
+        {
+            Macro * next = macro->m_Next;
+            FDELETE macro;
+            macro = next;
+        }
+    }
+    for ( File * file : m_Files )
+    {
+        while ( file )
+        {
+            File * next = file->m_Next;
+            FDELETE file;
+            file = next;
+        }
+    }
+    for ( AString * text : m_Scratch )
+    {
+        FDELETE text;
+    }
+}
+
+// Scan
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Scan( const AString & sourceFile, const Array< AString > & forcedIncludes )
+{
+    PROFILE_FUNCTION
+
+    if ( DefinePredefinedMacros() == false )
+    {
+        return false;
+    }
+    m_IsCPlusPlus = ( FindMacro( "__cplusplus", 11 ) != nullptr );
+    m_CharIsUnsigned = ( FindMacro( "__CHAR_UNSIGNED__", 17 ) != nullptr );
+
+    // forced includes (-include) are searched for in the working dir first
+    ASSERT( m_Contexts.IsEmpty() );
+    if ( forcedIncludes.GetSize() >= MAX_INCLUDE_DEPTH )
+    {
+        return Fail( "Too many forced includes" );
+    }
+    Array< File * > forcedFiles( forcedIncludes.GetSize(), false );
+    Array< int32_t > forcedDirs( forcedIncludes.GetSize(), false );
+    for ( const AString & forcedInclude : forcedIncludes )
+    {
+        int32_t dirIndex = DIR_NONE;
+        File * file = FindIncludeFile( forcedInclude, false, false, dirIndex );
+        if ( file == nullptr )
+        {
+            return Fail( "Unable to find forced include '%s'", forcedInclude.Get() );
+        }
+        forcedFiles.Append( file );
+        forcedDirs.Append( dirIndex );
+    }
+
+    File * mainFile = LoadFile( sourceFile );
+    if ( mainFile == nullptr )
+    {
+        return Fail( "Unable to open '%s'", sourceFile.Get() );
+    }
+    EnterFile( mainFile, DIR_MAIN, ACTIVE );
+
+    // files included by the compiler before the source (their macros are already defined)
+    for ( const AString & implicitInclude : m_Config.GetImplicitIncludes() )
+    {
+        File * file = LoadFile( implicitInclude );
+        if ( file )
+        {
+            RecordInclude( file );
+        }
+    }
+
+    // forced includes are processed (in order) before the source
+    for ( size_t i = forcedFiles.GetSize(); i > 0; --i )
+    {
+        EnterFile( forcedFiles[ i - 1 ], forcedDirs[ i - 1 ], ACTIVE );
+    }
+
+    return ProcessFiles();
+}
+
+// SwapIncludes
+//------------------------------------------------------------------------------
+void CIncludeScanner::SwapIncludes( Array< AString > & includes )
+{
+    m_Includes.Swap( includes );
+}
+
+// ProcessFiles
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessFiles()
+{
+    while ( m_Contexts.IsEmpty() == false )
+    {
+        Context & context = m_Contexts.Top();
+        const char * const end = context.m_File->m_Contents.GetEnd();
+
+        bool sawCode = false;
+        const char * directive = FindDirective( context.m_Pos, end, sawCode );
+        if ( sawCode && ( ( context.m_SeenDirective == false ) || context.m_GuardClosed ) )
+        {
+            context.m_GuardPossible = false; // code outside the include guard
+        }
+        if ( directive == nullptr )
+        {
+            if ( LeaveFile() == false )
+            {
+                return false;
+            }
+            continue;
+        }
+        context.m_Pos = ReadDirective( directive, end, m_Line );
+
+        // free temporary data from the previous directive
+        m_HideSets.SetSize( 1 );
+        for ( AString * text : m_Scratch )
+        {
+            FDELETE text;
+        }
+        m_Scratch.Clear();
+        m_NumExpansions = 0;
+
+        if ( ProcessDirective( context ) == false )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ProcessDirective
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessDirective( Context & context )
+{
+    const char * pos = SkipSpaces( m_Line.Get() );
+    if ( IsIdentifierStart( *pos ) == false )
+    {
+        return true; // null directive or line marker
+    }
+    const char * directive = pos;
+    pos = SkipIdentifier( pos, m_Line.GetEnd() );
+    const uint32_t directiveLen = (uint32_t)( pos - directive );
+
+    const bool isIf         = IsWord( directive, directiveLen, "if" );
+    const bool isIfndef     = IsWord( directive, directiveLen, "ifndef" );
+    const bool isCondition  = isIf || isIfndef ||
+                              IsWord( directive, directiveLen, "ifdef" ) ||
+                              IsWord( directive, directiveLen, "elif" ) ||
+                              IsWord( directive, directiveLen, "elifdef" ) ||
+                              IsWord( directive, directiveLen, "elifndef" ) ||
+                              IsWord( directive, directiveLen, "else" ) ||
+                              IsWord( directive, directiveLen, "endif" );
+
+    // track include guard: the first directive must be "#ifndef X" or "#if !defined( X )"
+    // and its #endif must be the last directive (with no #else/#elif)
+    if ( context.m_GuardClosed )
+    {
+        context.m_GuardPossible = false;
+    }
+    else if ( context.m_SeenDirective == false )
+    {
+        const char * const end = m_Line.GetEnd();
+        const char * guard = nullptr;
+        const char * guardEnd = nullptr;
+        const char * rest = SkipSpaces( pos );
+        if ( isIfndef )
+        {
+            guard = rest;
+            guardEnd = SkipIdentifier( guard, end );
+            rest = guardEnd;
+        }
+        else if ( isIf && ( *rest == '!' ) )
+        {
+            const char * word = SkipSpaces( rest + 1 );
+            rest = SkipIdentifier( word, end );
+            if ( IsWord( word, (size_t)( rest - word ), "defined" ) )
+            {
+                rest = SkipSpaces( rest );
+                const bool paren = ( *rest == '(' );
+                guard = paren ? SkipSpaces( rest + 1 ) : rest;
+                guardEnd = SkipIdentifier( guard, end );
+                rest = SkipSpaces( guardEnd );
+                if ( paren )
+                {
+                    rest = ( *rest == ')' ) ? ( rest + 1 ) : guard;
+                }
+            }
+        }
+        if ( guard && ( guardEnd > guard ) && ( IsDigit( *guard ) == false ) && ( *SkipSpaces( rest ) == 0 ) )
+        {
+            context.m_GuardName.Assign( guard, guardEnd );
+            context.m_GuardCondition = (uint32_t)m_Conditions.GetSize();
+        }
+        else
+        {
+            context.m_GuardPossible = false;
+        }
+    }
+    else if ( context.m_GuardPossible && ( m_Conditions.GetSize() == ( (size_t)context.m_GuardCondition + 1 ) ) && isCondition )
+    {
+        if ( IsWord( directive, directiveLen, "endif" ) )
+        {
+            context.m_GuardClosed = true;
+        }
+        else if ( !isIf && !isIfndef && !IsWord( directive, directiveLen, "ifdef" ) )
+        {
+            context.m_GuardPossible = false; // #else or #elif of guard
+        }
+    }
+    context.m_SeenDirective = true;
+
+    const State state = GetState();
+    if ( isCondition )
+    {
+        return ProcessCondition( directive, directiveLen, pos, state );
+    }
+    if ( state == INACTIVE )
+    {
+        return true;
+    }
+
+    if ( IsWord( directive, directiveLen, "include" ) )         { return ProcessInclude( pos, false, false, state ); }
+    if ( IsWord( directive, directiveLen, "include_next" ) )    { return ProcessInclude( pos, true, false, state ); }
+    if ( IsWord( directive, directiveLen, "import" ) )          { return ProcessInclude( pos, false, true, state ); }
+    if ( IsWord( directive, directiveLen, "define" ) )          { return ProcessDefine( pos, state ); }
+    if ( IsWord( directive, directiveLen, "undef" ) )           { return ProcessUndef( pos, state ); }
+    if ( IsWord( directive, directiveLen, "pragma" ) )          { return ProcessPragma( pos, state ); }
+    if ( IsWord( directive, directiveLen, "error" ) )
+    {
+        return FailIfActive( state, "#error in '%s'", GetFileName() );
+    }
+    if ( IsWord( directive, directiveLen, "line" ) ||
+         IsWord( directive, directiveLen, "warning" ) ||
+         IsWord( directive, directiveLen, "ident" ) ||
+         IsWord( directive, directiveLen, "sccs" ) ||
+         IsWord( directive, directiveLen, "assert" ) ||
+         IsWord( directive, directiveLen, "unassert" ) )
+    {
+        return true; // no effect on includes
+    }
+    return FailIfActive( state, "Unknown directive '#%.*s' in '%s'", (int)directiveLen, directive, GetFileName() );
+}
+
+// ProcessInclude
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessInclude( const char * pos, bool isNext, bool isImport, State state )
+{
+    AStackString<> name;
+    bool angled = false;
+    pos = SkipSpaces( pos );
+    if ( ( *pos == '"' ) || ( *pos == '<' ) )
+    {
+        const char close = ( *pos == '"' ) ? '"' : '>';
+        const char * nameEnd = strchr( pos + 1, close );
+        if ( nameEnd == nullptr )
+        {
+            return FailIfActive( state, "Invalid #include in '%s'", GetFileName() );
+        }
+        name.Assign( pos + 1, nameEnd );
+        angled = ( close == '>' );
+    }
+    else
+    {
+        // computed include - the result must be known even if the region might be inactive
+        Array< Token > tokens( 16, true );
+        Tokenize( pos, m_Line.GetEnd(), tokens );
+        if ( ExpandTokens( tokens, false ) == false )
+        {
+            return false;
+        }
+        for ( const Token & token : tokens )
+        {
+            if ( token.m_Type == TOKEN_UNKNOWN )
+            {
+                return Fail( "Unable to determine #include in '%s'", GetFileName() );
+            }
+        }
+        if ( GetIncludeName( tokens, name, angled ) == false )
+        {
+            return FailIfActive( state, "Invalid #include in '%s'", GetFileName() );
+        }
+    }
+
+    // files which are not found are only a problem in active code
+    int32_t dirIndex = DIR_NONE;
+    File * file = FindIncludeFile( name, angled, isNext, dirIndex );
+    if ( file == nullptr )
+    {
+        return FailIfActive( state, "Unable to find '%s' included by '%s'", name.Get(), GetFileName() );
+    }
+
+    // skip files protected from multiple inclusion
+    if ( file->m_Once )
+    {
+        return true;
+    }
+    if ( ( file->m_Guard.IsEmpty() == false ) && ( IsDefined( file->m_Guard.Get(), file->m_Guard.GetLength() ) == IS_TRUE ) )
+    {
+        return true;
+    }
+
+    if ( m_Contexts.GetSize() >= MAX_INCLUDE_DEPTH )
+    {
+        return Fail( "#include nested too deeply in '%s'", GetFileName() );
+    }
+    if ( isImport )
+    {
+        file->m_Once = true;
+    }
+    EnterFile( file, dirIndex, state );
+    return true;
+}
+
+// ProcessDefine
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessDefine( const char * pos, State state )
+{
+    const char * const end = m_Line.GetEnd();
+    pos = SkipSpaces( pos );
+    if ( IsIdentifierStart( *pos ) == false )
+    {
+        return FailIfActive( state, "Invalid #define in '%s'", GetFileName() );
+    }
+    const char * name = pos;
+    pos = SkipIdentifier( pos, end );
+    const uint32_t nameLen = (uint32_t)( pos - name );
+
+    // when the define might not happen, the value of the macro is unknown from now on
+    if ( state != ACTIVE )
+    {
+        DefineMacro( name, nameLen )->m_Poisoned = true;
+        return true;
+    }
+
+    Macro * macro = DefineMacro( name, nameLen );
+    if ( *pos == '(' )
+    {
+        macro->m_FunctionLike = true;
+        bool valid = false;
+        pos = SkipSpaces( pos + 1 );
+        if ( *pos == ')' )
+        {
+            valid = true;
+            ++pos;
+        }
+        while ( !valid )
+        {
+            if ( ( pos[ 0 ] == '.' ) && ( pos[ 1 ] == '.' ) && ( pos[ 2 ] == '.' ) )
+            {
+                macro->m_Variadic = true;
+                macro->m_Params.Append( AStackString<>( "__VA_ARGS__" ) );
+                pos += 3;
+            }
+            else if ( IsIdentifierStart( *pos ) )
+            {
+                const char * paramEnd = SkipIdentifier( pos, end );
+                macro->m_Params.Append( AStackString<>( pos, paramEnd ) );
+                pos = SkipSpaces( paramEnd );
+                if ( ( pos[ 0 ] == '.' ) && ( pos[ 1 ] == '.' ) && ( pos[ 2 ] == '.' ) )
+                {
+                    macro->m_Variadic = true; // GNU named variadic param
+                    pos += 3;
+                }
+            }
+            else
+            {
+                break;
+            }
+            pos = SkipSpaces( pos );
+            if ( *pos == ')' )
+            {
+                valid = true;
+                ++pos;
+            }
+            else if ( ( *pos != ',' ) || macro->m_Variadic )
+            {
+                break;
+            }
+            else
+            {
+                pos = SkipSpaces( pos + 1 );
+            }
+        }
+        if ( valid == false )
+        {
+            UndefineMacro( name, nameLen );
+            return Fail( "Invalid #define in '%s'", GetFileName() );
+        }
+    }
+
+    // body
+    pos = SkipSpaces( pos );
+    const char * bodyEnd = end;
+    while ( ( bodyEnd > pos ) && IsSpace( bodyEnd[ -1 ] ) )
+    {
+        --bodyEnd;
+    }
+    macro->m_Body.Assign( pos, bodyEnd );
+    Tokenize( macro->m_Body.Get(), macro->m_Body.GetEnd(), macro->m_Tokens );
+    for ( Token & token : macro->m_Tokens )
+    {
+        if ( token.Is( "##" ) )
+        {
+            token.m_Type = TOKEN_PASTE;
+        }
+    }
+    return true;
+}
+
+// ProcessUndef
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessUndef( const char * pos, State state )
+{
+    pos = SkipSpaces( pos );
+    if ( IsIdentifierStart( *pos ) == false )
+    {
+        return FailIfActive( state, "Invalid #undef in '%s'", GetFileName() );
+    }
+    const char * name = pos;
+    const uint32_t nameLen = (uint32_t)( SkipIdentifier( pos, m_Line.GetEnd() ) - name );
+    if ( state == ACTIVE )
+    {
+        UndefineMacro( name, nameLen );
+    }
+    else
+    {
+        DefineMacro( name, nameLen )->m_Poisoned = true;
+    }
+    return true;
+}
+
+// ProcessPragma
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessPragma( const char * pos, State state )
+{
+    (void)state;
+
+    pos = SkipSpaces( pos );
+    const char * word = pos;
+    pos = SkipIdentifier( pos, m_Line.GetEnd() );
+    const size_t wordLen = (size_t)( pos - word );
+    if ( IsWord( word, wordLen, "once" ) )
+    {
+        m_Contexts.Top().m_File->m_Once = true;
+    }
+    else if ( IsWord( word, wordLen, "pop_macro" ) )
+    {
+        // the restored value isn't tracked
+        const char * name = strchr( pos, '"' );
+        const char * nameEnd = name ? strchr( name + 1, '"' ) : nullptr;
+        if ( nameEnd )
+        {
+            DefineMacro( name + 1, (uint32_t)( nameEnd - name - 1 ) )->m_Poisoned = true;
+        }
+    }
+    return true;
+}
+
+// ProcessCondition
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ProcessCondition( const char * directive, uint32_t directiveLen, const char * pos, State state )
+{
+    if ( IsWord( directive, directiveLen, "if" ) ||
+         IsWord( directive, directiveLen, "ifdef" ) ||
+         IsWord( directive, directiveLen, "ifndef" ) )
+    {
+        Condition condition;
+        condition.m_State = INACTIVE;
+        condition.m_ParentState = state;
+        condition.m_TakenKnown = false;
+        condition.m_TakenMaybe = false;
+        condition.m_SeenElse = false;
+        if ( state != INACTIVE )
+        {
+            Truth truth = IS_UNKNOWN;
+            if ( EvaluateCondition( directive, directiveLen, pos, state, truth ) == false )
+            {
+                return false;
+            }
+            ApplyBranch( condition, truth );
+        }
+        m_Conditions.Append( condition );
+        return true;
+    }
+
+    // #elif, #else and #endif must match an #if in the same file
+    if ( m_Conditions.GetSize() <= m_Contexts.Top().m_ConditionBase )
+    {
+        return FailIfActive( state, "#%.*s without #if in '%s'", (int)directiveLen, directive, GetFileName() );
+    }
+    Condition & condition = m_Conditions.Top();
+    if ( IsWord( directive, directiveLen, "endif" ) )
+    {
+        m_Conditions.Pop();
+        return true;
+    }
+    if ( condition.m_SeenElse )
+    {
+        return FailIfActive( condition.m_ParentState, "#%.*s after #else in '%s'", (int)directiveLen, directive, GetFileName() );
+    }
+    if ( IsWord( directive, directiveLen, "else" ) )
+    {
+        condition.m_SeenElse = true;
+        ApplyBranch( condition, IS_TRUE );
+        return true;
+    }
+
+    // #elif, #elifdef, #elifndef
+    if ( ( condition.m_ParentState == INACTIVE ) || condition.m_TakenKnown )
+    {
+        condition.m_State = INACTIVE;
+        return true;
+    }
+    const State errorState = ( ( condition.m_ParentState == ACTIVE ) && ( condition.m_TakenMaybe == false ) ) ? ACTIVE : UNCERTAIN;
+    Truth truth = IS_UNKNOWN;
+    if ( EvaluateCondition( directive, directiveLen, pos, errorState, truth ) == false )
+    {
+        return false;
+    }
+    ApplyBranch( m_Conditions.Top(), truth );
+    return true;
+}
+
+// EnterFile
+//------------------------------------------------------------------------------
+void CIncludeScanner::EnterFile( File * file, int32_t dirIndex, State state )
+{
+    RecordInclude( file );
+
+    Context context;
+    context.m_File = file;
+    context.m_Pos = file->m_Contents.Get();
+    context.m_DirIndex = dirIndex;
+    context.m_ConditionBase = (uint32_t)m_Conditions.GetSize();
+    context.m_State = state;
+    context.m_SeenDirective = false;
+    context.m_GuardPossible = true;
+    context.m_GuardClosed = false;
+    context.m_GuardCondition = (uint32_t)-1;
+    m_Contexts.Append( context );
+}
+
+// RecordInclude
+//------------------------------------------------------------------------------
+void CIncludeScanner::RecordInclude( File * file )
+{
+    if ( file->m_Included == false )
+    {
+        file->m_Included = true;
+        m_Includes.Append( file->m_Path );
+    }
+}
+
+// LeaveFile
+//------------------------------------------------------------------------------
+bool CIncludeScanner::LeaveFile()
+{
+    Context & context = m_Contexts.Top();
+    if ( m_Conditions.GetSize() > context.m_ConditionBase )
+    {
+        if ( context.m_State == ACTIVE )
+        {
+            return Fail( "Unterminated #if in '%s'", context.m_File->m_Path.Get() );
+        }
+        m_Conditions.SetSize( context.m_ConditionBase );
+    }
+    if ( context.m_GuardPossible && context.m_GuardClosed && context.m_File->m_Guard.IsEmpty() )
+    {
+        context.m_File->m_Guard = context.m_GuardName;
+    }
+    m_Contexts.Pop();
+    return true;
+}
+
+// GetState
+//------------------------------------------------------------------------------
+CIncludeScanner::State CIncludeScanner::GetState() const
+{
+    const Context & context = m_Contexts.Top();
+    if ( m_Conditions.GetSize() > context.m_ConditionBase )
+    {
+        return m_Conditions.Top().m_State;
+    }
+    return context.m_State;
+}
+
+// GetFileName
+//------------------------------------------------------------------------------
+const char * CIncludeScanner::GetFileName() const
+{
+    return m_Contexts.IsEmpty() ? "<command line>" : m_Contexts.Top().m_File->m_Path.Get();
+}
+
+// EvaluateCondition
+//------------------------------------------------------------------------------
+bool CIncludeScanner::EvaluateCondition( const char * directive, uint32_t directiveLen, const char * pos, State errorState, Truth & outTruth )
+{
+    const bool isIfdef = IsWord( directive, directiveLen, "ifdef" ) || IsWord( directive, directiveLen, "elifdef" );
+    const bool isIfndef = IsWord( directive, directiveLen, "ifndef" ) || IsWord( directive, directiveLen, "elifndef" );
+    if ( isIfdef || isIfndef )
+    {
+        pos = SkipSpaces( pos );
+        if ( IsIdentifierStart( *pos ) == false )
+        {
+            outTruth = IS_UNKNOWN;
+            return FailIfActive( errorState, "Invalid #%.*s in '%s'", (int)directiveLen, directive, GetFileName() );
+        }
+        const Truth truth = IsDefined( pos, (uint32_t)( SkipIdentifier( pos, m_Line.GetEnd() ) - pos ) );
+        outTruth = ( isIfdef || ( truth == IS_UNKNOWN ) ) ? truth : ( truth == IS_TRUE ) ? IS_FALSE : IS_TRUE;
+        return true;
+    }
+
+    if ( Evaluate( pos, outTruth ) )
+    {
+        return true;
+    }
+    if ( errorState == ACTIVE )
+    {
+        return false;
+    }
+    m_Error.Clear(); // only an error if the compiler sees it
+    outTruth = IS_UNKNOWN;
+    return true;
+}
+
+// Evaluate
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Evaluate( const char * pos, Truth & outTruth )
+{
+    Array< Token > tokens( 64, true );
+    Tokenize( pos, m_Line.GetEnd(), tokens );
+    if ( ExpandTokens( tokens, true ) == false )
+    {
+        return false;
+    }
+    Expression expression( tokens, m_IsCPlusPlus, m_CharIsUnsigned );
+    if ( expression.Evaluate( outTruth ) == false )
+    {
+        return Fail( "Unable to evaluate #if in '%s'", GetFileName() );
+    }
+    return true;
+}
+
+// IsDefined
+//------------------------------------------------------------------------------
+CIncludeScanner::Truth CIncludeScanner::IsDefined( const char * name, uint32_t nameLen ) const
+{
+    const Macro * macro = FindMacro( name, nameLen );
+    if ( macro )
+    {
+        return macro->m_Poisoned ? IS_UNKNOWN : IS_TRUE;
+    }
+    if ( IsDynamicMacro( name, nameLen ) ||
+         IsWord( name, nameLen, "__has_include" ) ||
+         IsWord( name, nameLen, "__has_include_next" ) )
+    {
+        return IS_TRUE;
+    }
+    // other feature checking macros vary between compiler versions
+    if ( ( nameLen > 6 ) && ( memcmp( name, "__has_", 6 ) == 0 ) )
+    {
+        return IS_UNKNOWN;
+    }
+    return IS_FALSE;
+}
+
+// ApplyBranch
+//------------------------------------------------------------------------------
+/*static*/ void CIncludeScanner::ApplyBranch( Condition & condition, Truth truth )
+{
+    if ( ( condition.m_ParentState == INACTIVE ) || condition.m_TakenKnown || ( truth == IS_FALSE ) )
+    {
+        condition.m_State = INACTIVE;
+        return;
+    }
+
+    // only certain if no earlier branch might have been taken
+    const bool certain = ( truth == IS_TRUE ) && ( condition.m_TakenMaybe == false ) && ( condition.m_ParentState == ACTIVE );
+    condition.m_State = certain ? ACTIVE : UNCERTAIN;
+    if ( truth == IS_TRUE )
+    {
+        condition.m_TakenKnown = true;
+    }
+    else
+    {
+        condition.m_TakenMaybe = true;
+    }
+}
+
+// ExpandTokens
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ExpandTokens( Array< Token > & tokens, bool inCondition )
+{
+    if ( m_ExpandDepth >= MAX_EXPAND_DEPTH )
+    {
+        return Fail( "Macro arguments nested too deeply in '%s'", GetFileName() );
+    }
+
+    // tokens are consumed from the end of a reversed copy, so the result of each
+    // expansion can be pushed back to be rescanned with the tokens following it
+    Array< Token > pending( tokens.GetSize() + 16, true );
+    for ( size_t i = tokens.GetSize(); i > 0; --i )
+    {
+        pending.Append( tokens[ i - 1 ] );
+    }
+    tokens.Clear();
+
+    ++m_ExpandDepth;
+    Array< Token > argTokens( 0, true );
+    Array< uint32_t > argStarts( 0, true );
+    Array< Token > expansion( 0, true );
+    bool ok = true;
+    while ( ok && ( pending.IsEmpty() == false ) )
+    {
+        Token token = pending.Top();
+        pending.Pop();
+        if ( ( token.m_Type != TOKEN_IDENTIFIER ) || token.m_NoExpand )
+        {
+            tokens.Append( token );
+            continue;
+        }
+
+        if ( inCondition )
+        {
+            if ( token.Is( "defined" ) )
+            {
+                ok = ExpandDefined( pending, tokens );
+                continue;
+            }
+            if ( token.Is( "__has_include" ) || token.Is( "__has_include__" ) ||
+                 token.Is( "__has_include_next" ) || token.Is( "__has_include_next__" ) )
+            {
+                ok = ExpandHasInclude( token, pending, tokens );
+                continue;
+            }
+        }
+
+        const Macro * macro = FindMacro( token.m_Text, token.m_Length );
+        const bool isCall = ( pending.IsEmpty() == false ) && pending.Top().IsPunctuator( '(' );
+        if ( macro == nullptr )
+        {
+            // builtins only the compiler knows the value of (__LINE__, __has_builtin( x ) etc)
+            if ( inCondition && ( isCall || IsDynamicMacro( token.m_Text, token.m_Length ) ) )
+            {
+                if ( isCall && ( SkipArguments( pending ) == false ) )
+                {
+                    ok = Fail( "Unterminated argument list invoking '%.*s' in '%s'", (int)token.m_Length, token.m_Text, GetFileName() );
+                    continue;
+                }
+                tokens.Append( MakeTruthToken( IS_UNKNOWN ) );
+                continue;
+            }
+            tokens.Append( token );
+            continue;
+        }
+        if ( macro->m_Poisoned )
+        {
+            if ( isCall && ( SkipArguments( pending ) == false ) )
+            {
+                ok = Fail( "Unterminated argument list invoking '%s' in '%s'", macro->m_Name.Get(), GetFileName() );
+                continue;
+            }
+            tokens.Append( MakeTruthToken( IS_UNKNOWN ) );
+            continue;
+        }
+        if ( IsHidden( token.m_HideSet, macro ) )
+        {
+            token.m_NoExpand = true;
+            tokens.Append( token );
+            continue;
+        }
+        if ( macro->m_FunctionLike && ( isCall == false ) )
+        {
+            tokens.Append( token );
+            continue;
+        }
+        if ( ++m_NumExpansions > MAX_EXPANSIONS )
+        {
+            ok = Fail( "Too many macro expansions in '%s'", GetFileName() );
+            continue;
+        }
+
+        argTokens.Clear();
+        argStarts.Clear();
+        expansion.Clear();
+        if ( macro->m_FunctionLike && ( CollectArguments( macro, pending, argTokens, argStarts ) == false ) )
+        {
+            ok = false;
+            continue;
+        }
+        if ( Substitute( macro, token, argTokens, argStarts, inCondition, expansion ) == false )
+        {
+            ok = false;
+            continue;
+        }
+        for ( size_t i = expansion.GetSize(); i > 0; --i )
+        {
+            pending.Append( expansion[ i - 1 ] );
+        }
+    }
+    --m_ExpandDepth;
+    return ok;
+}
+
+// ExpandDefined
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ExpandDefined( Array< Token > & pending, Array< Token > & output )
+{
+    // defined X or defined( X )
+    bool paren = false;
+    if ( ( pending.IsEmpty() == false ) && pending.Top().IsPunctuator( '(' ) )
+    {
+        paren = true;
+        pending.Pop();
+    }
+    if ( pending.IsEmpty() || ( pending.Top().m_Type != TOKEN_IDENTIFIER ) )
+    {
+        return Fail( "Invalid use of 'defined' in '%s'", GetFileName() );
+    }
+    const Token name = pending.Top();
+    pending.Pop();
+    if ( paren )
+    {
+        if ( pending.IsEmpty() || ( pending.Top().IsPunctuator( ')' ) == false ) )
+        {
+            return Fail( "Invalid use of 'defined' in '%s'", GetFileName() );
+        }
+        pending.Pop();
+    }
+    output.Append( MakeTruthToken( IsDefined( name.m_Text, name.m_Length ) ) );
+    return true;
+}
+
+// ExpandHasInclude
+//------------------------------------------------------------------------------
+bool CIncludeScanner::ExpandHasInclude( const Token & name, Array< Token > & pending, Array< Token > & output )
+{
+    if ( pending.IsEmpty() || ( pending.Top().IsPunctuator( '(' ) == false ) )
+    {
+        return Fail( "Invalid use of '%.*s' in '%s'", (int)name.m_Length, name.m_Text, GetFileName() );
+    }
+    pending.Pop();
+
+    Array< Token > operand( 8, true );
+    uint32_t depth = 0;
+    for ( ;; )
+    {
+        if ( pending.IsEmpty() )
+        {
+            return Fail( "Invalid use of '%.*s' in '%s'", (int)name.m_Length, name.m_Text, GetFileName() );
+        }
+        const Token token = pending.Top();
+        pending.Pop();
+        if ( token.IsPunctuator( ')' ) )
+        {
+            if ( depth == 0 )
+            {
+                break;
+            }
+            --depth;
+        }
+        else if ( token.IsPunctuator( '(' ) )
+        {
+            ++depth;
+        }
+        operand.Append( token );
+    }
+
+    // operand is a header name or macros expanding to one
+    if ( ( operand.IsEmpty() == false ) && ( operand[ 0 ].m_Type != TOKEN_STRING ) && ( operand[ 0 ].IsPunctuator( '<' ) == false ) )
+    {
+        if ( ExpandTokens( operand, false ) == false )
+        {
+            return false;
+        }
+    }
+    for ( const Token & token : operand )
+    {
+        if ( token.m_Type == TOKEN_UNKNOWN )
+        {
+            output.Append( MakeTruthToken( IS_UNKNOWN ) );
+            return true;
+        }
+    }
+
+    AStackString<> includeName;
+    bool angled = false;
+    if ( GetIncludeName( operand, includeName, angled ) == false )
+    {
+        return Fail( "Invalid use of '%.*s' in '%s'", (int)name.m_Length, name.m_Text, GetFileName() );
+    }
+    const bool isNext = name.Is( "__has_include_next" ) || name.Is( "__has_include_next__" );
+    int32_t dirIndex = DIR_NONE;
+    output.Append( MakeTruthToken( FindIncludeFile( includeName, angled, isNext, dirIndex ) ? IS_TRUE : IS_FALSE ) );
+    return true;
+}
+
+// CollectArguments
+//------------------------------------------------------------------------------
+bool CIncludeScanner::CollectArguments( const Macro * macro, Array< Token > & pending, Array< Token > & argTokens, Array< uint32_t > & argStarts )
+{
+    pending.Pop(); // (
+
+    const size_t numParams = macro->m_Params.GetSize();
+    argStarts.Append( 0 );
+    uint32_t depth = 0;
+    for ( ;; )
+    {
+        if ( pending.IsEmpty() )
+        {
+            return Fail( "Unterminated argument list invoking '%s' in '%s'", macro->m_Name.Get(), GetFileName() );
+        }
+        const Token token = pending.Top();
+        pending.Pop();
+        if ( token.IsPunctuator( ')' ) )
+        {
+            if ( depth == 0 )
+            {
+                break;
+            }
+            --depth;
+        }
+        else if ( token.IsPunctuator( '(' ) )
+        {
+            ++depth;
+        }
+        else if ( token.IsPunctuator( ',' ) && ( depth == 0 ) )
+        {
+            // extra args are part of the variadic arg
+            if ( ( macro->m_Variadic == false ) || ( argStarts.GetSize() < numParams ) )
+            {
+                argStarts.Append( (uint32_t)argTokens.GetSize() );
+                continue;
+            }
+        }
+        argTokens.Append( token );
+    }
+
+    if ( ( numParams == 0 ) && ( argStarts.GetSize() == 1 ) && argTokens.IsEmpty() )
+    {
+        argStarts.Clear(); // MACRO()
+        return true;
+    }
+    if ( macro->m_Variadic && ( argStarts.GetSize() + 1 == numParams ) )
+    {
+        argStarts.Append( (uint32_t)argTokens.GetSize() ); // variadic arg omitted
+    }
+    if ( argStarts.GetSize() != numParams )
+    {
+        return Fail( "Wrong number of arguments invoking '%s' in '%s'", macro->m_Name.Get(), GetFileName() );
+    }
+    return true;
+}
+
+// Substitute
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Substitute( const Macro * macro, const Token & name, const Array< Token > & argTokens, const Array< uint32_t > & argStarts, bool inCondition, Array< Token > & output )
+{
+    const Token * const body = macro->m_Tokens.Begin();
+    const size_t numBody = macro->m_Tokens.GetSize();
+    bool hasPaste = false;
+    size_t vaOptClose = (size_t)-1; // closing paren of __VA_OPT__( ... ) being substituted
+
+    for ( size_t i = 0; i < numBody; ++i )
+    {
+        const Token & token = body[ i ];
+        if ( i == vaOptClose )
+        {
+            continue;
+        }
+        if ( token.m_Type == TOKEN_PASTE )
+        {
+            hasPaste = true;
+            output.Append( token );
+            continue;
+        }
+        if ( macro->m_FunctionLike == false )
+        {
+            output.Append( token );
+            continue;
+        }
+
+        // # param
+        if ( token.IsPunctuator( '#' ) && ( i + 1 < numBody ) )
+        {
+            const int32_t param = FindParam( macro, body[ i + 1 ] );
+            if ( param >= 0 )
+            {
+                Token str = Stringize( argTokens.Begin() + argStarts[ (size_t)param ],
+                                       argTokens.Begin() + GetArgEnd( argStarts, argTokens.GetSize(), (size_t)param ) );
+                str.m_LeadingSpace = token.m_LeadingSpace;
+                output.Append( str );
+                ++i;
+                continue;
+            }
+        }
+
+        // __VA_OPT__( ... ) is only substituted when the variadic arg is not empty
+        if ( macro->m_Variadic && token.Is( "__VA_OPT__" ) && ( i + 1 < numBody ) && body[ i + 1 ].IsPunctuator( '(' ) )
+        {
+            size_t close = i + 2;
+            uint32_t depth = 0;
+            for ( ; close < numBody; ++close )
+            {
+                if ( body[ close ].IsPunctuator( '(' ) )
+                {
+                    ++depth;
+                }
+                else if ( body[ close ].IsPunctuator( ')' ) )
+                {
+                    if ( depth == 0 )
+                    {
+                        break;
+                    }
+                    --depth;
+                }
+            }
+            if ( close == numBody )
+            {
+                return Fail( "Unterminated __VA_OPT__ in '%s'", macro->m_Name.Get() );
+            }
+            const size_t va = argStarts.GetSize() - 1;
+            if ( argStarts[ va ] == GetArgEnd( argStarts, argTokens.GetSize(), va ) )
+            {
+                output.Append( MakeToken( "", 0, TOKEN_PLACEMARKER ) );
+                i = close;
+            }
+            else
+            {
+                vaOptClose = close;
+                ++i;
+            }
+            continue;
+        }
+
+        // param
+        const int32_t param = FindParam( macro, token );
+        if ( param < 0 )
+        {
+            output.Append( token );
+            continue;
+        }
+        const Token * argBegin = argTokens.Begin() + argStarts[ (size_t)param ];
+        const Token * argEnd = argTokens.Begin() + GetArgEnd( argStarts, argTokens.GetSize(), (size_t)param );
+        const bool nextToPaste = ( ( i > 0 ) && ( body[ i - 1 ].m_Type == TOKEN_PASTE ) ) ||
+                                 ( ( i + 1 < numBody ) && ( body[ i + 1 ].m_Type == TOKEN_PASTE ) );
+        const size_t first = output.GetSize();
+        if ( argBegin == argEnd )
+        {
+            if ( nextToPaste )
+            {
+                output.Append( MakeToken( "", 0, TOKEN_PLACEMARKER ) );
+            }
+            continue;
+        }
+        if ( nextToPaste )
+        {
+            output.Append( argBegin, argEnd );
+        }
+        else
+        {
+            // args are fully expanded before substitution
+            Array< Token > expanded( argBegin, argEnd );
+            if ( ExpandTokens( expanded, inCondition ) == false )
+            {
+                return false;
+            }
+            output.Append( expanded );
+        }
+        if ( output.GetSize() > first )
+        {
+            output[ first ].m_LeadingSpace = token.m_LeadingSpace;
+        }
+    }
+
+    // ##
+    if ( hasPaste )
+    {
+        Array< Token > pasted( output.GetSize(), true );
+        for ( size_t i = 0; i < output.GetSize(); ++i )
+        {
+            if ( output[ i ].m_Type != TOKEN_PASTE )
+            {
+                pasted.Append( output[ i ] );
+                continue;
+            }
+            if ( pasted.IsEmpty() || ( i + 1 == output.GetSize() ) )
+            {
+                continue; // ## at start or end is an error in the #define
+            }
+            const Token left = pasted.Top();
+            pasted.Pop();
+            ++i;
+            Paste( left, output[ i ], pasted );
+        }
+        output.Swap( pasted );
+    }
+
+    // remove placemarkers, and prevent recursive expansion of this macro
+    const uint32_t hideSet = AddToHideSet( name.m_HideSet, macro );
+    size_t numOut = 0;
+    for ( size_t i = 0; i < output.GetSize(); ++i )
+    {
+        Token token = output[ i ];
+        if ( token.m_Type == TOKEN_PLACEMARKER )
+        {
+            continue;
+        }
+        token.m_HideSet = MergeHideSets( token.m_HideSet, hideSet );
+        output[ numOut++ ] = token;
+    }
+    output.SetSize( numOut );
+    if ( numOut > 0 )
+    {
+        output[ 0 ].m_LeadingSpace = name.m_LeadingSpace;
+    }
+    return true;
+}
+
+// Paste
+//------------------------------------------------------------------------------
+void CIncludeScanner::Paste( const Token & left, const Token & right, Array< Token > & output )
+{
+    if ( left.m_Type == TOKEN_PLACEMARKER )
+    {
+        Token token = right;
+        token.m_LeadingSpace = left.m_LeadingSpace;
+        output.Append( token );
+        return;
+    }
+    if ( right.m_Type == TOKEN_PLACEMARKER )
+    {
+        output.Append( left );
+        return;
+    }
+
+    AString * text = FNEW( AString( left.m_Length + right.m_Length ) );
+    text->Append( left.m_Text, left.m_Length );
+    text->Append( right.m_Text, right.m_Length );
+    m_Scratch.Append( text );
+
+    Array< Token > tokens( 2, true );
+    Tokenize( text->Get(), text->GetEnd(), tokens );
+    if ( tokens.GetSize() == 1 )
+    {
+        Token token = tokens[ 0 ];
+        token.m_LeadingSpace = left.m_LeadingSpace;
+        output.Append( token );
+        return;
+    }
+
+    // not a valid token (an error for GCC) - leave as they were
+    output.Append( left );
+    output.Append( right );
+}
+
+// Stringize
+//------------------------------------------------------------------------------
+CIncludeScanner::Token CIncludeScanner::Stringize( const Token * begin, const Token * end )
+{
+    AString * text = FNEW( AString( 64 ) );
+    *text += '"';
+    for ( const Token * it = begin; it != end; ++it )
+    {
+        if ( ( it != begin ) && it->m_LeadingSpace )
+        {
+            *text += ' ';
+        }
+        if ( ( it->m_Type == TOKEN_STRING ) || ( it->m_Type == TOKEN_CHAR ) )
+        {
+            for ( uint32_t i = 0; i < it->m_Length; ++i )
+            {
+                const char c = it->m_Text[ i ];
+                if ( ( c == '"' ) || ( c == '\\' ) )
+                {
+                    *text += '\\';
+                }
+                *text += c;
+            }
+        }
+        else
+        {
+            text->Append( it->m_Text, it->m_Length );
+        }
+    }
+    *text += '"';
+    m_Scratch.Append( text );
+    return MakeToken( text->Get(), text->GetLength(), TOKEN_STRING );
+}
+
+// SkipArguments
+//------------------------------------------------------------------------------
+/*static*/ bool CIncludeScanner::SkipArguments( Array< Token > & pending )
+{
+    pending.Pop(); // (
+    uint32_t depth = 0;
+    while ( pending.IsEmpty() == false )
+    {
+        const Token token = pending.Top();
+        pending.Pop();
+        if ( token.IsPunctuator( '(' ) )
+        {
+            ++depth;
+        }
+        else if ( token.IsPunctuator( ')' ) )
+        {
+            if ( depth == 0 )
+            {
+                return true;
+            }
+            --depth;
+        }
+    }
+    return false;
+}
+
+// FindParam
+//------------------------------------------------------------------------------
+/*static*/ int32_t CIncludeScanner::FindParam( const Macro * macro, const Token & token )
+{
+    if ( token.m_Type != TOKEN_IDENTIFIER )
+    {
+        return -1;
+    }
+    const size_t numParams = macro->m_Params.GetSize();
+    for ( size_t i = 0; i < numParams; ++i )
+    {
+        const AString & param = macro->m_Params[ i ];
+        if ( ( param.GetLength() == token.m_Length ) && ( memcmp( param.Get(), token.m_Text, token.m_Length ) == 0 ) )
+        {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+// MakeToken
+//------------------------------------------------------------------------------
+/*static*/ CIncludeScanner::Token CIncludeScanner::MakeToken( const char * text, uint32_t len, uint8_t type )
+{
+    Token token;
+    token.m_Text = text;
+    token.m_Length = len;
+    token.m_HideSet = 0;
+    token.m_Type = type;
+    token.m_LeadingSpace = true;
+    token.m_NoExpand = false;
+    return token;
+}
+
+// MakeTruthToken
+//------------------------------------------------------------------------------
+/*static*/ CIncludeScanner::Token CIncludeScanner::MakeTruthToken( Truth truth )
+{
+    switch ( truth )
+    {
+        case IS_FALSE:  return MakeToken( "0", 1, TOKEN_NUMBER );
+        case IS_TRUE:   return MakeToken( "1", 1, TOKEN_NUMBER );
+        default:        return MakeToken( "?", 1, TOKEN_UNKNOWN );
+    }
+}
+
+// IsHidden
+//------------------------------------------------------------------------------
+bool CIncludeScanner::IsHidden( uint32_t hideSet, const Macro * macro ) const
+{
+    while ( hideSet != 0 )
+    {
+        const HideSet & entry = m_HideSets[ hideSet ];
+        if ( entry.m_Macro == macro )
+        {
+            return true;
+        }
+        hideSet = entry.m_Parent;
+    }
+    return false;
+}
+
+// AddToHideSet
+//------------------------------------------------------------------------------
+uint32_t CIncludeScanner::AddToHideSet( uint32_t hideSet, const Macro * macro )
+{
+    if ( IsHidden( hideSet, macro ) )
+    {
+        return hideSet;
+    }
+    HideSet entry;
+    entry.m_Macro = macro;
+    entry.m_Parent = hideSet;
+    m_HideSets.Append( entry );
+    return (uint32_t)( m_HideSets.GetSize() - 1 );
+}
+
+// MergeHideSets
+//------------------------------------------------------------------------------
+uint32_t CIncludeScanner::MergeHideSets( uint32_t hideSet, uint32_t other )
+{
+    if ( ( hideSet == 0 ) || ( hideSet == other ) )
+    {
+        return other;
+    }
+    while ( other != 0 )
+    {
+        const HideSet entry = m_HideSets[ other ]; // copy, as AddToHideSet can re-allocate
+        hideSet = AddToHideSet( hideSet, entry.m_Macro );
+        other = entry.m_Parent;
+    }
+    return hideSet;
+}
+
+// FindMacro
+//------------------------------------------------------------------------------
+CIncludeScanner::Macro * CIncludeScanner::FindMacro( const char * name, uint32_t nameLen ) const
+{
+    const uint32_t hash = xxHash::Calc32( name, nameLen );
+    for ( Macro * macro = m_Macros[ hash & ( m_Macros.GetSize() - 1 ) ]; macro; macro = macro->m_Next )
+    {
+        if ( ( macro->m_Hash == hash ) &&
+             ( macro->m_Name.GetLength() == nameLen ) &&
+             ( memcmp( macro->m_Name.Get(), name, nameLen ) == 0 ) )
+        {
+            return macro;
+        }
+    }
+    return nullptr;
+}
+
+// DefineMacro
+//------------------------------------------------------------------------------
+CIncludeScanner::Macro * CIncludeScanner::DefineMacro( const char * name, uint32_t nameLen )
+{
+    Macro * macro = FindMacro( name, nameLen );
+    if ( macro == nullptr )
+    {
+        macro = FNEW( Macro );
+        macro->m_Hash = xxHash::Calc32( name, nameLen );
+        macro->m_Name.Assign( name, name + nameLen );
+        Insert( m_Macros, m_NumMacros, macro );
+    }
+    macro->m_FunctionLike = false;
+    macro->m_Variadic = false;
+    macro->m_Poisoned = false;
+    macro->m_Body.Clear();
+    macro->m_Tokens.Clear();
+    macro->m_Params.Clear();
+    return macro;
+}
+
+// UndefineMacro
+//------------------------------------------------------------------------------
+void CIncludeScanner::UndefineMacro( const char * name, uint32_t nameLen )
+{
+    const uint32_t hash = xxHash::Calc32( name, nameLen );
+    Macro ** link = &m_Macros[ hash & ( m_Macros.GetSize() - 1 ) ];
+    while ( *link )
+    {
+        Macro * macro = *link;
+        if ( ( macro->m_Hash == hash ) &&
+             ( macro->m_Name.GetLength() == nameLen ) &&
+             ( memcmp( macro->m_Name.Get(), name, nameLen ) == 0 ) )
+        {
+            *link = macro->m_Next;
+            FDELETE macro;
+            --m_NumMacros;
+            return;
+        }
+        link = &macro->m_Next;
+    }
+}
+
+// DefinePredefinedMacros
+//------------------------------------------------------------------------------
+bool CIncludeScanner::DefinePredefinedMacros()
+{
+    const AString & defines = m_Config.GetDefines();
+    const char * pos = defines.Get();
+    const char * const end = defines.GetEnd();
+    while ( pos < end )
+    {
+        const char * lineEnd = static_cast< const char * >( memchr( pos, '\n', (size_t)( end - pos ) ) );
+        if ( lineEnd == nullptr )
+        {
+            lineEnd = end;
+        }
+        if ( AString::StrNCmp( pos, "#define ", 8 ) == 0 )
+        {
+            m_Line.Assign( pos + 8, lineEnd );
+
+            // __has_include is handled as an operator
+            if ( ( m_Line.BeginsWith( "__has_include" ) == false ) && ( ProcessDefine( m_Line.Get(), ACTIVE ) == false ) )
+            {
+                return false;
+            }
+        }
+        else if ( AString::StrNCmp( pos, "#undef ", 7 ) == 0 )
+        {
+            m_Line.Assign( pos + 7, lineEnd );
+            if ( ProcessUndef( m_Line.Get(), ACTIVE ) == false )
+            {
+                return false;
+            }
+        }
+        pos = lineEnd + 1;
+    }
+    return true;
+}
+
+// FindIncludeFile
+//------------------------------------------------------------------------------
+CIncludeScanner::File * CIncludeScanner::FindIncludeFile( const AString & name, bool angled, bool isNext, int32_t & outDirIndex )
+{
+    outDirIndex = DIR_NONE;
+    if ( PathUtils::IsFullPath( name ) )
+    {
+        return LoadFile( name );
+    }
+
+    const Context * includer = m_Contexts.IsEmpty() ? nullptr : &m_Contexts.Top();
+    size_t start = angled ? m_Config.GetNumQuoteIncludePaths() : 0;
+    if ( isNext && includer && ( includer->m_DirIndex != DIR_MAIN ) )
+    {
+        // continue searching after the path the current file was found in
+        start = ( includer->m_DirIndex == DIR_NONE ) ? 0 : (size_t)( includer->m_DirIndex + 1 );
+    }
+    else if ( angled == false )
+    {
+        // relative to the current file (or the working dir for forced includes)
+        AStackString<> path;
+        if ( includer )
+        {
+            const AString & includerPath = includer->m_File->m_Path;
+            const char * lastSlash = includerPath.FindLast( NATIVE_SLASH );
+            if ( lastSlash )
+            {
+                path.Assign( includerPath.Get(), lastSlash + 1 );
+            }
+        }
+        path += name;
+        File * file = LoadFile( path );
+        if ( file )
+        {
+            return file;
+        }
+    }
+
+    const Array< AString > & includePaths = m_Config.GetIncludePaths();
+    AStackString<> path;
+    for ( size_t i = start; i < includePaths.GetSize(); ++i )
+    {
+        path = includePaths[ i ];
+        if ( ( path.EndsWith( NATIVE_SLASH ) == false ) && ( path.EndsWith( OTHER_SLASH ) == false ) )
+        {
+            path += NATIVE_SLASH;
+        }
+        path += name;
+        File * file = LoadFile( path );
+        if ( file )
+        {
+            outDirIndex = (int32_t)i;
+            return file;
+        }
+    }
+    return nullptr;
+}
+
+// LoadFile
+//------------------------------------------------------------------------------
+CIncludeScanner::File * CIncludeScanner::LoadFile( const AString & fileName )
+{
+    AStackString<> path;
+    NodeGraph::CleanPath( fileName, path );
+
+    #if defined( __WINDOWS__ ) || defined( __OSX__ )
+        // case-insensitive file systems
+        AStackString<> lowerPath( path );
+        lowerPath.ToLower();
+        const uint32_t hash = xxHash::Calc32( lowerPath );
+    #else
+        const uint32_t hash = xxHash::Calc32( path );
+    #endif
+
+    for ( File * file = m_Files[ hash & ( m_Files.GetSize() - 1 ) ]; file; file = file->m_Next )
+    {
+        #if defined( __WINDOWS__ ) || defined( __OSX__ )
+            const bool match = ( file->m_Hash == hash ) && file->m_Path.EqualsI( path );
+        #else
+            const bool match = ( file->m_Hash == hash ) && ( file->m_Path == path );
+        #endif
+        if ( match )
+        {
+            return file->m_Exists ? file : nullptr;
+        }
+    }
+
+    File * file = FNEW( File );
+    file->m_Hash = hash;
+    file->m_Once = false;
+    file->m_Included = false;
+    file->m_Path = path;
+    file->m_Exists = ReadFile( path, file->m_Contents );
+    Insert( m_Files, m_NumFiles, file );
+    return file->m_Exists ? file : nullptr;
+}
+
+// ReadFile
+//------------------------------------------------------------------------------
+/*static*/ bool CIncludeScanner::ReadFile( const AString & fileName, AString & outContents )
+{
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const uint32_t size = (uint32_t)f.GetFileSize();
+    outContents.SetLength( size );
+    if ( f.Read( outContents.Get(), size ) != size )
+    {
+        return false;
+    }
+
+    // remove line continuations (backslash newline) in place
+    char * dst = static_cast< char * >( memchr( outContents.Get(), '\\', size ) );
+    if ( dst == nullptr )
+    {
+        return true;
+    }
+    const char * src = dst;
+    const char * const end = outContents.GetEnd();
+    while ( src < end )
+    {
+        if ( *src == '\\' )
+        {
+            const char * next = src + 1;
+            while ( ( next < end ) && ( ( *next == ' ' ) || ( *next == '\t' ) || ( *next == '\r' ) ) )
+            {
+                ++next;
+            }
+            if ( ( next < end ) && ( *next == '\n' ) )
+            {
+                src = next + 1;
+                continue;
+            }
+        }
+        *dst++ = *src++;
+    }
+    outContents.SetLength( (uint32_t)( dst - outContents.Get() ) );
+    return true;
+}
+
+// GetIncludeName
+//------------------------------------------------------------------------------
+/*static*/ bool CIncludeScanner::GetIncludeName( const Array< Token > & tokens, AString & outName, bool & outAngled )
+{
+    if ( tokens.IsEmpty() )
+    {
+        return false;
+    }
+
+    // "name"
+    const Token & first = tokens[ 0 ];
+    if ( ( first.m_Type == TOKEN_STRING ) && ( first.m_Text[ 0 ] == '"' ) )
+    {
+        if ( ( first.m_Length < 2 ) || ( first.m_Text[ first.m_Length - 1 ] != '"' ) )
+        {
+            return false;
+        }
+        outName.Assign( first.m_Text + 1, first.m_Text + first.m_Length - 1 );
+        outAngled = false;
+        return ( outName.IsEmpty() == false );
+    }
+
+    // < name >, which is made of the spelling of the tokens in between
+    if ( first.IsPunctuator( '<' ) == false )
+    {
+        return false;
+    }
+    outName.Clear();
+    for ( size_t i = 1; i < tokens.GetSize(); ++i )
+    {
+        const Token & token = tokens[ i ];
+        if ( token.IsPunctuator( '>' ) )
+        {
+            outAngled = true;
+            return ( outName.IsEmpty() == false );
+        }
+        if ( token.m_LeadingSpace && ( i > 1 ) )
+        {
+            outName += ' ';
+        }
+        outName.Append( token.m_Text, token.m_Length );
+    }
+    return false;
+}
+
+// FindDirective
+//------------------------------------------------------------------------------
+/*static*/ const char * CIncludeScanner::FindDirective( const char * pos, const char * end, bool & outSawCode )
+{
+    // Returns the position after the next '#' which starts a line, skipping
+    // comments and literals (which can contain '#')
+    bool startOfLine = true;
+    while ( pos < end )
+    {
+        const char c = *pos;
+        if ( c == '\n' )
+        {
+            startOfLine = true;
+            ++pos;
+            continue;
+        }
+        if ( IsSpace( c ) )
+        {
+            ++pos;
+            continue;
+        }
+        if ( c == '/' )
+        {
+            if ( pos[ 1 ] == '/' )
+            {
+                pos = static_cast< const char * >( memchr( pos, '\n', (size_t)( end - pos ) ) );
+                if ( pos == nullptr )
+                {
+                    return nullptr;
+                }
+                continue;
+            }
+            if ( pos[ 1 ] == '*' )
+            {
+                const char * commentEnd = strstr( pos + 2, "*/" );
+                if ( commentEnd == nullptr )
+                {
+                    return nullptr;
+                }
+                pos = commentEnd + 2;
+                continue;
+            }
+        }
+        else if ( c == '#' )
+        {
+            if ( startOfLine )
+            {
+                return pos + 1;
+            }
+        }
+        else if ( ( c == '"' ) || ( c == '\'' ) )
+        {
+            pos = SkipLiteral( pos, end );
+            outSawCode = true;
+            startOfLine = false;
+            continue;
+        }
+        else if ( IsDigit( c ) )
+        {
+            pos = SkipNumber( pos, end );
+            outSawCode = true;
+            startOfLine = false;
+            continue;
+        }
+        else if ( IsIdentifierStart( c ) )
+        {
+            const char * start = pos;
+            pos = SkipIdentifier( pos, end );
+            if ( ( pos < end ) && ( *pos == '"' ) && IsRawStringPrefix( start, pos ) )
+            {
+                const char * rawEnd = SkipRawString( pos, end );
+                if ( rawEnd )
+                {
+                    pos = rawEnd;
+                }
+            }
+            outSawCode = true;
+            startOfLine = false;
+            continue;
+        }
+
+        // anything else
+        outSawCode = true;
+        startOfLine = false;
+        ++pos;
+    }
+    return nullptr;
+}
+
+// ReadDirective
+//------------------------------------------------------------------------------
+/*static*/ const char * CIncludeScanner::ReadDirective( const char * pos, const char * end, AString & outLine )
+{
+    // Copy the rest of the directive, replacing comments with a space, and
+    // return the start of the next line
+    outLine.Clear();
+    const char * copyFrom = pos;
+    while ( pos < end )
+    {
+        const char c = *pos;
+        if ( c == '\n' )
+        {
+            break;
+        }
+        if ( ( c == '/' ) && ( pos[ 1 ] == '/' ) )
+        {
+            outLine.Append( copyFrom, (size_t)( pos - copyFrom ) );
+            pos = static_cast< const char * >( memchr( pos, '\n', (size_t)( end - pos ) ) );
+            if ( pos == nullptr )
+            {
+                pos = end;
+            }
+            copyFrom = pos;
+            break;
+        }
+        if ( ( c == '/' ) && ( pos[ 1 ] == '*' ) )
+        {
+            outLine.Append( copyFrom, (size_t)( pos - copyFrom ) );
+            outLine += ' ';
+            const char * commentEnd = strstr( pos + 2, "*/" );
+            pos = commentEnd ? ( commentEnd + 2 ) : end;
+            copyFrom = pos;
+            continue;
+        }
+        if ( IsIdentifierStart( c ) )
+        {
+            pos = SkipIdentifier( pos, end );
+            continue;
+        }
+        if ( IsDigit( c ) )
+        {
+            pos = SkipNumber( pos, end ); // can contain ' digit separators
+            continue;
+        }
+        if ( ( c == '"' ) || ( c == '\'' ) )
+        {
+            pos = SkipLiteral( pos, end );
+            continue;
+        }
+        ++pos;
+    }
+    outLine.Append( copyFrom, (size_t)( pos - copyFrom ) );
+    return ( pos < end ) ? ( pos + 1 ) : end;
+}
+
+// Tokenize
+//------------------------------------------------------------------------------
+/*static*/ void CIncludeScanner::Tokenize( const char * pos, const char * end, Array< Token > & outTokens )
+{
+    bool leadingSpace = false;
+    while ( pos < end )
+    {
+        const char c = *pos;
+        if ( IsSpace( c ) || ( c == '\n' ) )
+        {
+            leadingSpace = true;
+            ++pos;
+            continue;
+        }
+
+        Token token = MakeToken( pos, 0, TOKEN_PUNCTUATOR );
+        token.m_LeadingSpace = leadingSpace;
+        leadingSpace = false;
+        if ( IsIdentifierStart( c ) )
+        {
+            pos = SkipIdentifier( pos, end );
+            token.m_Type = TOKEN_IDENTIFIER;
+            if ( ( pos < end ) && ( ( *pos == '"' ) || ( *pos == '\'' ) ) && IsEncodingPrefix( token.m_Text, pos ) )
+            {
+                token.m_Type = ( *pos == '"' ) ? TOKEN_STRING : TOKEN_CHAR;
+                pos = SkipLiteral( pos, end );
+            }
+        }
+        else if ( IsDigit( c ) || ( ( c == '.' ) && ( pos + 1 < end ) && IsDigit( pos[ 1 ] ) ) )
+        {
+            pos = SkipNumber( pos, end );
+            token.m_Type = TOKEN_NUMBER;
+        }
+        else if ( ( c == '"' ) || ( c == '\'' ) )
+        {
+            token.m_Type = ( c == '"' ) ? TOKEN_STRING : TOKEN_CHAR;
+            pos = SkipLiteral( pos, end );
+        }
+        else
+        {
+            pos += PunctuatorLength( pos, end );
+        }
+        token.m_Length = (uint32_t)( pos - token.m_Text );
+        outTokens.Append( token );
+    }
+}
+
+// Fail
+//------------------------------------------------------------------------------
+bool CIncludeScanner::Fail( const char * fmtString, ... )
+{
+    va_list args;
+    va_start( args, fmtString );
+    m_Error.VFormat( fmtString, args );
+    va_end( args );
+    return false;
+}
+
+// FailIfActive
+//------------------------------------------------------------------------------
+bool CIncludeScanner::FailIfActive( State state, const char * fmtString, ... )
+{
+    // errors in code which might not be seen by the compiler are ignored
+    if ( state != ACTIVE )
+    {
+        return true;
+    }
+    va_list args;
+    va_start( args, fmtString );
+    m_Error.VFormat( fmtString, args );
+    va_end( args );
+    return false;
+}
+
+// Insert
+//------------------------------------------------------------------------------
+template < class T >
+/*static*/ void CIncludeScanner::Insert( Array< T * > & buckets, size_t & count, T * item )
+{
+    // grow to keep chains short
+    if ( count >= buckets.GetSize() )
+    {
+        Array< T * > oldBuckets( 0, true );
+        oldBuckets.Swap( buckets );
+        buckets.SetSize( oldBuckets.GetSize() * 2 );
+        memset( buckets.Begin(), 0, buckets.GetSize() * sizeof( T * ) );
+        const size_t mask = buckets.GetSize() - 1;
+        for ( T * chain : oldBuckets )
+        {
+            while ( chain )
+            {
+                T * next = chain->m_Next;
+                T * & bucket = buckets[ chain->m_Hash & mask ];
+                chain->m_Next = bucket;
+                bucket = chain;
+                chain = next;
+            }
+        }
+    }
+    T * & bucket = buckets[ item->m_Hash & ( buckets.GetSize() - 1 ) ];
+    item->m_Next = bucket;
+    bucket = item;
+    ++count;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,177 @@
+// CIncludeScanner - Determine the headers included by a c, cpp or h file
+//                   without running the preprocessor
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+
+// CIncludeScannerConfig
+//------------------------------------------------------------------------------
+// The state of the preprocessor before it sees the source file (predefined
+// macros, include search paths and implicitly included files) as reported by
+// GCC or Clang for a given set of args
+class CIncludeScannerConfig
+{
+public:
+    explicit CIncludeScannerConfig( uint64_t key );
+    ~CIncludeScannerConfig();
+
+    // parse the output of "<compiler> <args> -E -dD -v -H <empty file>"
+    bool ParseCompilerOutput( const char * stdOut, const char * stdErr );
+
+    inline uint64_t                 GetKey() const                  { return m_Key; }
+    inline bool                     IsValid() const                 { return m_Valid; }
+    inline const AString &          GetDefines() const              { return m_Defines; }
+    inline const Array< AString > & GetIncludePaths() const         { return m_IncludePaths; }
+    inline size_t                   GetNumQuoteIncludePaths() const { return m_NumQuoteIncludePaths; }
+    inline const Array< AString > & GetImplicitIncludes() const     { return m_ImplicitIncludes; }
+
+private:
+    uint64_t            m_Key;                  // hash of compiler and args
+    bool                m_Valid;                // compiler output was understood
+    AString             m_Defines;              // predefined macros ("#define X Y" and "#undef X" lines)
+    Array< AString >    m_IncludePaths;         // in search order, starting with paths only used for #include "..."
+    size_t              m_NumQuoteIncludePaths; // number of paths only used for #include "..."
+    Array< AString >    m_ImplicitIncludes;     // files included before the source file (stdc-predef.h etc)
+};
+
+// CIncludeScanner class
+//------------------------------------------------------------------------------
+// Evaluates only the preprocessor directives of the source file and the files
+// it includes. When a condition can't be evaluated with certainty (such as
+// __has_builtin), both branches are followed, so the includes found are always
+// a superset of those the preprocessor would find. Anything else which can't
+// be handled reliably (unresolvable #include, #error etc.) causes the scan to
+// fail, so the caller can fall back to the preprocessor.
+class CIncludeScanner
+{
+public:
+    explicit CIncludeScanner( const CIncludeScannerConfig & config );
+    ~CIncludeScanner();
+
+    bool Scan( const AString & sourceFile, const Array< AString > & forcedIncludes );
+
+    const Array< AString > & GetIncludes() const { return m_Includes; }
+
+    // take ownership of includes array to avoid re-allocations
+    void SwapIncludes( Array< AString > & includes );
+
+    // reason the scan failed
+    inline const AString & GetError() const { return m_Error; }
+
+private:
+    struct Token;
+    struct Macro;
+    struct File;
+    struct Context;
+    struct Condition;
+    struct HideSet;
+    class Expression;
+
+    // State of a region of code
+    enum State : uint8_t
+    {
+        ACTIVE,     // will be seen by the compiler
+        UNCERTAIN,  // might be seen by the compiler
+        INACTIVE    // will not be seen by the compiler
+    };
+
+    // Result of a condition
+    enum Truth : uint8_t
+    {
+        IS_FALSE,
+        IS_TRUE,
+        IS_UNKNOWN
+    };
+
+    // File processing
+    bool ProcessFiles();
+    bool ProcessDirective( Context & context );
+    bool ProcessInclude( const char * pos, bool isNext, bool isImport, State state );
+    bool ProcessDefine( const char * pos, State state );
+    bool ProcessUndef( const char * pos, State state );
+    bool ProcessPragma( const char * pos, State state );
+    bool ProcessCondition( const char * directive, uint32_t directiveLen, const char * pos, State state );
+    void EnterFile( File * file, int32_t dirIndex, State state );
+    void RecordInclude( File * file );
+    bool LeaveFile();
+    State GetState() const;
+    const char * GetFileName() const;
+
+    // Conditions
+    bool EvaluateCondition( const char * directive, uint32_t directiveLen, const char * pos, State errorState, Truth & outTruth );
+    bool Evaluate( const char * pos, Truth & outTruth );
+    Truth IsDefined( const char * name, uint32_t nameLen ) const;
+    static void ApplyBranch( Condition & condition, Truth truth );
+
+    // Macro expansion
+    bool ExpandTokens( Array< Token > & tokens, bool inCondition );
+    bool ExpandDefined( Array< Token > & pending, Array< Token > & output );
+    bool ExpandHasInclude( const Token & name, Array< Token > & pending, Array< Token > & output );
+    bool CollectArguments( const Macro * macro, Array< Token > & pending, Array< Token > & argTokens, Array< uint32_t > & argStarts );
+    bool Substitute( const Macro * macro, const Token & name, const Array< Token > & argTokens, const Array< uint32_t > & argStarts, bool inCondition, Array< Token > & output );
+    void Paste( const Token & left, const Token & right, Array< Token > & output );
+    Token Stringize( const Token * begin, const Token * end );
+    static bool SkipArguments( Array< Token > & pending );
+    static int32_t FindParam( const Macro * macro, const Token & token );
+    static Token MakeToken( const char * text, uint32_t len, uint8_t type );
+    static Token MakeTruthToken( Truth truth );
+
+    // Hide sets (macros which must not be expanded again)
+    bool IsHidden( uint32_t hideSet, const Macro * macro ) const;
+    uint32_t AddToHideSet( uint32_t hideSet, const Macro * macro );
+    uint32_t MergeHideSets( uint32_t hideSet, uint32_t other );
+
+    // Macros
+    Macro * FindMacro( const char * name, uint32_t nameLen ) const;
+    Macro * DefineMacro( const char * name, uint32_t nameLen );
+    void UndefineMacro( const char * name, uint32_t nameLen );
+    bool DefinePredefinedMacros();
+
+    // Files
+    File * FindIncludeFile( const AString & name, bool angled, bool isNext, int32_t & outDirIndex );
+    File * LoadFile( const AString & fileName );
+    static bool ReadFile( const AString & fileName, AString & outContents );
+    static bool GetIncludeName( const Array< Token > & tokens, AString & outName, bool & outAngled );
+
+    // Lexing
+    static const char * FindDirective( const char * pos, const char * end, bool & outSawCode );
+    static const char * ReadDirective( const char * pos, const char * end, AString & outLine );
+    static void Tokenize( const char * pos, const char * end, Array< Token > & outTokens );
+
+    bool Fail( const char * fmtString, ... ) FORMAT_STRING( 2, 3 );
+    bool FailIfActive( State state, const char * fmtString, ... ) FORMAT_STRING( 3, 4 );
+
+    template < class T > static void Insert( Array< T * > & buckets, size_t & count, T * item );
+
+    const CIncludeScannerConfig &   m_Config;
+
+    // preprocessor state
+    Array< Macro * >    m_Macros;       // hash buckets
+    size_t              m_NumMacros;
+    Array< File * >     m_Files;        // hash buckets
+    size_t              m_NumFiles;
+    Array< Context >    m_Contexts;     // stack of files being processed
+    Array< Condition >  m_Conditions;   // stack of #if/#endif blocks
+    bool                m_IsCPlusPlus;
+    bool                m_CharIsUnsigned;
+
+    // temporary data for the current directive
+    AString             m_Line;         // directive with comments removed
+    Array< HideSet >    m_HideSets;
+    Array< AString * >  m_Scratch;      // text of tokens created by ## and #
+    uint32_t            m_NumExpansions;
+    uint32_t            m_ExpandDepth;
+
+    // final data
+    Array< AString >    m_Includes;
+    AString             m_Error;
+};
+
+//------------------------------------------------------------------------------
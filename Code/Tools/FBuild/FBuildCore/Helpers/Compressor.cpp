@@ -67,7 +67,11 @@ bool Compressor::Compress( const void * data, size_t dataSize )
     AutoPtr< char > output( (char *)ALLOC( worstCaseSize ) );
 
     // do compression
-    const int compressedSize = LZ4_compress_default( (const char*)data, output.Get(), (int)dataSize, worstCaseSize);
+    // (LZ4's state is too big for the stack of some threads we compress on, such as
+    // network threads storing results of remote jobs to the cache, so use the heap)
+    AutoPtr< void > state( ALLOC( (size_t)LZ4_sizeofState() ) );
+    const int acceleration = 1; // same as LZ4_compress_default
+    const int compressedSize = LZ4_compress_fast_extState( state.Get(), (const char*)data, output.Get(), (int)dataSize, worstCaseSize, acceleration );
 
     // did the compression yield any benefit?
     const bool compressed = ( compressedSize < (int)dataSize );
@@ -40,6 +40,10 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_NumRacesStarted( 0 )
+    , m_NumRacesWonLocally( 0 )
+    , m_NumRacesWonRemotely( 0 )
+    , m_RaceWastedTimeMS( 0 )
     , m_RootNode( nullptr )
     , m_NodesByTime( 100 * 1000, true )
 {}
@@ -201,6 +205,15 @@ void FBuildStats::OutputSummary() const
     FormatTime( totalRemoteCPUInSeconds, buffer );
     float remoteRatio = ( totalRemoteCPUInSeconds / m_TotalBuildTime );
     output.AppendFormat( " - Remote CPU : %s (%2.1f:1)\n", buffer.Get(), remoteRatio );
+    if ( m_NumRacesStarted > 0 )
+    {
+        output += "Races:\n";
+        output.AppendFormat( " - Started    : %u\n", m_NumRacesStarted );
+        output.AppendFormat( " - Won Local  : %u\n", m_NumRacesWonLocally );
+        output.AppendFormat( " - Won Remote : %u\n", m_NumRacesWonRemotely );
+        FormatTime( (float)( (double)m_RaceWastedTimeMS / (double)1000 ), buffer );
+        output.AppendFormat( " - Wasted CPU : %s\n", buffer.Get() );
+    }
     output += "-----------------------------------------------------------------\n";
 
     OUTPUT( "%s", output.Get() );
@@ -32,6 +32,12 @@ public:
     uint32_t    m_TotalLocalCPUTimeMS;  // Total CPU time on local host
     uint32_t    m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
 
+    // local races of remote jobs
+    uint32_t    m_NumRacesStarted;
+    uint32_t    m_NumRacesWonLocally;
+    uint32_t    m_NumRacesWonRemotely;
+    uint32_t    m_RaceWastedTimeMS;     // Time spent on the losing side of races
+
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( Node * node );
 
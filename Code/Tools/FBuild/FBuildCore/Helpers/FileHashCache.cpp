@@ -0,0 +1,240 @@
+// FileHashCache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "FileHashCache.h"
+
+// Core
+#include "Core/Containers/AutoPtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/CRC32.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+#include <memory.h>
+
+// Defines
+//------------------------------------------------------------------------------
+// Files modified more recently than this could change again without changing
+// their timestamp on file systems with coarse times, so aren't cached
+#if defined( __WINDOWS__ )
+    #define FILE_HASH_CACHE_MIN_AGE ( 2 * 10000000ULL ) // 100ns units
+#else
+    #define FILE_HASH_CACHE_MIN_AGE ( 2 * 1000000000ULL ) // ns
+#endif
+
+// Entry
+//------------------------------------------------------------------------------
+struct FileHashCache::Entry
+{
+    Entry *     m_Next;
+    uint32_t    m_NameCRC;
+    AString     m_FileName;
+    uint64_t    m_TimeStamp;
+    uint64_t    m_Size;
+    uint64_t    m_Hash;
+    bool        m_Used;         // during this build (only used entries are saved)
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileHashCache::FileHashCache()
+    : m_Table( nullptr )
+    , m_NumEntries( 0 )
+    , m_NumHits( 0 )
+    , m_NumMisses( 0 )
+{
+    m_Table = FNEW_ARRAY( Entry *[ TABLE_SIZE ] );
+    memset( m_Table, 0, sizeof( Entry * ) * TABLE_SIZE );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileHashCache::~FileHashCache()
+{
+    for ( size_t i = 0; i < TABLE_SIZE; ++i )
+    {
+        Entry * entry = m_Table[ i ];
+        while ( entry )
+        {
+            Entry * next = entry->m_Next;
+            FDELETE entry;
+            entry = next;
+        }
+    }
+    FDELETE_ARRAY( m_Table );
+}
+
+// GetHash
+//------------------------------------------------------------------------------
+bool FileHashCache::GetHash( const AString & fileName, uint64_t & outHash )
+{
+    FileIO::FileInfo info;
+    if ( FileIO::GetFileInfo( fileName, info ) == false )
+    {
+        return false;
+    }
+    if ( Find( fileName, info.m_LastWriteTime, info.m_Size, outHash ) )
+    {
+        return true;
+    }
+
+    // read and hash outside of the lock
+    FileStream fs;
+    if ( fs.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const size_t size = (size_t)fs.GetFileSize();
+    AutoPtr< void > mem( ALLOC( size ) );
+    if ( fs.Read( mem.Get(), size ) != size )
+    {
+        return false;
+    }
+    outHash = xxHash::Calc64( mem.Get(), size );
+
+    Add( fileName, info.m_LastWriteTime, info.m_Size, outHash );
+    return true;
+}
+
+// Find
+//------------------------------------------------------------------------------
+bool FileHashCache::Find( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t & outHash )
+{
+    const uint32_t nameCRC = CRC32::CalcLower( fileName );
+
+    MutexHolder mh( m_Mutex );
+    Entry * entry = FindEntry( fileName, nameCRC );
+    if ( entry && ( entry->m_TimeStamp == timeStamp ) && ( entry->m_Size == size ) )
+    {
+        outHash = entry->m_Hash;
+        entry->m_Used = true;
+        ++m_NumHits;
+        return true;
+    }
+    ++m_NumMisses;
+    return false;
+}
+
+// Add
+//------------------------------------------------------------------------------
+void FileHashCache::Add( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t hash )
+{
+    if ( ( timeStamp + FILE_HASH_CACHE_MIN_AGE ) > Time::GetCurrentFileTime() )
+    {
+        return; // too recent to trust the timestamp
+    }
+
+    const bool used = true;
+    AddEntry( fileName, timeStamp, size, hash, used );
+}
+
+// AddEntry
+//------------------------------------------------------------------------------
+void FileHashCache::AddEntry( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t hash, bool used )
+{
+    const uint32_t nameCRC = CRC32::CalcLower( fileName );
+
+    MutexHolder mh( m_Mutex );
+
+    // only the latest version of each file is kept
+    Entry * entry = FindEntry( fileName, nameCRC );
+    if ( entry == nullptr )
+    {
+        entry = FNEW( Entry );
+        entry->m_NameCRC = nameCRC;
+        entry->m_FileName = fileName;
+        entry->m_Next = m_Table[ nameCRC & ( TABLE_SIZE - 1 ) ];
+        m_Table[ nameCRC & ( TABLE_SIZE - 1 ) ] = entry;
+        ++m_NumEntries;
+    }
+    entry->m_TimeStamp = timeStamp;
+    entry->m_Size = size;
+    entry->m_Hash = hash;
+    entry->m_Used = used;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void FileHashCache::Save( IOStream & stream ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    // files no longer used (deleted, or no longer part of the build) are dropped
+    uint32_t numUsedEntries = 0;
+    for ( size_t i = 0; i < TABLE_SIZE; ++i )
+    {
+        for ( const Entry * entry = m_Table[ i ]; entry; entry = entry->m_Next )
+        {
+            numUsedEntries += entry->m_Used ? 1 : 0;
+        }
+    }
+
+    stream.Write( numUsedEntries );
+    for ( size_t i = 0; i < TABLE_SIZE; ++i )
+    {
+        for ( const Entry * entry = m_Table[ i ]; entry; entry = entry->m_Next )
+        {
+            if ( entry->m_Used == false )
+            {
+                continue;
+            }
+            stream.Write( entry->m_FileName );
+            stream.Write( entry->m_TimeStamp );
+            stream.Write( entry->m_Size );
+            stream.Write( entry->m_Hash );
+        }
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool FileHashCache::Load( IOStream & stream )
+{
+    uint32_t numEntries = 0;
+    if ( stream.Read( numEntries ) == false )
+    {
+        return false;
+    }
+    AStackString<> fileName;
+    for ( uint32_t i = 0; i < numEntries; ++i )
+    {
+        uint64_t timeStamp = 0;
+        uint64_t size = 0;
+        uint64_t hash = 0;
+        if ( ( stream.Read( fileName ) == false ) ||
+             ( stream.Read( timeStamp ) == false ) ||
+             ( stream.Read( size ) == false ) ||
+             ( stream.Read( hash ) == false ) )
+        {
+            return false;
+        }
+        const bool used = false; // until found during this build
+        AddEntry( fileName, timeStamp, size, hash, used );
+    }
+    return true;
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+FileHashCache::Entry * FileHashCache::FindEntry( const AString & fileName, uint32_t nameCRC ) const
+{
+    for ( Entry * entry = m_Table[ nameCRC & ( TABLE_SIZE - 1 ) ]; entry; entry = entry->m_Next )
+    {
+        if ( ( entry->m_NameCRC == nameCRC ) && PathUtils::ArePathsEqual( entry->m_FileName, fileName ) )
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+// FileHashCache - Hashes of file contents, shared by all nodes
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+
+// FileHashCache
+//------------------------------------------------------------------------------
+// Headers are included by many translation units, so rather than reading and
+// hashing them each time, the hash of each version of a file (identified by its
+// timestamp and size) is stored. The cache is thread-safe, and is persisted in
+// the fdb so it is also shared between builds. Files modified too recently to
+// be identified reliably by their timestamp are not stored, and files not used
+// during a build are dropped when it is saved.
+class FileHashCache
+{
+public:
+    FileHashCache();
+    ~FileHashCache();
+
+    // get the hash of a file, reading it only if this version hasn't been seen
+    bool GetHash( const AString & fileName, uint64_t & outHash );
+
+    // for callers which read the file themselves (and need its contents anyway)
+    bool Find( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t & outHash );
+    void Add( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t hash );
+
+    // Serialization
+    void Save( IOStream & stream ) const;
+    bool Load( IOStream & stream );
+
+    inline uint32_t GetNumEntries() const   { return m_NumEntries; }
+    inline uint32_t GetNumHits() const      { return m_NumHits; }
+    inline uint32_t GetNumMisses() const    { return m_NumMisses; }
+
+private:
+    struct Entry;
+    void AddEntry( const AString & fileName, uint64_t timeStamp, uint64_t size, uint64_t hash, bool used );
+    Entry * FindEntry( const AString & fileName, uint32_t nameCRC ) const;
+
+    enum { TABLE_SIZE = 16384 };
+
+    mutable Mutex   m_Mutex;
+    Entry **        m_Table;
+    uint32_t        m_NumEntries;
+    uint32_t        m_NumHits;
+    uint32_t        m_NumMisses;
+};
+
+//------------------------------------------------------------------------------
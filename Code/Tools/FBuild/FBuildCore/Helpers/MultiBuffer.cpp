@@ -9,6 +9,7 @@
 
 // Core
 #include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
 
@@ -40,26 +41,22 @@ MultiBuffer::~MultiBuffer()
 //------------------------------------------------------------------------------
 bool MultiBuffer::CreateFromFiles( const Array< AString > & fileNames )
 {
-    ASSERT( fileNames.GetSize() <= MAX_FILES );
     ASSERT( ( m_ReadStream == nullptr ) && ( m_WriteStream == nullptr ) );
 
-    uint64_t fileSizes[ MAX_FILES ];
-    FileStream fileStreams[ MAX_FILES ];
     const size_t numFiles = fileNames.GetSize();
+    Array< uint64_t > fileSizes( numFiles, false );
 
-    // Open all the files and determine their size
+    // Determine the size of all the files
     uint64_t memSize = sizeof( uint32_t ); // write number of files
     for ( size_t i = 0; i <numFiles; ++i )
     {
-        FileStream& fs = fileStreams[ i ];
-        if ( fs.Open( fileNames[ i ].Get(), FileStream::READ_ONLY ) == false )
+        FileIO::FileInfo info;
+        if ( FileIO::GetFileInfo( fileNames[ i ], info ) == false )
         {
-            ASSERT( false ); // Shouldn't fail to open file locally
             return false;
         }
-        const uint64_t fileSize = fs.GetFileSize();
-        memSize += ( sizeof( uint64_t ) + fileSize );
-        fileSizes[ i ] = fileSize;
+        memSize += ( sizeof( uint64_t ) + info.m_Size );
+        fileSizes.Append( info.m_Size );
     }
 
     // Allocate enough space for the concatenated output
@@ -77,7 +74,11 @@ bool MultiBuffer::CreateFromFiles( const Array< AString > & fileNames )
     // Read data for each file
     for ( size_t i = 0; i <numFiles; ++i )
     {
-        FileStream & fs = fileStreams[ i ];
+        FileStream fs;
+        if ( fs.Open( fileNames[ i ].Get(), FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
         if ( m_WriteStream->WriteBuffer( fs, fileSizes[ i ] ) != fileSizes[ i ] )
         {
             return false;
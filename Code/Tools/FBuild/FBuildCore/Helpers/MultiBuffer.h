@@ -30,8 +30,6 @@ public:
     uint64_t        GetDataSize() const;
 
 private:
-    enum : uint32_t { MAX_FILES = 4 };
-
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
 };
@@ -0,0 +1,413 @@
+// PCHAnalysis
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "PCHAnalysis.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Graph/Dependencies.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define PCH_CANDIDATE_MIN_OBJECTS   ( 2 )   // a header must be shared to benefit
+#define PCH_RARELY_USED_THRESHOLD   ( 0.5f )
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+PCHAnalysis::PCHAnalysis()
+    : m_ObjectLists( 64, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+PCHAnalysis::~PCHAnalysis()
+{
+    for ( ObjectListStats * stats : m_ObjectLists )
+    {
+        FDELETE stats;
+    }
+}
+
+// Analyze
+//------------------------------------------------------------------------------
+void PCHAnalysis::Analyze( const Node * rootNode )
+{
+    if ( rootNode )
+    {
+        FindObjectListsRecurse( rootNode );
+    }
+}
+
+// FindObjectList
+//------------------------------------------------------------------------------
+const PCHAnalysis::ObjectListStats * PCHAnalysis::FindObjectList( const AString & name ) const
+{
+    for ( const ObjectListStats * stats : m_ObjectLists )
+    {
+        if ( stats->m_ObjectList->GetName() == name )
+        {
+            return stats;
+        }
+    }
+    return nullptr;
+}
+
+// WriteJSON
+//------------------------------------------------------------------------------
+void PCHAnalysis::WriteJSON( AString & outJSON ) const
+{
+    outJSON += "{\n\"objectLists\":[\n";
+    for ( size_t i = 0; i < m_ObjectLists.GetSize(); ++i )
+    {
+        const ObjectListStats & ols = *m_ObjectLists[ i ];
+
+        outJSON += ( i > 0 ) ? ",\n{" : "{";
+        outJSON += "\"name\":";
+        WriteJSONString( outJSON, ols.m_ObjectList->GetName() );
+        outJSON.AppendFormat( ",\"objects\":%u,\"buildTimeMS\":%u", ols.m_NumObjects, ols.m_BuildTimeMS );
+
+        outJSON += ",\"pch\":";
+        if ( ols.m_HasPCH )
+        {
+            const PCHStats & pch = ols.m_PCH;
+            outJSON += "{\"name\":";
+            WriteJSONString( outJSON, pch.m_PCH->GetName() );
+            outJSON.AppendFormat( ",\"users\":%u,\"buildTimeMS\":%u,\"usersBuildTimeMS\":%u,\"headers\":%u,\"rarelyUsedHeaders\":%u,\"headerUsage\":%.3f,\"estimatedSavingsMS\":%.1f,\"estimatedWastedRebuildMS\":%.1f,\"effective\":%s}",
+                                  pch.m_NumUsers,
+                                  pch.m_BuildTimeMS,
+                                  pch.m_UsersBuildTimeMS,
+                                  pch.m_NumHeaders,
+                                  pch.m_NumRarelyUsedHeaders,
+                                  (double)pch.m_HeaderUsage,
+                                  (double)pch.m_SavingsMS,
+                                  (double)pch.m_WastedRebuildMS,
+                                  pch.IsEffective() ? "true" : "false" );
+        }
+        else
+        {
+            outJSON += "null";
+        }
+
+        outJSON.AppendFormat( ",\"candidateSavingsMS\":%.1f,\"candidates\":[", (double)ols.m_CandidateSavingsMS );
+        for ( size_t j = 0; j < ols.m_Candidates.GetSize(); ++j )
+        {
+            const HeaderStats & hs = ols.m_Candidates[ j ];
+            outJSON += ( j > 0 ) ? ",\n{\"name\":" : "\n{\"name\":";
+            WriteJSONString( outJSON, hs.m_Header->GetName() );
+            outJSON.AppendFormat( ",\"objects\":%u,\"estimatedParseTimeMS\":%.1f,\"estimatedSavingsMS\":%.1f}",
+                                  hs.m_NumObjects,
+                                  (double)hs.m_ParseTimeMS,
+                                  (double)hs.m_SavingsMS );
+        }
+        outJSON += "]}";
+    }
+    outJSON += "\n]\n}\n";
+}
+
+// FindObjectListsRecurse
+//------------------------------------------------------------------------------
+void PCHAnalysis::FindObjectListsRecurse( const Node * node )
+{
+    // skip nodes we've already seen
+    if ( node->GetStatFlag( Node::STATS_PCH_ANALYSIS_PROCESSED ) )
+    {
+        return;
+    }
+    node->SetStatFlag( Node::STATS_PCH_ANALYSIS_PROCESSED );
+
+    const Node::Type type = node->GetType();
+    if ( type == Node::OBJECT_NODE )
+    {
+        return; // Stop recursing at Objects
+    }
+
+    if ( ( type == Node::OBJECT_LIST_NODE ) || ( type == Node::LIBRARY_NODE ) )
+    {
+        AnalyzeObjectList( node );
+    }
+
+    // Dependencies
+    FindObjectListsRecurse( node->GetPreBuildDependencies() );
+    FindObjectListsRecurse( node->GetStaticDependencies() );
+    FindObjectListsRecurse( node->GetDynamicDependencies() );
+}
+
+// FindObjectListsRecurse
+//------------------------------------------------------------------------------
+void PCHAnalysis::FindObjectListsRecurse( const Dependencies & dependencies )
+{
+    const Dependency * const end = dependencies.End();
+    for ( const Dependency * it = dependencies.Begin(); it != end; ++it )
+    {
+        FindObjectListsRecurse( it->GetNode() );
+    }
+}
+
+// AnalyzeObjectList
+//------------------------------------------------------------------------------
+void PCHAnalysis::AnalyzeObjectList( const Node * objectList )
+{
+    // the objects (and PCH, if any) are the dynamic dependencies of the list
+    const ObjectNode * pch = nullptr;
+    Array< const ObjectNode * > objects( objectList->GetDynamicDependencies().GetSize(), true );
+    for ( const Dependency & dep : objectList->GetDynamicDependencies() )
+    {
+        const Node * node = dep.GetNode();
+        if ( node->GetType() != Node::OBJECT_NODE )
+        {
+            continue;
+        }
+        const ObjectNode * obj = node->CastTo< ObjectNode >();
+        if ( obj->IsCreatingPCH() )
+        {
+            pch = obj;
+        }
+        else
+        {
+            objects.Append( obj );
+        }
+    }
+    if ( objects.IsEmpty() )
+    {
+        return;
+    }
+
+    // find all headers included by the objects
+    Array< const Node * > includes( 4096, true );
+    for ( const ObjectNode * obj : objects )
+    {
+        const Node * sourceFile = obj->GetSourceFile();
+        for ( const Dependency & dep : obj->GetDynamicDependencies() )
+        {
+            if ( dep.GetNode() != sourceFile )
+            {
+                includes.Append( dep.GetNode() );
+            }
+        }
+    }
+    includes.Sort();
+
+    Array< HeaderStats > headers( includes.GetSize(), true );
+    const Node * previous = nullptr;
+    for ( const Node * include : includes )
+    {
+        if ( include == previous )
+        {
+            continue;
+        }
+        previous = include;
+
+        FileIO::FileInfo info;
+        HeaderStats hs;
+        hs.m_Header = include;
+        hs.m_Size = FileIO::GetFileInfo( include->GetName(), info ) ? info.m_Size : 0;
+        hs.m_NumObjects = 0;
+        hs.m_NumPCHUsers = 0;
+        hs.m_ParseTimeMS = 0.0f;
+        hs.m_SavingsMS = 0.0f;
+        hs.m_InPCH = false;
+        headers.Append( hs );
+    }
+
+    ObjectListStats * ols = FNEW( ObjectListStats );
+    ols->m_ObjectList = objectList;
+    ols->m_NumObjects = (uint32_t)objects.GetSize();
+    ols->m_BuildTimeMS = 0;
+    ols->m_HasPCH = ( pch != nullptr );
+    ols->m_CandidateSavingsMS = 0.0f;
+    m_ObjectLists.Append( ols );
+
+    PCHStats & pchStats = ols->m_PCH;
+    pchStats.m_PCH = pch;
+    pchStats.m_NumUsers = 0;
+    pchStats.m_BuildTimeMS = pch ? pch->GetLastBuildTime() : 0;
+    pchStats.m_UsersBuildTimeMS = 0;
+
+    // split the build time of each object across the files it includes
+    for ( const ObjectNode * obj : objects )
+    {
+        const uint32_t buildTime = obj->GetLastBuildTime();
+        ols->m_BuildTimeMS += buildTime;
+
+        const bool usesPCH = ( pch != nullptr ) && obj->IsUsingPCH();
+        if ( usesPCH )
+        {
+            pchStats.m_NumUsers++;
+            pchStats.m_UsersBuildTimeMS += buildTime;
+        }
+
+        const Node * sourceFile = obj->GetSourceFile();
+        FileIO::FileInfo info;
+        uint64_t totalSize = FileIO::GetFileInfo( sourceFile->GetName(), info ) ? info.m_Size : 0;
+        for ( const Dependency & dep : obj->GetDynamicDependencies() )
+        {
+            if ( dep.GetNode() != sourceFile )
+            {
+                totalSize += FindHeader( headers, dep.GetNode() )->m_Size;
+            }
+        }
+
+        for ( const Dependency & dep : obj->GetDynamicDependencies() )
+        {
+            if ( dep.GetNode() == sourceFile )
+            {
+                continue;
+            }
+            HeaderStats * hs = FindHeader( headers, dep.GetNode() );
+            hs->m_NumObjects++;
+            if ( usesPCH )
+            {
+                hs->m_NumPCHUsers++;
+            }
+            if ( totalSize > 0 )
+            {
+                hs->m_ParseTimeMS += (float)( (double)buildTime * (double)hs->m_Size / (double)totalSize );
+            }
+        }
+    }
+
+    // precompiled header
+    if ( pch )
+    {
+        const Node * pchSourceFile = pch->GetSourceFile();
+        HeaderStats * pchSource = FindHeader( headers, pchSourceFile );
+        if ( pchSource )
+        {
+            pchSource->m_InPCH = true; // with GCC/Clang, the PCH is built from the header itself
+        }
+
+        uint32_t numHeaders = 0;
+        uint32_t numRarelyUsed = 0;
+        uint32_t numKnownUsage = 0;
+        float totalUsage = 0.0f;
+        for ( const Dependency & dep : pch->GetDynamicDependencies() )
+        {
+            if ( dep.GetNode() == pchSourceFile )
+            {
+                continue;
+            }
+            ++numHeaders;
+
+            // objects using a PCH only list its headers if the compiler reports them (GCC/Clang)
+            HeaderStats * hs = FindHeader( headers, dep.GetNode() );
+            float usage = 0.0f;
+            if ( hs )
+            {
+                hs->m_InPCH = true;
+                ++numKnownUsage;
+                usage = ( pchStats.m_NumUsers > 0 ) ? ( (float)hs->m_NumPCHUsers / (float)pchStats.m_NumUsers ) : 0.0f;
+            }
+            totalUsage += usage;
+            if ( usage < PCH_RARELY_USED_THRESHOLD )
+            {
+                ++numRarelyUsed;
+            }
+        }
+
+        pchStats.m_NumHeaders = numHeaders;
+        if ( numKnownUsage > 0 )
+        {
+            pchStats.m_HeaderUsage = ( totalUsage / (float)numHeaders );
+            pchStats.m_NumRarelyUsedHeaders = numRarelyUsed;
+        }
+        else
+        {
+            // usage is unknown, so assume every header is needed
+            pchStats.m_HeaderUsage = 1.0f;
+            pchStats.m_NumRarelyUsedHeaders = 0;
+        }
+
+        // Each user avoids parsing the headers, but the PCH itself must be built
+        // once. When a header in the PCH changes, all users are rebuilt, whether or
+        // not they include it.
+        pchStats.m_SavingsMS = ( (float)pchStats.m_NumUsers - 1.0f ) * (float)pchStats.m_BuildTimeMS;
+        pchStats.m_WastedRebuildMS = ( 1.0f - pchStats.m_HeaderUsage ) * (float)pchStats.m_UsersBuildTimeMS;
+    }
+    else
+    {
+        pchStats.m_NumHeaders = 0;
+        pchStats.m_NumRarelyUsedHeaders = 0;
+        pchStats.m_HeaderUsage = 0.0f;
+        pchStats.m_SavingsMS = 0.0f;
+        pchStats.m_WastedRebuildMS = 0.0f;
+    }
+
+    // headers included by at least half of the objects are candidates
+    for ( HeaderStats & hs : headers )
+    {
+        if ( hs.m_InPCH ||
+             ( hs.m_NumObjects < PCH_CANDIDATE_MIN_OBJECTS ) ||
+             ( ( hs.m_NumObjects * 2 ) < ols->m_NumObjects ) )
+        {
+            continue;
+        }
+
+        // once precompiled, a header is parsed once instead of once per object
+        hs.m_SavingsMS = hs.m_ParseTimeMS * (float)( hs.m_NumObjects - 1 ) / (float)hs.m_NumObjects;
+        ols->m_Candidates.Append( hs );
+        ols->m_CandidateSavingsMS += hs.m_SavingsMS;
+    }
+    ols->m_Candidates.Sort();
+}
+
+// FindHeader
+//------------------------------------------------------------------------------
+/*static*/ PCHAnalysis::HeaderStats * PCHAnalysis::FindHeader( Array< HeaderStats > & headers, const Node * header )
+{
+    // headers are sorted by node
+    size_t low = 0;
+    size_t high = headers.GetSize();
+    while ( low < high )
+    {
+        const size_t mid = ( low + high ) / 2;
+        const Node * node = headers[ mid ].m_Header;
+        if ( node == header )
+        {
+            return &headers[ mid ];
+        }
+        if ( node < header )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+// WriteJSONString
+//------------------------------------------------------------------------------
+/*static*/ void PCHAnalysis::WriteJSONString( AString & outJSON, const AString & string )
+{
+    outJSON += '"';
+    for ( const char * pos = string.Get(); *pos; ++pos )
+    {
+        const char c = *pos;
+        if ( ( c == '"' ) || ( c == '\\' ) )
+        {
+            outJSON += '\\';
+            outJSON += c;
+        }
+        else if ( (unsigned char)c < 0x20 )
+        {
+            outJSON.AppendFormat( "\\u%04x", (uint32_t)(unsigned char)c );
+        }
+        else
+        {
+            outJSON += c;
+        }
+    }
+    outJSON += '"';
+}
+
+//------------------------------------------------------------------------------
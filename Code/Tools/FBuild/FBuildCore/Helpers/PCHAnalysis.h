@@ -0,0 +1,88 @@
+// PCHAnalysis - Estimate the effectiveness of precompiled headers
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Dependencies;
+class Node;
+class ObjectNode;
+
+// PCHAnalysis
+//------------------------------------------------------------------------------
+// Compilers don't report how long each header takes to parse, so the cost of a
+// header is estimated by splitting the last build time of each object which
+// includes it in proportion to the size of the files involved. From this:
+//  - headers included by most objects of a library, but not in its PCH, are
+//    reported as candidates, along with the time precompiling them could save
+//  - each PCH is compared against the work it causes: when any header in the
+//    PCH changes, every user is rebuilt, even those not including it
+class PCHAnalysis
+{
+public:
+    PCHAnalysis();
+    ~PCHAnalysis();
+
+    void Analyze( const Node * rootNode );
+
+    void WriteJSON( AString & outJSON ) const;
+
+    struct HeaderStats
+    {
+        const Node *    m_Header;
+        uint64_t        m_Size;
+        uint32_t        m_NumObjects;       // objects including this header
+        uint32_t        m_NumPCHUsers;      // objects using the PCH which include this header
+        float           m_ParseTimeMS;      // estimated time spent parsing this header, over all objects
+        float           m_SavingsMS;        // estimated time saved if this header was precompiled
+        bool            m_InPCH;
+
+        bool operator < ( const HeaderStats & other ) const { return m_SavingsMS > other.m_SavingsMS; }
+    };
+
+    struct PCHStats
+    {
+        const ObjectNode *  m_PCH;
+        uint32_t            m_NumUsers;
+        uint32_t            m_BuildTimeMS;
+        uint32_t            m_UsersBuildTimeMS;
+        uint32_t            m_NumHeaders;
+        uint32_t            m_NumRarelyUsedHeaders; // included by less than half of the users
+        float               m_HeaderUsage;          // average fraction of users including each header
+        float               m_SavingsMS;            // parsing avoided by the users
+        float               m_WastedRebuildMS;      // rebuilds of users not including a changed header
+
+        inline bool IsEffective() const { return ( m_SavingsMS > m_WastedRebuildMS ); }
+    };
+
+    struct ObjectListStats
+    {
+        const Node *            m_ObjectList;
+        uint32_t                m_NumObjects;
+        uint32_t                m_BuildTimeMS;
+        bool                    m_HasPCH;
+        PCHStats                m_PCH;
+        Array< HeaderStats >    m_Candidates;   // sorted by estimated savings
+        float                   m_CandidateSavingsMS;
+    };
+
+    inline const Array< ObjectListStats * > & GetObjectLists() const { return m_ObjectLists; }
+    const ObjectListStats * FindObjectList( const AString & name ) const;
+
+private:
+    void FindObjectListsRecurse( const Node * node );
+    void FindObjectListsRecurse( const Dependencies & dependencies );
+    void AnalyzeObjectList( const Node * objectList );
+
+    static HeaderStats * FindHeader( Array< HeaderStats > & headers, const Node * header );
+    static void WriteJSONString( AString & outJSON, const AString & string );
+
+    Array< ObjectListStats * > m_ObjectLists;
+};
+
+//------------------------------------------------------------------------------
@@ -81,6 +81,7 @@ void Report::Generate( const FBuildStats & stats )
 
     // generate some common data used in reporting
     GetLibraryStats( stats );
+    m_PCHAnalysis.Analyze( stats.GetRootNode() );
 
     // build the report
     CreateHeader();
@@ -96,6 +97,8 @@ void Report::Generate( const FBuildStats & stats )
 
     DoIncludes();
 
+    DoPrecompiledHeaders();
+
     CreateFooter();
 
     // patch in time take
@@ -116,6 +119,15 @@ void Report::Save() const
     {
         f.Write( m_Output.Get(), m_Output.GetLength() );
     }
+
+    // machine readable PCH analysis
+    AString json( 64 * 1024 );
+    m_PCHAnalysis.WriteJSON( json );
+    FileStream fJSON;
+    if ( fJSON.Open( "report.json", FileStream::WRITE_ONLY ) )
+    {
+        fJSON.Write( json.Get(), json.GetLength() );
+    }
 }
 
 // CreateHeader
@@ -710,6 +722,92 @@ void Report::DoIncludes()
 }
 PRAGMA_DISABLE_POP_MSVC // warning C6262: Function uses '262212' bytes of stack
 
+// DoPrecompiledHeaders
+//------------------------------------------------------------------------------
+void Report::DoPrecompiledHeaders()
+{
+    DoSectionTitle( "Precompiled Headers", "precompiledHeaders" );
+
+    Write( "<p>Parse times are estimated from object build times, in proportion to file sizes.</p>\n" );
+
+    size_t numLibsOutput = 0;
+
+    for ( const PCHAnalysis::ObjectListStats * ols : m_PCHAnalysis.GetObjectLists() )
+    {
+        if ( ( ols->m_HasPCH == false ) && ols->m_Candidates.IsEmpty() )
+        {
+            continue;
+        }
+
+        Write( "<h3>%s</h3>\n", ols->m_ObjectList->GetName().Get() );
+        numLibsOutput++;
+
+        // existing PCH
+        if ( ols->m_HasPCH )
+        {
+            const PCHAnalysis::PCHStats & pch = ols->m_PCH;
+
+            DoTableStart();
+            Write( "<tr><th style=\"width:60px;\">Users</th><th style=\"width:80px;\">PCH Time</th><th style=\"width:80px;\">Usage</th><th style=\"width:80px;\">Rarely Used</th><th style=\"width:80px;\">Saved</th><th style=\"width:80px;\">Wasted</th><th style=\"width:80px;\">Effective</th><th>Name</th></tr>\n" );
+            Write( "<tr><td>%u</td><td>%2.3fs</td><td>%2.1f%%</td><td>%u/%u</td><td>%2.3fs</td><td>%2.3fs</td><td>%s</td><td>%s</td></tr>\n",
+                   pch.m_NumUsers,
+                   (double)pch.m_BuildTimeMS * 0.001, // ms to s
+                   (double)pch.m_HeaderUsage * 100.0,
+                   pch.m_NumRarelyUsedHeaders,
+                   pch.m_NumHeaders,
+                   (double)pch.m_SavingsMS * 0.001,
+                   (double)pch.m_WastedRebuildMS * 0.001,
+                   pch.IsEffective() ? "yes" : "NO",
+                   pch.m_PCH->GetName().Get() );
+            DoTableStop();
+        }
+
+        // candidates
+        if ( ols->m_Candidates.IsEmpty() )
+        {
+            continue;
+        }
+
+        Write( "<p>Candidates (estimated savings %2.3fs)</p>\n", (double)ols->m_CandidateSavingsMS * 0.001 );
+
+        DoTableStart();
+        Write( "<tr><th style=\"width:80px;\">Objects</th><th style=\"width:80px;\">Included</th><th style=\"width:80px;\">Parse Time</th><th style=\"width:80px;\">Saved</th><th>Name</th></tr>\n" );
+
+        const size_t numCandidates = ols->m_Candidates.GetSize();
+        size_t numOutput = 0;
+        for ( const PCHAnalysis::HeaderStats & hs : ols->m_Candidates )
+        {
+            // start collapsable section
+            if ( numOutput == 10 )
+            {
+                DoToggleSection( numCandidates - 10 );
+            }
+
+            Write( ( numOutput == 10 ) ? "<tr></tr><tr><td style=\"width:80px;\">%u</td><td style=\"width:80px;\">%u</td><td style=\"width:80px;\">%2.3fs</td><td style=\"width:80px;\">%2.3fs</td><td>%s</td></tr>\n"
+                                       : "<tr><td>%u</td><td>%u</td><td>%2.3fs</td><td>%2.3fs</td><td>%s</td></tr>\n",
+                        ols->m_NumObjects,
+                        hs.m_NumObjects,
+                        (double)hs.m_ParseTimeMS * 0.001,
+                        (double)hs.m_SavingsMS * 0.001,
+                        hs.m_Header->GetName().Get() );
+            numOutput++;
+        }
+
+        DoTableStop();
+
+        // end collpsable section
+        if ( numOutput > 10 )
+        {
+            Write( "</details>\n" );
+        }
+    }
+
+    if ( numLibsOutput == 0 )
+    {
+        Write( "No precompiled headers or candidates.\n" );
+    }
+}
+
 // DoPieChart
 //------------------------------------------------------------------------------
 void Report::DoPieChart( const Array< PieItem > & items, const char * units )
@@ -4,6 +4,8 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "PCHAnalysis.h"
+
 #include "Core/Containers/Array.h"
 #include "Core/Mem/MemPoolBlock.h"
 #include "Core/Strings/AString.h"
@@ -35,6 +37,7 @@ private:
     void DoCPUTimeByItem( const FBuildStats & stats );
     void DoCPUTimeByLibrary();
     void DoIncludes();
+    void DoPrecompiledHeaders();
 
     void CreateFooter();
 
@@ -117,6 +120,7 @@ private:
     // intermediate collected data
     Array< LibraryStats * > m_LibraryStats;
     uint32_t m_NumPieCharts;
+    PCHAnalysis m_PCHAnalysis;
 
     // final output
     AString m_Output;
@@ -474,6 +474,23 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId, const void * data, size_t &
     return true; // file stored ok
 }
 
+// LoadRemoteFileData
+//------------------------------------------------------------------------------
+bool ToolManifest::LoadRemoteFileData( uint32_t fileId, void * & content, uint32_t & contentSize ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    // Only files which have been fully received can be served to peers
+    if ( m_Files[ fileId ].m_SyncState != ToolManifestFile::SYNCHRONIZED )
+    {
+        return false;
+    }
+
+    AStackString<> fileName;
+    GetRemoteFilePath( fileId, fileName );
+    return LoadFile( fileName, content, contentSize );
+}
+
 // GetRelativePath
 //------------------------------------------------------------------------------
 /*static*/ void ToolManifest::GetRelativePath( const AString & root, const AString & otherFile, AString & otherFileRelativePath )
@@ -84,6 +84,7 @@ public:
 
     const void *    GetFileData( uint32_t fileId, size_t & dataSize ) const;
     bool            ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize );
+    bool            LoadRemoteFileData( uint32_t fileId, void * & content, uint32_t & contentSize ) const;
 
     void            GetRemotePath( AString & path ) const;
     void            GetRemoteFilePath( uint32_t fileId, AString & exe ) const;
@@ -11,6 +11,7 @@
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/ExecNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
@@ -22,6 +23,7 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/Random.h"
 #include "Core/Profile/Profile.h"
 
@@ -30,6 +32,7 @@
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
+#define MAX_TOOLCHAIN_PEERS ( 4 )
 #define DIST_INFO( ... ) if ( m_DetailedLogging ) { FLOG_BUILD( __VA_ARGS__ ); }
 
 // CONSTRUCTOR
@@ -43,6 +46,7 @@ Client::Client( const Array< AString > & workerList,
     , m_DetailedLogging( detailedLogging )
     , m_WorkerConnectionLimit( workerConnectionLimit )
     , m_Port( port )
+    , m_AverageJobTimeMS( 0.0f )
 {
     // allocate space for server states
     m_ServerList.SetSize( workerList.GetSize() );
@@ -83,7 +87,9 @@ Client::~Client()
         const Job * const * end = ss->m_Jobs.End();
         while ( it != end )
         {
+            ss->m_Performance.RecordJobFailed();
             FLOG_MONITOR( "FINISH_JOB TIMEOUT %s \"%s\" \n", ss->m_RemoteName.Get(), (*it)->GetNode()->GetName().Get() );
+            JobQueue::Get().ReleaseResourcePool( *it );
             JobQueue::Get().ReturnUnfinishedDistributableJob( *it );
             ++it;
         }
@@ -97,6 +103,7 @@ Client::~Client()
     ss->m_RemoteName.Clear();
     ss->m_Connection = nullptr;
     ss->m_CurrentMessage = nullptr;
+    ss->m_ToolIds.Clear();
 }
 
 // ThreadFuncStatic
@@ -420,6 +427,12 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_TOOL_AVAILABLE:
+        {
+            const Protocol::MsgToolAvailable * msg = static_cast< const Protocol::MsgToolAvailable * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -459,7 +472,7 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
         return;
     }
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
+    Job * job = JobQueue::Get().GetDistributableJobToProcess( true, GetJobCostPreference( ss ) );
     if ( job == nullptr )
     {
         PROFILE_SECTION( "NoJob" )
@@ -480,15 +493,28 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     ss->m_Jobs.Append( job ); // Track in-flight job
 
     // if tool is explicity specified, get the id of the tool manifest
-    Node * n = job->GetNode()->CastTo< ObjectNode >()->GetCompiler();
-    const ToolManifest & manifest = n->CastTo< CompilerNode >()->GetManifest();
+    const ToolManifest & manifest = GetManifest( job );
     uint64_t toolId = manifest.GetToolId();
     ASSERT( toolId );
 
     // output to signify remote start
-    FLOG_BUILD( "-> Obj: %s <REMOTE: %s>\n", job->GetNode()->GetName().Get(), ss->m_RemoteName.Get() );
+    const char * jobType = ( job->GetNode()->GetType() == Node::EXEC_NODE ) ? "Run" : "Obj";
+    FLOG_BUILD( "-> %s: %s <REMOTE: %s>\n", jobType, job->GetNode()->GetName().Get(), ss->m_RemoteName.Get() );
     FLOG_MONITOR( "START_JOB %s \"%s\" \n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
 
+    if ( ss->m_NumJobsSent++ == 0 )
+    {
+        ss->m_ActiveTimer.Start();
+    }
+    ss->m_BytesSent += stream.GetSize();
+    job->SetRemoteSendTime( Timer::GetNow() );
+
+    // predict when the job will be back, so local races are only started when
+    // they are expected to finish first
+    float expectedTimeMS;
+    const bool predicted = ss->m_Performance.GetPredictedJobTimeMS( (float)job->GetNode()->GetLastBuildTime(), expectedTimeMS );
+    job->SetRemoteExpectedTimeMS( predicted ? Math::Max< uint32_t >( (uint32_t)expectedTimeMS, 1 ) : 0 );
+
     {
         PROFILE_SECTION( "SendJob" )
         Protocol::MsgJob msg( toolId );
@@ -533,7 +559,11 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
 
     {
         MutexHolder mh( ss->m_Mutex );
-        VERIFY( ss->m_Jobs.FindDerefAndErase( jobId ) );
+        Job ** it = ss->m_Jobs.FindDeref( jobId );
+        ASSERT( it );
+        RecordJobResult( *ss, *it, buildTime, payloadSize, result, systemError );
+        JobQueue::Get().ReleaseResourcePool( *it ); // no longer running remotely
+        ss->m_Jobs.Erase( it );
     }
 
     // Has the job been cancelled in the interim?
@@ -554,9 +584,10 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     if ( result == true )
     {
         // built ok - serialize to disc
-
-        ObjectNode * objectNode = job->GetNode()->CastTo< ObjectNode >();
-        const AString & nodeName = objectNode->GetName();
+        // (only objects have a second file, the PDB)
+        Node * node = job->GetNode();
+        ObjectNode * objectNode = ( node->GetType() == Node::OBJECT_NODE ) ? node->CastTo< ObjectNode >() : nullptr;
+        const AString & nodeName = node->GetName();
         if ( Node::EnsurePathExistsForFile( nodeName ) == false )
         {
             FLOG_ERROR( "Failed to create path for '%s'", nodeName.Get() );
@@ -564,18 +595,18 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
         }
         else
         {
-            const ObjectNode * on = job->GetNode()->CastTo< ObjectNode >();
+            const bool usingPDB = ( objectNode && objectNode->IsUsingPDB() );
             const uint32_t firstFileSize = *(uint32_t *)data;
-            const uint32_t secondFileSize = on->IsUsingPDB() ? *(uint32_t *)( (const char *)data + sizeof( uint32_t ) + firstFileSize ) : 0;
+            const uint32_t secondFileSize = usingPDB ? *(uint32_t *)( (const char *)data + sizeof( uint32_t ) + firstFileSize ) : 0;
 
             result = WriteFileToDisk( nodeName, (const char *)data + sizeof( uint32_t ), firstFileSize );
-            if ( result && on->IsUsingPDB() )
+            if ( result && usingPDB )
             {
                 data = (const void *)( (const char *)data + sizeof( uint32_t ) + firstFileSize );
                 ASSERT( ( firstFileSize + secondFileSize + ( sizeof( uint32_t ) * 2 ) ) == size );
 
                 AStackString<> pdbName;
-                on->GetPDBName( pdbName );
+                objectNode->GetPDBName( pdbName );
                 result = WriteFileToDisk( pdbName, (const char *)data + sizeof( uint32_t ), secondFileSize );
             }
 
@@ -591,10 +622,24 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
                 f->SetStatFlag(Node::STATS_BUILT_REMOTE);
 
                 // commit to cache?
-                if ( FBuild::Get().GetOptions().m_UseCacheWrite &&
-                        objectNode->ShouldUseCache() )
+                if ( FBuild::Get().GetOptions().m_UseCacheWrite )
                 {
-                    objectNode->WriteToCache( job );
+                    if ( objectNode )
+                    {
+                        if ( objectNode->ShouldUseCache() )
+                        {
+                            objectNode->WriteToCache( job );
+                        }
+                    }
+                    else
+                    {
+                        // the cache name was only determined if the output can be cached
+                        ExecNode * execNode = node->CastTo< ExecNode >();
+                        if ( execNode->ShouldUseCache() && ( job->GetCacheName().IsEmpty() == false ) )
+                        {
+                            execNode->WriteToCache( job );
+                        }
+                    }
                 }
             }
             else
@@ -696,6 +741,17 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     MemoryStream ms;
     manifest->SerializeForRemote( ms );
 
+    // Let the worker fetch the files from other workers which already have
+    // them, so the toolchain doesn't have to be uploaded from here every time
+    Array< AString > peers;
+    GetPeersWithTool( connection, toolId, peers );
+    ms.Write( peers );
+    ms.Write( m_Port );
+    if ( peers.IsEmpty() == false )
+    {
+        DIST_INFO( "Toolchain peers for %s: %u\n", ((ServerState *)connection->GetUserData())->m_RemoteName.Get(), (uint32_t)peers.GetSize() );
+    }
+
     // Send manifest to worker
     Protocol::MsgManifest resultMsg( toolId );
     resultMsg.Send( connection, ms );
@@ -753,6 +809,146 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgServ
     ss->m_StatusTimer.Start();
 }
 
+// Process ( MsgToolAvailable )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgToolAvailable * msg )
+{
+    PROFILE_SECTION( "MsgToolAvailable" )
+
+    // find server
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    MutexHolder mh( ss->m_Mutex );
+    const uint64_t toolId = msg->GetToolId();
+    if ( ss->m_ToolIds.Find( toolId ) == nullptr )
+    {
+        ss->m_ToolIds.Append( toolId );
+    }
+}
+
+// GetPeersWithTool
+//------------------------------------------------------------------------------
+void Client::GetPeersWithTool( const ConnectionInfo * connection, uint64_t toolId, Array< AString > & outPeers )
+{
+    // NOTE: m_ServerListMutex is held by OnReceive
+
+    const ServerState * requester = (const ServerState *)connection->GetUserData();
+
+    // randomize the start index so requests are spread across all peers
+    // instead of every worker fetching from the same one
+    const size_t numServers = m_ServerList.GetSize();
+    Random r;
+    const size_t startIndex = numServers ? r.GetRandIndex( (uint32_t)numServers ) : 0;
+
+    for ( size_t j = 0; j < numServers; ++j )
+    {
+        ServerState & ss = m_ServerList[ ( j + startIndex ) % numServers ];
+        if ( &ss == requester )
+        {
+            continue;
+        }
+
+        MutexHolder mh( ss.m_Mutex );
+        if ( ss.m_Connection && ss.m_ToolIds.Find( toolId ) )
+        {
+            outPeers.Append( ss.m_RemoteName );
+            if ( outPeers.GetSize() == MAX_TOOLCHAIN_PEERS )
+            {
+                return;
+            }
+        }
+    }
+}
+
+// GetJobCostPreference
+//------------------------------------------------------------------------------
+JobQueue::JobCostPreference Client::GetJobCostPreference( ServerState * requester )
+{
+    // NOTE: m_ServerListMutex is held by OnReceive
+
+    float requesterTimeMS;
+    {
+        MutexHolder mh( requester->m_Mutex );
+        if ( requester->m_Performance.GetPredictedJobTimeMS( m_AverageJobTimeMS, requesterTimeMS ) == false )
+        {
+            return JobQueue::JOB_COST_ANY; // not enough history yet
+        }
+    }
+
+    // rank the requester against the other workers we know the speed of
+    uint32_t numRanked = 0;
+    uint32_t numFaster = 0;
+    for ( ServerState & ss : m_ServerList )
+    {
+        if ( &ss == requester )
+        {
+            continue;
+        }
+
+        MutexHolder mh( ss.m_Mutex );
+        float timeMS;
+        if ( ss.m_Connection && ( ss.m_Blacklisted == false ) && ss.m_Performance.GetPredictedJobTimeMS( m_AverageJobTimeMS, timeMS ) )
+        {
+            ++numRanked;
+            if ( timeMS < requesterTimeMS )
+            {
+                ++numFaster;
+            }
+        }
+    }
+
+    if ( numRanked == 0 )
+    {
+        return JobQueue::JOB_COST_ANY; // nothing to compare against
+    }
+
+    // the faster half gets the expensive jobs, so they don't end up as the
+    // tail of the build on a slow or distant worker
+    return ( ( numFaster * 2 ) <= numRanked ) ? JobQueue::JOB_COST_MOST_EXPENSIVE
+                                              : JobQueue::JOB_COST_CHEAPEST;
+}
+
+// RecordJobResult
+//------------------------------------------------------------------------------
+void Client::RecordJobResult( ServerState & ss, const Job * job, uint32_t buildTimeMS, size_t payloadSize, bool result, bool systemError )
+{
+    // NOTE: m_ServerListMutex is held by OnReceive and ss.m_Mutex by the caller
+
+    ss.m_BytesReceived += payloadSize;
+
+    if ( systemError )
+    {
+        ss.m_Performance.RecordJobFailed();
+    }
+    else if ( result )
+    {
+        // the node still holds the previous build time (0 if it was never built)
+        const float roundTripMS = (float)( Timer::GetNow() - job->GetRemoteSendTime() ) * Timer::GetFrequencyInvFloatMS();
+        const uint32_t lastBuildTimeMS = job->GetNode()->GetLastBuildTime();
+        ss.m_Performance.RecordJobCompleted( lastBuildTimeMS, buildTimeMS, roundTripMS );
+
+        if ( lastBuildTimeMS > 0 )
+        {
+            m_AverageJobTimeMS = ( m_AverageJobTimeMS == 0.0f ) ? (float)lastBuildTimeMS
+                                                                : m_AverageJobTimeMS + ( (float)lastBuildTimeMS - m_AverageJobTimeMS ) * WORKER_PERFORMANCE_SMOOTHING;
+        }
+    }
+
+    if ( FLog::IsMonitorEnabled() )
+    {
+        const float activeMinutes = Math::Max( ss.m_ActiveTimer.GetElapsed() / 60.0f, 0.001f );
+        const float transferSeconds = Math::Max( ss.m_Performance.GetTotalOverheadMS() / 1000.0f, 0.001f );
+        const float failureRate = ss.m_Performance.GetFailureRate();
+        const char * name = ss.m_RemoteName.Get();
+        FLOG_MONITOR( "GRAPH %s \"Throughput\" jobs/min %f\n", name, (float)ss.m_Performance.GetNumJobsCompleted() / activeMinutes );
+        FLOG_MONITOR( "GRAPH %s \"Speed Ratio\" x %f\n", name, ss.m_Performance.GetSpeedRatio() );
+        FLOG_MONITOR( "GRAPH %s \"Round Trip Overhead\" ms %f\n", name, ss.m_Performance.GetOverheadMS() );
+        FLOG_MONITOR( "GRAPH %s \"Transfer Rate\" KB/s %f\n", name, (float)( ss.m_BytesSent + ss.m_BytesReceived ) / ( (float)KILOBYTE * transferSeconds ) );
+        FLOG_MONITOR( "GRAPH %s \"Failure Rate\" %% %f\n", name, failureRate * 100.0f );
+    }
+}
+
 // FindManifest
 //------------------------------------------------------------------------------
 const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const
@@ -766,8 +962,7 @@ const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, ui
           it != ss->m_Jobs.End();
           ++it )
     {
-        Node * n = ( *it )->GetNode()->CastTo< ObjectNode >()->GetCompiler();
-        const ToolManifest & m = n->CastTo< CompilerNode >()->GetManifest();
+        const ToolManifest & m = GetManifest( *it );
         if ( m.GetToolId() == toolId )
         {
             // found a job with the same toolid
@@ -778,6 +973,18 @@ const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, ui
     return nullptr;
 }
 
+// GetManifest
+//------------------------------------------------------------------------------
+/*static*/ const ToolManifest & Client::GetManifest( const Job * job )
+{
+    // the tool is provided by the Compiler() used by the distributed node
+    const Node * node = job->GetNode();
+    const CompilerNode * compiler = ( node->GetType() == Node::EXEC_NODE ) ? node->CastTo< ExecNode >()->GetCompiler()
+                                                                           : node->CastTo< ObjectNode >()->GetCompiler();
+    ASSERT( compiler );
+    return compiler->GetManifest();
+}
+
 // WriteFileToDisk
 //------------------------------------------------------------------------------
 bool Client::WriteFileToDisk( const AString & fileName, const char * data, const uint32_t dataSize ) const
@@ -817,6 +1024,10 @@ Client::ServerState::ServerState()
     , m_NumJobsAvailable( 0 )
     , m_Jobs( 16, true )
     , m_Blacklisted( false )
+    , m_ToolIds( 4, true )
+    , m_NumJobsSent( 0 )
+    , m_BytesSent( 0 )
+    , m_BytesReceived( 0 )
 {
     m_DelayTimer.Start( 999.0f );
 }
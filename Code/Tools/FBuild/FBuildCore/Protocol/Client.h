@@ -10,6 +10,9 @@
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 
+#include "Tools/FBuild/FBuildCore/Protocol/WorkerPerformance.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
 // Forward Declarations
 //------------------------------------------------------------------------------
 class Job;
@@ -22,6 +25,7 @@ namespace Protocol
     class MsgRequestManifest;
     class MsgRequestFile;
     class MsgServerStatus;
+    class MsgToolAvailable;
 }
 class ToolManifest;
 
@@ -45,10 +49,17 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgServerStatus * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgToolAvailable * msg );
 
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
+    static const ToolManifest & GetManifest( const Job * job );
+    void GetPeersWithTool( const ConnectionInfo * connection, uint64_t toolId, Array< AString > & outPeers );
     bool WriteFileToDisk( const AString & fileName, const char * data, const uint32_t dataSize ) const;
 
+    struct ServerState;
+    JobQueue::JobCostPreference GetJobCostPreference( ServerState * requester );
+    void RecordJobResult( ServerState & ss, const Job * job, uint32_t buildTimeMS, size_t payloadSize, bool result, bool systemError );
+
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
 
@@ -84,11 +95,21 @@ private:
         Timer                   m_StatusTimer;
 
         bool                    m_Blacklisted;
+        Array< uint64_t >       m_ToolIds;              // toolchains this server holds and can share with other servers
+
+        // performance history, used to match expensive jobs to fast workers
+        // (kept across reconnections)
+        WorkerPerformance       m_Performance;
+        uint32_t                m_NumJobsSent;
+        uint64_t                m_BytesSent;
+        uint64_t                m_BytesReceived;
+        Timer                   m_ActiveTimer;          // started when the first job is sent
     };
     Mutex                   m_ServerListMutex;
     Array< ServerState >    m_ServerList;
     uint32_t                m_WorkerConnectionLimit;
     uint16_t                m_Port;
+    float                   m_AverageJobTimeMS;     // smoothed last known build time of completed remote jobs
 };
 
 //------------------------------------------------------------------------------
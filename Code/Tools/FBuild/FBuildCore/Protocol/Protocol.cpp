@@ -34,7 +34,11 @@
             "Manifest",
             "RequestFile",
             "File",
-            "ServerStatus"
+            "ServerStatus",
+            "ToolAvailable",
+            "BrokerageRegister",
+            "BrokerageQuery",
+            "BrokerageWorkers"
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -196,4 +200,36 @@ Protocol::MsgServerStatus::MsgServerStatus()
     : Protocol::IMessage( Protocol::MSG_SERVER_STATUS, sizeof( MsgServerStatus ), false )
 {}
 
+// MsgToolAvailable
+//------------------------------------------------------------------------------
+Protocol::MsgToolAvailable::MsgToolAvailable( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_TOOL_AVAILABLE, sizeof( MsgToolAvailable ), false )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgBrokerageRegister
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageRegister::MsgBrokerageRegister()
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_REGISTER, sizeof( MsgBrokerageRegister ), true )
+    , m_ProtocolVersion( PROTOCOL_VERSION )
+{
+}
+
+// MsgBrokerageQuery
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageQuery::MsgBrokerageQuery()
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_QUERY, sizeof( MsgBrokerageQuery ), false )
+    , m_ProtocolVersion( PROTOCOL_VERSION )
+{
+}
+
+// MsgBrokerageWorkers
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageWorkers::MsgBrokerageWorkers()
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_WORKERS, sizeof( MsgBrokerageWorkers ), true )
+{
+}
+
 //------------------------------------------------------------------------------
@@ -28,7 +28,11 @@ class TCPConnectionPool;
 namespace Protocol
 {
     enum { PROTOCOL_PORT = 31264 }; // Arbitrarily chosen port
-    enum { PROTOCOL_VERSION = 17 };
+    enum { PROTOCOL_VERSION = 19 };
+
+    enum { BROKERAGE_PORT = 31274 };                    // Arbitrarily chosen port for the brokerage service
+    enum { BROKERAGE_REGISTRATION_FREQUENCY_MS = 2000 };// frequency of worker registration updates to the brokerage service
+    enum { BROKERAGE_REGISTRATION_TIMEOUT_MS = 30000 }; // worker is gone if time elapses between registration updates
 
     enum { SERVER_STATUS_FREQUENCY_MS = 1000 }; // frequency of server status updates to client
     enum { SERVER_STATUS_TIMEOUT_MS = 30000 };  // server is dead if time elapses between updates
@@ -54,6 +58,12 @@ namespace Protocol
 
         MSG_SERVER_STATUS       = 11,// Server -> Client : Send status / keep connection alive
 
+        MSG_TOOL_AVAILABLE      = 12,// Server -> Client : Advertise a fully synchronized toolchain
+
+        MSG_BROKERAGE_REGISTER  = 13,// Server -> Brokerage : Register/update worker availability and capacity
+        MSG_BROKERAGE_QUERY     = 14,// Client -> Brokerage : Ask for available workers
+        MSG_BROKERAGE_WORKERS   = 15,// Client <- Brokerage : Respond with available workers
+
         NUM_MESSAGES            // leave last
     };
 };
@@ -230,6 +240,55 @@ namespace Protocol
         MsgServerStatus();
     };
     static_assert( sizeof( MsgServerStatus ) == sizeof( IMessage ), "MsgServerStatus message has incorrect size" );
+
+    // MsgToolAvailable
+    //------------------------------------------------------------------------------
+    class MsgToolAvailable : public IMessage
+    {
+    public:
+        explicit MsgToolAvailable( uint64_t toolId );
+
+        inline uint64_t GetToolId() const { return m_ToolId; }
+    private:
+        char     m_Padding2[ 4 ];
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgToolAvailable ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgToolAvailable message has incorrect size" );
+
+    // MsgBrokerageRegister
+    //------------------------------------------------------------------------------
+    class MsgBrokerageRegister : public IMessage
+    {
+    public:
+        MsgBrokerageRegister();
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+    private:
+        uint32_t        m_ProtocolVersion;
+    };
+    static_assert( sizeof( MsgBrokerageRegister ) == sizeof( IMessage ) + 4, "MsgBrokerageRegister message has incorrect size" );
+
+    // MsgBrokerageQuery
+    //------------------------------------------------------------------------------
+    class MsgBrokerageQuery : public IMessage
+    {
+    public:
+        MsgBrokerageQuery();
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+    private:
+        uint32_t        m_ProtocolVersion;
+    };
+    static_assert( sizeof( MsgBrokerageQuery ) == sizeof( IMessage ) + 4, "MsgBrokerageQuery message has incorrect size" );
+
+    // MsgBrokerageWorkers
+    //------------------------------------------------------------------------------
+    class MsgBrokerageWorkers : public IMessage
+    {
+    public:
+        MsgBrokerageWorkers();
+    };
+    static_assert( sizeof( MsgBrokerageWorkers ) == sizeof( IMessage ), "MsgBrokerageWorkers message has incorrect size" );
 };
 
 //------------------------------------------------------------------------------
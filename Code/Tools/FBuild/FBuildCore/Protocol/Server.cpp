@@ -23,12 +23,14 @@
 // Defines
 //------------------------------------------------------------------------------
 #define SERVER_STATUS_SEND_FREQUENCY ( 1.0f )
+#define PEER_CONNECTION_TIMEOUT_MS ( 1000 )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Server::Server( uint32_t numThreadsInJobQueue )
     : m_ShouldExit( false )
     , m_ClientList( 32, true )
+    , m_PeerFetches( 0, true )
 {
     m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors() ) );
 
@@ -37,6 +39,12 @@ Server::Server( uint32_t numThreadsInJobQueue )
                                      ( 64 * KILOBYTE ),
                                      this );
     ASSERT( m_Thread );
+
+    m_PeerThread = Thread::CreateThread( PeerThreadFuncStatic,
+                                         "ServerPeers",
+                                         ( 64 * KILOBYTE ),
+                                         this );
+    ASSERT( m_PeerThread );
 }
 
 // DESTRUCTOR
@@ -46,10 +54,18 @@ Server::~Server()
     m_ShouldExit = true;
     JobQueueRemote::Get().WakeMainThread();
     Thread::WaitForThread( m_Thread );
+    m_PeerFetchSemaphore.Signal();
+    Thread::WaitForThread( m_PeerThread );
 
     ShutdownAllConnections();
 
     Thread::CloseHandle( m_Thread );
+    Thread::CloseHandle( m_PeerThread );
+
+    for ( PeerFetch * fetch : m_PeerFetches )
+    {
+        FDELETE fetch;
+    }
 
     FDELETE m_JobQueueRemote;
 
@@ -104,15 +120,58 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     return false; // no toolchain is currently synching
 }
 
+// GetSynchronizedToolIds
+//------------------------------------------------------------------------------
+void Server::GetSynchronizedToolIds( Array< uint64_t > & toolIds ) const
+{
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+
+    toolIds.Clear();
+    for ( const ToolManifest * tm : m_Tools )
+    {
+        if ( tm->IsSynchronized() )
+        {
+            toolIds.Append( tm->GetToolId() );
+        }
+    }
+}
+
 // OnConnected
 //------------------------------------------------------------------------------
 /*virtual*/ void Server::OnConnected( const ConnectionInfo * connection )
 {
-    ClientState * cs = FNEW( ClientState( connection ) );
-    connection->SetUserData( cs );
+    // Outgoing connections to peer workers have their state created up-front
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    if ( cs )
+    {
+        ASSERT( cs->m_PeerManifest );
+        cs->m_Connection = connection;
+    }
+    else
+    {
+        cs = FNEW( ClientState( connection ) );
+        connection->SetUserData( cs );
+    }
 
-    MutexHolder mh( m_ClientListMutex );
-    m_ClientList.Append( cs );
+    {
+        MutexHolder mh( m_ClientListMutex );
+        m_ClientList.Append( cs );
+    }
+
+    if ( cs->m_PeerManifest )
+    {
+        // Peers only provide files once the handshake is done
+        Protocol::MsgConnection msg( 0 ); // no jobs available
+        msg.Send( connection );
+
+        // Fetch the toolchain from the peer. If another connection claimed the
+        // remaining files in the meantime, this peer is not needed anymore.
+        RequestMissingFiles( connection, cs->m_PeerManifest );
+        if ( cs->m_PeerManifest->GetUserData() != connection )
+        {
+            Disconnect( connection );
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -267,6 +326,18 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_REQUEST_FILE:
+        {
+            const Protocol::MsgRequestFile * msg = static_cast< const Protocol::MsgRequestFile * >( imsg );
+            Process( connection, msg );
+            break;
+        }
+        case Protocol::MSG_SERVER_STATUS:
+        case Protocol::MSG_TOOL_AVAILABLE:
+        {
+            // only received on connections to peer workers - nothing to do
+            break;
+        }
         default:
         {
             // unknown message type
@@ -300,6 +371,18 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConn
     ClientState * cs = (ClientState *)connection->GetUserData();
     cs->m_NumJobsAvailable = msg->GetNumJobsAvailable();
     cs->m_HostName = msg->GetHostName();
+
+    // let the client know which toolchains we can share with other workers
+    MutexHolder mh( cs->m_Mutex );
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+    for ( const ToolManifest * manifest : m_Tools )
+    {
+        if ( manifest->IsSynchronized() )
+        {
+            Protocol::MsgToolAvailable toolMsg( manifest->GetToolId() );
+            toolMsg.Send( connection );
+        }
+    }
 }
 
 // Process( MsgStatus )
@@ -388,6 +471,10 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
     const uint64_t toolId = msg->GetToolId();
     ConstMemoryStream ms( payload, payloadSize );
 
+    // other workers which already have this toolchain
+    Array< AString > peers;
+    uint16_t peerPort( 0 );
+
     {
         MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
 
@@ -396,17 +483,38 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         ASSERT( found );
         manifest = *found;
         manifest->DeserializeFromRemote( ms );
+
+        ms.Read( peers );
+        ms.Read( peerPort );
     }
 
     // manifest has checked local files, from previous sessions an may
     // be synchronized
     if ( manifest->IsSynchronized() )
     {
+        AdvertiseTool( manifest );
         CheckWaitingJobs( manifest );
         return;
     }
 
-    RequestMissingFiles( connection, manifest );
+    // No peers have this toolchain, so fetch it from the client
+    if ( peers.IsEmpty() )
+    {
+        RequestMissingFiles( connection, manifest );
+        return;
+    }
+
+    // Prefer to fetch from a peer (falling back to the client if none can be
+    // reached). Connecting can be slow, so is done on another thread.
+    PeerFetch * fetch = FNEW( PeerFetch );
+    fetch->m_Manifest = manifest;
+    fetch->m_Peers.Swap( peers );
+    fetch->m_Port = peerPort;
+    {
+        MutexHolder mh( m_PeerFetchesMutex );
+        m_PeerFetches.Append( fetch );
+    }
+    m_PeerFetchSemaphore.Signal();
 }
 
 // Process( MsgFile )
@@ -443,11 +551,64 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
         manifest->SetUserData( nullptr );
     }
 
+    // Connections to peers exist only to fetch one toolchain
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    if ( cs->m_PeerManifest )
+    {
+        Disconnect( connection );
+    }
+
+    // Other workers can now fetch this toolchain from us
+    AdvertiseTool( manifest );
+
     // ToolChain is now synchronized
     // Allow any jobs that were waiting on it to start
     CheckWaitingJobs( manifest );
 }
 
+// Process( MsgRequestFile )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg )
+{
+    // A peer worker is fetching a toolchain file from us (which is only
+    // allowed once it has completed the handshake)
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    if ( cs->m_HostName.IsEmpty() )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t fileId = msg->GetFileId();
+
+    void * data = nullptr;
+    uint32_t dataSize = 0;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        if ( ( found == nullptr ) ||
+             ( fileId >= ( *found )->GetFiles().GetSize() ) ||
+             ( ( *found )->LoadRemoteFileData( fileId, data, dataSize ) == false ) )
+        {
+            // We can't provide this file. Dropping the connection causes
+            // the peer to fall back to requesting it from its client.
+            FREE( data );
+            Disconnect( connection );
+            return;
+        }
+    }
+
+    ConstMemoryStream ms( data, dataSize );
+
+    MutexHolder mh( cs->m_Mutex );
+    Protocol::MsgFile resultMsg( toolId, fileId );
+    resultMsg.Send( connection, ms );
+
+    FREE( data );
+}
+
 // CheckWaitingJobs
 //------------------------------------------------------------------------------
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
@@ -517,6 +678,47 @@ void Server::ThreadFunc()
     }
 }
 
+// PeerThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::PeerThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "ServerPeerThread" )
+
+    Server * s = (Server *)param;
+    s->PeerThreadFunc();
+    return 0;
+}
+
+// PeerThreadFunc
+//------------------------------------------------------------------------------
+void Server::PeerThreadFunc()
+{
+    while ( m_ShouldExit == false )
+    {
+        m_PeerFetchSemaphore.Wait();
+
+        for ( ;; )
+        {
+            PeerFetch * fetch;
+            {
+                MutexHolder mh( m_PeerFetchesMutex );
+                if ( m_ShouldExit || m_PeerFetches.IsEmpty() )
+                {
+                    break;
+                }
+                fetch = m_PeerFetches[ 0 ];
+                m_PeerFetches.PopFront();
+            }
+
+            if ( RequestMissingFilesFromPeers( fetch->m_Peers, fetch->m_Port, fetch->m_Manifest ) == false )
+            {
+                RequestMissingFilesFromClients( fetch->m_Manifest );
+            }
+            FDELETE fetch;
+        }
+    }
+}
+
 // FindNeedyClients
 //------------------------------------------------------------------------------
 void Server::FindNeedyClients()
@@ -536,7 +738,10 @@ void Server::FindNeedyClients()
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
+    if ( WorkerThreadRemote::IsThrottled() == false )
+    {
+        ++availableJobs; // over request to parallelize building/network transfers
+    }
 
     ClientState ** iter = m_ClientList.Begin();
     const ClientState * const * end = m_ClientList.End();
@@ -657,6 +862,10 @@ void Server::SendServerStatus()
     for ( ClientState ** it = m_ClientList.Begin(); it !=  end; ++it )
     {
         ClientState * cs = *it;
+        if ( cs->m_PeerManifest )
+        {
+            continue; // peer workers don't track our status
+        }
         MutexHolder mh2( cs->m_Mutex );
         if ( cs->m_StatusTimer.GetElapsedMS() < Protocol::SERVER_STATUS_FREQUENCY_MS )
         {
@@ -698,4 +907,63 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
     }
 }
 
+// RequestMissingFilesFromPeers
+//------------------------------------------------------------------------------
+bool Server::RequestMissingFilesFromPeers( const Array< AString > & peers, uint16_t port, ToolManifest * manifest )
+{
+    for ( const AString & peer : peers )
+    {
+        // Files are requested once the connection is established (see OnConnected)
+        ClientState * peerState = FNEW( ClientState( nullptr ) );
+        peerState->m_PeerManifest = manifest;
+        if ( Connect( peer, port, PEER_CONNECTION_TIMEOUT_MS, peerState ) )
+        {
+            FLOG_INFO( "Fetching toolchain 0x%" PRIx64 " from peer '%s'\n", manifest->GetToolId(), peer.Get() );
+            return true;
+        }
+        FDELETE peerState;
+    }
+    return false; // no peer could be reached
+}
+
+// RequestMissingFilesFromClients
+//------------------------------------------------------------------------------
+void Server::RequestMissingFilesFromClients( ToolManifest * manifest )
+{
+    // request from a client with jobs waiting for this toolchain
+    MutexHolder mh( m_ClientListMutex );
+    for ( ClientState * cs : m_ClientList )
+    {
+        MutexHolder mh2( cs->m_Mutex );
+        for ( const Job * job : cs->m_WaitingJobs )
+        {
+            if ( job->GetToolManifest() == manifest )
+            {
+                RequestMissingFiles( cs->m_Connection, manifest );
+                return;
+            }
+        }
+    }
+}
+
+// AdvertiseTool
+//------------------------------------------------------------------------------
+void Server::AdvertiseTool( const ToolManifest * manifest )
+{
+    ASSERT( manifest->IsSynchronized() );
+
+    Protocol::MsgToolAvailable msg( manifest->GetToolId() );
+
+    MutexHolder mh( m_ClientListMutex );
+    for ( ClientState * cs : m_ClientList )
+    {
+        if ( cs->m_PeerManifest || cs->m_HostName.IsEmpty() )
+        {
+            continue; // only clients which completed the handshake share toolchain locations
+        }
+        MutexHolder mh2( cs->m_Mutex );
+        msg.Send( cs->m_Connection );
+    }
+}
+
 //------------------------------------------------------------------------------
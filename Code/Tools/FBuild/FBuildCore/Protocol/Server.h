@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
@@ -19,6 +20,7 @@ namespace Protocol
     class MsgManifest;
     class MsgNoJobAvailable;
     class MsgStatus;
+    class MsgRequestFile;
     class MsgFile;
 }
 class ToolManifest;
@@ -34,6 +36,7 @@ public:
     static void GetHostForJob( const Job * job, AString & hostName );
 
     bool IsSynchingTool( AString & statusStr ) const;
+    void GetSynchronizedToolIds( Array< uint64_t > & toolIds ) const;
 
 private:
     // TCPConnection interface
@@ -47,10 +50,13 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobAvailable * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
+    static uint32_t PeerThreadFuncStatic( void * param );
+    void            PeerThreadFunc();
 
     void            FindNeedyClients();
     void            FinalizeCompletedJobs();
@@ -58,10 +64,13 @@ private:
     void            CheckWaitingJobs( const ToolManifest * manifest );
 
     void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
+    bool            RequestMissingFilesFromPeers( const Array< AString > & peers, uint16_t port, ToolManifest * manifest );
+    void            RequestMissingFilesFromClients( ToolManifest * manifest );
+    void            AdvertiseTool( const ToolManifest * manifest );
 
     struct ClientState
     {
-        explicit ClientState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_NumJobsAvailable( 0 ), m_NumJobsRequested( 0 ), m_NumJobsActive( 0 ), m_WaitingJobs( 16, true ) {}
+        explicit ClientState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_NumJobsAvailable( 0 ), m_NumJobsRequested( 0 ), m_NumJobsActive( 0 ), m_WaitingJobs( 16, true ), m_PeerManifest( nullptr ) {}
 
         inline bool operator < ( const ClientState & other ) const { return ( m_NumJobsAvailable > other.m_NumJobsAvailable ); }
 
@@ -78,14 +87,28 @@ private:
         Array< Job * >          m_WaitingJobs; // jobs waiting for manifests/toolchains
 
         Timer                   m_StatusTimer;
+
+        ToolManifest *          m_PeerManifest; // for outgoing connections to peer workers, the toolchain being fetched
+    };
+
+    // a toolchain to fetch from other workers
+    struct PeerFetch
+    {
+        ToolManifest *          m_Manifest;
+        Array< AString >        m_Peers;
+        uint16_t                m_Port;
     };
 
     JobQueueRemote *        m_JobQueueRemote;
 
     volatile bool           m_ShouldExit;   // signal from main thread
     Thread::ThreadHandle    m_Thread;       // the thread to manage workload
+    Thread::ThreadHandle    m_PeerThread;   // connects to peer workers (which can be slow) for toolchains
     Mutex                   m_ClientListMutex;
     Array< ClientState * >  m_ClientList;
+    Semaphore               m_PeerFetchSemaphore;
+    Mutex                   m_PeerFetchesMutex;
+    Array< PeerFetch * >    m_PeerFetches;
 
     mutable Mutex           m_ToolManifestsMutex;
     Array< ToolManifest * > m_Tools;
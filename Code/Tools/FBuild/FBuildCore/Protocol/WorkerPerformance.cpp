@@ -0,0 +1,74 @@
+// WorkerPerformance
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "WorkerPerformance.h"
+
+#include "Core/Math/Conversions.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define MIN_SPEED_SAMPLES ( 3 )     // completed jobs before a worker's speed is trusted
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerPerformance::WorkerPerformance()
+    : m_NumJobsCompleted( 0 )
+    , m_NumJobsFailed( 0 )
+    , m_NumSpeedSamples( 0 )
+    , m_SpeedRatio( 1.0f )
+    , m_OverheadMS( 0.0f )
+    , m_TotalOverheadMS( 0.0f )
+{
+}
+
+// RecordJobCompleted
+//------------------------------------------------------------------------------
+void WorkerPerformance::RecordJobCompleted( uint32_t lastBuildTimeMS, uint32_t buildTimeMS, float roundTripMS )
+{
+    // the ratio tells us how fast this worker is compared to wherever the node
+    // was built before, which can't be known for a node never built before
+    if ( lastBuildTimeMS > 0 )
+    {
+        const float speedRatio = (float)buildTimeMS / (float)lastBuildTimeMS;
+        m_SpeedRatio = ( m_NumSpeedSamples == 0 ) ? speedRatio
+                                                  : m_SpeedRatio + ( speedRatio - m_SpeedRatio ) * WORKER_PERFORMANCE_SMOOTHING;
+        ++m_NumSpeedSamples;
+    }
+
+    const float overheadMS = Math::Max( roundTripMS - (float)buildTimeMS, 0.0f );
+    m_OverheadMS = ( m_NumJobsCompleted == 0 ) ? overheadMS
+                                               : m_OverheadMS + ( overheadMS - m_OverheadMS ) * WORKER_PERFORMANCE_SMOOTHING;
+    m_TotalOverheadMS += overheadMS;
+    ++m_NumJobsCompleted;
+}
+
+// GetPredictedJobTimeMS
+//------------------------------------------------------------------------------
+bool WorkerPerformance::GetPredictedJobTimeMS( float jobTimeMS, float & outTimeMS ) const
+{
+    if ( m_NumSpeedSamples < MIN_SPEED_SAMPLES )
+    {
+        return false;
+    }
+
+    // time for the job on this worker, including the round trip
+    outTimeMS = ( m_SpeedRatio * jobTimeMS ) + m_OverheadMS;
+
+    // account for the jobs which have to be retried elsewhere
+    outTimeMS /= Math::Max( 1.0f - GetFailureRate(), 0.1f );
+    return true;
+}
+
+// GetFailureRate
+//------------------------------------------------------------------------------
+float WorkerPerformance::GetFailureRate() const
+{
+    const uint32_t numJobs = ( m_NumJobsCompleted + m_NumJobsFailed );
+    return ( numJobs > 0 ) ? (float)m_NumJobsFailed / (float)numJobs : 0.0f;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,44 @@
+// WorkerPerformance - Measured speed of a remote worker
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define WORKER_PERFORMANCE_SMOOTHING ( 0.2f ) // weight of the newest sample in smoothed stats
+
+// WorkerPerformance
+//------------------------------------------------------------------------------
+class WorkerPerformance
+{
+public:
+    WorkerPerformance();
+
+    // lastBuildTimeMS is the build time of the job before it was sent (0 if never built)
+    void RecordJobCompleted( uint32_t lastBuildTimeMS, uint32_t buildTimeMS, float roundTripMS );
+    inline void RecordJobFailed() { ++m_NumJobsFailed; }
+
+    // predicted time for a job taking jobTimeMS where it was last built,
+    // including the round trip (false until there is enough history)
+    bool GetPredictedJobTimeMS( float jobTimeMS, float & outTimeMS ) const;
+
+    inline uint32_t GetNumJobsCompleted() const { return m_NumJobsCompleted; }
+    inline uint32_t GetNumJobsFailed() const    { return m_NumJobsFailed; }
+    inline float    GetSpeedRatio() const       { return m_SpeedRatio; }
+    inline float    GetOverheadMS() const       { return m_OverheadMS; }
+    inline float    GetTotalOverheadMS() const  { return m_TotalOverheadMS; }
+    float           GetFailureRate() const;
+
+private:
+    uint32_t    m_NumJobsCompleted;     // built successfully
+    uint32_t    m_NumJobsFailed;        // system errors and timeouts
+    uint32_t    m_NumSpeedSamples;      // completed jobs which had a previous build time
+    float       m_SpeedRatio;           // smoothed remote build time relative to the last known build time
+    float       m_OverheadMS;           // smoothed round trip time not spent building (latency, transfer)
+    float       m_TotalOverheadMS;
+};
+
+//------------------------------------------------------------------------------
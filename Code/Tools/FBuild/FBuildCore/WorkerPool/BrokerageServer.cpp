@@ -0,0 +1,221 @@
+// BrokerageServer - Service tracking available workers
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "BrokerageServer.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Profile/Profile.h"
+
+// WorkerInfoSorter
+//------------------------------------------------------------------------------
+class WorkerInfoSorter
+{
+public:
+    // most free cpus first, then least loaded
+    inline bool operator () ( const WorkerBrokerage::WorkerInfo * a, const WorkerBrokerage::WorkerInfo * b ) const
+    {
+        if ( a->m_NumFreeCPUs != b->m_NumFreeCPUs )
+        {
+            return ( a->m_NumFreeCPUs > b->m_NumFreeCPUs );
+        }
+        return ( a->m_CPULoad < b->m_CPULoad );
+    }
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageServer::BrokerageServer()
+    : m_ConnectionStates( 64, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageServer::~BrokerageServer()
+{
+    ShutdownAllConnections();
+}
+
+// GetNumRegisteredWorkers
+//------------------------------------------------------------------------------
+size_t BrokerageServer::GetNumRegisteredWorkers() const
+{
+    MutexHolder mh( m_ConnectionStatesMutex );
+
+    size_t numWorkers = 0;
+    for ( const ConnectionState * cs : m_ConnectionStates )
+    {
+        if ( cs->m_IsRegistered )
+        {
+            ++numWorkers;
+        }
+    }
+    return numWorkers;
+}
+
+// OnConnected
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageServer::OnConnected( const ConnectionInfo * connection )
+{
+    ConnectionState * cs = FNEW( ConnectionState( connection ) );
+    connection->SetUserData( cs );
+
+    MutexHolder mh( m_ConnectionStatesMutex );
+    m_ConnectionStates.Append( cs );
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageServer::OnDisconnected( const ConnectionInfo * connection )
+{
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // a worker is unregistered when its connection drops
+    {
+        MutexHolder mh( m_ConnectionStatesMutex );
+        VERIFY( m_ConnectionStates.FindAndErase( cs ) );
+    }
+
+    // This is usually null here, but might need to be freed if
+    // we had the connection drop between message and payload
+    FREE( (void *)( cs->m_CurrentMessage ) );
+
+    FDELETE cs;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageServer::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    keepMemory = true; // we'll take care of freeing the memory
+
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // are we expecting a msg, or the payload for a msg?
+    void * payload = nullptr;
+    size_t payloadSize = 0;
+    if ( cs->m_CurrentMessage == nullptr )
+    {
+        // message
+        cs->m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
+        if ( cs->m_CurrentMessage->HasPayload() )
+        {
+            return;
+        }
+    }
+    else
+    {
+        // payload
+        ASSERT( cs->m_CurrentMessage->HasPayload() );
+        payload = data;
+        payloadSize = size;
+    }
+
+    // determine message type
+    const Protocol::IMessage * imsg = cs->m_CurrentMessage;
+    Protocol::MessageType messageType = imsg->GetType();
+
+    PROTOCOL_DEBUG( "-> Brokerage : %u (%s)\n", messageType, GetProtocolMessageDebugName( messageType ) );
+
+    switch ( messageType )
+    {
+        case Protocol::MSG_BROKERAGE_REGISTER:
+        {
+            const Protocol::MsgBrokerageRegister * msg = static_cast< const Protocol::MsgBrokerageRegister * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_BROKERAGE_QUERY:
+        {
+            const Protocol::MsgBrokerageQuery * msg = static_cast< const Protocol::MsgBrokerageQuery * >( imsg );
+            Process( connection, msg );
+            break;
+        }
+        default:
+        {
+            // unknown message type - could be a client or worker connecting to the wrong port
+            Disconnect( connection );
+            break;
+        }
+    }
+
+    // free everything
+    FREE( (void *)( cs->m_CurrentMessage ) );
+    FREE( payload );
+    cs->m_CurrentMessage = nullptr;
+}
+
+// Process( MsgBrokerageRegister )
+//------------------------------------------------------------------------------
+void BrokerageServer::Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageRegister * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgBrokerageRegister" )
+
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+
+    WorkerBrokerage::WorkerInfo info;
+    ConstMemoryStream ms( payload, payloadSize );
+    if ( info.Deserialize( ms ) == false )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    MutexHolder mh( m_ConnectionStatesMutex );
+    cs->m_ProtocolVersion = msg->GetProtocolVersion();
+    cs->m_Info = info;
+    cs->m_IsRegistered = true;
+    cs->m_LastUpdateTimer.Start();
+}
+
+// Process( MsgBrokerageQuery )
+//------------------------------------------------------------------------------
+void BrokerageServer::Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageQuery * msg )
+{
+    PROFILE_SECTION( "MsgBrokerageQuery" )
+
+    MemoryStream ms;
+    {
+        MutexHolder mh( m_ConnectionStatesMutex );
+
+        // find available workers which can talk to the client
+        Array< const WorkerBrokerage::WorkerInfo * > workers( m_ConnectionStates.GetSize(), false );
+        for ( const ConnectionState * cs : m_ConnectionStates )
+        {
+            if ( ( cs->m_IsRegistered == false ) ||
+                 ( cs->m_ProtocolVersion != msg->GetProtocolVersion() ) ||
+                 ( cs->m_Info.m_NumCPUs == 0 ) ||
+                 ( cs->m_LastUpdateTimer.GetElapsedMS() >= (float)Protocol::BROKERAGE_REGISTRATION_TIMEOUT_MS ) )
+            {
+                continue;
+            }
+            workers.Append( &cs->m_Info );
+        }
+
+        // put the workers most likely to take work first
+        WorkerInfoSorter sorter;
+        workers.Sort( sorter );
+
+        ms.Write( (uint32_t)workers.GetSize() );
+        for ( const WorkerBrokerage::WorkerInfo * info : workers )
+        {
+            info->Serialize( ms );
+        }
+    }
+
+    Protocol::MsgBrokerageWorkers resultMsg;
+    resultMsg.Send( connection, ms );
+}
+
+//------------------------------------------------------------------------------
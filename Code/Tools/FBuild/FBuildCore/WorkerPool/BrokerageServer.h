@@ -0,0 +1,60 @@
+// BrokerageServer - Service tracking available workers
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
+
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class IMessage;
+    class MsgBrokerageRegister;
+    class MsgBrokerageQuery;
+}
+
+// BrokerageServer
+//------------------------------------------------------------------------------
+class BrokerageServer : public TCPConnectionPool
+{
+public:
+    BrokerageServer();
+    ~BrokerageServer();
+
+    size_t GetNumRegisteredWorkers() const;
+
+private:
+    // TCPConnection interface
+    virtual void OnConnected( const ConnectionInfo * connection );
+    virtual void OnDisconnected( const ConnectionInfo * connection );
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory );
+
+    // helpers to handle messages
+    void Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageRegister * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageQuery * msg );
+
+    struct ConnectionState
+    {
+        explicit ConnectionState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_ProtocolVersion( 0 ), m_IsRegistered( false ) {}
+
+        const Protocol::IMessage *  m_CurrentMessage;
+        const ConnectionInfo *      m_Connection;
+
+        // registration of a worker
+        uint32_t                    m_ProtocolVersion;
+        bool                        m_IsRegistered;
+        WorkerBrokerage::WorkerInfo m_Info;
+        Timer                       m_LastUpdateTimer;
+    };
+
+    mutable Mutex               m_ConnectionStatesMutex;
+    Array< ConnectionState * >  m_ConnectionStates;
+};
+
+//------------------------------------------------------------------------------
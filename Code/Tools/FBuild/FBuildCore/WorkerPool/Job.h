@@ -10,6 +10,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class IOStream;
+class JobResourcePool;
 class Node;
 class ToolManifest;
 
@@ -47,6 +48,20 @@ public:
     inline void             SetToolManifest( ToolManifest * manifest )  { m_ToolManifest = manifest; }
     inline ToolManifest *   GetToolManifest() const                     { return m_ToolManifest; }
 
+    inline void                 SetResourcePool( JobResourcePool * pool )   { m_ResourcePool = pool; }
+    inline JobResourcePool *    GetResourcePool() const                     { return m_ResourcePool; }
+
+    // time the job was last sent to a remote worker and how long it is expected
+    // to take there, including the round trip (0 if unknown) (client side)
+    inline void     SetRemoteSendTime( int64_t time )           { m_RemoteSendTime = time; }
+    inline int64_t  GetRemoteSendTime() const                   { return m_RemoteSendTime; }
+    inline void     SetRemoteExpectedTimeMS( uint32_t timeMS )  { m_RemoteExpectedTimeMS = timeMS; }
+    inline uint32_t GetRemoteExpectedTimeMS() const             { return m_RemoteExpectedTimeMS; }
+
+    // time a local race of this job was started (client side)
+    inline void     SetRaceStartTime( int64_t time )    { m_RaceStartTime = time; }
+    inline int64_t  GetRaceStartTime() const            { return m_RaceStartTime; }
+
     inline bool     IsDataCompressed() const { return m_DataIsCompressed; }
     inline bool     IsLocal() const     { return m_IsLocal; }
 
@@ -95,6 +110,9 @@ private:
     Node *              m_Node              = nullptr;
     void *              m_Data              = nullptr;
     void *              m_UserData          = nullptr;
+    int64_t             m_RemoteSendTime    = 0;
+    int64_t             m_RaceStartTime     = 0;
+    uint32_t            m_RemoteExpectedTimeMS = 0;
     volatile bool       m_Abort             = false;
     bool                m_DataIsCompressed  = false;
     bool                m_IsLocal           = true;
@@ -105,6 +123,7 @@ private:
     AString             m_CacheName;
 
     ToolManifest *      m_ToolManifest      = nullptr;
+    JobResourcePool *   m_ResourcePool      = nullptr;
 
     Array< AString >    m_Messages;
 
@@ -13,13 +13,21 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
 
 #include "Core/Time/Timer.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define DISTRIBUTABLE_JOB_SELECTION_WINDOW ( 16 ) // how far past the oldest job to look when matching cost
+#define LOCAL_SPEED_SMOOTHING ( 0.2f )              // weight of the newest sample in the local speed ratio
+
 // JobCostSorter
 //------------------------------------------------------------------------------
 class JobCostSorter
@@ -36,6 +44,7 @@ public:
 JobSubQueue::JobSubQueue()
     : m_Count( 0 )
     , m_Jobs( 1024, true )
+    , m_ResourcePools( 0, true )
 {
 }
 
@@ -45,6 +54,11 @@ JobSubQueue::~JobSubQueue()
 {
     ASSERT( m_Jobs.IsEmpty() );
     ASSERT( m_Count == 0 );
+
+    for ( JobResourcePool * pool : m_ResourcePools )
+    {
+        FDELETE pool;
+    }
 }
 
 // JobSubQueue:QueueJobs
@@ -56,6 +70,11 @@ void JobSubQueue::QueueJobs( Array< Node * > & nodes )
     for ( Node * node : nodes )
     {
         Job * job = FNEW( Job( node ) );
+        const AString & resourcePool = node->GetResourcePool();
+        if ( resourcePool.IsEmpty() == false )
+        {
+            job->SetResourcePool( GetResourcePool( resourcePool ) );
+        }
         jobs.Append( job );
     }
 
@@ -98,13 +117,116 @@ Job * JobSubQueue::RemoveJob()
         return nullptr;
     }
 
-    ASSERT( m_Count );
-    --m_Count;
+    // take the most expensive job, passing over any waiting for a resource pool
+    for ( size_t i = m_Jobs.GetSize(); i > 0; --i )
+    {
+        Job * job = m_Jobs[ i - 1 ];
+        JobResourcePool * pool = job->GetResourcePool();
+        if ( pool )
+        {
+            if ( pool->m_NumInUse == pool->m_Capacity )
+            {
+                continue;
+            }
+            ++pool->m_NumInUse;
+        }
 
-    Job * job = m_Jobs.Top();
-    m_Jobs.Pop();
+        ASSERT( m_Count );
+        --m_Count;
+        m_Jobs.EraseIndex( i - 1 );
+        return job;
+    }
 
-    return job;
+    return nullptr; // all remaining jobs are waiting for a resource pool
+}
+
+// AcquireResourcePool
+//------------------------------------------------------------------------------
+bool JobSubQueue::AcquireResourcePool( const Job * job )
+{
+    JobResourcePool * pool = job->GetResourcePool();
+    if ( pool == nullptr )
+    {
+        return true;
+    }
+
+    MutexHolder mh( m_Mutex );
+    if ( pool->m_NumInUse == pool->m_Capacity )
+    {
+        return false;
+    }
+    ++pool->m_NumInUse;
+    return true;
+}
+
+// IsResourcePoolFull
+//------------------------------------------------------------------------------
+bool JobSubQueue::IsResourcePoolFull( const Job * job )
+{
+    const JobResourcePool * pool = job->GetResourcePool();
+    if ( pool == nullptr )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_Mutex );
+    return ( pool->m_NumInUse == pool->m_Capacity );
+}
+
+// ReleaseResourcePool
+//------------------------------------------------------------------------------
+void JobSubQueue::ReleaseResourcePool( const Job * job )
+{
+    JobResourcePool * pool = job->GetResourcePool();
+    if ( pool == nullptr )
+    {
+        return;
+    }
+
+    MutexHolder mh( m_Mutex );
+    ASSERT( pool->m_NumInUse > 0 );
+    --pool->m_NumInUse;
+}
+
+// DeleteJobs
+//------------------------------------------------------------------------------
+void JobSubQueue::DeleteJobs()
+{
+    MutexHolder mh( m_Mutex );
+    for ( Job * job : m_Jobs )
+    {
+        FDELETE job;
+    }
+    m_Jobs.Clear();
+    m_Count = 0;
+}
+
+// GetResourcePool (Main Thread)
+//------------------------------------------------------------------------------
+JobResourcePool * JobSubQueue::GetResourcePool( const AString & name )
+{
+    for ( JobResourcePool * pool : m_ResourcePools )
+    {
+        if ( pool->m_Name == name )
+        {
+            return pool;
+        }
+    }
+
+    // pools are checked when the BFF is parsed, but can't limit anything without Settings
+    uint32_t capacity;
+    const SettingsNode * settings = FBuild::Get().GetSettings();
+    if ( ( settings == nullptr ) || ( settings->GetResourcePoolCapacity( name, capacity ) == false ) )
+    {
+        return nullptr;
+    }
+
+    JobResourcePool * pool = FNEW( JobResourcePool );
+    pool->m_Name = name;
+    pool->m_Capacity = capacity;
+    pool->m_NumInUse = 0;
+    m_ResourcePools.Append( pool );
+    return pool;
 }
 
 // CONSTRUCTOR
@@ -113,6 +235,11 @@ JobQueue::JobQueue( uint32_t numWorkerThreads ) :
     m_NumLocalJobsActive( 0 ),
     m_DistributableJobs_Available( 1024, true ),
     m_DistributableJobs_InProgress( 1024, true ),
+    m_LocalSpeedRatio( 1.0f ),
+    m_NumRacesStarted( 0 ),
+    m_NumRacesWonLocally( 0 ),
+    m_NumRacesWonRemotely( 0 ),
+    m_RaceWastedTimeMS( 0 ),
     m_CompletedJobs( 1024, true ),
     m_CompletedJobsFailed( 1024, true ),
     m_CompletedJobs2( 1024, true ),
@@ -142,10 +269,7 @@ JobQueue::~JobQueue()
     SignalStopWorkers();
 
     // delete incomplete jobs
-    while ( Job * job = m_LocalJobs_Available.RemoveJob() )
-    {
-        FDELETE job;
-    }
+    m_LocalJobs_Available.DeleteJobs();
 
     // wait for workers to finish - ok if they stopped before this
     const size_t numWorkerThreads = m_Workers.GetSize();
@@ -213,6 +337,18 @@ void JobQueue::GetJobStats( uint32_t & numJobs,
     numJobsDistActive = (uint32_t)m_DistributableJobs_InProgress.GetSize();
 }
 
+// GetRaceStats
+//------------------------------------------------------------------------------
+void JobQueue::GetRaceStats( FBuildStats & stats ) const
+{
+    MutexHolder m( m_DistributedJobsMutex );
+
+    stats.m_NumRacesStarted = m_NumRacesStarted;
+    stats.m_NumRacesWonLocally = m_NumRacesWonLocally;
+    stats.m_NumRacesWonRemotely = m_NumRacesWonRemotely;
+    stats.m_RaceWastedTimeMS = m_RaceWastedTimeMS;
+}
+
 // AddJobToBatch (Main Thread)
 //------------------------------------------------------------------------------
 void JobQueue::AddJobToBatch( Node * node )
@@ -270,13 +406,14 @@ void JobQueue::QueueDistributableJob( Job * job )
 
     ASSERT( m_NumLocalJobsActive > 0 );
     AtomicDecU32( &m_NumLocalJobsActive ); // job converts from active to pending remote
+    m_LocalJobs_Available.ReleaseResourcePool( job );
 
     m_WorkerThreadSemaphore.Signal();
 }
 
 // GetDistributableJobToProcess
 //------------------------------------------------------------------------------
-Job * JobQueue::GetDistributableJobToProcess( bool remote )
+Job * JobQueue::GetDistributableJobToProcess( bool remote, JobCostPreference costPreference )
 {
     MutexHolder m( m_DistributedJobsMutex );
 
@@ -285,9 +422,48 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote )
         return nullptr;
     }
 
-    // building jobs in the order they are queued
-    Job * job = m_DistributableJobs_Available[ 0 ];
-    m_DistributableJobs_Available.PopFront();
+    // building jobs in the order they are queued, but when the caller knows how
+    // fast it is, match the job cost to it from a small window of the oldest jobs
+    // (the window bounds how long any job can be passed over). Jobs whose
+    // resource pool is full are passed over, wherever they are built.
+    const size_t numJobs = m_DistributableJobs_Available.GetSize();
+    size_t index = numJobs;
+    uint32_t bestCost = 0;
+    size_t windowSize = 0;
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        const Job * candidate = m_DistributableJobs_Available[ i ];
+        if ( m_LocalJobs_Available.IsResourcePoolFull( candidate ) )
+        {
+            continue;
+        }
+
+        const uint32_t cost = candidate->GetNode()->GetRecursiveCost();
+        const bool better = ( costPreference == JOB_COST_MOST_EXPENSIVE ) ? ( cost > bestCost ) : ( cost < bestCost );
+        if ( ( index == numJobs ) || better )
+        {
+            bestCost = cost;
+            index = i;
+        }
+
+        if ( ( costPreference == JOB_COST_ANY ) || ( ++windowSize == DISTRIBUTABLE_JOB_SELECTION_WINDOW ) )
+        {
+            break;
+        }
+    }
+    if ( index == numJobs )
+    {
+        return nullptr; // all jobs are waiting for a resource pool
+    }
+
+    // hold a slot in the job's resource pool (if any) until it is built (released by ReleaseResourcePool)
+    if ( m_LocalJobs_Available.AcquireResourcePool( m_DistributableJobs_Available[ index ] ) == false )
+    {
+        return nullptr; // resource pool was filled by another thread
+    }
+
+    Job * job = m_DistributableJobs_Available[ index ];
+    m_DistributableJobs_Available.EraseIndex( index );
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
@@ -307,8 +483,15 @@ Job * JobQueue::GetDistributableJobToRace()
         return nullptr;
     }
 
-    // take newest job, which is least likely to finish first
-    // compared to older distributed jobs
+    // Race the job we expect to gain the most time on, comparing how long it
+    // should still take remotely with how long it should take here. When no
+    // predicted job is worth racing, jobs sent to workers we know nothing about
+    // yet are raced as before, newest first, as they are the least likely to
+    // finish first.
+    const int64_t now = Timer::GetNow();
+    Job * bestJob = nullptr;
+    Job * unpredictedJob = nullptr;
+    float bestGainMS = 0.0f;
     const int32_t numJobs = (int32_t)m_DistributableJobs_InProgress.GetSize();
     for ( int32_t i = ( numJobs - 1 ); i >= 0; --i )
     {
@@ -316,14 +499,84 @@ Job * JobQueue::GetDistributableJobToRace()
 
         // Don't Race jobs already building locally
         const Job::DistributionState distState = job->GetDistributionState();
-        if ( distState == Job::DIST_BUILDING_REMOTELY )
+        if ( distState != Job::DIST_BUILDING_REMOTELY )
         {
-            job->SetDistributionState( Job::DIST_RACING );
-            return job;
+            continue;
+        }
+
+        // Don't Race jobs which would exceed their resource pool
+        if ( m_LocalJobs_Available.IsResourcePoolFull( job ) )
+        {
+            continue;
+        }
+
+        const uint32_t remoteExpectedMS = job->GetRemoteExpectedTimeMS();
+        if ( remoteExpectedMS == 0 )
+        {
+            // no prediction possible - only raced if no predicted job is worth it
+            if ( unpredictedJob == nullptr )
+            {
+                unpredictedJob = job;
+            }
+            continue;
+        }
+
+        const float elapsedMS = (float)( now - job->GetRemoteSendTime() ) * Timer::GetFrequencyInvFloatMS();
+        const float localMS = (float)job->GetNode()->GetLastBuildTime() * m_LocalSpeedRatio;
+        const float gainMS = GetRaceGainMS( remoteExpectedMS, elapsedMS, localMS );
+        if ( gainMS > bestGainMS )
+        {
+            bestGainMS = gainMS;
+            bestJob = job;
         }
     }
 
-    return nullptr; // No job found to race (all were local or races already)
+    if ( bestJob == nullptr )
+    {
+        bestJob = unpredictedJob;
+    }
+    if ( bestJob == nullptr )
+    {
+        return nullptr; // No job worth racing (all were local, races already or expected to finish remotely first)
+    }
+    if ( m_LocalJobs_Available.AcquireResourcePool( bestJob ) == false )
+    {
+        return nullptr; // resource pool was filled by another thread (released by ReleaseResourcePool)
+    }
+
+    bestJob->SetDistributionState( Job::DIST_RACING );
+    bestJob->SetRaceStartTime( now );
+    ++m_NumRacesStarted;
+    return bestJob;
+}
+
+// GetRaceGainMS
+//------------------------------------------------------------------------------
+/*static*/ float JobQueue::GetRaceGainMS( uint32_t remoteExpectedMS, float remoteElapsedMS, float localExpectedMS )
+{
+    // A job running later than expected is treated as if it will still take
+    // as long as it is late - the later it is, the less we trust the worker
+    float remainingMS = (float)remoteExpectedMS - remoteElapsedMS;
+    if ( remainingMS < 0.0f )
+    {
+        remainingMS = -remainingMS;
+    }
+
+    return ( remainingMS - localExpectedMS );
+}
+
+// ReleaseResourcePool
+//------------------------------------------------------------------------------
+void JobQueue::ReleaseResourcePool( const Job * job )
+{
+    if ( job->GetResourcePool() == nullptr )
+    {
+        return;
+    }
+
+    // a job waiting for the resource pool can now be processed
+    m_LocalJobs_Available.ReleaseResourcePool( job );
+    m_WorkerThreadSemaphore.Signal();
 }
 
 // OnReturnRemoteJob
@@ -380,6 +633,7 @@ Job * JobQueue::OnReturnRemoteJob( uint32_t jobId )
             }
 
             // Cancellation failed - job will be managed normally (as if local)
+            OnRaceWonLocally( job );
             return nullptr;
         }
 
@@ -438,6 +692,34 @@ void JobQueue::ReturnUnfinishedDistributableJob( Job * job )
     m_WorkerThreadSemaphore.Signal();
 }
 
+// OnLocalDistributableJobBuilt
+//------------------------------------------------------------------------------
+void JobQueue::OnLocalDistributableJobBuilt( uint32_t previousBuildTimeMS, uint32_t buildTimeMS )
+{
+    if ( previousBuildTimeMS == 0 )
+    {
+        return;
+    }
+
+    // track how fast this machine is compared to where nodes were last built,
+    // so local build times can be predicted when deciding to race
+    const float speedRatio = (float)buildTimeMS / (float)previousBuildTimeMS;
+
+    MutexHolder m( m_DistributedJobsMutex );
+    m_LocalSpeedRatio += ( speedRatio - m_LocalSpeedRatio ) * LOCAL_SPEED_SMOOTHING;
+}
+
+// OnRaceWonLocally
+//------------------------------------------------------------------------------
+void JobQueue::OnRaceWonLocally( const Job * job )
+{
+    // NOTE: m_DistributedJobsMutex must be held
+
+    // the remote result will be discarded, so the time spent on it so far was wasted
+    ++m_NumRacesWonLocally;
+    m_RaceWastedTimeMS += (uint32_t)( (float)( Timer::GetNow() - job->GetRemoteSendTime() ) * Timer::GetFrequencyInvFloatMS() );
+}
+
 // FinalizeCompletedJobs (Main Thread)
 //------------------------------------------------------------------------------
 void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
@@ -488,6 +770,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERT( distState == Job::DIST_RACING );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            OnRaceWonLocally( job );
 
             // We can't delete the job yet, because it's still in use by the remote
             // job. It will be freed when the remote job completes
@@ -525,6 +808,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERT( distState == Job::DIST_RACING );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            OnRaceWonLocally( job );
 
             // We can't delete the job yet, because it's still in use by the remote
             // job. It will be freed when the remote job completes
@@ -590,6 +874,8 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
             if ( success == false )
             {
                 // Allow remote job to win race
+                ++m_NumRacesWonRemotely;
+                m_RaceWastedTimeMS += (uint32_t)( (float)( Timer::GetNow() - job->GetRaceStartTime() ) * Timer::GetFrequencyInvFloatMS() );
                 job->SetDistributionState( Job::DIST_RACE_WON_REMOTELY );
                 return; // Remote job will complete processing
             }
@@ -625,6 +911,8 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
     {
         ASSERT( m_NumLocalJobsActive > 0 );
         AtomicDecU32( &m_NumLocalJobsActive );
+
+        ReleaseResourcePool( job );
     }
 
     {
@@ -6,6 +6,7 @@
 //------------------------------------------------------------------------------
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Singleton.h"
+#include "Core/Strings/AString.h"
 
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Core/Process/Semaphore.h"
@@ -16,7 +17,17 @@
 class Node;
 class Job;
 class WorkerThread;
+struct FBuildStats;
 
+// JobResourcePool - limits how many jobs using it are processed at once
+//------------------------------------------------------------------------------
+class JobResourcePool
+{
+public:
+    AString     m_Name;
+    uint32_t    m_Capacity;
+    uint32_t    m_NumInUse;
+};
 
 // JobSubQueue
 //------------------------------------------------------------------------------
@@ -33,10 +44,19 @@ public:
 
     // jobs consumed by workers
     Job * RemoveJob();
+    bool  AcquireResourcePool( const Job * job );
+    bool  IsResourcePoolFull( const Job * job );
+    void  ReleaseResourcePool( const Job * job );
+
+    // free jobs which were never processed
+    void  DeleteJobs();
 private:
+    JobResourcePool * GetResourcePool( const AString & name );
+
     uint32_t    m_Count;    // access the current count
     Mutex       m_Mutex;    // lock to add/remove jobs
     Array< Job * > m_Jobs;  // Sorted, most expensive at end
+    Array< JobResourcePool * > m_ResourcePools; // created on first use by the main thread
 };
 
 // JobQueue
@@ -65,6 +85,10 @@ public:
 
     void GetJobStats( uint32_t & numJobs, uint32_t & numJobsActive,
                       uint32_t & numJobsDist, uint32_t & numJobsDistActive ) const;
+    void GetRaceStats( FBuildStats & stats ) const;
+
+    // time expected to be saved by racing a remote job locally (<= 0 if the remote job should finish first)
+    static float GetRaceGainMS( uint32_t remoteExpectedMS, float remoteElapsedMS, float localExpectedMS );
 
 private:
     // worker threads call these
@@ -74,12 +98,24 @@ private:
     Job *       GetDistributableJobToRace();
     static Node::BuildResult DoBuild( Job * job );
     void        FinishedProcessingJob( Job * job, bool result, bool wasARemoteJob );
+    void        ReleaseResourcePool( const Job * job );
 
     void        QueueDistributableJob( Job * job );
 
+    // local build of a distributable job completed
+    friend class JobQueueRemote;
+    void        OnLocalDistributableJobBuilt( uint32_t previousBuildTimeMS, uint32_t buildTimeMS );
+    void        OnRaceWonLocally( const Job * job );
+
     // client side of protocol consumes jobs via this interface
     friend class Client;
-    Job *       GetDistributableJobToProcess( bool remote );
+    enum JobCostPreference
+    {
+        JOB_COST_ANY,               // oldest job first
+        JOB_COST_CHEAPEST,          // cheapest of the oldest jobs (slow workers)
+        JOB_COST_MOST_EXPENSIVE,    // most expensive of the oldest jobs (fast workers)
+    };
+    Job *       GetDistributableJobToProcess( bool remote, JobCostPreference costPreference = JOB_COST_ANY );
     Job *       OnReturnRemoteJob( uint32_t jobId );
     void        ReturnUnfinishedDistributableJob( Job * job );
 
@@ -98,6 +134,13 @@ private:
     Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere
     Array< Job * >      m_DistributableJobs_InProgress; // In progress remotely, locally or both
 
+    // Race prediction and statistics (protected by m_DistributedJobsMutex)
+    float               m_LocalSpeedRatio;          // smoothed local build time relative to the last known build time
+    uint32_t            m_NumRacesStarted;
+    uint32_t            m_NumRacesWonLocally;
+    uint32_t            m_NumRacesWonRemotely;
+    uint32_t            m_RaceWastedTimeMS;         // local time of races lost and remote time of races won locally
+
     // Semaphore to manage thread idle
     Semaphore           m_MainThreadSemaphore;
 
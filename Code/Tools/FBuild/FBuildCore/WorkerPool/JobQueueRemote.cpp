@@ -7,6 +7,7 @@
 
 #include "JobQueueRemote.h"
 #include "Job.h"
+#include "JobQueue.h"
 #include "WorkerThreadRemote.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
@@ -94,6 +95,22 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumActiveJobs
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumActiveJobs() const
+{
+    size_t numJobs = 0;
+    {
+        MutexHolder m( m_PendingJobsMutex );
+        numJobs += m_PendingJobs.GetSize();
+    }
+    {
+        MutexHolder m( m_InFlightJobsMutex );
+        numJobs += m_InFlightJobs.GetSize();
+    }
+    return numJobs;
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -277,7 +294,11 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
 {
     Timer timer; // track how long the item takes
 
-    ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
+    FileNode * node = job->GetNode()->CastTo< FileNode >();
+
+    // only objects have a PDB alongside the output
+    const ObjectNode * objectNode = ( node->GetType() == Node::OBJECT_NODE ) ? node->CastTo< ObjectNode >() : nullptr;
+    const bool usingPDB = ( objectNode && objectNode->IsUsingPDB() );
 
     if ( job->IsLocal() )
     {
@@ -307,10 +328,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     }
 
     // Delete any left over PDB from a previous run (to be sure we have a clean pdb)
-    if ( node->IsUsingPDB() && ( job->IsLocal() == false ) )
+    if ( usingPDB && ( job->IsLocal() == false ) )
     {
         AStackString<> pdbName;
-        node->GetPDBName( pdbName );
+        objectNode->GetPDBName( pdbName );
         FileIO::FileDelete( pdbName.Get() );
     }
 
@@ -335,6 +356,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     {
         // record new build time only if built (i.e. if failed, the time
         // does not represent how long it takes to create this resource)
+        if ( job->IsLocal() )
+        {
+            JobQueue::Get().OnLocalDistributableJobBuilt( node->GetLastBuildTime(), timeTakenMS );
+        }
         node->SetLastBuildTime( timeTakenMS );
         node->SetStatFlag( Node::STATS_BUILT );
 
@@ -385,10 +410,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         FileIO::FileDelete( node->GetName().Get() );
 
         // Cleanup PDB file
-        if ( node->IsUsingPDB() )
+        if ( usingPDB )
         {
             AStackString<> pdbName;
-            node->GetPDBName( pdbName );
+            objectNode->GetPDBName( pdbName );
             FileIO::FileDelete( pdbName.Get() );
         }
     }
@@ -414,8 +439,9 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
 //------------------------------------------------------------------------------
 /*static*/ bool JobQueueRemote::ReadResults( Job * job )
 {
-    const ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
-    const bool includePDB = (  node->IsUsingPDB() && ( job->IsLocal() == false ) );
+    const Node * node = job->GetNode();
+    const ObjectNode * objectNode = ( node->GetType() == Node::OBJECT_NODE ) ? node->CastTo< ObjectNode >() : nullptr;
+    const bool includePDB = ( objectNode && objectNode->IsUsingPDB() && ( job->IsLocal() == false ) );
 
     // main object
     FileStream fs;
@@ -433,7 +459,7 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
     AStackString<> pdbName;
     if ( includePDB )
     {
-        node->GetPDBName( pdbName );
+        objectNode->GetPDBName( pdbName );
         if ( fs2.Open( pdbName.Get() ) == false )
         {
             job->Error( "File missing despite success: '%s'", pdbName.Get() );
@@ -36,6 +36,7 @@ public:
 
     inline size_t GetNumWorkers() const { return m_Workers.GetSize(); }
     void          GetWorkerStatus( size_t index, AString & hostName, AString & status, bool & isIdle ) const;
+    size_t        GetNumActiveJobs() const; // queued or being built
 
     void MainThreadWait( uint32_t timeoutMS );
     void WakeMainThread();
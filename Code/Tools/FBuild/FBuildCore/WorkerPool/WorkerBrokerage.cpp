@@ -13,19 +13,138 @@
 
 // Core
 #include "Core/Env/Env.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Network/Network.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Thread.h"
 
+// system
+#include <stdio.h> // for sscanf
+
+// Defines
+//------------------------------------------------------------------------------
+#define BROKERAGE_CONNECTION_TIMEOUT_MS ( 2000 )
+#define BROKERAGE_QUERY_TIMEOUT_MS ( 5000 )
+#define BROKERAGE_RECONNECT_DELAY_SECONDS ( 10.0f )
+
+// BrokerageConnection - connection to the brokerage service
+//------------------------------------------------------------------------------
+class BrokerageConnection : public TCPConnectionPool
+{
+public:
+    BrokerageConnection()
+        : m_Connection( nullptr )
+        , m_CurrentMessage( nullptr )
+        , m_Reply( nullptr )
+        , m_ReplySize( 0 )
+    {}
+    ~BrokerageConnection()
+    {
+        ShutdownAllConnections();
+        FREE( (void *)m_CurrentMessage );
+        FREE( m_Reply );
+    }
+
+    bool Connect( const AString & host, uint16_t port )
+    {
+        const ConnectionInfo * ci = TCPConnectionPool::Connect( host, port, BROKERAGE_CONNECTION_TIMEOUT_MS );
+        MutexHolder mh( m_Mutex );
+        m_Connection = ci;
+        return ( ci != nullptr );
+    }
+
+    bool IsConnected() const
+    {
+        MutexHolder mh( m_Mutex );
+        return ( m_Connection != nullptr );
+    }
+
+    bool Send( const Protocol::IMessage & msg )
+    {
+        MutexHolder mh( m_Mutex );
+        return m_Connection ? msg.Send( m_Connection ) : false;
+    }
+
+    bool Send( const Protocol::IMessage & msg, const MemoryStream & payload )
+    {
+        MutexHolder mh( m_Mutex );
+        return m_Connection ? msg.Send( m_Connection, payload ) : false;
+    }
+
+    // wait for the list of workers in response to a query
+    bool WaitForReply( uint32_t timeoutMS )
+    {
+        m_ReplySemaphore.Wait( timeoutMS );
+        MutexHolder mh( m_Mutex );
+        return ( m_Reply != nullptr );
+    }
+
+    inline const void * GetReply() const    { return m_Reply; }
+    inline uint32_t     GetReplySize() const { return m_ReplySize; }
+
+private:
+    virtual void OnDisconnected( const ConnectionInfo * )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            m_Connection = nullptr;
+        }
+        m_ReplySemaphore.Signal(); // don't wait for a reply which will never come
+    }
+
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+    {
+        // only the list of workers (with payload) is expected
+        if ( m_CurrentMessage == nullptr )
+        {
+            const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+            if ( ( msg->GetType() != Protocol::MSG_BROKERAGE_WORKERS ) || ( msg->HasPayload() == false ) )
+            {
+                Disconnect( connection );
+                return;
+            }
+            keepMemory = true;
+            m_CurrentMessage = msg;
+            return;
+        }
+
+        keepMemory = true;
+        {
+            MutexHolder mh( m_Mutex );
+            FREE( m_Reply );
+            m_Reply = data;
+            m_ReplySize = size;
+        }
+        FREE( (void *)m_CurrentMessage );
+        m_CurrentMessage = nullptr;
+        m_ReplySemaphore.Signal();
+    }
+
+    mutable Mutex               m_Mutex;
+    const ConnectionInfo *      m_Connection;
+    const Protocol::IMessage *  m_CurrentMessage;
+    void *                      m_Reply;
+    uint32_t                    m_ReplySize;
+    Semaphore                   m_ReplySemaphore;
+};
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerage::WorkerBrokerage()
-    : m_Availability( false )
+    : m_BrokerageServerPort( Protocol::BROKERAGE_PORT )
+    , m_Availability( false )
     , m_Initialized( false )
+    , m_Connection( nullptr )
+    , m_ConnectionThread( INVALID_THREAD_HANDLE )
+    , m_ConnectionThreadDone( false )
 {
 }
 
@@ -57,11 +176,37 @@ void WorkerBrokerage::Init()
         #endif
     }
 
+    // brokerage service: <host>[:<port>]
+    AStackString<> server;
+    if ( Env::GetEnvVariable( "FASTBUILD_BROKERAGE_SERVER", server ) && ( server.IsEmpty() == false ) )
+    {
+        const char * colon = server.Find( ':' );
+        if ( colon )
+        {
+            uint32_t port = 0;
+            if ( ( sscanf( colon + 1, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+            {
+                m_BrokerageServerPort = (uint16_t)port;
+            }
+            else
+            {
+                FLOG_WARN( "Invalid port in FASTBUILD_BROKERAGE_SERVER '%s'", server.Get() );
+            }
+            m_BrokerageServer.Assign( server.Get(), colon );
+        }
+        else
+        {
+            m_BrokerageServer = server;
+        }
+    }
+
     Network::GetHostName(m_HostName);
+    m_WorkerInfo.m_HostName = m_HostName;
 
     AStackString<> filePath;
     m_BrokerageFilePath.Format( "%s%s", m_BrokerageRoot.Get(), m_HostName.Get() );
     m_TimerLastUpdate.Start();
+    m_TimerLastConnectionAttempt.Start( BROKERAGE_RECONNECT_DELAY_SECONDS ); // allow immediate first attempt
 
     m_Initialized = true;
 }
@@ -70,8 +215,18 @@ void WorkerBrokerage::Init()
 //------------------------------------------------------------------------------
 WorkerBrokerage::~WorkerBrokerage()
 {
+    // Wait for any connection attempt in progress
+    if ( m_ConnectionThread != INVALID_THREAD_HANDLE )
+    {
+        Thread::WaitForThread( m_ConnectionThread );
+        Thread::CloseHandle( m_ConnectionThread );
+    }
+
+    // Closing the connection removes the worker from the brokerage service
+    FDELETE m_Connection;
+
     // Ensure the file disapears when closing
-    if ( m_Availability )
+    if ( m_Availability && ( m_BrokerageRoot.IsEmpty() == false ) )
     {
         FileIO::FileDelete( m_BrokerageFilePath.Get() );
     }
@@ -85,12 +240,199 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
 
     Init();
 
+    // prefer the brokerage service, which answers with a single request
+    if ( m_BrokerageServer.IsEmpty() == false )
+    {
+        if ( FindWorkersFromService( workerList ) )
+        {
+            return;
+        }
+
+        if ( m_BrokerageRoot.IsEmpty() )
+        {
+            FLOG_WARN( "Brokerage service '%s' is unavailable", m_BrokerageServer.Get() );
+            return;
+        }
+
+        FLOG_WARN( "Brokerage service '%s' is unavailable, using FASTBUILD_BROKERAGE_PATH", m_BrokerageServer.Get() );
+    }
+
     if ( m_BrokerageRoot.IsEmpty() )
     {
-        FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
+        FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH or FASTBUILD_BROKERAGE_SERVER?" );
+        return;
+    }
+
+    FindWorkersFromFileShare( workerList );
+}
+
+// SetWorkerInfo
+//------------------------------------------------------------------------------
+void WorkerBrokerage::SetWorkerInfo( uint32_t numCPUs, uint32_t numFreeCPUs, uint32_t cpuLoad, const Array< uint64_t > & toolIds )
+{
+    m_WorkerInfo.m_NumCPUs = numCPUs;
+    m_WorkerInfo.m_NumFreeCPUs = numFreeCPUs;
+    m_WorkerInfo.m_CPULoad = cpuLoad;
+    m_WorkerInfo.m_ToolIds = toolIds;
+}
+
+// SetAvailability
+//------------------------------------------------------------------------------
+void WorkerBrokerage::SetAvailability(bool available)
+{
+    Init();
+
+    if ( m_BrokerageServer.IsEmpty() == false )
+    {
+        RegisterWithService( available );
+    }
+
+    // ignore if brokerage not configured
+    if ( m_BrokerageRoot.IsEmpty() == false )
+    {
+        SetFileShareAvailability( available );
+    }
+
+    m_Availability = available;
+}
+
+// FindWorkersFromService
+//------------------------------------------------------------------------------
+bool WorkerBrokerage::FindWorkersFromService( Array< AString > & workerList )
+{
+    BrokerageConnection connection;
+    if ( connection.Connect( m_BrokerageServer, m_BrokerageServerPort ) == false )
+    {
+        return false;
+    }
+
+    Protocol::MsgBrokerageQuery msg;
+    if ( ( connection.Send( msg ) == false ) ||
+         ( connection.WaitForReply( BROKERAGE_QUERY_TIMEOUT_MS ) == false ) )
+    {
+        return false;
+    }
+
+    ConstMemoryStream ms( connection.GetReply(), connection.GetReplySize() );
+    uint32_t numWorkers = 0;
+    if ( ms.Read( numWorkers ) == false )
+    {
+        return false;
+    }
+
+    // presize
+    if ( ( workerList.GetSize() + numWorkers ) > workerList.GetCapacity() )
+    {
+        workerList.SetCapacity( workerList.GetSize() + numWorkers );
+    }
+
+    for ( uint32_t i = 0; i < numWorkers; ++i )
+    {
+        WorkerInfo info;
+        if ( info.Deserialize( ms ) == false )
+        {
+            return false;
+        }
+        if ( info.m_HostName.CompareI( m_HostName ) != 0 )
+        {
+            workerList.Append( info.m_HostName );
+        }
+    }
+
+    if ( workerList.IsEmpty() )
+    {
+        FLOG_WARN( "No workers registered with brokerage service '%s'", m_BrokerageServer.Get() );
+    }
+    return true;
+}
+
+// RegisterWithService
+//------------------------------------------------------------------------------
+void WorkerBrokerage::RegisterWithService( bool available )
+{
+    // send changes in availability (or a new connection) right away, otherwise refresh periodically
+    if ( ( available == m_Availability ) &&
+         m_Connection && m_Connection->IsConnected() &&
+         ( m_TimerLastRegistration.GetElapsedMS() < (float)Protocol::BROKERAGE_REGISTRATION_FREQUENCY_MS ) )
+    {
         return;
     }
 
+    if ( m_Connection == nullptr )
+    {
+        m_Connection = FNEW( BrokerageConnection );
+    }
+
+    if ( m_Connection->IsConnected() == false )
+    {
+        // Connecting blocks until the service answers (or times out), so is
+        // done on another thread to avoid stalling the worker
+        if ( m_ConnectionThread != INVALID_THREAD_HANDLE )
+        {
+            if ( m_ConnectionThreadDone == false )
+            {
+                return; // still connecting
+            }
+            Thread::WaitForThread( m_ConnectionThread );
+            Thread::CloseHandle( m_ConnectionThread );
+            m_ConnectionThread = INVALID_THREAD_HANDLE;
+            if ( m_Connection->IsConnected() == false )
+            {
+                return; // failed (will retry later)
+            }
+        }
+        else
+        {
+            // An unavailable worker doesn't need to be registered
+            if ( available == false )
+            {
+                return;
+            }
+
+            // Avoid retrying constantly when the service is down
+            if ( m_TimerLastConnectionAttempt.GetElapsed() < BROKERAGE_RECONNECT_DELAY_SECONDS )
+            {
+                return;
+            }
+            m_TimerLastConnectionAttempt.Start();
+
+            m_ConnectionThreadDone = false;
+            m_ConnectionThread = Thread::CreateThread( ConnectionThreadFunc, "BrokerageConnection", ( 64 * KILOBYTE ), this );
+            return;
+        }
+    }
+
+    // an unavailable worker registers no cpus, so it is not handed out to clients
+    WorkerInfo info( m_WorkerInfo );
+    if ( available == false )
+    {
+        info.m_NumCPUs = 0;
+        info.m_NumFreeCPUs = 0;
+    }
+
+    MemoryStream ms;
+    info.Serialize( ms );
+
+    Protocol::MsgBrokerageRegister msg;
+    m_Connection->Send( msg, ms );
+
+    m_TimerLastRegistration.Start();
+}
+
+// ConnectionThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t WorkerBrokerage::ConnectionThreadFunc( void * userData )
+{
+    WorkerBrokerage * self = static_cast< WorkerBrokerage * >( userData );
+    self->m_Connection->Connect( self->m_BrokerageServer, self->m_BrokerageServerPort );
+    self->m_ConnectionThreadDone = true;
+    return 0;
+}
+
+// FindWorkersFromFileShare
+//------------------------------------------------------------------------------
+void WorkerBrokerage::FindWorkersFromFileShare( Array< AString > & workerList )
+{
     Array< AString > results( 256, true );
     if ( !FileIO::GetFiles( m_BrokerageRoot,
                             AStackString<>( "*" ),
@@ -121,18 +463,10 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
     }
 }
 
-// SetAvailability
+// SetFileShareAvailability
 //------------------------------------------------------------------------------
-void WorkerBrokerage::SetAvailability(bool available)
+void WorkerBrokerage::SetFileShareAvailability( bool available )
 {
-    Init();
-
-    // ignore if brokerage not configured
-    if ( m_BrokerageRoot.IsEmpty() )
-    {
-        return;
-    }
-
     if ( available )
     {
         // Check the last update time to avoid too much File IO.
@@ -163,7 +497,39 @@ void WorkerBrokerage::SetAvailability(bool available)
         // Restart the timer
         m_TimerLastUpdate.Start();
     }
-    m_Availability = available;
+}
+
+// WorkerInfo (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+WorkerBrokerage::WorkerInfo::WorkerInfo()
+    : m_NumCPUs( 0 )
+    , m_NumFreeCPUs( 0 )
+    , m_CPULoad( 0 )
+    , m_ToolIds( 0, true )
+{
+}
+
+// WorkerInfo::Serialize
+//------------------------------------------------------------------------------
+void WorkerBrokerage::WorkerInfo::Serialize( IOStream & stream ) const
+{
+    stream.Write( m_HostName );
+    stream.Write( m_NumCPUs );
+    stream.Write( m_NumFreeCPUs );
+    stream.Write( m_CPULoad );
+    stream.Write( m_ToolIds );
+}
+
+// WorkerInfo::Deserialize
+//------------------------------------------------------------------------------
+bool WorkerBrokerage::WorkerInfo::Deserialize( IOStream & stream )
+{
+    return ( stream.Read( m_HostName ) &&
+             stream.Read( m_NumCPUs ) &&
+             stream.Read( m_NumFreeCPUs ) &&
+             stream.Read( m_CPULoad ) &&
+             stream.Read( m_ToolIds ) &&
+             ( m_HostName.IsEmpty() == false ) );
 }
 
 //------------------------------------------------------------------------------
@@ -4,11 +4,15 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class BrokerageConnection;
+class IOStream;
 
 // WorkerBrokerage
 //------------------------------------------------------------------------------
@@ -18,20 +22,53 @@ public:
     WorkerBrokerage();
     ~WorkerBrokerage();
 
+    // details a worker registers with the brokerage service
+    struct WorkerInfo
+    {
+        WorkerInfo();
+
+        void Serialize( IOStream & stream ) const;
+        bool Deserialize( IOStream & stream );
+
+        AString             m_HostName;
+        uint32_t            m_NumCPUs;          // cpus the worker will use
+        uint32_t            m_NumFreeCPUs;      // cpus not currently busy with jobs
+        uint32_t            m_CPULoad;          // total machine cpu usage (%)
+        Array< uint64_t >   m_ToolIds;          // toolchains synchronized on the worker
+    };
+
     // client interface
     void FindWorkers( Array< AString > & workerList );
 
     // server interface
+    void SetWorkerInfo( uint32_t numCPUs, uint32_t numFreeCPUs, uint32_t cpuLoad, const Array< uint64_t > & toolIds );
     void SetAvailability( bool available );
 private:
     void Init();
 
+    // brokerage service
+    bool FindWorkersFromService( Array< AString > & workerList );
+    void RegisterWithService( bool available );
+    static uint32_t ConnectionThreadFunc( void * userData );
+
+    // file share brokerage (fallback)
+    void FindWorkersFromFileShare( Array< AString > & workerList );
+    void SetFileShareAvailability( bool available );
+
     AString             m_BrokerageRoot;
+    AString             m_BrokerageServer;      // host of the brokerage service (if configured)
+    uint16_t            m_BrokerageServerPort;
     bool                m_Availability;
     bool                m_Initialized;
     AString             m_HostName;
     AString             m_BrokerageFilePath;
     Timer               m_TimerLastUpdate;      // Throttle network access
+    Timer               m_TimerLastRegistration;// Throttle brokerage service updates
+    Timer               m_TimerLastConnectionAttempt;
+    BrokerageConnection * m_Connection;         // persistent connection to the brokerage service (server side)
+    Thread::ThreadHandle m_ConnectionThread;    // connects to the brokerage service without stalling the worker
+    volatile bool       m_ConnectionThreadDone;
+    WorkerInfo          m_WorkerInfo;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,121 @@
+// WorkerCapacity
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/PrecompiledHeader.h"
+
+#include "WorkerCapacity.h"
+
+#include "Core/Math/Conversions.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define WORKER_DEFAULT_JOB_MEMORY   ( (uint64_t)512 * MEGABYTE )   // initial estimate of memory used by a job
+#define WORKER_MIN_JOB_MEMORY       ( (uint64_t)64 * MEGABYTE )
+#define WORKER_MAX_JOB_MEMORY       ( (uint64_t)4096 * MEGABYTE )
+#define WORKER_JOB_MEMORY_SMOOTHING ( 0.2f )
+#define WORKER_RESERVED_MEMORY      ( (uint64_t)1024 * MEGABYTE )  // left free for the rest of the system
+#define WORKER_MAX_IO_WAIT_PERCENT  ( 30.0f )
+
+// CONSTRUCTOR (MachineLoad)
+//------------------------------------------------------------------------------
+WorkerCapacity::MachineLoad::MachineLoad()
+    : m_NumProcessors( 1 )
+    , m_CPUUsageTotal( 0.0f )
+    , m_CPUUsageFASTBuild( 0.0f )
+    , m_IOWait( 0.0f )
+    , m_HasMemoryInfo( false )
+    , m_TotalMemory( 0 )
+    , m_AvailableMemory( 0 )
+{
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerCapacity::WorkerCapacity()
+    : m_JobMemoryEstimate( WORKER_DEFAULT_JOB_MEMORY )
+    , m_IdleAvailableMemory( 0 )
+    , m_LastNumActiveJobs( 0 )
+    , m_ThrottleReason( nullptr )
+{
+}
+
+// Update
+//------------------------------------------------------------------------------
+uint32_t WorkerCapacity::Update( uint32_t numCPUsToUse, uint32_t numActiveJobs, const MachineLoad & load )
+{
+    m_ThrottleReason = nullptr;
+    const uint32_t lastNumActiveJobs = m_LastNumActiveJobs;
+    m_LastNumActiveJobs = numActiveJobs;
+    if ( numCPUsToUse == 0 )
+    {
+        return 0;
+    }
+
+    uint32_t capacity = numCPUsToUse;
+
+    // CPU: leave the cpus used by other work on the machine alone
+    {
+        // The FASTBuild usage is sampled infrequently, so short-lived jobs can be
+        // missing from it. Each active job is assumed to keep a cpu busy so they
+        // are never mistaken for other work.
+        const float numProcessors = (float)load.m_NumProcessors;
+        const float busyCPUs = load.m_CPUUsageTotal * numProcessors / 100.0f;
+        const float ourCPUs = Math::Max( load.m_CPUUsageFASTBuild * numProcessors / 100.0f, (float)numActiveJobs );
+        const uint32_t numOtherCPUs = (uint32_t)( Math::Max( 0.0f, busyCPUs - ourCPUs ) + 0.5f );
+        const uint32_t cpuCapacity = ( numOtherCPUs < load.m_NumProcessors ) ? Math::Max( load.m_NumProcessors - numOtherCPUs, 1u ) : 1u;
+        if ( cpuCapacity < capacity )
+        {
+            capacity = cpuCapacity;
+            m_ThrottleReason = "CPU";
+        }
+    }
+
+    // Memory: only accept as many jobs as are expected to fit in free memory
+    if ( load.m_HasMemoryInfo )
+    {
+        const uint64_t availableMemory = load.m_AvailableMemory;
+        if ( numActiveJobs == 0 )
+        {
+            m_IdleAvailableMemory = availableMemory;
+        }
+        else if ( numActiveJobs < lastNumActiveJobs )
+        {
+            // Jobs have completed. Other programs may have changed their memory
+            // use since the machine was last idle, so re-base on the current value.
+            m_IdleAvailableMemory = availableMemory + ( numActiveJobs * m_JobMemoryEstimate );
+        }
+        else if ( m_IdleAvailableMemory > availableMemory )
+        {
+            // refine the per-job estimate from the memory used by in-flight jobs
+            const float observed = (float)( ( m_IdleAvailableMemory - availableMemory ) / numActiveJobs );
+            const float estimate = ( (float)m_JobMemoryEstimate * ( 1.0f - WORKER_JOB_MEMORY_SMOOTHING ) ) + ( observed * WORKER_JOB_MEMORY_SMOOTHING );
+            m_JobMemoryEstimate = Math::Clamp( (uint64_t)estimate, WORKER_MIN_JOB_MEMORY, WORKER_MAX_JOB_MEMORY );
+        }
+
+        const uint64_t reserved = Math::Min( WORKER_RESERVED_MEMORY, load.m_TotalMemory / 8 );
+        const uint64_t usableMemory = ( availableMemory > reserved ) ? ( availableMemory - reserved ) : 0;
+        const uint32_t memoryCapacity = numActiveJobs + (uint32_t)( usableMemory / m_JobMemoryEstimate );
+        if ( memoryCapacity < capacity )
+        {
+            capacity = memoryCapacity; // can be less than active jobs, shedding load as they complete
+            m_ThrottleReason = "Memory";
+        }
+    }
+
+    // I/O: don't add jobs while the machine is waiting on the disk
+    if ( load.m_IOWait > WORKER_MAX_IO_WAIT_PERCENT )
+    {
+        const uint32_t ioCapacity = Math::Max( numActiveJobs, 1u );
+        if ( ioCapacity < capacity )
+        {
+            capacity = ioCapacity;
+            m_ThrottleReason = "I/O";
+        }
+    }
+
+    return capacity;
+}
+
+//------------------------------------------------------------------------------
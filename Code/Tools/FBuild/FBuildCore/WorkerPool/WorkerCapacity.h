@@ -0,0 +1,43 @@
+// WorkerCapacity - how many jobs a worker can take given the load on the machine
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// WorkerCapacity
+//------------------------------------------------------------------------------
+class WorkerCapacity
+{
+public:
+    WorkerCapacity();
+
+    // a sample of the machine's state
+    struct MachineLoad
+    {
+        MachineLoad();
+
+        uint32_t    m_NumProcessors;
+        float       m_CPUUsageTotal;        // % of all cpus in use
+        float       m_CPUUsageFASTBuild;    // % of all cpus used by the worker and its jobs (can be stale)
+        float       m_IOWait;               // % of cpu time spent waiting for I/O
+        bool        m_HasMemoryInfo;
+        uint64_t    m_TotalMemory;          // bytes
+        uint64_t    m_AvailableMemory;      // bytes
+    };
+
+    // number of jobs that can be run (which can be less than the active jobs)
+    uint32_t Update( uint32_t numCPUsToUse, uint32_t numActiveJobs, const MachineLoad & load );
+
+    inline const char * GetThrottleReason() const { return m_ThrottleReason; }
+    inline uint64_t     GetJobMemoryEstimate() const { return m_JobMemoryEstimate; }
+
+private:
+    uint64_t        m_JobMemoryEstimate;    // expected memory use of a single job (bytes)
+    uint64_t        m_IdleAvailableMemory;  // available memory without our jobs (bytes)
+    uint32_t        m_LastNumActiveJobs;
+    const char *    m_ThrottleReason;       // resource limiting the number of jobs (if any)
+};
+
+//------------------------------------------------------------------------------
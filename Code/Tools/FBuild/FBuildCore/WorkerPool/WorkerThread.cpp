@@ -183,6 +183,7 @@ void WorkerThread::WaitForStop()
         {
             // process the work
             Node::BuildResult result = JobQueueRemote::DoBuild( job, false );
+            JobQueue::Get().ReleaseResourcePool( job );
 
             if ( result == Node::NODE_RESULT_FAILED )
             {
@@ -203,6 +204,7 @@ void WorkerThread::WaitForStop()
         {
             // process the work
             Node::BuildResult result = JobQueueRemote::DoBuild( job, true );
+            JobQueue::Get().ReleaseResourcePool( job );
 
             if ( result == Node::NODE_RESULT_FAILED )
             {
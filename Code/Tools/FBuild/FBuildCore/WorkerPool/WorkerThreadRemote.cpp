@@ -21,6 +21,7 @@
 // Static
 //------------------------------------------------------------------------------
 /*static*/ uint32_t WorkerThreadRemote::s_NumCPUsToUse( 999 ); // no limit
+/*static*/ bool WorkerThreadRemote::s_Throttled( false );
 
 //------------------------------------------------------------------------------
 WorkerThreadRemote::WorkerThreadRemote( uint32_t threadIndex )
@@ -24,6 +24,8 @@ public:
     // control remote CPU usage
     static void     SetNumCPUsToUse( uint32_t c ) { s_NumCPUsToUse = c; }
     static uint32_t GetNumCPUsToUse() { return s_NumCPUsToUse; }
+    static void     SetThrottled( bool throttled ) { s_Throttled = throttled; } // limited by machine load
+    static bool     IsThrottled() { return s_Throttled; }
 private:
     virtual void Main();
 
@@ -34,6 +36,7 @@ private:
 
     // static
     static uint32_t s_NumCPUsToUse;
+    static bool     s_Throttled;
 };
 
 //------------------------------------------------------------------------------
@@ -1,16 +1,38 @@
 //
 // An simple executable to run
 //
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <thread>
+
+long long GetTimeUS()
+{
+    // system wide, so times written by concurrent processes can be compared
+    return std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::system_clock::now().time_since_epoch() ).count();
+}
 
 int main(int argc, char *argv[], char *[])
 {
+    // With -timestamps, write when the process started and finished instead
+    // of "T" (and to stdout), and take a while so that overlapping runs can
+    // be detected
+    bool timestamps = false;
+    const long long startTime = GetTimeUS();
+
     // Touch each file listed
+    int numTouched = 0;
     for (int i = 1; i < argc; ++i)
     {
         const char * arg = argv[i];
+        if (strcmp(arg, "-timestamps") == 0)
+        {
+            timestamps = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
 
         // Make a new filename based on the input
         std::string outFileName = arg;
@@ -19,14 +41,23 @@ int main(int argc, char *argv[], char *[])
         // Touch the file
         std::ofstream file;
         file.open(outFileName);
-        file << "T";
-        file.close();
+        if (timestamps)
+        {
+            const long long endTime = GetTimeUS();
+            file << startTime << " " << endTime;
+            std::cout << startTime << " " << endTime << std::endl;
+        }
+        else
+        {
+            file << "T";
 
-        // Generate some output
-        // on STDOUT based on the arguments too
-        std::cout << "Touched: " << outFileName << std::endl;
+            // Generate some output
+            // on STDOUT based on the arguments too
+            std::cout << "Touched: " << outFileName << std::endl;
+        }
+        file.close();
+        ++numTouched;
     }
 
-    return argc - 1;
+    return numTouched;
 }
-
@@ -0,0 +1,7 @@
+//
+// Compiled by ObjectList 'A', which is not changed by the test
+//
+int FunctionA()
+{
+    return 1;
+}
@@ -0,0 +1,7 @@
+//
+// Compiled by ObjectList 'B', whose options are changed by the test
+//
+int FunctionB()
+{
+    return 2;
+}
@@ -0,0 +1,8 @@
+// main.cpp
+//------------------------------------------------------------------------------
+#include "header.h"
+
+int Function()
+{
+    return HEADER_VALUE;
+}
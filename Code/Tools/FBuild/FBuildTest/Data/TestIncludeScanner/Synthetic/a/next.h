@@ -0,0 +1,3 @@
+#pragma once
+
+#include_next <next.h>
@@ -0,0 +1,3 @@
+#pragma once
+
+extern int elif_h;
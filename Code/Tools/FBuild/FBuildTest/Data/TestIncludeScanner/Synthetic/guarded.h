@@ -0,0 +1,6 @@
+#ifndef GUARDED_H
+#define GUARDED_H
+
+#include "nested/nested.h"
+
+#endif // GUARDED_H
@@ -0,0 +1,3 @@
+#pragma once
+
+extern int guarded_defined_h;
@@ -0,0 +1,57 @@
+// main.cpp - exercises the directives understood by the include scanner
+//------------------------------------------------------------------------------
+
+// include guards and #pragma once
+#include "guarded.h"
+#include "guarded.h"
+#include "once.h"
+#include "once.h"
+
+// computed includes
+#define STR( x ) #x
+#define XSTR( x ) STR( x )
+#define CAT( a, b ) a ## b
+#define COMPUTED_HEADER "computed.h"
+#include COMPUTED_HEADER
+#include XSTR( CAT( pas, ted.h ) )
+
+// conditions
+#if 0
+    #error "Inactive code should be skipped"
+    #include "missing.h"
+#elif defined( __cplusplus ) && ( __GNUC__ >= 3 ) && ( 'A' == 65 ) && ( ( 1 << 4 ) == 16 )
+    #include "elif.h"
+#else
+    #include "missing.h"
+#endif
+#ifdef GUARDED_H
+    #include "guarded_defined.h"
+#endif
+#if defined( UNDEFINED_MACRO ) || UNDEFINED_MACRO
+    #include "missing.h"
+#endif
+
+// __has_include
+#if __has_include( "hasinclude.h" )
+    #include "hasinclude.h"
+#endif
+#if defined( __has_include ) && __has_include( <missing.h> )
+    #include <missing.h>
+#endif
+
+// variadic macros
+#define FIRST( first, ... ) first
+#define COUNT( ... ) FIRST( __VA_ARGS__ )
+#if COUNT( 1, 0, 0 )
+    #include "variadic.h"
+#endif
+
+// includes which are not directives
+/* #include "missing.h" */
+// #include "missing.h"
+const char * notAnInclude = "#include \"missing.h\"";
+
+// #include_next (found in a/, which includes b/)
+#include <next.h>
+
+int main() { return 0; }
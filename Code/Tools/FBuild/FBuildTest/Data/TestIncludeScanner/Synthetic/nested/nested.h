@@ -0,0 +1,4 @@
+#pragma once
+
+// found relative to this file, not the file including it
+#include "sibling.h"
@@ -0,0 +1,3 @@
+#pragma once
+
+extern int once_nested_h;
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "nested/once_nested.h"
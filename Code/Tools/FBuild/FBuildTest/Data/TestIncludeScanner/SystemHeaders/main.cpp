@@ -0,0 +1,8 @@
+// main.cpp - includes a selection of system headers
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+int main() { return 0; }
@@ -0,0 +1,6 @@
+#define VALUE 12345
+
+unsigned long long Function()
+{
+    return VALUE;
+}
@@ -0,0 +1,7 @@
+#include "Common.h"
+#include "Rare.h"
+
+int FunctionA()
+{
+    return CommonFunction( 1 );
+}
@@ -0,0 +1,6 @@
+#include "Common.h"
+
+int FunctionB()
+{
+    return CommonFunction( 1 );
+}
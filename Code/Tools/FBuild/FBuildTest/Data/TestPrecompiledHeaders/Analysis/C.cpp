@@ -0,0 +1,6 @@
+#include "Common.h"
+
+int FunctionC()
+{
+    return CommonFunction( 1 );
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Included by every object, so a candidate for precompilation
+extern int Common_h;
+
+inline int CommonFunction( int value )
+{
+    return value * 2;
+}
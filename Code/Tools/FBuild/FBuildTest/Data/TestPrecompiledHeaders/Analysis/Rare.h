@@ -0,0 +1,4 @@
+#pragma once
+
+// Included by a single object, so not a candidate for precompilation
+extern int Rare_h;
@@ -0,0 +1,4 @@
+int Function_a()
+{
+    return 0;
+}
@@ -0,0 +1,4 @@
+int Function_b()
+{
+    return 0;
+}
@@ -0,0 +1,4 @@
+int Function_c()
+{
+    return 0;
+}
@@ -0,0 +1,4 @@
+int Function_d()
+{
+    return 0;
+}
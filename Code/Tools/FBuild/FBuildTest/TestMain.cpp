@@ -23,8 +23,10 @@ int main(int , char * [])
     REGISTER_TESTGROUP( TestDLL )
     REGISTER_TESTGROUP( TestExe )
     REGISTER_TESTGROUP( TestExec )
+    REGISTER_TESTGROUP( TestFileHashCache )
     REGISTER_TESTGROUP( TestGraph )
     REGISTER_TESTGROUP( TestIncludeParser )
+    REGISTER_TESTGROUP( TestIncludeScanner )
     REGISTER_TESTGROUP( TestLinker )
     REGISTER_TESTGROUP( TestNodeReflection )
     REGISTER_TESTGROUP( TestObject )
@@ -36,6 +38,7 @@ int main(int , char * [])
     REGISTER_TESTGROUP( TestUnity )
     REGISTER_TESTGROUP( TestVariableStack )
     REGISTER_TESTGROUP( TestWarnings )
+    REGISTER_TESTGROUP( TestWorkerCapacity )
 
     // Windows-specific tests
     #if defined( __WINDOWS__ )
@@ -11,7 +11,11 @@
 
 #include "Core/Containers/AutoPtr.h"
 #include "Core/Env/Env.h"
+#include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
 
 // TestBFFParsing
 //------------------------------------------------------------------------------
@@ -58,6 +62,7 @@ private:
     void FrozenVariable_Nested() const;
     void DynamicVarNameConstruction() const;
     void OperatorMinus() const;
+    void CopyOnWrite() const;
     void IfFunctionTrue() const;
     void IfNotFunctionTrue() const;
     void IfSetFunctionTrue() const;
@@ -70,8 +75,10 @@ private:
     void IfFunctionStringCompare() const;
     void BuiltInVariables() const;
     void CyclicDependency() const;
+    void IncludeTree() const;
 
     void Parse( const char * fileName, bool expectFailure = false ) const;
+    void WriteFile( const AString & fileName, const AString & contents ) const;
 };
 
 // Register Tests
@@ -115,6 +122,7 @@ REGISTER_TESTS_BEGIN( TestBFFParsing )
     REGISTER_TEST( FrozenVariable_Nested )
     REGISTER_TEST( DynamicVarNameConstruction )
     REGISTER_TEST( OperatorMinus )
+    REGISTER_TEST( CopyOnWrite )
     REGISTER_TEST( IfFunctionTrue )
     REGISTER_TEST( IfNotFunctionTrue )
     REGISTER_TEST( IfSetFunctionTrue )
@@ -127,6 +135,7 @@ REGISTER_TESTS_BEGIN( TestBFFParsing )
     REGISTER_TEST( IfFunctionStringCompare )
     REGISTER_TEST( BuiltInVariables )
     REGISTER_TEST( CyclicDependency )
+    REGISTER_TEST( IncludeTree )
 REGISTER_TESTS_END
 
 // Empty
@@ -447,6 +456,26 @@ void TestBFFParsing::OperatorMinus() const
     Parse( "Tools/FBuild/FBuildTest/Data/TestBFFParsing/operator_minus.bff" );
 }
 
+// CopyOnWrite
+//------------------------------------------------------------------------------
+void TestBFFParsing::CopyOnWrite() const
+{
+    Parse( "Tools/FBuild/FBuildTest/Data/TestBFFParsing/copy_on_write.bff" );
+
+    // modifying a copy must not modify the variable it was copied from (or vice versa)
+    TEST_ASSERT( GetRecordedOutput().Find( "String: String String-Modified" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "StringCopy: String-Modified-Again String-Modified" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( ".Array = // ArrayOfStrings, size: 1" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( ".ArrayCopy = // ArrayOfStrings, size: 2" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( ".ArraySelf = // ArrayOfStrings, size: 4" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "StringSelf: SelfSelf" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "Using: Struct-Using" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( ".StructString = 'Struct'" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( ".StructArray = // ArrayOfStrings, size: 1" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "Inner: Outer" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "Outer: Outer-Modified" ) );
+}
+
 // IfFunctionTrue
 //------------------------------------------------------------------------------
 void TestBFFParsing::IfFunctionTrue() const
@@ -549,4 +578,90 @@ void TestBFFParsing::CyclicDependency() const
     TEST_ASSERT( GetRecordedOutput().Find( "Cyclic dependency detected for node" ) );
 }
 
+// IncludeTree
+//------------------------------------------------------------------------------
+void TestBFFParsing::IncludeTree() const
+{
+    // A large generated configuration: many modules, each including files
+    // for several platforms and a common file, which are loaded ahead of the
+    // parser
+    const AStackString<> root( "../tmp/Test/BFFParsing/IncludeTree/" );
+    const uint32_t numModules = 200;
+    const char * const platforms[] = { "Windows", "Linux", "OSX" };
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/BFFParsing/IncludeTree/Modules" ) ) );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/BFFParsing/IncludeTree/Platforms" ) ) );
+
+    AStackString<> fileName;
+    AStackString<> contents;
+    AStackString<> line;
+
+    fileName.Format( "%scommon.bff", root.Get() );
+    WriteFile( fileName, AStackString<>( "#once\n.Common = 'Common'\n" ) );
+
+    contents = ".ModulesDir = 'Modules'\n";
+    for ( uint32_t i = 0; i < numModules; ++i )
+    {
+        // every other module is included through a substitution, which can
+        // only be resolved by the parser
+        line.Format( ( i % 2 ) ? "#include \"$ModulesDir$/Module%u.bff\"\n" : "#include \"Modules/Module%u.bff\"\n", i );
+        contents += line;
+
+        AStackString<> module( "#include \"../common.bff\"\n" );
+        for ( const char * platform : platforms )
+        {
+            line.Format( "#include \"../Platforms/Module%u_%s.bff\"\n", i, platform );
+            module += line;
+
+            AStackString<> platformContents;
+            platformContents.Format( "#include \"../common.bff\"\n"
+                                     "Alias( 'Module%u_%s' )\n"
+                                     "{\n"
+                                     "    .Targets = 'Module%u_%s.txt'\n"
+                                     "}\n", i, platform, i, platform );
+            fileName.Format( "%sPlatforms/Module%u_%s.bff", root.Get(), i, platform );
+            WriteFile( fileName, platformContents );
+        }
+
+        // includes in inactive blocks are found ahead too, but not used
+        module += "#if __NEVER_DEFINED__\n"
+                  "    #include \"missing.bff\"\n"
+                  "#endif\n";
+
+        fileName.Format( "%sModules/Module%u.bff", root.Get(), i );
+        WriteFile( fileName, module );
+    }
+    fileName.Format( "%sfbuild.bff", root.Get() );
+    WriteFile( fileName, contents );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = fileName;
+    FBuild fBuild( options );
+    Timer t;
+    TEST_ASSERT( fBuild.Initialize() );
+    const float parseTime = t.GetElapsed();
+
+    // every platform file of every module was parsed once
+    const NodeGraph & ng = fBuild.GetDependencyGraph();
+    for ( uint32_t i = 0; i < numModules; ++i )
+    {
+        for ( const char * platform : platforms )
+        {
+            AStackString<> alias;
+            alias.Format( "Module%u_%s", i, platform );
+            TEST_ASSERT( ng.FindNode( alias ) );
+        }
+    }
+
+    OUTPUT( "Parsed %u files in %2.3fs\n", ( numModules * 4 + 2 ), parseTime );
+}
+
+// WriteFile
+//------------------------------------------------------------------------------
+void TestBFFParsing::WriteFile( const AString & fileName, const AString & contents ) const
+{
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) );
+    TEST_ASSERT( f.WriteBuffer( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+}
+
 //------------------------------------------------------------------------------
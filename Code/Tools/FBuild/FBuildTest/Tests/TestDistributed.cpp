@@ -8,14 +8,23 @@
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
+#include "Tools/FBuild/FBuildCore/Protocol/WorkerPerformance.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageServer.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
 
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
 // Defines
 //------------------------------------------------------------------------------
 #define TEST_PROTOCOL_PORT ( Protocol::PROTOCOL_PORT + 1 ) // Avoid conflict with real worker
+#define TEST_BROKERAGE_PORT ( Protocol::BROKERAGE_PORT + 1 ) // Avoid conflict with real brokerage service
 
 // TestDistributed
 //------------------------------------------------------------------------------
@@ -36,6 +45,11 @@ private:
     void TestZiDebugFormat() const;
     void TestZiDebugFormat_Local() const;
     void D8049_ToolLongDebugRecord() const;
+    void BrokerageService() const;
+    void CacheWriteRemote() const;
+    void WorkerPerformanceEstimate() const;
+    void ToolchainFromPeer() const;
+    void RemoteRaceHeuristic() const;
 
     void TestHelper( const char * target,
                      uint32_t numRemoteWorkers,
@@ -54,6 +68,11 @@ REGISTER_TESTS_BEGIN( TestDistributed )
     REGISTER_TEST( RemoteRaceWinRemote )
     REGISTER_TEST( AnonymousNamespaces )
     REGISTER_TEST( ErrorsAreCorrectlyReported )
+    REGISTER_TEST( BrokerageService )
+    REGISTER_TEST( CacheWriteRemote )
+    REGISTER_TEST( WorkerPerformanceEstimate )
+    REGISTER_TEST( ToolchainFromPeer )
+    REGISTER_TEST( RemoteRaceHeuristic )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( TestForceInclude )
         REGISTER_TEST( TestZiDebugFormat )
@@ -322,4 +341,303 @@ void TestDistributed::D8049_ToolLongDebugRecord() const
     TEST_ASSERT( fBuild.Build( AStackString<>( "D8049" ) ) );
 }
 
+// BrokerageService
+//------------------------------------------------------------------------------
+void TestDistributed::BrokerageService() const
+{
+    BrokerageServer server;
+    TEST_ASSERT( server.Listen( TEST_BROKERAGE_PORT ) );
+
+    // point discovery at the test service (restored even if the test fails)
+    class EnvVarOverride
+    {
+    public:
+        EnvVarOverride( const char * name, const AString & value )
+            : m_Name( name )
+        {
+            m_HadOldValue = Env::GetEnvVariable( name, m_OldValue );
+            m_Set = Env::SetEnvVariable( name, value );
+        }
+        ~EnvVarOverride()
+        {
+            Env::SetEnvVariable( m_Name, m_HadOldValue ? m_OldValue : AString::GetEmpty() );
+        }
+        const char *    m_Name;
+        AString         m_OldValue;
+        bool            m_HadOldValue;
+        bool            m_Set;
+    };
+    AStackString<> serverAddress;
+    serverAddress.Format( "127.0.0.1:%u", (uint32_t)TEST_BROKERAGE_PORT );
+    const EnvVarOverride serverOverride( "FASTBUILD_BROKERAGE_SERVER", serverAddress );
+    TEST_ASSERT( serverOverride.m_Set );
+
+    // register a (fake) remote worker
+    TCPConnectionPool fakeWorker;
+    const ConnectionInfo * ci = fakeWorker.Connect( AStackString<>( "127.0.0.1" ), TEST_BROKERAGE_PORT );
+    TEST_ASSERT( ci );
+    {
+        WorkerBrokerage::WorkerInfo info;
+        info.m_HostName = "FakeWorker";
+        info.m_NumCPUs = 8;
+        info.m_NumFreeCPUs = 8;
+        info.m_ToolIds.Append( 0x1234 );
+        MemoryStream ms;
+        info.Serialize( ms );
+        Protocol::MsgBrokerageRegister msg;
+        TEST_ASSERT( msg.Send( ci, ms ) );
+    }
+
+    // register ourselves (as a worker would) over a persistent connection
+    {
+        WorkerBrokerage localWorker;
+        localWorker.SetWorkerInfo( 4, 4, 0, Array< uint64_t >() );
+
+        // wait for both workers to be registered (the worker connects in
+        // the background, and registers on a later update)
+        Timer t;
+        while ( ( server.GetNumRegisteredWorkers() < 2 ) && ( t.GetElapsed() < 5.0f ) )
+        {
+            localWorker.SetAvailability( true );
+            Thread::Sleep( 10 );
+        }
+        TEST_ASSERT( server.GetNumRegisteredWorkers() == 2 );
+
+        // a client finds the remote worker, but not itself
+        WorkerBrokerage client;
+        Array< AString > workers;
+        client.FindWorkers( workers );
+        TEST_ASSERT( workers.GetSize() == 1 );
+        TEST_ASSERT( workers[ 0 ] == "FakeWorker" );
+    }
+
+    // the worker is unregistered when its connection drops
+    fakeWorker.Disconnect( ci );
+    Timer t;
+    while ( ( server.GetNumRegisteredWorkers() > 0 ) && ( t.GetElapsed() < 5.0f ) )
+    {
+        Thread::Sleep( 10 );
+    }
+    TEST_ASSERT( server.GetNumRegisteredWorkers() == 0 );
+    {
+        WorkerBrokerage client;
+        Array< AString > workers;
+        client.FindWorkers( workers );
+        TEST_ASSERT( workers.IsEmpty() );
+    }
+}
+
+// CacheWriteRemote
+//------------------------------------------------------------------------------
+void TestDistributed::CacheWriteRemote() const
+{
+    // Objects compiled remotely and stored in the cache must be retrievable
+    // by a build which is not distributed
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+        options.m_AllowDistributed = true;
+        options.m_NumWorkerThreads = 1;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheWrite = true; // write only, so no cache lookup happens first
+        options.m_DistributionPort = TEST_PROTOCOL_PORT;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Server s( 1 );
+        s.Listen( TEST_PROTOCOL_PORT );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( target ) ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumBuilt > 0 );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumBuilt );
+    }
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheRead = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( target ) ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits > 0 );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+    }
+}
+
+// WorkerPerformanceEstimate
+//------------------------------------------------------------------------------
+void TestDistributed::WorkerPerformanceEstimate() const
+{
+    WorkerPerformance perf;
+    float timeMS = 0.0f;
+
+    // Nothing is predicted without history
+    TEST_ASSERT( perf.GetPredictedJobTimeMS( 100.0f, timeMS ) == false );
+
+    // Jobs never built before measure the overhead, but not the speed
+    perf.RecordJobCompleted( 0, 50, 60.0f );
+    perf.RecordJobCompleted( 0, 50, 60.0f );
+    perf.RecordJobCompleted( 0, 50, 60.0f );
+    TEST_ASSERT( perf.GetNumJobsCompleted() == 3 );
+    TEST_ASSERT( perf.GetOverheadMS() == 10.0f );
+    TEST_ASSERT( perf.GetSpeedRatio() == 1.0f );
+    TEST_ASSERT( perf.GetPredictedJobTimeMS( 100.0f, timeMS ) == false );
+
+    // Jobs with a previous build time measure the speed
+    perf.RecordJobCompleted( 100, 50, 60.0f );
+    perf.RecordJobCompleted( 100, 50, 60.0f );
+    TEST_ASSERT( perf.GetPredictedJobTimeMS( 100.0f, timeMS ) == false ); // not enough samples yet
+    perf.RecordJobCompleted( 100, 50, 60.0f );
+    TEST_ASSERT( perf.GetSpeedRatio() == 0.5f );
+    TEST_ASSERT( perf.GetPredictedJobTimeMS( 100.0f, timeMS ) );
+    TEST_ASSERT( timeMS == 60.0f ); // half the time, plus the overhead
+
+    // Failures make the worker look slower, as jobs have to be retried elsewhere
+    perf.RecordJobFailed();
+    perf.RecordJobFailed();
+    TEST_ASSERT( perf.GetFailureRate() == 0.25f );
+    TEST_ASSERT( perf.GetPredictedJobTimeMS( 100.0f, timeMS ) );
+    TEST_ASSERT( timeMS == 80.0f );
+}
+
+// ToolchainFromPeer
+//------------------------------------------------------------------------------
+void TestDistributed::ToolchainFromPeer() const
+{
+    // a worker fetching a toolchain from another worker
+    class FakePeer : public TCPConnectionPool
+    {
+    public:
+        ~FakePeer()
+        {
+            ShutdownAllConnections();
+        }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & )
+        {
+            if ( m_ExpectingFile )
+            {
+                m_ExpectingFile = false;
+                m_FileSize = size;
+                return;
+            }
+            const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+            if ( msg->GetType() == Protocol::MSG_TOOL_AVAILABLE )
+            {
+                m_ToolId = static_cast< const Protocol::MsgToolAvailable * >( msg )->GetToolId();
+            }
+            else if ( msg->GetType() == Protocol::MSG_FILE )
+            {
+                m_ExpectingFile = true; // payload follows
+            }
+        }
+        virtual void OnDisconnected( const ConnectionInfo * )
+        {
+            m_Disconnected = true;
+        }
+        volatile uint64_t m_ToolId = 0;
+        volatile uint32_t m_FileSize = 0;
+        volatile bool m_ExpectingFile = false;
+        volatile bool m_Disconnected = false;
+    };
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start the worker once initialization (which must be single threaded) is done
+    Server s( 1 );
+    s.Listen( TEST_PROTOCOL_PORT );
+
+    // synchronize the toolchain to the worker
+    TEST_ASSERT( fBuild.Build( AStackString<>( "../tmp/Test/Distributed/dist.lib" ) ) );
+
+    // files are not provided to connections which have not completed the handshake
+    {
+        FakePeer unknownPeer;
+        const ConnectionInfo * unknownCi = unknownPeer.Connect( AStackString<>( "127.0.0.1" ), TEST_PROTOCOL_PORT );
+        TEST_ASSERT( unknownCi );
+        Protocol::MsgRequestFile msg( 0, 0 );
+        TEST_ASSERT( msg.Send( unknownCi ) );
+        Timer t;
+        while ( ( unknownPeer.m_Disconnected == false ) && ( t.GetElapsed() < 5.0f ) )
+        {
+            Thread::Sleep( 10 );
+        }
+        TEST_ASSERT( unknownPeer.m_Disconnected );
+        TEST_ASSERT( unknownPeer.m_FileSize == 0 );
+    }
+
+    // the worker advertises the toolchain on connection
+    FakePeer peer;
+    const ConnectionInfo * ci = peer.Connect( AStackString<>( "127.0.0.1" ), TEST_PROTOCOL_PORT );
+    TEST_ASSERT( ci );
+    {
+        Protocol::MsgConnection msg( 0 );
+        TEST_ASSERT( msg.Send( ci ) );
+    }
+    Timer t;
+    while ( ( peer.m_ToolId == 0 ) && ( t.GetElapsed() < 5.0f ) )
+    {
+        Thread::Sleep( 10 );
+    }
+    TEST_ASSERT( peer.m_ToolId != 0 );
+
+    // files of the toolchain can be fetched from it
+    {
+        Protocol::MsgRequestFile msg( peer.m_ToolId, 0 );
+        TEST_ASSERT( msg.Send( ci ) );
+    }
+    t.Start();
+    while ( ( peer.m_FileSize == 0 ) && ( t.GetElapsed() < 5.0f ) )
+    {
+        Thread::Sleep( 10 );
+    }
+    TEST_ASSERT( peer.m_FileSize > 0 );
+
+    // requesting a file the worker can't provide drops the connection, so
+    // the peer falls back to requesting it from its client
+    {
+        Protocol::MsgRequestFile msg( peer.m_ToolId, 0xFFFFFFFF );
+        TEST_ASSERT( msg.Send( ci ) );
+    }
+    t.Start();
+    while ( ( peer.m_Disconnected == false ) && ( t.GetElapsed() < 5.0f ) )
+    {
+        Thread::Sleep( 10 );
+    }
+    TEST_ASSERT( peer.m_Disconnected );
+}
+
+// RemoteRaceHeuristic
+//------------------------------------------------------------------------------
+void TestDistributed::RemoteRaceHeuristic() const
+{
+    // Jobs expected to finish remotely before a local build would are not raced
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 1000, 0.0f, 2000.0f ) <= 0.0f );
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 1000, 900.0f, 200.0f ) <= 0.0f );
+
+    // Jobs on slower workers are raced, gaining the remaining difference
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 3000, 0.0f, 1000.0f ) == 2000.0f );
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 3000, 1000.0f, 1000.0f ) == 1000.0f );
+
+    // Jobs running late are expected to take as long again as they are late
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 1000, 1500.0f, 200.0f ) == 300.0f );
+    TEST_ASSERT( JobQueue::GetRaceGainMS( 1000, 3000.0f, 200.0f ) == 1800.0f );
+}
+
 //------------------------------------------------------------------------------
@@ -6,13 +6,24 @@
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
+#include <stdio.h> // for sscanf
+
+// Defines
+//------------------------------------------------------------------------------
+#define TEST_PROTOCOL_PORT ( Protocol::PROTOCOL_PORT + 1 ) // Avoid conflict with real worker
+
 // TestExec
 //------------------------------------------------------------------------------
 class TestExec : public FBuildTest
@@ -27,6 +38,16 @@ private:
     void Build_ExecCommand_MultipleInputChange() const;
     void Build_ExecCommand_UseStdOut() const;
     void Build_ExecCommand_ExpectedFailures() const;
+    void Build_ExecCommand_ResourcePool() const;
+    void Build_ExecCommand_ResourcePool_Distributed() const;
+    void ResourcePool_Errors() const;
+    void Build_ExecCommand_Cacheable() const;
+    void Build_ExecCommand_Distributed() const;
+    void Build_ExecCommand_DistributedLayout() const;
+    void Distribution_Errors() const;
+
+    void BuildResourcePoolDistributed( FBuild & fBuild ) const;
+    uint32_t GetMaxConcurrency( const char * outFileFormat, const char * const * inputs, size_t numInputs ) const;
 };
 
 // Register Tests
@@ -39,6 +60,13 @@ REGISTER_TESTS_BEGIN( TestExec )
     REGISTER_TEST(Build_ExecCommand_MultipleInputChange)
     REGISTER_TEST(Build_ExecCommand_UseStdOut)
     REGISTER_TEST(Build_ExecCommand_ExpectedFailures)
+    REGISTER_TEST(Build_ExecCommand_ResourcePool)
+    REGISTER_TEST(ResourcePool_Errors)
+    REGISTER_TEST(Build_ExecCommand_Cacheable)
+    REGISTER_TEST(Build_ExecCommand_Distributed)
+    REGISTER_TEST(Build_ExecCommand_DistributedLayout)
+    REGISTER_TEST(Distribution_Errors)
+    REGISTER_TEST(Build_ExecCommand_ResourcePool_Distributed)
 REGISTER_TESTS_END
 
 // Helpers
@@ -309,3 +337,388 @@ void TestExec::Build_ExecCommand_ExpectedFailures() const
     TEST_ASSERT(!fBuild.Build(AStackString<>("ExecCommandTest_OneInput_ReturnCode_ExpectFail")));
     TEST_ASSERT(!fBuild.Build(AStackString<>("ExecCommandTest_OneInput_WrongOutput_ExpectFail")));
 }
+
+//------------------------------------------------------------------------------
+void TestExec::Build_ExecCommand_ResourcePool() const
+{
+    // Commands sharing a resource pool with a capacity of 1 are run one at a
+    // time, but must all still be run
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_NumWorkerThreads = 4; // enough to run them all at once without the pool
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    const char * const inputs[] = { "ResourcePoolA", "ResourcePoolB", "ResourcePoolC", "ResourcePoolD" };
+    for ( const char * input : inputs )
+    {
+        AStackString<> inFile;
+        inFile.Format( "../tmp/Test/Exec/%s.txt", input );
+        CreateInputFile( inFile );
+
+        AStackString<> outFile;
+        outFile.Format( "../tmp/Test/Exec/%s.txt.out", input );
+        EnsureFileDoesNotExist( outFile );
+    }
+
+    // build (via alias)
+    TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_ResourcePool" ) ) );
+
+    // no more commands than the capacity of the pool ran at the same time
+    TEST_ASSERT( GetMaxConcurrency( "../tmp/Test/Exec/%s.txt.out", inputs, sizeof( inputs ) / sizeof( inputs[ 0 ] ) ) == 1 );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 4,     4,      Node::EXEC_NODE );
+}
+
+//------------------------------------------------------------------------------
+void TestExec::ResourcePool_Errors() const
+{
+    // A pool which is not declared in the Settings
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/ResourcePool/undefined.bff";
+
+        // Parsing of BFF should FAIL
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() == false );
+        TEST_ASSERT( GetRecordedOutput().Find( "FASTBuild Error #1107" ) ); // '.ResourcePool' ('%s') is not declared in the Settings '.ResourcePools'.
+    }
+
+    // A pool without a capacity
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/ResourcePool/badcapacity.bff";
+
+        // Parsing of BFF should FAIL
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() == false );
+        TEST_ASSERT( GetRecordedOutput().Find( "FASTBuild Error #1106" ) ); // missing '='
+    }
+
+    // A capacity which is not a decimal number
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/ResourcePool/badnumber.bff";
+
+        // Parsing of BFF should FAIL
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() == false );
+        TEST_ASSERT( GetRecordedOutput().Find( "FASTBuild Error #1054" ) ); // Integer '%s' must be in range %i to %i.
+    }
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/ResourcePool/hexnumber.bff";
+
+        // Parsing of BFF should FAIL
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() == false );
+        TEST_ASSERT( GetRecordedOutput().Find( "FASTBuild Error #1054" ) ); // Integer '%s' must be in range %i to %i.
+    }
+}
+
+//------------------------------------------------------------------------------
+void TestExec::Build_ExecCommand_Cacheable() const
+{
+    const AStackString<> inFile( "../tmp/Test/Exec/Cacheable.txt" );
+    const AStackString<> outFile( "../tmp/Test/Exec/Cacheable.txt.out" );
+    CreateInputFile( inFile );
+
+    // Write to the cache
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheWrite = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        EnsureFileDoesNotExist( outFile );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_Cacheable" ) ) );
+
+        EnsureFileExists( outFile );
+
+        const FBuildStats::Stats & execStats = fBuild.GetStats().GetStatsFor( Node::EXEC_NODE );
+        TEST_ASSERT( execStats.m_NumCacheStores == 1 );
+        TEST_ASSERT( execStats.m_NumBuilt == 1 );
+    }
+
+    // Read from the cache
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheRead = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        EnsureFileDoesNotExist( outFile );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_Cacheable" ) ) );
+
+        EnsureFileExists( outFile );
+
+        const FBuildStats::Stats & execStats = fBuild.GetStats().GetStatsFor( Node::EXEC_NODE );
+        TEST_ASSERT( execStats.m_NumCacheHits == 1 );
+        TEST_ASSERT( execStats.m_NumBuilt == 0 );
+    }
+
+    // A different working dir doesn't use the cached output
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/Cacheable/workingdir.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheRead = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( "../tmp/Test/Exec/Cacheable/workingdir.fdb" ) );
+
+        EnsureFileDoesNotExist( outFile );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_Cacheable" ) ) );
+
+        EnsureFileExists( outFile );
+
+        const FBuildStats::Stats & execStats = fBuild.GetStats().GetStatsFor( Node::EXEC_NODE );
+        TEST_ASSERT( execStats.m_NumCacheHits == 0 );
+        TEST_ASSERT( execStats.m_NumBuilt == 1 );
+    }
+}
+
+//------------------------------------------------------------------------------
+void TestExec::Build_ExecCommand_Distributed() const
+{
+    const AStackString<> inFile( "../tmp/Test/Exec/Distributed.txt" );
+    const AStackString<> outFile( "../tmp/Test/Exec/Distributed.txt.stdout" );
+    CreateInputFile( inFile );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_AllowDistributed = true;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure the job happens on the remote worker
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a server to emulate the other end
+    Server s( 1 );
+    s.Listen( TEST_PROTOCOL_PORT );
+
+    EnsureFileDoesNotExist( outFile );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_Distributed" ) ) );
+
+    // the output was returned by the worker
+    EnsureFileExists( outFile );
+    const Node * node = fBuild.GetDependencyGraph().FindNode( outFile );
+    TEST_ASSERT( node && node->GetStatFlag( Node::STATS_BUILT_REMOTE ) );
+
+    // the output is "Touched: <tmpDir>/Distributed.txt.out", and the temp dir
+    // holding the input on the worker has been removed
+    AStackString<> output;
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( outFile.Get(), FileStream::READ_ONLY ) );
+        output.SetLength( (uint32_t)f.GetFileSize() );
+        TEST_ASSERT( f.ReadBuffer( output.Get(), output.GetLength() ) == output.GetLength() );
+    }
+    const char * touched = output.Find( "Touched: " );
+    TEST_ASSERT( touched );
+    AStackString<> tmpDir( touched + 9 );
+    char * lastSlash = tmpDir.FindLast( NATIVE_SLASH );
+    TEST_ASSERT( lastSlash );
+    tmpDir.SetLength( (uint32_t)( lastSlash - tmpDir.Get() ) );
+    TEST_ASSERT( FileIO::DirectoryExists( tmpDir ) == false );
+}
+
+//------------------------------------------------------------------------------
+void TestExec::Build_ExecCommand_DistributedLayout() const
+{
+    const AStackString<> outFile( "../tmp/Test/Exec/DistributedLayout.txt.stdout" );
+    const AStackString<> clientOutFile( "Tools/FBuild/FBuildTest/Data/TestExec/DistributedLayout/a/x.txt.out" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_AllowDistributed = true;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure the job happens on the remote worker
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a server to emulate the other end
+    Server s( 1 );
+    s.Listen( TEST_PROTOCOL_PORT );
+
+    EnsureFileDoesNotExist( outFile );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_DistributedLayout" ) ) );
+
+    const Node * node = fBuild.GetDependencyGraph().FindNode( outFile );
+    TEST_ASSERT( node && node->GetStatFlag( Node::STATS_BUILT_REMOTE ) );
+
+    // the files touched were all in the same temp dir on the worker, in the
+    // same layout as on the client
+    AStackString<> output;
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( outFile.Get(), FileStream::READ_ONLY ) );
+        output.SetLength( (uint32_t)f.GetFileSize() );
+        TEST_ASSERT( f.ReadBuffer( output.Get(), output.GetLength() ) == output.GetLength() );
+    }
+    Array< AString > lines;
+    output.Tokenize( lines, '\n' );
+    TEST_ASSERT( lines.GetSize() == 3 );
+    AStackString<> expectedA;
+    AStackString<> expectedB;
+    expectedA.Format( "%ca%cx.txt.out", NATIVE_SLASH, NATIVE_SLASH );
+    expectedB.Format( "%cb%cy.txt.out", NATIVE_SLASH, NATIVE_SLASH );
+    AStackString<> tmpDir;
+    for ( AString & line : lines )
+    {
+        line.Replace( "\r", "" );
+        TEST_ASSERT( line.BeginsWith( "Touched: " ) );
+        const bool isA = line.EndsWith( expectedA );
+        TEST_ASSERT( isA || line.EndsWith( expectedB ) );
+        const AStackString<> dir( line.Get() + 9, line.GetEnd() - ( isA ? expectedA : expectedB ).GetLength() );
+        if ( tmpDir.IsEmpty() )
+        {
+            tmpDir = dir;
+        }
+        TEST_ASSERT( dir == tmpDir );
+    }
+
+    // including the input passed by its full path on the client
+    EnsureFileDoesNotExist( clientOutFile );
+
+    // the temp dir (and the dirs of the inputs in it) were removed
+    TEST_ASSERT( FileIO::DirectoryExists( tmpDir ) == false );
+}
+
+//------------------------------------------------------------------------------
+void TestExec::Distribution_Errors() const
+{
+    // Distribution with an executable which is not a Compiler()
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/Distribution/notacompiler.bff";
+
+    // Parsing of BFF should FAIL
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() == false );
+    TEST_ASSERT( GetRecordedOutput().Find( "FASTBuild Error #1102" ) ); // '%s' ('%s') is of unexpected type '%s'. Expected '%s'.
+}
+
+//------------------------------------------------------------------------------
+void TestExec::Build_ExecCommand_ResourcePool_Distributed() const
+{
+    // Distributable commands built locally (because no worker is available)
+    // still respect their resource pool
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_AllowDistributed = true;
+        options.m_DistributionPort = TEST_PROTOCOL_PORT; // nothing is listening
+        options.m_NumWorkerThreads = 4; // enough to run them all at once without the pool
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        BuildResourcePoolDistributed( fBuild );
+    }
+
+    // and so do commands built by a remote worker
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestExec/exec.bff";
+        options.m_ForceCleanBuild = true;
+        options.m_AllowDistributed = true;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure the jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_DistributionPort = TEST_PROTOCOL_PORT;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // start a server to emulate the other end
+        Server s( 4 ); // enough to run them all at once without the pool
+        s.Listen( TEST_PROTOCOL_PORT );
+
+        BuildResourcePoolDistributed( fBuild );
+    }
+}
+
+// BuildResourcePoolDistributed
+//------------------------------------------------------------------------------
+void TestExec::BuildResourcePoolDistributed( FBuild & fBuild ) const
+{
+    const char * const inputs[] = { "ResourcePoolDistA", "ResourcePoolDistB", "ResourcePoolDistC", "ResourcePoolDistD" };
+    for ( const char * input : inputs )
+    {
+        AStackString<> inFile;
+        inFile.Format( "../tmp/Test/Exec/%s.txt", input );
+        CreateInputFile( inFile );
+    }
+
+    // build (via alias)
+    TEST_ASSERT( fBuild.Build( AStackString<>( "ExecCommandTest_ResourcePool_Distributed" ) ) );
+
+    // no more commands than the capacity of the pool ran at the same time
+    TEST_ASSERT( GetMaxConcurrency( "../tmp/Test/Exec/%s.txt.stdout", inputs, sizeof( inputs ) / sizeof( inputs[ 0 ] ) ) == 1 );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 4,     4,      Node::EXEC_NODE );
+}
+
+// GetMaxConcurrency
+//------------------------------------------------------------------------------
+uint32_t TestExec::GetMaxConcurrency( const char * outFileFormat, const char * const * inputs, size_t numInputs ) const
+{
+    // each command wrote the times it started and finished
+    Array< long long > startTimes( numInputs, false );
+    Array< long long > endTimes( numInputs, false );
+    for ( size_t i = 0; i < numInputs; ++i )
+    {
+        AStackString<> outFile;
+        outFile.Format( outFileFormat, inputs[ i ] );
+        EnsureFileExists( outFile );
+
+        FileStream f;
+        TEST_ASSERT( f.Open( outFile.Get(), FileStream::READ_ONLY ) );
+        AStackString<> times;
+        times.SetLength( (uint32_t)f.GetFileSize() );
+        TEST_ASSERT( f.ReadBuffer( times.Get(), times.GetLength() ) == times.GetLength() );
+        long long startTime = 0;
+        long long endTime = 0;
+        TEST_ASSERT( sscanf( times.Get(), "%lld %lld", &startTime, &endTime ) == 2 );
+        startTimes.Append( startTime );
+        endTimes.Append( endTime );
+    }
+
+    // the most commands running at the same time
+    uint32_t maxConcurrency = 0;
+    for ( size_t i = 0; i < numInputs; ++i )
+    {
+        uint32_t concurrency = 0;
+        for ( size_t j = 0; j < numInputs; ++j )
+        {
+            if ( ( startTimes[ j ] <= startTimes[ i ] ) && ( startTimes[ i ] < endTimes[ j ] ) )
+            {
+                ++concurrency; // j was running when i started
+            }
+        }
+        maxConcurrency = Math::Max( maxConcurrency, concurrency );
+    }
+    return maxConcurrency;
+}
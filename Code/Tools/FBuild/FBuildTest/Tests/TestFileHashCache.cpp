@@ -0,0 +1,290 @@
+// TestFileHashCache.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/FileHashCache.h"
+
+// Core
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// TestFileHashCache
+//------------------------------------------------------------------------------
+class TestFileHashCache : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void FindAndAdd() const;
+    void GetHash() const;
+    void SaveLoad() const;
+    void SaveUsedOnly() const;
+    void RecentlyModified() const;
+    void MultipleThreads() const;
+
+    void WriteFile( const char * fileName, const char * contents ) const;
+    void AgeFile( const AString & fileName ) const;
+
+    struct ThreadData
+    {
+        FileHashCache * m_Cache;
+        uint32_t        m_ThreadIndex;
+        uint32_t        m_Failures;
+    };
+    static uint32_t ThreadFunction( void * userData );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestFileHashCache )
+    REGISTER_TEST( FindAndAdd )
+    REGISTER_TEST( GetHash )
+    REGISTER_TEST( SaveLoad )
+    REGISTER_TEST( SaveUsedOnly )
+    REGISTER_TEST( RecentlyModified )
+    REGISTER_TEST( MultipleThreads )
+REGISTER_TESTS_END
+
+// FindAndAdd
+//------------------------------------------------------------------------------
+void TestFileHashCache::FindAndAdd() const
+{
+    FileHashCache cache;
+    uint64_t hash = 0;
+
+    // not yet known
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 1, 100, hash ) == false );
+
+    // known
+    cache.Add( AStackString<>( "c:\\file.h" ), 1, 100, 0x1234 );
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 1, 100, hash ) );
+    TEST_ASSERT( hash == 0x1234 );
+
+    // paths are only case-insensitive on platforms with case-insensitive file systems
+    #if defined( __WINDOWS__ ) || defined( __OSX__ )
+        TEST_ASSERT( cache.Find( AStackString<>( "C:\\FILE.H" ), 1, 100, hash ) );
+    #else
+        TEST_ASSERT( cache.Find( AStackString<>( "C:\\FILE.H" ), 1, 100, hash ) == false );
+    #endif
+
+    // different version of the file
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 2, 100, hash ) == false ); // timestamp changed
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 1, 101, hash ) == false ); // size changed
+
+    // only the latest version of each file is kept
+    cache.Add( AStackString<>( "c:\\file.h" ), 2, 100, 0x5678 );
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 1, 100, hash ) == false );
+    TEST_ASSERT( cache.Find( AStackString<>( "c:\\file.h" ), 2, 100, hash ) );
+    TEST_ASSERT( hash == 0x5678 );
+    TEST_ASSERT( cache.GetNumEntries() == 1 );
+
+    #if defined( __WINDOWS__ ) || defined( __OSX__ )
+        TEST_ASSERT( cache.GetNumHits() == 3 );
+        TEST_ASSERT( cache.GetNumMisses() == 4 );
+    #else
+        TEST_ASSERT( cache.GetNumHits() == 2 );
+        TEST_ASSERT( cache.GetNumMisses() == 5 );
+    #endif
+}
+
+// GetHash
+//------------------------------------------------------------------------------
+void TestFileHashCache::GetHash() const
+{
+    const AStackString<> fileName( "../tmp/Test/FileHashCache/file.h" );
+    const char * contentsA = "// Contents A";
+    const char * contentsB = "// Contents B (different size)";
+
+    FileHashCache cache;
+    uint64_t hash = 0;
+
+    // missing file
+    EnsureFileDoesNotExist( fileName );
+    TEST_ASSERT( cache.GetHash( fileName, hash ) == false );
+
+    // first access reads the file (aged so it can be cached)
+    WriteFile( fileName.Get(), contentsA );
+    AgeFile( fileName );
+    TEST_ASSERT( cache.GetHash( fileName, hash ) );
+    TEST_ASSERT( hash == xxHash::Calc64( contentsA, AString::StrLen( contentsA ) ) );
+    const uint32_t numMisses = cache.GetNumMisses();
+
+    // second access doesn't
+    TEST_ASSERT( cache.GetHash( fileName, hash ) );
+    TEST_ASSERT( hash == xxHash::Calc64( contentsA, AString::StrLen( contentsA ) ) );
+    TEST_ASSERT( cache.GetNumMisses() == numMisses );
+    TEST_ASSERT( cache.GetNumHits() == 1 );
+
+    // modified file is read again
+    WriteFile( fileName.Get(), contentsB );
+    AgeFile( fileName );
+    TEST_ASSERT( cache.GetHash( fileName, hash ) );
+    TEST_ASSERT( hash == xxHash::Calc64( contentsB, AString::StrLen( contentsB ) ) );
+    TEST_ASSERT( cache.GetNumMisses() == ( numMisses + 1 ) );
+}
+
+// SaveLoad
+//------------------------------------------------------------------------------
+void TestFileHashCache::SaveLoad() const
+{
+    FileHashCache cache;
+    cache.Add( AStackString<>( "/path/a.h" ), 1, 100, 0x1111 );
+    cache.Add( AStackString<>( "/path/b.h" ), 2, 200, 0x2222 );
+
+    MemoryStream ms;
+    cache.Save( ms );
+
+    FileHashCache loadedCache;
+    ConstMemoryStream cms( ms.GetData(), ms.GetSize() );
+    TEST_ASSERT( loadedCache.Load( cms ) );
+    TEST_ASSERT( loadedCache.GetNumEntries() == 2 );
+
+    uint64_t hash = 0;
+    TEST_ASSERT( loadedCache.Find( AStackString<>( "/path/a.h" ), 1, 100, hash ) );
+    TEST_ASSERT( hash == 0x1111 );
+    TEST_ASSERT( loadedCache.Find( AStackString<>( "/path/b.h" ), 2, 200, hash ) );
+    TEST_ASSERT( hash == 0x2222 );
+
+    // truncated data
+    FileHashCache badCache;
+    ConstMemoryStream truncated( ms.GetData(), ms.GetSize() - 1 );
+    TEST_ASSERT( badCache.Load( truncated ) == false );
+}
+
+// SaveUsedOnly
+//------------------------------------------------------------------------------
+void TestFileHashCache::SaveUsedOnly() const
+{
+    FileHashCache cache;
+    cache.Add( AStackString<>( "/path/a.h" ), 1, 100, 0x1111 );
+    cache.Add( AStackString<>( "/path/b.h" ), 2, 200, 0x2222 );
+    MemoryStream ms;
+    cache.Save( ms );
+
+    // next build only uses one of the files
+    FileHashCache loadedCache;
+    ConstMemoryStream cms( ms.GetData(), ms.GetSize() );
+    TEST_ASSERT( loadedCache.Load( cms ) );
+    uint64_t hash = 0;
+    TEST_ASSERT( loadedCache.Find( AStackString<>( "/path/a.h" ), 1, 100, hash ) );
+    MemoryStream ms2;
+    loadedCache.Save( ms2 );
+
+    // the other is not saved
+    FileHashCache loadedCache2;
+    ConstMemoryStream cms2( ms2.GetData(), ms2.GetSize() );
+    TEST_ASSERT( loadedCache2.Load( cms2 ) );
+    TEST_ASSERT( loadedCache2.GetNumEntries() == 1 );
+    TEST_ASSERT( loadedCache2.Find( AStackString<>( "/path/a.h" ), 1, 100, hash ) );
+    TEST_ASSERT( loadedCache2.Find( AStackString<>( "/path/b.h" ), 2, 200, hash ) == false );
+}
+
+// RecentlyModified
+//------------------------------------------------------------------------------
+void TestFileHashCache::RecentlyModified() const
+{
+    // a file modified within the timestamp granularity of "now" could change
+    // again without its timestamp changing, so it is not cached
+    FileHashCache cache;
+    const uint64_t now = Time::GetCurrentFileTime();
+    cache.Add( AStackString<>( "/path/a.h" ), now, 100, 0x1111 );
+    TEST_ASSERT( cache.GetNumEntries() == 0 );
+
+    const AStackString<> fileName( "../tmp/Test/FileHashCache/recent.h" );
+    const char * contents = "// Contents";
+    WriteFile( fileName.Get(), contents );
+    uint64_t hash = 0;
+    TEST_ASSERT( cache.GetHash( fileName, hash ) );
+    TEST_ASSERT( hash == xxHash::Calc64( contents, AString::StrLen( contents ) ) );
+    TEST_ASSERT( cache.GetHash( fileName, hash ) );
+    TEST_ASSERT( cache.GetNumHits() == 0 );
+    TEST_ASSERT( cache.GetNumEntries() == 0 );
+}
+
+// MultipleThreads
+//------------------------------------------------------------------------------
+void TestFileHashCache::MultipleThreads() const
+{
+    FileHashCache cache;
+
+    const uint32_t numThreads = 4;
+    ThreadData data[ numThreads ];
+    Thread::ThreadHandle handles[ numThreads ];
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        data[ i ].m_Cache = &cache;
+        data[ i ].m_ThreadIndex = i;
+        data[ i ].m_Failures = 0;
+        handles[ i ] = Thread::CreateThread( ThreadFunction, "TestFileHashCache", ( 64 * KILOBYTE ), &data[ i ] );
+    }
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread::WaitForThread( handles[ i ] );
+        Thread::CloseHandle( handles[ i ] );
+        TEST_ASSERT( data[ i ].m_Failures == 0 );
+    }
+
+    // each thread added a unique set of files, and one file shared by all threads
+    TEST_ASSERT( cache.GetNumEntries() == ( ( numThreads * 1000 ) + 1 ) );
+}
+
+// ThreadFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestFileHashCache::ThreadFunction( void * userData )
+{
+    ThreadData & data = *static_cast< ThreadData * >( userData );
+    AStackString<> fileName;
+    uint64_t hash = 0;
+    for ( uint32_t i = 0; i < 1000; ++i )
+    {
+        fileName.Format( "/path/%u/%u.h", data.m_ThreadIndex, i );
+        data.m_Cache->Add( fileName, i, i, i );
+        data.m_Cache->Add( AStackString<>( "/path/shared.h" ), 1, 1, 1 );
+        if ( ( data.m_Cache->Find( fileName, i, i, hash ) == false ) || ( hash != i ) )
+        {
+            ++data.m_Failures;
+        }
+    }
+    return 0;
+}
+
+// WriteFile
+//------------------------------------------------------------------------------
+void TestFileHashCache::WriteFile( const char * fileName, const char * contents ) const
+{
+    EnsureDirExists( "../tmp/Test/FileHashCache/" );
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName, FileStream::WRITE_ONLY ) );
+    TEST_ASSERT( f.Write( contents, AString::StrLen( contents ) ) == AString::StrLen( contents ) );
+    f.Close();
+}
+
+// AgeFile
+//------------------------------------------------------------------------------
+void TestFileHashCache::AgeFile( const AString & fileName ) const
+{
+    #if defined( __WINDOWS__ )
+        const uint64_t past = ( Time::GetCurrentFileTime() - ( 3600 * 10000000ULL ) );
+    #else
+        const uint64_t past = ( Time::GetCurrentFileTime() - ( 3600 * 1000000000ULL ) );
+    #endif
+
+    // use the full path (SetFileLastWriteTime doesn't handle relative paths on all platforms)
+    AStackString<> fullPath;
+    TEST_ASSERT( FileIO::GetCurrentDir( fullPath ) );
+    PathUtils::EnsureTrailingSlash( fullPath );
+    fullPath += fileName;
+    TEST_ASSERT( FileIO::SetFileLastWriteTime( fullPath, past ) );
+}
+
+//------------------------------------------------------------------------------
@@ -28,6 +28,7 @@
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
 #include "Core/Time/Timer.h"
 
 // system
@@ -49,12 +50,17 @@ private:
     void SingleFileNode() const;
     void SingleFileNodeMissing() const;
     void TestDirectoryListNode() const;
+    void TestDirectoryListNode_Snapshots() const;
     void TestSerialization() const;
     void TestDeepGraph() const;
     void TestNoStopOnFirstError() const;
     void DBLocationChanged() const;
     void BFFDirtied() const;
+    void BFFChanged_BuildStateKept() const;
+    void BFFChanged_EnvironmentChanged() const;
     void DBVersionChanged() const;
+
+    static const DirectoryListNode * FindDirectoryListNode( const FBuild & fBuild );
 };
 
 // Register Tests
@@ -67,11 +73,14 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( SingleFileNode )
     REGISTER_TEST( SingleFileNodeMissing )
     REGISTER_TEST( TestDirectoryListNode )
+    REGISTER_TEST( TestDirectoryListNode_Snapshots )
     REGISTER_TEST( TestSerialization )
     REGISTER_TEST( TestDeepGraph )
     REGISTER_TEST( TestNoStopOnFirstError )
     REGISTER_TEST( DBLocationChanged )
     REGISTER_TEST( BFFDirtied )
+    REGISTER_TEST( BFFChanged_BuildStateKept )
+    REGISTER_TEST( BFFChanged_EnvironmentChanged )
     REGISTER_TEST( DBVersionChanged )
 REGISTER_TESTS_END
 
@@ -296,6 +305,139 @@ void TestGraph::TestDirectoryListNode() const
     }
 }
 
+// TestDirectoryListNode_Snapshots
+//------------------------------------------------------------------------------
+void TestGraph::TestDirectoryListNode_Snapshots() const
+{
+    const char * const files[] =
+    {
+        "a.cpp",
+        "Sub1/b.cpp",
+        "Sub1/Sub2/c.cpp",
+        "Sub3/d.cpp",
+        "Excluded/e.cpp",
+        "Excluded/Deep/f.cpp",
+    };
+    const char * const dirs[] = { "", "Sub1/", "Sub1/Sub2/", "Sub3/", "Excluded/", "Excluded/Deep/" };
+
+    // create the tree
+    AStackString<> root;
+    {
+        FBuild fBuild; // needed for CleanPath
+        NodeGraph::CleanPath( AStackString<>( "../tmp/Test/Graph/DirectoryListSnapshots/Input/" ), root );
+    }
+    AStackString<> path;
+    for ( const char * dir : dirs )
+    {
+        path = root;
+        path += dir;
+        EnsureDirExists( path );
+    }
+    AStackString<> addedFile( root );
+    addedFile += "Sub1/g.cpp";
+    EnsureFileDoesNotExist( addedFile );
+    for ( const char * file : files )
+    {
+        path = root;
+        path += file;
+        FileStream f;
+        TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) );
+        f.Close();
+    }
+
+    // directories modified very recently are always listed, so age them
+    #if !defined( __WINDOWS__ )
+        const uint64_t past = ( Time::GetCurrentFileTime() - ( 3600 * 1000000000ULL ) );
+        for ( const char * dir : dirs )
+        {
+            path = root;
+            path += dir;
+            TEST_ASSERT( FileIO::SetFileLastWriteTime( path, past ) );
+        }
+    #endif
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DirectoryListSnapshots/fbuild.bff";
+    const char * dbFile = "../tmp/Test/Graph/DirectoryListSnapshots/fbuild.fdb";
+
+    // clean build lists every directory, except those excluded
+    {
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "Unity" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        const DirectoryListNode * node = FindDirectoryListNode( fBuild );
+        TEST_ASSERT( node->GetNumDirectoriesListed() == 4 );
+        TEST_ASSERT( node->GetNumDirectoriesReused() == 0 );
+
+        // files are sorted, in each directory before sub-directories
+        const Array< FileIO::FileInfo > & foundFiles = node->GetFiles();
+        TEST_ASSERT( foundFiles.GetSize() == 4 );
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            path = root;
+            path += files[ i ];
+            #if defined( __WINDOWS__ )
+                path.Replace( '/', '\\' );
+            #endif
+            TEST_ASSERT( foundFiles[ i ].m_Name == path );
+        }
+    }
+
+    // unchanged directories are not listed again
+    {
+        options.m_ForceCleanBuild = false;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "Unity" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        const DirectoryListNode * node = FindDirectoryListNode( fBuild );
+        TEST_ASSERT( node->GetFiles().GetSize() == 4 );
+        #if !defined( __WINDOWS__ )
+            TEST_ASSERT( node->GetNumDirectoriesListed() == 0 );
+            TEST_ASSERT( node->GetNumDirectoriesReused() == 4 );
+        #endif
+    }
+
+    // adding a file modifies its directory, which is listed again
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( addedFile.Get(), FileStream::WRITE_ONLY ) );
+        f.Close();
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "Unity" ) ) );
+
+        const DirectoryListNode * node = FindDirectoryListNode( fBuild );
+        TEST_ASSERT( node->GetFiles().GetSize() == 5 );
+        #if !defined( __WINDOWS__ )
+            TEST_ASSERT( node->GetNumDirectoriesListed() == 1 );
+            TEST_ASSERT( node->GetNumDirectoriesReused() == 3 );
+        #endif
+    }
+}
+
+// FindDirectoryListNode
+//------------------------------------------------------------------------------
+/*static*/ const DirectoryListNode * TestGraph::FindDirectoryListNode( const FBuild & fBuild )
+{
+    const NodeGraph & nodeGraph = fBuild.GetDependencyGraph();
+    for ( size_t i = 0; i < nodeGraph.GetNodeCount(); ++i )
+    {
+        const Node * node = nodeGraph.GetNodeByIndex( i );
+        if ( node->GetType() == Node::DIRECTORY_LIST_NODE )
+        {
+            return node->CastTo< DirectoryListNode >();
+        }
+    }
+    TEST_ASSERT( false );
+    return nullptr;
+}
+
 // TestSerialization
 //------------------------------------------------------------------------------
 void TestGraph::TestSerialization() const
@@ -718,6 +860,180 @@ void TestGraph::BFFDirtied() const
     }
 }
 
+// BFFChanged_BuildStateKept
+//------------------------------------------------------------------------------
+void TestGraph::BFFChanged_BuildStateKept() const
+{
+    const char* bffFile = "../tmp/Test/Graph/BFFChanged/fbuild.bff";
+    const char* dbFile  = "../tmp/Test/Graph/BFFChanged/fbuild.fdb";
+
+    EnsureFileDoesNotExist( bffFile );
+    EnsureFileDoesNotExist( dbFile );
+    EnsureDirExists( "../tmp/Test/Graph/BFFChanged/" );
+
+    // The BFF is generated, as it is modified by the test
+    AStackString<> workingDir;
+    TEST_ASSERT( FileIO::GetCurrentDir( workingDir ) );
+    PathUtils::EnsureTrailingSlash( workingDir );
+    const char * const bffFormat =
+        "#include \"%sTools/FBuild/FBuildTest/Data/testcommon.bff\"\n"
+        "Using( .StandardEnvironment )\n"
+        "Settings {}\n"
+        ".CompilerOutputPath = '$Out$/Test/Graph/BFFChanged/'\n"
+        "ObjectList( 'A' )\n"
+        "{\n"
+        "    .CompilerInputFiles = 'Tools/FBuild/FBuildTest/Data/TestGraph/BFFChanged/a.cpp'\n"
+        "}\n"
+        "ObjectList( 'B' )\n"
+        "{\n"
+        "    .CompilerInputFiles = 'Tools/FBuild/FBuildTest/Data/TestGraph/BFFChanged/b.cpp'\n"
+        "    .CompilerOptions + '%s'\n"
+        "}\n"
+        "Alias( 'All' ) { .Targets = { 'A', 'B' } }\n";
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+
+    // Build
+    {
+        AStackString<> bff;
+        bff.Format( bffFormat, workingDir.Get(), "" );
+        FileStream fs;
+        TEST_ASSERT( fs.Open( bffFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( bff.Get(), bff.GetLength() ) == bff.GetLength() );
+        fs.Close();
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 2,     2,      Node::OBJECT_NODE );
+    }
+
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #elif defined( __LINUX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of ext2/ext3/reiserfs and time caching used by used by others
+    #endif
+
+    // Change the options of B only
+    {
+        AStackString<> bff;
+        bff.Format( bffFormat, workingDir.Get(), " -DCHANGED" );
+        FileStream fs;
+        TEST_ASSERT( fs.Open( bffFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( bff.Get(), bff.GetLength() ) == bff.GetLength() );
+        fs.Close();
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "has changed (reparsing will occur)" ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // Only B is rebuilt, A keeps the build state from before the BFF changed
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     0,      Node::COMPILER_NODE );
+        CheckStatsNode ( 2,     1,      Node::OBJECT_NODE );
+    }
+
+    // No rebuild
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 2,     0,      Node::OBJECT_NODE );
+    }
+}
+
+// BFFChanged_EnvironmentChanged
+//------------------------------------------------------------------------------
+void TestGraph::BFFChanged_EnvironmentChanged() const
+{
+    const char* bffFile = "../tmp/Test/Graph/BFFChangedEnvironment/fbuild.bff";
+    const char* dbFile  = "../tmp/Test/Graph/BFFChangedEnvironment/fbuild.fdb";
+
+    EnsureFileDoesNotExist( bffFile );
+    EnsureFileDoesNotExist( dbFile );
+    EnsureDirExists( "../tmp/Test/Graph/BFFChangedEnvironment/" );
+
+    // The BFF is generated, as it is modified by the test
+    AStackString<> workingDir;
+    TEST_ASSERT( FileIO::GetCurrentDir( workingDir ) );
+    PathUtils::EnsureTrailingSlash( workingDir );
+    const char * const bffFormat =
+        "#include \"%sTools/FBuild/FBuildTest/Data/testcommon.bff\"\n"
+        "Using( .StandardEnvironment )\n"
+        "Settings\n"
+        "{\n"
+        "    #if __WINDOWS__\n"
+        "        .Environment + { 'FBUILD_TEST_VAR=%s' }\n"
+        "    #else\n"
+        "        .Environment = { 'PATH=/usr/bin:/bin', 'FBUILD_TEST_VAR=%s' }\n"
+        "    #endif\n"
+        "}\n"
+        ".CompilerOutputPath = '$Out$/Test/Graph/BFFChangedEnvironment/'\n"
+        "ObjectList( 'All' )\n"
+        "{\n"
+        "    .CompilerInputFiles = { 'Tools/FBuild/FBuildTest/Data/TestGraph/BFFChanged/a.cpp',\n"
+        "                            'Tools/FBuild/FBuildTest/Data/TestGraph/BFFChanged/b.cpp' }\n"
+        "}\n";
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+
+    // Build
+    {
+        AStackString<> bff;
+        bff.Format( bffFormat, workingDir.Get(), "1", "1" );
+        FileStream fs;
+        TEST_ASSERT( fs.Open( bffFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( bff.Get(), bff.GetLength() ) == bff.GetLength() );
+        fs.Close();
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 2,     2,      Node::OBJECT_NODE );
+    }
+
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #elif defined( __LINUX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of ext2/ext3/reiserfs and time caching used by used by others
+    #endif
+
+    // Change the environment only
+    {
+        AStackString<> bff;
+        bff.Format( bffFormat, workingDir.Get(), "2", "2" );
+        FileStream fs;
+        TEST_ASSERT( fs.Open( bffFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( bff.Get(), bff.GetLength() ) == bff.GetLength() );
+        fs.Close();
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "build state will not be reused" ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // The objects are defined the same way, but the compiler runs with a
+        // different environment, so they are rebuilt
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 2,     2,      Node::OBJECT_NODE );
+    }
+}
+
 // DBVersionChanged
 //------------------------------------------------------------------------------
 void TestGraph::DBVersionChanged() const
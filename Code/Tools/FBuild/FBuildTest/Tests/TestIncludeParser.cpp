@@ -32,6 +32,8 @@ private:
     void TestClangMSExtensionsPreprocessedOutput() const;
     void TestEdgeCases() const;
     void ClangLineEndings() const;
+    void FindLineStartingWithHash() const;
+    void LargeSyntheticInput() const;
 };
 
 // Register Tests
@@ -49,6 +51,8 @@ REGISTER_TESTS_BEGIN( TestIncludeParser )
     REGISTER_TEST( TestClangMSExtensionsPreprocessedOutput );
     REGISTER_TEST( TestEdgeCases );
     REGISTER_TEST( ClangLineEndings )
+    REGISTER_TEST( FindLineStartingWithHash )
+    REGISTER_TEST( LargeSyntheticInput )
 REGISTER_TESTS_END
 
 // TestMSVCPreprocessedOutput
@@ -433,4 +437,66 @@ void TestIncludeParser::ClangLineEndings() const
     #endif
 }
 
+// FindLineStartingWithHash
+//------------------------------------------------------------------------------
+void TestIncludeParser::FindLineStartingWithHash() const
+{
+    // Place directives at every offset across a few blocks, with distractions
+    // (# not at the start of a line) to check block boundaries are handled
+    for ( size_t offset = 1; offset < 190; ++offset )
+    {
+        AStackString<> data;
+        for ( size_t i = 0; i < 200; ++i )
+        {
+            data += 'x';
+        }
+        data[ offset - 1 ] = ( ( offset % 2 ) == 0 ) ? '\n' : '\r';
+        data[ offset ] = '#';
+        for ( size_t i = 1; ( i + 1 ) < offset; i += 7 )
+        {
+            data[ i ] = '#'; // preceeded by 'x' or '#'
+        }
+
+        const char * found = CIncludeParser::FindNextLineStartingWithHash( data.Get() + 1, data.GetEnd() );
+        TEST_ASSERT( found == ( data.Get() + offset ) );
+        TEST_ASSERT( CIncludeParser::FindNextLineStartingWithHash( found + 1, data.GetEnd() ) == nullptr );
+    }
+}
+
+// LargeSyntheticInput
+//------------------------------------------------------------------------------
+void TestIncludeParser::LargeSyntheticInput() const
+{
+    FBuild fBuild; // needed for CleanPath
+
+    // Generate ~32 MiB of output similar to GCC preprocessed output, with
+    // many (mostly repeated) line directives and lots of code between them
+    const size_t numUniqueIncludes = 2000;
+    AString mem;
+    mem.SetReserved( 34 * 1024 * 1024 );
+    AStackString<> line;
+    for ( uint32_t i = 0; mem.GetLength() < ( 32 * 1024 * 1024 ); ++i )
+    {
+        line.Format( "# %u \"/usr/include/synthetic/header%u.h\" 1\n", i, (uint32_t)( i % numUniqueIncludes ) );
+        mem += line;
+        for ( uint32_t j = 0; j < 16; ++j )
+        {
+            mem += "    static inline int Function( int a, int b ) { return ( a * b ) + ( a # b ); }\n";
+        }
+    }
+
+    Timer t;
+
+    const size_t repeatCount( 4 );
+    for ( size_t i = 0; i < repeatCount; ++i )
+    {
+        CIncludeParser parser;
+        TEST_ASSERT( parser.ParseGCC_Preprocessed( mem.Get(), mem.GetLength() ) );
+        TEST_ASSERT( parser.GetIncludes().GetSize() == numUniqueIncludes );
+    }
+
+    float time = t.GetElapsed();
+    OUTPUT( "Synthetic (GCC)      : %2.3fs (%2.1f MiB/sec)\n", time, ( (float)( mem.GetLength() * repeatCount / ( 1024.0f * 1024.0f ) ) / time ) );
+}
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,270 @@
+// TestIncludeScanner.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CIncludeScanner.h"
+
+// Core
+#include "Core/Containers/AutoPtr.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Process/Process.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// TestIncludeScanner
+//------------------------------------------------------------------------------
+class TestIncludeScanner : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void ParseCompilerOutput() const;
+    void Synthetic() const;
+    void SystemHeaders() const;
+    void Build() const;
+    void Build_NoRebuild() const;
+    void Build_HeaderChanged() const;
+
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        static bool RunCompiler( const char * args, AString & outStdOut, AString & outStdErr );
+        static void CheckIncludes( const char * args, const char * sourceFile );
+    #endif
+    void WriteHeader( int value ) const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestIncludeScanner )
+    REGISTER_TEST( ParseCompilerOutput )
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TEST( Synthetic )
+        REGISTER_TEST( SystemHeaders )
+        REGISTER_TEST( Build )
+        REGISTER_TEST( Build_NoRebuild )
+        REGISTER_TEST( Build_HeaderChanged )
+    #endif
+REGISTER_TESTS_END
+
+#if defined( __LINUX__ )
+    #define COMPILER "/usr/bin/gcc"
+#elif defined( __OSX__ )
+    #define COMPILER "/usr/bin/clang++"
+#endif
+
+// ParseCompilerOutput
+//------------------------------------------------------------------------------
+void TestIncludeScanner::ParseCompilerOutput() const
+{
+    const char * stdOut = "# 0 \"/dev/null\"\n"
+                          "# 0 \"<built-in>\"\n"
+                          "#define __GNUC__ 12\n"
+                          "# 0 \"<command-line>\"\n"
+                          "# 1 \"/usr/include/stdc-predef.h\" 1 3 4\n"
+                          "#define __STDC_IEC_559__ 1\n"
+                          "# 0 \"<command-line>\" 2\n"
+                          "# 1 \"/dev/null\"\n";
+    const char * stdErr = "ignoring nonexistent directory \"/missing\"\n"
+                          "#include \"...\" search starts here:\n"
+                          " /quote\n"
+                          "#include <...> search starts here:\n"
+                          " /usr/include/c++/12\n"
+                          " /usr/include\n"
+                          " /System/Library/Frameworks (framework directory)\n"
+                          "End of search list.\n"
+                          ". /usr/include/stdc-predef.h\n";
+
+    CIncludeScannerConfig config( 0 );
+    TEST_ASSERT( config.ParseCompilerOutput( stdOut, stdErr ) );
+    TEST_ASSERT( config.IsValid() );
+    TEST_ASSERT( config.GetIncludePaths().GetSize() == 3 );
+    TEST_ASSERT( config.GetIncludePaths()[ 0 ] == "/quote" );
+    TEST_ASSERT( config.GetIncludePaths()[ 2 ] == "/usr/include" );
+    TEST_ASSERT( config.GetNumQuoteIncludePaths() == 1 );
+    TEST_ASSERT( config.GetImplicitIncludes().GetSize() == 1 );
+    TEST_ASSERT( config.GetImplicitIncludes()[ 0 ] == "/usr/include/stdc-predef.h" );
+
+    // unrecognized output
+    CIncludeScannerConfig badConfig( 0 );
+    TEST_ASSERT( badConfig.ParseCompilerOutput( "", "error: unrecognized command-line option\n" ) == false );
+    TEST_ASSERT( badConfig.IsValid() == false );
+}
+
+#if defined( __LINUX__ ) || defined( __OSX__ )
+
+// Synthetic
+//------------------------------------------------------------------------------
+void TestIncludeScanner::Synthetic() const
+{
+    CheckIncludes( "-x c++"
+                   " -ITools/FBuild/FBuildTest/Data/TestIncludeScanner/Synthetic/a"
+                   " -ITools/FBuild/FBuildTest/Data/TestIncludeScanner/Synthetic/b",
+                   "Tools/FBuild/FBuildTest/Data/TestIncludeScanner/Synthetic/main.cpp" );
+}
+
+// SystemHeaders
+//------------------------------------------------------------------------------
+void TestIncludeScanner::SystemHeaders() const
+{
+    CheckIncludes( "-x c++ -std=c++11",
+                   "Tools/FBuild/FBuildTest/Data/TestIncludeScanner/SystemHeaders/main.cpp" );
+}
+
+// Build
+//------------------------------------------------------------------------------
+void TestIncludeScanner::Build() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestIncludeScanner/Build/includescanner.bff";
+    options.m_ForceCleanBuild = true;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    WriteHeader( 1 );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "IncludeScanner" ) ) );
+    TEST_ASSERT( fBuild.SaveDependencyGraph( "../tmp/Test/IncludeScanner/Build/includescanner.fdb" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::COMPILER_NODE );
+    CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+    CheckStatsNode ( 1,     1,      Node::OBJECT_LIST_NODE );
+}
+
+// Build_NoRebuild
+//------------------------------------------------------------------------------
+void TestIncludeScanner::Build_NoRebuild() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestIncludeScanner/Build/includescanner.bff";
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( "../tmp/Test/IncludeScanner/Build/includescanner.fdb" ) );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "IncludeScanner" ) ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     0,      Node::COMPILER_NODE );
+    CheckStatsNode ( 1,     0,      Node::OBJECT_NODE );
+    CheckStatsNode ( 1,     0,      Node::OBJECT_LIST_NODE );
+}
+
+// Build_HeaderChanged
+//------------------------------------------------------------------------------
+void TestIncludeScanner::Build_HeaderChanged() const
+{
+    // TODO:C Changes to the way dependencies are managed might make this unnecessary
+    Thread::Sleep( 1000 ); // Work around low time resolution of HFS+ and ext2/ext3/reiserfs
+
+    // the header was found by the scanner, so modifying it should cause a rebuild
+    WriteHeader( 2 );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestIncludeScanner/Build/includescanner.bff";
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( "../tmp/Test/IncludeScanner/Build/includescanner.fdb" ) );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "IncludeScanner" ) ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     0,      Node::COMPILER_NODE );
+    CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+    CheckStatsNode ( 1,     1,      Node::OBJECT_LIST_NODE );
+}
+
+// RunCompiler
+//------------------------------------------------------------------------------
+/*static*/ bool TestIncludeScanner::RunCompiler( const char * args, AString & outStdOut, AString & outStdErr )
+{
+    Process p;
+    if ( p.Spawn( COMPILER, args, nullptr, nullptr ) == false )
+    {
+        return false;
+    }
+    AutoPtr< char > out;
+    AutoPtr< char > err;
+    uint32_t outSize = 0;
+    uint32_t errSize = 0;
+    p.ReadAllData( out, &outSize, err, &errSize );
+    outStdOut = out.Get() ? out.Get() : "";
+    outStdErr = err.Get() ? err.Get() : "";
+    return ( p.WaitForExit() == 0 );
+}
+
+// CheckIncludes
+//------------------------------------------------------------------------------
+/*static*/ void TestIncludeScanner::CheckIncludes( const char * args, const char * sourceFile )
+{
+    FBuild fBuild; // needed for CleanPath
+
+    // configure the scanner
+    AStackString<> configArgs( args );
+    configArgs += " -E -dD -v -H /dev/null";
+    AString stdOut;
+    AString stdErr;
+    TEST_ASSERT( RunCompiler( configArgs.Get(), stdOut, stdErr ) );
+    CIncludeScannerConfig config( 0 );
+    TEST_ASSERT( config.ParseCompilerOutput( stdOut.Get(), stdErr.Get() ) );
+
+    // find includes with the scanner
+    Timer t;
+    CIncludeScanner scanner( config );
+    TEST_ASSERT( scanner.Scan( AStackString<>( sourceFile ), Array< AString >() ) );
+    const float scanTime = t.GetElapsed();
+
+    // find includes with the preprocessor
+    t.Start();
+    AStackString<> preprocessArgs( args );
+    preprocessArgs += " -E ";
+    preprocessArgs += sourceFile;
+    TEST_ASSERT( RunCompiler( preprocessArgs.Get(), stdOut, stdErr ) );
+    CIncludeParser parser;
+    TEST_ASSERT( parser.ParseGCC_Preprocessed( stdOut.Get(), stdOut.GetLength() ) );
+    const float preprocessTime = t.GetElapsed();
+
+    // the scanner must find everything the preprocessor does, since missing
+    // dependencies would cause incorrect incremental builds
+    const Array< AString > & scannerIncludes = scanner.GetIncludes();
+    for ( const AString & include : parser.GetIncludes() )
+    {
+        AStackString<> cleanInclude;
+        NodeGraph::CleanPath( include, cleanInclude );
+        if ( scannerIncludes.Find( cleanInclude ) == nullptr )
+        {
+            OUTPUT( "Include not found by scanner: %s\n", cleanInclude.Get() );
+            TEST_ASSERT( false );
+        }
+    }
+
+    // and for these simple cases, nothing more (besides the source file itself)
+    TEST_ASSERT( scannerIncludes.GetSize() <= ( parser.GetIncludes().GetSize() + 1 ) );
+
+    OUTPUT( "Scanner      : %2.3fs (%u includes)\n", (double)scanTime, (uint32_t)scannerIncludes.GetSize() );
+    OUTPUT( "Preprocessor : %2.3fs (%u includes)\n", (double)preprocessTime, (uint32_t)parser.GetIncludes().GetSize() );
+}
+
+#endif
+
+// WriteHeader
+//------------------------------------------------------------------------------
+void TestIncludeScanner::WriteHeader( int value ) const
+{
+    EnsureDirExists( "../tmp/Test/IncludeScanner/Build/" );
+    AStackString<> contents;
+    contents.Format( "#pragma once\n\n#define HEADER_VALUE %i\n", value );
+    FileStream f;
+    TEST_ASSERT( f.Open( "../tmp/Test/IncludeScanner/Build/header.h", FileStream::WRITE_ONLY ) );
+    TEST_ASSERT( f.Write( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+    f.Close();
+}
+
+//------------------------------------------------------------------------------
@@ -13,6 +13,7 @@
 
 // Core
 #include "Core/FileIO/FileStream.h"
+#include "Core/Process/Process.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
@@ -27,6 +28,7 @@ private:
     void MSVCArgHelpers() const;
     void Preprocessor() const;
     void TestStaleDynamicDeps() const;
+    void PreprocessedOutputFromMemory() const;
 };
 
 // Register Tests
@@ -35,6 +37,9 @@ REGISTER_TESTS_BEGIN( TestObject )
     REGISTER_TEST( MSVCArgHelpers )             // Test functions that check for MSVC args
     REGISTER_TEST( Preprocessor )
     REGISTER_TEST( TestStaleDynamicDeps )       // Test dynamic deps are cleared when necessary
+    #if defined( __LINUX__ )
+        REGISTER_TEST( PreprocessedOutputFromMemory ) // Test preprocessed output is compiled via /proc/<pid>/fd
+    #endif
 REGISTER_TESTS_END
 
 // MSVCArgHelpers
@@ -196,4 +201,56 @@ void TestObject::TestStaleDynamicDeps() const
     }
 }
 
+// PreprocessedOutputFromMemory
+//------------------------------------------------------------------------------
+void TestObject::PreprocessedOutputFromMemory() const
+{
+    const char * configFile = "Tools/FBuild/FBuildTest/Data/TestObject/PreprocessedFromMemory/preprocessedfrommemory.bff";
+
+    // Language is known from the source file, so the compiler reads the
+    // preprocessed output from memory
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = configFile;
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheWrite = true; // ensure preprocessed output is compiled
+        options.m_ShowCommandLines = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( "FromMemory" ) ) );
+        EnsureFileExists( "../tmp/Test/Object/PreprocessedFromMemory/FromMemory/a.o" );
+
+        AStackString<> procPath;
+        procPath.Format( "-x c++ \"/proc/%u/fd/", Process::GetCurrentId() );
+        TEST_ASSERT( GetRecordedOutput().Find( procPath.Get() ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+    }
+
+    // Language specified by the user, so a temp file is used instead
+    {
+        const size_t outputStart = GetRecordedOutput().GetLength();
+
+        FBuildTestOptions options;
+        options.m_ConfigFile = configFile;
+        options.m_ForceCleanBuild = true;
+        options.m_UseCacheWrite = true; // ensure preprocessed output is compiled
+        options.m_ShowCommandLines = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( AStackString<>( "ExplicitLanguage" ) ) );
+        EnsureFileExists( "../tmp/Test/Object/PreprocessedFromMemory/ExplicitLanguage/a.o" );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "/proc/", GetRecordedOutput().Get() + outputStart ) == nullptr );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+    }
+}
+
 //------------------------------------------------------------------------------
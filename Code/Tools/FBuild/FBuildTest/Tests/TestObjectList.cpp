@@ -7,6 +7,8 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/Strings/AStackString.h"
 
 // TestObjectList
@@ -19,6 +21,7 @@ private:
     // Tests
     void TestExcludedFiles() const;
     void CompilerInputFilesRoot() const;
+    void ManyInputs() const;
     #if defined( __WINDOWS__ )
         void ExtraOutputFolders() const;
     #endif
@@ -29,6 +32,7 @@ private:
 REGISTER_TESTS_BEGIN( TestObjectList )
     REGISTER_TEST( TestExcludedFiles )      // Ensure files are correctly excluded
     REGISTER_TEST( CompilerInputFilesRoot )
+    REGISTER_TEST( ManyInputs )             // Many objects, including ones which already exist
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ExtraOutputFolders )
     #endif
@@ -82,6 +86,73 @@ void TestObjectList::CompilerInputFilesRoot() const
     TEST_ASSERT( fBuild.Build( AStackString<>( "ObjectList" ) ) );
 }
 
+// ManyInputs
+//------------------------------------------------------------------------------
+void TestObjectList::ManyInputs() const
+{
+    const char * configFile = "Tools/FBuild/FBuildTest/Data/TestObjectList/ManyInputs/fbuild.bff";
+    const char * database = "../tmp/Test/ObjectList/ManyInputs/fbuild.fdb";
+
+    // Generate enough files for the object names to be determined in several
+    // batches, in sub-directories which are replicated in the output
+    const uint32_t numDirs = 4;
+    const uint32_t numFilesPerDir = 100;
+    const uint32_t numFiles = ( numDirs * numFilesPerDir );
+    for ( uint32_t i = 0; i < numDirs; ++i )
+    {
+        AStackString<> dir;
+        dir.Format( "../tmp/Test/ObjectList/ManyInputs/Src/Dir%u/", i );
+        TEST_ASSERT( FileIO::EnsurePathExists( dir ) );
+        for ( uint32_t j = 0; j < numFilesPerDir; ++j )
+        {
+            AStackString<> fileName;
+            fileName.Format( "%sFile%u.cpp", dir.Get(), j );
+            FileStream f;
+            TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.WriteBuffer( fileName.Get(), fileName.GetLength() ) == fileName.GetLength() );
+        }
+    }
+
+    // Build
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = configFile;
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // The second ObjectList finds the objects created by the first
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( database ) );
+
+        EnsureFileExists( "../tmp/Test/ObjectList/ManyInputs/Obj/Dir0/File0.o" );
+        EnsureFileExists( "../tmp/Test/ObjectList/ManyInputs/Obj/Dir3/File99.o" );
+
+        // Check stats
+        //               Seen,      Built,      Type
+        CheckStatsNode ( 1,         1,          Node::COMPILER_NODE );
+        CheckStatsNode ( 2,         2,          Node::OBJECT_LIST_NODE );
+        CheckStatsNode ( numFiles,  numFiles,   Node::OBJECT_NODE );
+    }
+
+    // No Rebuild
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = configFile;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( database ) );
+
+        // The objects already exist in the loaded graph
+        TEST_ASSERT( fBuild.Build( AStackString<>( "All" ) ) );
+
+        // Check stats
+        //               Seen,      Built,      Type
+        CheckStatsNode ( 1,         0,          Node::COMPILER_NODE );
+        CheckStatsNode ( 2,         0,          Node::OBJECT_LIST_NODE );
+        CheckStatsNode ( numFiles,  0,          Node::OBJECT_NODE );
+    }
+}
+
 // ExtraOutputFolders
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ )
@@ -6,6 +6,8 @@
 #include "FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/PCHAnalysis.h"
 
 #include "Core/FileIO/FileIO.h"
 #include "Core/Strings/AStackString.h"
@@ -34,6 +36,7 @@ private:
     void CacheUniqueness2() const;
     void Deoptimization() const;
     void PrecompiledHeaderCacheAnalyze_MSVC() const;
+    void Analysis() const;
 
     // Clang on Windows
     #if defined( __WINDOWS__ )
@@ -54,6 +57,7 @@ REGISTER_TESTS_BEGIN( TestPrecompiledHeaders )
     REGISTER_TEST( CacheUniqueness )
     REGISTER_TEST( CacheUniqueness2 )
     REGISTER_TEST( Deoptimization )
+    REGISTER_TEST( Analysis )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( PrecompiledHeaderCacheAnalyze_MSVC )
         REGISTER_TEST( PreventUselessCacheTraffic_MSVC )
@@ -391,6 +395,58 @@ void TestPrecompiledHeaders::Deoptimization() const
     TEST_ASSERT( GetRecordedOutput().FindI( "**Deoptimized**" ) == nullptr );
 }
 
+// Analysis
+//------------------------------------------------------------------------------
+void TestPrecompiledHeaders::Analysis() const
+{
+    // A PCH with a single user is not worth building
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestPrecompiledHeaders/fbuild.bff";
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( nullptr ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "PCHTest" ) ) );
+
+        PCHAnalysis analysis;
+        analysis.Analyze( fBuild.GetDependencyGraph().FindNode( AStackString<>( "PCHTest" ) ) );
+
+        const PCHAnalysis::ObjectListStats * ols = analysis.FindObjectList( AStackString<>( "PCHTest-lib" ) );
+        TEST_ASSERT( ols );
+        TEST_ASSERT( ols->m_NumObjects == 1 );
+        TEST_ASSERT( ols->m_HasPCH );
+        TEST_ASSERT( ols->m_PCH.m_NumUsers == 1 );
+        TEST_ASSERT( ols->m_PCH.IsEffective() == false );
+        TEST_ASSERT( ols->m_Candidates.IsEmpty() ); // nothing is shared
+    }
+
+    // Headers shared by most objects are candidates
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestPrecompiledHeaders/Analysis/fbuild.bff";
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( "../tmp/Test/PrecompiledHeaders/Analysis/fbuild.fdb" ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "PCHAnalysis" ) ) );
+
+        PCHAnalysis analysis;
+        analysis.Analyze( fBuild.GetDependencyGraph().FindNode( AStackString<>( "PCHAnalysis" ) ) );
+
+        const PCHAnalysis::ObjectListStats * ols = analysis.FindObjectList( AStackString<>( "PCHAnalysis" ) );
+        TEST_ASSERT( ols );
+        TEST_ASSERT( ols->m_NumObjects == 3 );
+        TEST_ASSERT( ols->m_HasPCH == false );
+        TEST_ASSERT( ols->m_Candidates.GetSize() == 1 ); // Rare.h is only included once
+        TEST_ASSERT( ols->m_Candidates[ 0 ].m_Header->GetName().EndsWithI( "Common.h" ) );
+        TEST_ASSERT( ols->m_Candidates[ 0 ].m_NumObjects == 3 );
+
+        AString json;
+        analysis.WriteJSON( json );
+        TEST_ASSERT( json.Find( "\"name\":\"PCHAnalysis\"" ) );
+        TEST_ASSERT( json.Find( "Common.h" ) );
+        TEST_ASSERT( json.Find( "Rare.h" ) == nullptr );
+    }
+}
 
 // PrecompiledHeaderCacheAnalyze_MSVC
 //------------------------------------------------------------------------------
@@ -7,12 +7,17 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Graph/UnityNode.h"
 
 #include "Core/Containers/AutoPtr.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Math/Random.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
 
 // TestUnity
 //------------------------------------------------------------------------------
@@ -35,6 +40,16 @@ private:
     void TestGenerateFromExplicitList() const;
     void TestExcludedFiles() const;
     void IsolateFromUnity_Regression() const;
+    void PartitionByCost() const;
+    void BalanceByBuildTime() const;
+    void BalanceByBuildTime_Persisted() const;
+    void AssignByHash() const;
+    void StableAssignment() const;
+    void StableAssignment_AddFile() const;
+
+    static void CountChangedGroups( const Array< uint32_t > & oldGroups, const Array< uint32_t > & newGroups,
+                                    size_t changedIndex, bool added, Array< bool > & changed );
+    void WriteStableAssignmentFile( uint32_t index ) const;
 };
 
 // Register Tests
@@ -47,6 +62,12 @@ REGISTER_TESTS_BEGIN( TestUnity )
     REGISTER_TEST( TestGenerateFromExplicitList ) // create a unity with manually provided files
     REGISTER_TEST( TestExcludedFiles )      // Ensure files are correctly excluded
     REGISTER_TEST( IsolateFromUnity_Regression )
+    REGISTER_TEST( PartitionByCost )
+    REGISTER_TEST( BalanceByBuildTime )
+    REGISTER_TEST( BalanceByBuildTime_Persisted )
+    REGISTER_TEST( AssignByHash )
+    REGISTER_TEST( StableAssignment )
+    REGISTER_TEST( StableAssignment_AddFile )
 REGISTER_TESTS_END
 
 // BuildGenerate
@@ -266,4 +287,334 @@ void TestUnity::IsolateFromUnity_Regression() const
     TEST_ASSERT( fBuild.Build( AStackString<>( "Compile" ) ) );
 }
 
+// PartitionByCost
+//------------------------------------------------------------------------------
+void TestUnity::PartitionByCost() const
+{
+    // one expensive file
+    {
+        const uint32_t costs[] = { 90, 10, 10, 10, 10, 10, 10, 10, 10, 10 };
+        Array< uint32_t > ends( 0, true );
+        UnityNode::PartitionByCost( Array< uint32_t >( costs, costs + 10 ), 2, ends );
+        TEST_ASSERT( ends.GetSize() == 2 );
+        TEST_ASSERT( ends[ 0 ] == 1 ); // 90 vs 90 (splitting by count would give 130 vs 50)
+        TEST_ASSERT( ends[ 1 ] == 10 );
+    }
+
+    // equal costs are split evenly
+    {
+        const uint32_t costs[] = { 1, 1, 1, 1, 1, 1 };
+        Array< uint32_t > ends( 0, true );
+        UnityNode::PartitionByCost( Array< uint32_t >( costs, costs + 6 ), 3, ends );
+        TEST_ASSERT( ( ends[ 0 ] == 2 ) && ( ends[ 1 ] == 4 ) && ( ends[ 2 ] == 6 ) );
+    }
+
+    // expensive files don't leave groups empty
+    {
+        const uint32_t costs[] = { 100, 1, 1, 1 };
+        Array< uint32_t > ends( 0, true );
+        UnityNode::PartitionByCost( Array< uint32_t >( costs, costs + 4 ), 3, ends );
+        TEST_ASSERT( ( ends[ 0 ] == 1 ) && ( ends[ 1 ] == 2 ) && ( ends[ 2 ] == 4 ) );
+    }
+
+    // more groups than files
+    {
+        const uint32_t costs[] = { 5, 5 };
+        Array< uint32_t > ends( 0, true );
+        UnityNode::PartitionByCost( Array< uint32_t >( costs, costs + 2 ), 4, ends );
+        TEST_ASSERT( ( ends[ 0 ] == 1 ) && ( ends[ 1 ] == 2 ) && ( ends[ 2 ] == 2 ) && ( ends[ 3 ] == 2 ) );
+    }
+}
+
+// BalanceByBuildTime
+//------------------------------------------------------------------------------
+void TestUnity::BalanceByBuildTime() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestUnity/BalanceByBuildTime/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( AStackString<>( "Compile" ) ) );
+    TEST_ASSERT( fBuild.SaveDependencyGraph( "../tmp/Test/Unity/BalanceByBuildTime/fbuild.fdb" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::UNITY_NODE );
+    CheckStatsNode ( 2,     2,      Node::OBJECT_NODE );
+
+    // the time of each unity object was split across the files it includes
+    const Node * node = fBuild.GetDependencyGraph().FindNode( AStackString<>( "Unity" ) );
+    TEST_ASSERT( node );
+    const UnityNode * unity = node->CastTo< UnityNode >();
+    const char * files[] = { "a.cpp", "b.cpp", "c.cpp", "d.cpp" };
+    for ( const char * file : files )
+    {
+        AStackString<> fileName( "Tools/FBuild/FBuildTest/Data/TestUnity/BalanceByBuildTime/" );
+        fileName += file;
+        AStackString<> cleanFileName;
+        NodeGraph::CleanPath( fileName, cleanFileName );
+        uint32_t buildTime = 0;
+        TEST_ASSERT( unity->GetFileBuildTime( cleanFileName, buildTime ) );
+    }
+}
+
+// BalanceByBuildTime_Persisted
+//------------------------------------------------------------------------------
+void TestUnity::BalanceByBuildTime_Persisted() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestUnity/BalanceByBuildTime/fbuild.bff";
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( "../tmp/Test/Unity/BalanceByBuildTime/fbuild.fdb" ) );
+
+    // times measured by the previous build are available before building
+    const Node * node = fBuild.GetDependencyGraph().FindNode( AStackString<>( "Unity" ) );
+    TEST_ASSERT( node );
+    AStackString<> cleanFileName;
+    NodeGraph::CleanPath( AStackString<>( "Tools/FBuild/FBuildTest/Data/TestUnity/BalanceByBuildTime/a.cpp" ), cleanFileName );
+    uint32_t buildTime = 0;
+    TEST_ASSERT( node->CastTo< UnityNode >()->GetFileBuildTime( cleanFileName, buildTime ) );
+
+    TEST_ASSERT( fBuild.Build( AStackString<>( "Compile" ) ) );
+}
+
+// AssignByHash
+//------------------------------------------------------------------------------
+void TestUnity::AssignByHash() const
+{
+    Array< uint64_t > keys( 0, true );
+    Array< uint32_t > costs( 0, true );
+    for ( uint32_t i = 0; i < 100; ++i )
+    {
+        AStackString<> name;
+        name.Format( "File%u.cpp", i );
+        keys.Append( xxHash::Calc64( name ) );
+        costs.Append( 1 );
+    }
+
+    // every group is used, and none exceeds the bound (25% over average)
+    Array< uint32_t > groups( 0, true );
+    UnityNode::AssignByHash( keys, costs, 4, groups );
+    TEST_ASSERT( groups.GetSize() == 100 );
+    uint32_t groupSizes[ 4 ] = { 0, 0, 0, 0 };
+    for ( const uint32_t group : groups )
+    {
+        TEST_ASSERT( group < 4 );
+        ++groupSizes[ group ];
+    }
+    for ( const uint32_t groupSize : groupSizes )
+    {
+        TEST_ASSERT( ( groupSize > 0 ) && ( groupSize <= 32 ) );
+    }
+
+    // the order of the items doesn't affect the assignment
+    Array< uint64_t > reversedKeys( 0, true );
+    for ( size_t i = keys.GetSize(); i > 0; --i )
+    {
+        reversedKeys.Append( keys[ i - 1 ] );
+    }
+    Array< uint32_t > reversedGroups( 0, true );
+    UnityNode::AssignByHash( reversedKeys, costs, 4, reversedGroups );
+    for ( size_t i = 0; i < 100; ++i )
+    {
+        TEST_ASSERT( groups[ i ] == reversedGroups[ 99 - i ] );
+    }
+
+    // an expensive item doesn't prevent others being balanced
+    costs[ 0 ] = 1000;
+    UnityNode::AssignByHash( keys, costs, 4, groups );
+    for ( size_t i = 1; i < 100; ++i )
+    {
+        TEST_ASSERT( groups[ i ] != groups[ 0 ] );
+    }
+}
+
+// StableAssignment
+//------------------------------------------------------------------------------
+void TestUnity::StableAssignment() const
+{
+    // Measure how many unity files change as files are added and removed when
+    // splitting files by position, compared to assigning them by hash
+    const uint32_t numGroups = 16;
+    const uint32_t numOperations = 200;
+    Random r( 1234 );
+
+    Array< AString > names( 0, true );
+    uint32_t nextName = 0;
+    for ( ; nextName < 1000; ++nextName )
+    {
+        AStackString<> name;
+        name.Format( "Code/Module%u/File%u.cpp", r.GetRandIndex( 10 ), nextName );
+        names.Append( name );
+    }
+
+    size_t changedByPosition = 0;
+    size_t changedByHash = 0;
+    Array< uint32_t > oldPositionGroups( 0, true );
+    Array< uint32_t > oldHashGroups( 0, true );
+    for ( uint32_t op = 0; op <= numOperations; ++op )
+    {
+        // add or remove a random file (the first iteration establishes the baseline)
+        size_t changedIndex = 0;
+        const bool added = ( r.GetRandIndex( 2 ) == 0 );
+        if ( op > 0 )
+        {
+            changedIndex = r.GetRandIndex( (uint32_t)names.GetSize() );
+            if ( added )
+            {
+                AStackString<> name;
+                name.Format( "Code/Module%u/File%u.cpp", r.GetRandIndex( 10 ), nextName++ );
+                names.Append( name );
+                for ( size_t i = names.GetSize() - 1; i > changedIndex; --i )
+                {
+                    names[ i ] = names[ i - 1 ];
+                }
+                names[ changedIndex ] = name;
+            }
+            else
+            {
+                names.EraseIndex( changedIndex );
+            }
+        }
+
+        // split by position
+        Array< uint32_t > costs( 0, true );
+        Array< uint64_t > keys( 0, true );
+        for ( const AString & name : names )
+        {
+            costs.Append( 1 );
+            keys.Append( xxHash::Calc64( name ) );
+        }
+        Array< uint32_t > ends( 0, true );
+        UnityNode::PartitionByCost( costs, numGroups, ends );
+        Array< uint32_t > positionGroups( 0, true );
+        for ( uint32_t group = 0; group < numGroups; ++group )
+        {
+            while ( positionGroups.GetSize() < ends[ group ] )
+            {
+                positionGroups.Append( group );
+            }
+        }
+
+        // assign by hash
+        Array< uint32_t > hashGroups( 0, true );
+        UnityNode::AssignByHash( keys, costs, numGroups, hashGroups );
+
+        if ( op > 0 )
+        {
+            Array< bool > changed( 0, true );
+            CountChangedGroups( oldPositionGroups, positionGroups, changedIndex, added, changed );
+            for ( const bool c : changed )
+            {
+                changedByPosition += c ? 1 : 0;
+            }
+            CountChangedGroups( oldHashGroups, hashGroups, changedIndex, added, changed );
+            for ( const bool c : changed )
+            {
+                changedByHash += c ? 1 : 0;
+            }
+        }
+
+        oldPositionGroups.Swap( positionGroups );
+        oldHashGroups.Swap( hashGroups );
+    }
+
+    const float averageByPosition = (float)changedByPosition / numOperations;
+    const float averageByHash = (float)changedByHash / numOperations;
+    OUTPUT( "Unity files changed per file added/removed (of %u):\n", numGroups );
+    OUTPUT( " - By Position : %2.2f\n", (double)averageByPosition );
+    OUTPUT( " - By Hash     : %2.2f\n", (double)averageByHash );
+
+    // most additions/removals should affect a single unity file
+    TEST_ASSERT( averageByHash < 1.5f );
+    TEST_ASSERT( averageByHash < averageByPosition );
+}
+
+// CountChangedGroups
+//------------------------------------------------------------------------------
+/*static*/ void TestUnity::CountChangedGroups( const Array< uint32_t > & oldGroups, const Array< uint32_t > & newGroups,
+                                               size_t changedIndex, bool added, Array< bool > & changed )
+{
+    changed.Clear();
+    for ( size_t i = 0; i < 16; ++i )
+    {
+        changed.Append( false );
+    }
+
+    // the file which was added or removed
+    changed[ added ? newGroups[ changedIndex ] : oldGroups[ changedIndex ] ] = true;
+
+    // files which moved
+    const size_t numUnchanged = added ? oldGroups.GetSize() : newGroups.GetSize();
+    for ( size_t i = 0; i < numUnchanged; ++i )
+    {
+        const size_t oldIndex = ( ( added == false ) && ( i >= changedIndex ) ) ? ( i + 1 ) : i;
+        const size_t newIndex = ( added && ( i >= changedIndex ) ) ? ( i + 1 ) : i;
+        if ( oldGroups[ oldIndex ] != newGroups[ newIndex ] )
+        {
+            changed[ oldGroups[ oldIndex ] ] = true;
+            changed[ newGroups[ newIndex ] ] = true;
+        }
+    }
+}
+
+// StableAssignment_AddFile
+//------------------------------------------------------------------------------
+void TestUnity::StableAssignment_AddFile() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestUnity/StableAssignment/fbuild.bff";
+
+    // clean build
+    {
+        EnsureFileDoesNotExist( "../tmp/Test/Unity/StableAssignment/Input/File20.cpp" );
+        for ( uint32_t i = 0; i < 20; ++i )
+        {
+            WriteStableAssignmentFile( i );
+        }
+
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "Compile" ) ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( "../tmp/Test/Unity/StableAssignment/fbuild.fdb" ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::UNITY_NODE );
+        CheckStatsNode ( 4,     4,      Node::OBJECT_NODE );
+    }
+
+    // adding a file only affects the unity file it is assigned to
+    {
+        WriteStableAssignmentFile( 20 );
+
+        options.m_ForceCleanBuild = false;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( "../tmp/Test/Unity/StableAssignment/fbuild.fdb" ) );
+        TEST_ASSERT( fBuild.Build( AStackString<>( "Compile" ) ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::UNITY_NODE );
+        CheckStatsNode ( 4,     1,      Node::OBJECT_NODE );
+    }
+}
+
+// WriteStableAssignmentFile
+//------------------------------------------------------------------------------
+void TestUnity::WriteStableAssignmentFile( uint32_t index ) const
+{
+    EnsureDirExists( "../tmp/Test/Unity/StableAssignment/Input/" );
+    AStackString<> fileName;
+    fileName.Format( "../tmp/Test/Unity/StableAssignment/Input/File%u.cpp", index );
+    AStackString<> contents;
+    contents.Format( "int Function%u() { return %u; }\n", index, index );
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) );
+    TEST_ASSERT( f.Write( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+    f.Close();
+}
+
 //------------------------------------------------------------------------------
@@ -7,7 +7,10 @@
 #include "Tools/FBuild/FBuildCore/BFF/BFFStackFrame.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFVariable.h"
 
+#include "Core/Mem/Mem.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
 
 // TestVariableStack
 //------------------------------------------------------------------------------
@@ -20,6 +23,7 @@ private:
     void TestStackFramesAdditional() const;
     void TestStackFramesOverride() const;
     void TestStackFramesParent() const;
+    void TestStackFramesManyVariables() const;
 };
 
 // Register Tests
@@ -29,6 +33,7 @@ REGISTER_TESTS_BEGIN( TestVariableStack )
     REGISTER_TEST( TestStackFramesAdditional )
     REGISTER_TEST( TestStackFramesOverride )
     REGISTER_TEST( TestStackFramesParent )
+    REGISTER_TEST( TestStackFramesManyVariables )
 REGISTER_TESTS_END
 
 // TestStackFramesEmpty
@@ -159,4 +164,79 @@ void TestVariableStack::TestStackFramesParent() const
     TEST_ASSERT( BFFStackFrame::GetParentDeclaration( "myVar", &sf1, v ) == nullptr );
 }
 
+// TestStackFramesManyVariables
+//------------------------------------------------------------------------------
+void TestVariableStack::TestStackFramesManyVariables() const
+{
+    // deep scopes with many variables each, as seen in large configs
+    const uint32_t numFrames = 32;
+    const uint32_t numVarsPerFrame = 250;
+    BFFStackFrame * frames[ numFrames ];
+    AStackString<> name;
+    AStackString<> value;
+    for ( uint32_t f = 0; f < numFrames; ++f )
+    {
+        frames[ f ] = FNEW( BFFStackFrame );
+        for ( uint32_t v = 0; v < numVarsPerFrame; ++v )
+        {
+            name.Format( ".Frame%uVar%u", f, v );
+            value.Format( "Value%u_%u", f, v );
+            BFFStackFrame::SetVarString( name, value, nullptr );
+        }
+
+        // every frame shadows a common variable
+        value.Format( "Shadow%u", f );
+        BFFStackFrame::SetVarString( AStackString<>( ".Shadowed" ), value, nullptr );
+    }
+
+    Timer t;
+    const uint32_t repeatCount = 10;
+    for ( uint32_t r = 0; r < repeatCount; ++r )
+    {
+        for ( uint32_t f = 0; f < numFrames; ++f )
+        {
+            for ( uint32_t v = 0; v < numVarsPerFrame; ++v )
+            {
+                name.Format( ".Frame%uVar%u", f, v );
+                const BFFVariable * var = BFFStackFrame::GetVar( name );
+                TEST_ASSERT( var );
+
+                // in own frame only
+                TEST_ASSERT( BFFStackFrame::GetVar( name, frames[ f ] ) == var );
+                TEST_ASSERT( ( f == 0 ) || ( BFFStackFrame::GetVar( name, frames[ f - 1 ] ) == nullptr ) );
+            }
+            TEST_ASSERT( BFFStackFrame::GetVar( ".Missing" ) == nullptr );
+        }
+    }
+    const float lookupTime = t.GetElapsed();
+
+    // values survive the table growing
+    name.Format( ".Frame%uVar%u", 0, numVarsPerFrame - 1 );
+    TEST_ASSERT( BFFStackFrame::GetVar( name )->GetString() == "Value0_249" );
+    name.Format( ".Frame%uVar%u", numFrames - 1, 0 );
+    TEST_ASSERT( BFFStackFrame::GetVar( name )->GetString() == "Value31_0" );
+
+    // nearest declaration wins
+    TEST_ASSERT( BFFStackFrame::GetVar( ".Shadowed" )->GetString() == "Shadow31" );
+    const BFFVariable * parentVar = nullptr;
+    TEST_ASSERT( BFFStackFrame::GetParentDeclaration( ".Shadowed", nullptr, parentVar ) == frames[ numFrames - 2 ] );
+    TEST_ASSERT( parentVar->GetString() == "Shadow30" );
+
+    // replacing a value in a large frame
+    BFFStackFrame::SetVarString( AStackString<>( ".Frame31Var100" ), AStackString<>( "Replaced" ), nullptr );
+    TEST_ASSERT( BFFStackFrame::GetVar( ".Frame31Var100" )->GetString() == "Replaced" );
+    TEST_ASSERT( frames[ numFrames - 1 ]->GetLocalVariables().GetSize() == ( numVarsPerFrame + 1 ) );
+
+    // substitution style lookup (name without '.')
+    TEST_ASSERT( BFFStackFrame::GetVarAny( AStackString<>( "Frame5Var5" ) )->GetString() == "Value5_5" );
+    TEST_ASSERT( BFFStackFrame::GetVarAny( AStackString<>( "Missing" ) ) == nullptr );
+
+    for ( uint32_t f = numFrames; f > 0; --f )
+    {
+        FDELETE frames[ f - 1 ];
+    }
+
+    OUTPUT( "%u lookups in %2.3fs\n", ( numFrames * numVarsPerFrame * repeatCount * 3 ), lookupTime );
+}
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,216 @@
+// TestWorkerCapacity.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCapacity.h"
+
+// Core
+#include "Core/Env/Types.h"
+
+// system
+#include <string.h>
+
+// TestWorkerCapacity
+//------------------------------------------------------------------------------
+class TestWorkerCapacity : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void Disabled() const;
+    void CPU() const;
+    void CPUOwnJobs() const;
+    void Memory() const;
+    void MemoryEstimate() const;
+    void MemoryOtherPrograms() const;
+    void IO() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkerCapacity )
+    REGISTER_TEST( Disabled )
+    REGISTER_TEST( CPU )
+    REGISTER_TEST( CPUOwnJobs )
+    REGISTER_TEST( Memory )
+    REGISTER_TEST( MemoryEstimate )
+    REGISTER_TEST( MemoryOtherPrograms )
+    REGISTER_TEST( IO )
+REGISTER_TESTS_END
+
+// Disabled
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::Disabled() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+    TEST_ASSERT( wc.Update( 0, 0, load ) == 0 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+
+    // an idle machine is not throttled
+    TEST_ASSERT( wc.Update( 8, 0, load ) == 8 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+}
+
+// CPU
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::CPU() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+
+    // cpus busy with other work are left alone
+    load.m_CPUUsageTotal = 50.0f;
+    TEST_ASSERT( wc.Update( 8, 0, load ) == 4 );
+    TEST_ASSERT( strcmp( wc.GetThrottleReason(), "CPU" ) == 0 );
+
+    // fewer cpus than are free were requested
+    TEST_ASSERT( wc.Update( 2, 0, load ) == 2 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+
+    // one job is always allowed
+    load.m_CPUUsageTotal = 100.0f;
+    TEST_ASSERT( wc.Update( 8, 0, load ) == 1 );
+    TEST_ASSERT( strcmp( wc.GetThrottleReason(), "CPU" ) == 0 );
+}
+
+// CPUOwnJobs
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::CPUOwnJobs() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+
+    // our own jobs are not counted as other work, even if the sampled
+    // FASTBuild usage doesn't include them yet
+    load.m_CPUUsageTotal = 50.0f;
+    load.m_CPUUsageFASTBuild = 0.0f;
+    TEST_ASSERT( wc.Update( 8, 4, load ) == 8 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+
+    // nor if the sampled usage is higher than the number of jobs
+    load.m_CPUUsageTotal = 75.0f;
+    load.m_CPUUsageFASTBuild = 75.0f;
+    TEST_ASSERT( wc.Update( 8, 2, load ) == 8 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+
+    // other work on top of our jobs is
+    load.m_CPUUsageTotal = 75.0f;
+    load.m_CPUUsageFASTBuild = 0.0f;
+    TEST_ASSERT( wc.Update( 8, 4, load ) == 6 );
+    TEST_ASSERT( strcmp( wc.GetThrottleReason(), "CPU" ) == 0 );
+}
+
+// Memory
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::Memory() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+    load.m_HasMemoryInfo = true;
+    load.m_TotalMemory = (uint64_t)16 * 1024 * MEGABYTE;
+
+    // 1 GiB is reserved, and jobs are initially expected to use 512 MiB
+    load.m_AvailableMemory = (uint64_t)4 * 1024 * MEGABYTE;
+    TEST_ASSERT( wc.Update( 8, 0, load ) == 6 );
+    TEST_ASSERT( strcmp( wc.GetThrottleReason(), "Memory" ) == 0 );
+
+    // active jobs are shed as they complete when memory runs out
+    WorkerCapacity wc2;
+    load.m_AvailableMemory = (uint64_t)4 * 1024 * MEGABYTE;
+    TEST_ASSERT( wc2.Update( 8, 0, load ) == 6 );
+    load.m_AvailableMemory = (uint64_t)512 * MEGABYTE;
+    TEST_ASSERT( wc2.Update( 8, 4, load ) == 4 );
+    TEST_ASSERT( strcmp( wc2.GetThrottleReason(), "Memory" ) == 0 );
+
+    // no memory info available
+    WorkerCapacity wc3;
+    load.m_HasMemoryInfo = false;
+    TEST_ASSERT( wc3.Update( 8, 0, load ) == 8 );
+    TEST_ASSERT( wc3.GetThrottleReason() == nullptr );
+}
+
+// MemoryEstimate
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::MemoryEstimate() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+    load.m_HasMemoryInfo = true;
+    load.m_TotalMemory = (uint64_t)64 * 1024 * MEGABYTE;
+    load.m_AvailableMemory = (uint64_t)32 * 1024 * MEGABYTE;
+    wc.Update( 8, 0, load );
+    const uint64_t initialEstimate = wc.GetJobMemoryEstimate();
+
+    // jobs using more memory than expected raise the estimate
+    load.m_AvailableMemory = (uint64_t)24 * 1024 * MEGABYTE;
+    wc.Update( 8, 4, load );
+    const uint64_t higherEstimate = wc.GetJobMemoryEstimate();
+    TEST_ASSERT( higherEstimate > initialEstimate );
+
+    // and using less lowers it
+    load.m_AvailableMemory = (uint64_t)31 * 1024 * MEGABYTE;
+    wc.Update( 8, 4, load );
+    TEST_ASSERT( wc.GetJobMemoryEstimate() < higherEstimate );
+}
+
+// MemoryOtherPrograms
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::MemoryOtherPrograms() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+    load.m_HasMemoryInfo = true;
+    load.m_TotalMemory = (uint64_t)16 * 1024 * MEGABYTE;
+
+    // idle, then 4 jobs using the expected 512 MiB each
+    load.m_AvailableMemory = (uint64_t)8 * 1024 * MEGABYTE;
+    wc.Update( 8, 0, load );
+    load.m_AvailableMemory = (uint64_t)6 * 1024 * MEGABYTE;
+    wc.Update( 8, 4, load );
+    TEST_ASSERT( wc.GetJobMemoryEstimate() > (uint64_t)500 * MEGABYTE );
+    TEST_ASSERT( wc.GetJobMemoryEstimate() < (uint64_t)520 * MEGABYTE );
+
+    // another program takes 2 GiB while 2 jobs complete, so the machine
+    // is never idle for the baseline to be re-measured
+    load.m_AvailableMemory = (uint64_t)5 * 1024 * MEGABYTE;
+    wc.Update( 8, 2, load );
+    wc.Update( 8, 2, load );
+
+    // the other program's memory is not attributed to our jobs
+    TEST_ASSERT( wc.GetJobMemoryEstimate() > (uint64_t)500 * MEGABYTE );
+    TEST_ASSERT( wc.GetJobMemoryEstimate() < (uint64_t)520 * MEGABYTE );
+}
+
+// IO
+//------------------------------------------------------------------------------
+void TestWorkerCapacity::IO() const
+{
+    WorkerCapacity wc;
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = 8;
+
+    // no jobs are added while waiting on the disk
+    load.m_IOWait = 50.0f;
+    TEST_ASSERT( wc.Update( 8, 3, load ) == 3 );
+    TEST_ASSERT( strcmp( wc.GetThrottleReason(), "I/O" ) == 0 );
+
+    // but one job is always allowed
+    TEST_ASSERT( wc.Update( 8, 0, load ) == 1 );
+
+    // some I/O wait is fine
+    load.m_IOWait = 10.0f;
+    TEST_ASSERT( wc.Update( 8, 3, load ) == 8 );
+    TEST_ASSERT( wc.GetThrottleReason() == nullptr );
+}
+
+//------------------------------------------------------------------------------
@@ -28,7 +28,8 @@ FBuildWorkerOptions::FBuildWorkerOptions() :
     m_CPUAllocation( 0 ),
     m_OverrideWorkMode( false ),
     m_WorkMode( WorkerSettings::WHEN_IDLE ),
-    m_ConsoleMode( false )
+    m_ConsoleMode( false ),
+    m_BrokerageService( false )
 {
     #ifndef __WINDOWS__
         m_ConsoleMode = true; // TODO:OSX Support GUI mode
@@ -48,7 +49,12 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
     for ( const AString * it=tokens.Begin(); it != end; ++it )
     {
         const AString & token = *it;
-        if ( token == "-console" )
+        if ( token == "-brokerage" )
+        {
+            m_BrokerageService = true;
+            continue;
+        }
+        else if ( token == "-console" )
         {
             m_ConsoleMode = true;
             #if defined( __WINDOWS__ )
@@ -132,6 +138,8 @@ void FBuildWorkerOptions::ShowUsageError()
                        "\n"
                        "Command Line Options:\n"
                        "------------------------------------------------------------\n"
+                       "-brokerage : Host the worker brokerage service.\n"
+                       "\n"
                        "-cpus=[n|-n|n%] : Set number of CPUs to use.\n"
                        "                n : Explicit number.\n"
                        "                -n : NUMBER_OF_PROCESSORS-n.\n"
@@ -38,6 +38,9 @@ public:
     // Console mode
     bool m_ConsoleMode;
 
+    // Host the worker brokerage service
+    bool m_BrokerageService;
+
 private:
     void ShowUsageError();
 };
@@ -33,11 +33,13 @@
 IdleDetection::IdleDetection()
     : m_CPUUsageFASTBuild( 0.0f )
     , m_CPUUsageTotal( 0.0f )
+    , m_IOWait( 0.0f )
     , m_IsIdle( false )
     , m_IdleSmoother( 0 )
     , m_ProcessesInOurHierarchy( 32, true )
     , m_LastTimeIdle( 0 )
     , m_LastTimeBusy( 0 )
+    , m_LastTimeIOWait( 0 )
 {
     ProcessInfo self;
     self.m_PID = Process::GetCurrentId();
@@ -89,17 +91,23 @@ bool IdleDetection::IsIdleInternal()
         uint64_t idleTime = 0;
         uint64_t kernTime = 0;
         uint64_t userTime = 0;
-        GetSystemTotalCPUUsage( idleTime, kernTime, userTime );
+        uint64_t ioWaitTime = 0;
+        GetSystemTotalCPUUsage( idleTime, kernTime, userTime, ioWaitTime );
 
         if ( m_LastTimeBusy > 0 )
         {
             uint64_t idleTimeDelta = (idleTime - m_LastTimeIdle);
             uint64_t usedTimeDelta = ( ( userTime + kernTime ) - m_LastTimeBusy );
             systemTime = (idleTimeDelta + usedTimeDelta);
-            m_CPUUsageTotal = (float)((double)usedTimeDelta / (double)systemTime) * 100.0f;
+            if ( systemTime > 0 )
+            {
+                m_CPUUsageTotal = (float)((double)usedTimeDelta / (double)systemTime) * 100.0f;
+                m_IOWait = (float)((double)( ioWaitTime - m_LastTimeIOWait ) / (double)systemTime) * 100.0f;
+            }
         }
         m_LastTimeIdle = ( idleTime );
         m_LastTimeBusy = ( userTime + kernTime );
+        m_LastTimeIOWait = ( ioWaitTime );
     }
 
     // if the total CPU time is below the idle theshold, we don't need to
@@ -150,8 +158,10 @@ bool IdleDetection::IsIdleInternal()
 //------------------------------------------------------------------------------
 /*static*/ void IdleDetection::GetSystemTotalCPUUsage( uint64_t & outIdleTime,
                                                        uint64_t & outKernTime,
-                                                       uint64_t & outUserTime )
+                                                       uint64_t & outUserTime,
+                                                       uint64_t & outIOWaitTime )
 {
+    outIOWaitTime = 0; // only reported on Linux
     #if defined( __WINDOWS__ )
         FILETIME ftIdle, ftKern, ftUser;
         VERIFY(::GetSystemTimes(&ftIdle, &ftKern, &ftUser));
@@ -197,6 +207,11 @@ bool IdleDetection::IsIdleInternal()
                 }
                 outIdleTime -= outUserTime;
                 outIdleTime -= outKernTime;
+                // 4 = iowait time (included in idle)
+                if ( values.GetSize() > 4 )
+                {
+                    outIOWaitTime = values[ 4 ];
+                }
                 return;
             }
         }
@@ -26,6 +26,9 @@ public:
 
     // query status
     inline bool IsIdle() const { return m_IsIdle; }
+    inline float GetCPUUsageTotal() const { return m_CPUUsageTotal; }
+    inline float GetCPUUsageFASTBuild() const { return m_CPUUsageFASTBuild; }
+    inline float GetIOWait() const { return m_IOWait; }
 
 private:
     // struct to track processes with
@@ -45,7 +48,8 @@ private:
 
     static void GetSystemTotalCPUUsage( uint64_t & outIdleTime,
                                         uint64_t & outKernTime,
-                                        uint64_t & outUserTime );
+                                        uint64_t & outUserTime,
+                                        uint64_t & outIOWaitTime );
     static void GetProcessTime( const ProcessInfo & pi,
                                 uint64_t & outKernTime,
                                 uint64_t & outUserTime );
@@ -58,11 +62,13 @@ private:
     Timer   m_Timer;
     float   m_CPUUsageFASTBuild;
     float   m_CPUUsageTotal;
+    float   m_IOWait;           // % of cpu time spent waiting for I/O
     bool    m_IsIdle;
     int32_t m_IdleSmoother;
     Array< ProcessInfo > m_ProcessesInOurHierarchy;
     uint64_t m_LastTimeIdle;
     uint64_t m_LastTimeBusy;
+    uint64_t m_LastTimeIOWait;
 };
 
 //------------------------------------------------------------------------------
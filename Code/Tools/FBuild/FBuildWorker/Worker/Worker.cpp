@@ -16,6 +16,7 @@
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageServer.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
@@ -29,23 +30,29 @@
 
 // system
 #include <stdio.h>
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    #include <sys/statvfs.h>
+#endif
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Worker::Worker( void * hInstance, const AString & args, bool consoleMode )
+Worker::Worker( void * hInstance, const AString & args, bool consoleMode, bool brokerageService )
     : m_MainWindow( nullptr )
     , m_ConnectionPool( nullptr )
+    , m_BrokerageServer( nullptr )
     , m_NetworkStartupHelper( nullptr )
     , m_BaseArgs( args )
     , m_LastWriteTime( 0 )
     , m_RestartNeeded( false )
-    #if defined( __WINDOWS__ )
-        , m_LastDiskSpaceResult( -1 )
-    #endif
+    , m_LastDiskSpaceResult( -1 )
 {
     m_WorkerSettings = FNEW( WorkerSettings );
     m_NetworkStartupHelper = FNEW( NetworkStartupHelper );
     m_ConnectionPool = FNEW( Server );
+    if ( brokerageService )
+    {
+        m_BrokerageServer = FNEW( BrokerageServer );
+    }
     if ( consoleMode == true )
     {
         #if __WINDOWS__
@@ -73,6 +80,7 @@ Worker::Worker( void * hInstance, const AString & args, bool consoleMode )
 Worker::~Worker()
 {
     FDELETE m_NetworkStartupHelper;
+    FDELETE m_BrokerageServer;
     FDELETE m_ConnectionPool;
     FDELETE m_MainWindow;
     FDELETE m_WorkerSettings;
@@ -116,6 +124,17 @@ int Worker::Work()
         return -1;
     }
 
+    // optionally host the brokerage service for other workers and clients
+    if ( m_BrokerageServer )
+    {
+        StatusMessage( "Brokerage service listening on port %u\n", Protocol::BROKERAGE_PORT );
+        if ( m_BrokerageServer->Listen( Protocol::BROKERAGE_PORT ) == false )
+        {
+            ErrorMessage( "Failed to listen on port %u.  Check port is not in use.", Protocol::BROKERAGE_PORT );
+            return -1;
+        }
+    }
+
     // Special folder for Orbis Clang
     // We just create this folder whether it's needed or not
     {
@@ -181,37 +200,40 @@ int Worker::Work()
 //------------------------------------------------------------------------------
 bool Worker::HasEnoughDiskSpace()
 {
-    #if defined( __WINDOWS__ )
-        // Only check disk space every few seconds
-        float elapsedTime = m_TimerLastDiskSpaceCheck.GetElapsedMS();
-        if ( ( elapsedTime < 15000.0f ) && ( m_LastDiskSpaceResult != -1 ) )
-        {
-            return ( m_LastDiskSpaceResult != 0 );
-        }
-        m_TimerLastDiskSpaceCheck.Start();
+    // Only check disk space every few seconds
+    float elapsedTime = m_TimerLastDiskSpaceCheck.GetElapsedMS();
+    if ( ( elapsedTime < 15000.0f ) && ( m_LastDiskSpaceResult != -1 ) )
+    {
+        return ( m_LastDiskSpaceResult != 0 );
+    }
+    m_TimerLastDiskSpaceCheck.Start();
 
-        static const uint64_t MIN_DISK_SPACE = 1024 * 1024 * 1024; // 1 GiB
+    static const uint64_t MIN_DISK_SPACE = 1024 * 1024 * 1024; // 1 GiB
 
+    // Check available disk space of temp path
+    AStackString<> tmpPath;
+    VERIFY( FBuild::GetTempDir( tmpPath ) );
+
+    #if defined( __WINDOWS__ )
         unsigned __int64 freeBytesAvailable = 0;
         unsigned __int64 totalNumberOfBytes = 0;
         unsigned __int64 totalNumberOfFreeBytes = 0;
 
-        // Check available disk space of temp path
-        AStackString<> tmpPath;
-        VERIFY( FBuild::GetTempDir( tmpPath ) );
         BOOL result = GetDiskFreeSpaceExA( tmpPath.Get(), (PULARGE_INTEGER)&freeBytesAvailable, (PULARGE_INTEGER)&totalNumberOfBytes, (PULARGE_INTEGER)&totalNumberOfFreeBytes );
-        if ( result && ( freeBytesAvailable >= MIN_DISK_SPACE ) )
-        {
-            m_LastDiskSpaceResult = 1;
-            return true;
-        }
-
-        // The drive doesn't have enough free space or could not be queried. Exclude this machine from worker pool.
-        m_LastDiskSpaceResult = 0;
-        return false;
     #else
-        return true; // TODO:MAC TODO:LINUX Implement disk space checks
+        struct statvfs stats;
+        const bool result = ( statvfs( tmpPath.Get(), &stats ) == 0 );
+        const uint64_t freeBytesAvailable = result ? ( (uint64_t)stats.f_bavail * (uint64_t)stats.f_frsize ) : 0;
     #endif
+    if ( result && ( freeBytesAvailable >= MIN_DISK_SPACE ) )
+    {
+        m_LastDiskSpaceResult = 1;
+        return true;
+    }
+
+    // The drive doesn't have enough free space or could not be queried. Exclude this machine from worker pool.
+    m_LastDiskSpaceResult = 0;
+    return false;
 }
 
 // UpdateAvailability
@@ -252,7 +274,24 @@ void Worker::UpdateAvailability()
         numCPUsToUse = 0;
     }
 
-    WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
+    // limit work to what the machine can currently handle
+    const uint32_t numActiveJobs = (uint32_t)JobQueueRemote::Get().GetNumActiveJobs();
+    WorkerCapacity::MachineLoad load;
+    load.m_NumProcessors = Env::GetNumProcessors();
+    load.m_CPUUsageTotal = m_IdleDetection.GetCPUUsageTotal();
+    load.m_CPUUsageFASTBuild = m_IdleDetection.GetCPUUsageFASTBuild();
+    load.m_IOWait = m_IdleDetection.GetIOWait();
+    load.m_HasMemoryInfo = Env::GetMemoryInfo( load.m_TotalMemory, load.m_AvailableMemory );
+    const uint32_t capacity = m_WorkerCapacity.Update( numCPUsToUse, numActiveJobs, load );
+
+    WorkerThreadRemote::SetNumCPUsToUse( capacity );
+    WorkerThreadRemote::SetThrottled( capacity < numCPUsToUse );
+
+    // details advertised to clients through the brokerage service
+    const uint32_t numFreeCPUs = ( numActiveJobs < capacity ) ? ( capacity - numActiveJobs ) : 0;
+    Array< uint64_t > toolIds( 8, true );
+    m_ConnectionPool->GetSynchronizedToolIds( toolIds );
+    m_WorkerBrokerage.SetWorkerInfo( numCPUsToUse, numFreeCPUs, (uint32_t)m_IdleDetection.GetCPUUsageTotal(), toolIds );
 
     m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0);
 }
@@ -275,12 +314,14 @@ void Worker::UpdateUI()
     {
         status += " (Restart Pending)";
     }
-    #if defined( __WINDOWS__ )
-        if ( m_LastDiskSpaceResult == 0 )
-        {
-            status += " (Low Disk Space)";
-        }
-    #endif
+    if ( m_LastDiskSpaceResult == 0 )
+    {
+        status += " (Low Disk Space)";
+    }
+    else if ( m_WorkerCapacity.GetThrottleReason() )
+    {
+        status.AppendFormat( " (Throttled: %s)", m_WorkerCapacity.GetThrottleReason() );
+    }
     if ( InConsoleMode() )
     {
         status += '\n';
@@ -8,12 +8,14 @@
 
 // FBuild
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerCapacity.h"
 
 // Core
 #include "Core/FileIO/FileStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class BrokerageServer;
 class Server;
 class WorkerWindow;
 class JobQueueRemote;
@@ -25,7 +27,7 @@ class WorkerSettings;
 class Worker
 {
 public:
-    explicit Worker( void * hInstance, const AString & args, bool consoleMode );
+    explicit Worker( void * hInstance, const AString & args, bool consoleMode, bool brokerageService );
     ~Worker();
 
     int Work();
@@ -43,6 +45,7 @@ private:
 
     WorkerWindow        * m_MainWindow;
     Server              * m_ConnectionPool;
+    BrokerageServer     * m_BrokerageServer;
     NetworkStartupHelper * m_NetworkStartupHelper;
     WorkerSettings      * m_WorkerSettings;
     IdleDetection       m_IdleDetection;
@@ -53,10 +56,9 @@ private:
     bool                m_RestartNeeded;
     Timer               m_UIUpdateTimer;
     FileStream          m_TargetIncludeFolderLock;
-    #if defined( __WINDOWS__ )
-        Timer               m_TimerLastDiskSpaceCheck;
-        int32_t             m_LastDiskSpaceResult;      // -1 : No check done yet. 0=Not enough space right now. 1=OK for now.
-    #endif
+    Timer               m_TimerLastDiskSpaceCheck;
+    int32_t             m_LastDiskSpaceResult;      // -1 : No check done yet. 0=Not enough space right now. 1=OK for now.
+    WorkerCapacity      m_WorkerCapacity;
     mutable AString     m_LastStatusMessage;
 };
 